@@ -0,0 +1,109 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// AtomicSharedPtr<T> holds a std::shared_ptr<T> that can be loaded and replaced
+// concurrently. It is used to publish immutable snapshots (read-copy-update):
+// readers load the current snapshot and use it without any lock, and writers
+// build a new object and store it. The old object is destroyed when the last
+// reader releases it.
+//
+// Uses std::atomic<std::shared_ptr<T>> where available (C++20). Otherwise the
+// pointer is guarded by a reader-writer mutex, as the atomic free functions for
+// std::shared_ptr are deprecated in C++20. Readers share the lock, and the
+// critical sections only copy or swap the pointer; the old snapshot is released
+// outside of the lock.
+//
+// Loading still costs a reference count update, so readers checking many items
+// should load the snapshot once and keep it for the whole operation.
+
+#ifndef MOZC_BASE_ATOMIC_SHARED_PTR_H_
+#define MOZC_BASE_ATOMIC_SHARED_PTR_H_
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#ifndef __cpp_lib_atomic_shared_ptr
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#endif  // __cpp_lib_atomic_shared_ptr
+
+namespace mozc {
+
+template <typename T>
+class AtomicSharedPtr {
+ public:
+  AtomicSharedPtr() = default;
+  explicit AtomicSharedPtr(std::shared_ptr<T> ptr) : ptr_(std::move(ptr)) {}
+
+  AtomicSharedPtr(const AtomicSharedPtr &) = delete;
+  AtomicSharedPtr &operator=(const AtomicSharedPtr &) = delete;
+
+  // Returns the current snapshot.
+  std::shared_ptr<T> load() const {
+#ifdef __cpp_lib_atomic_shared_ptr
+    return ptr_.load(std::memory_order_acquire);
+#else   // __cpp_lib_atomic_shared_ptr
+    absl::ReaderMutexLock lock(&mutex_);
+    return ptr_;
+#endif  // __cpp_lib_atomic_shared_ptr
+  }
+
+  // Publishes `ptr` as the new snapshot.
+  void store(std::shared_ptr<T> ptr) {
+#ifdef __cpp_lib_atomic_shared_ptr
+    ptr_.store(std::move(ptr), std::memory_order_release);
+#else   // __cpp_lib_atomic_shared_ptr
+    exchange(std::move(ptr));
+#endif  // __cpp_lib_atomic_shared_ptr
+  }
+
+  // Publishes `ptr` and returns the previous snapshot.
+  std::shared_ptr<T> exchange(std::shared_ptr<T> ptr) {
+#ifdef __cpp_lib_atomic_shared_ptr
+    return ptr_.exchange(std::move(ptr), std::memory_order_acq_rel);
+#else   // __cpp_lib_atomic_shared_ptr
+    absl::MutexLock lock(&mutex_);
+    ptr_.swap(ptr);
+    return ptr;
+#endif  // __cpp_lib_atomic_shared_ptr
+  }
+
+ private:
+#ifdef __cpp_lib_atomic_shared_ptr
+  std::atomic<std::shared_ptr<T>> ptr_;
+#else   // __cpp_lib_atomic_shared_ptr
+  mutable absl::Mutex mutex_;
+  std::shared_ptr<T> ptr_ ABSL_GUARDED_BY(mutex_);
+#endif  // __cpp_lib_atomic_shared_ptr
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_ATOMIC_SHARED_PTR_H_
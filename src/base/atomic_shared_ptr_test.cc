@@ -0,0 +1,85 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/atomic_shared_ptr.h"
+
+#include <memory>
+#include <vector>
+
+#include "base/thread.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(AtomicSharedPtrTest, LoadStore) {
+  AtomicSharedPtr<const int> ptr;
+  EXPECT_EQ(ptr.load(), nullptr);
+
+  ptr.store(std::make_shared<const int>(1));
+  std::shared_ptr<const int> snapshot = ptr.load();
+  ASSERT_NE(snapshot, nullptr);
+  EXPECT_EQ(*snapshot, 1);
+
+  // The old snapshot is kept alive while it is referenced.
+  std::shared_ptr<const int> old = ptr.exchange(std::make_shared<const int>(2));
+  EXPECT_EQ(old, snapshot);
+  EXPECT_EQ(*snapshot, 1);
+  EXPECT_EQ(*ptr.load(), 2);
+}
+
+TEST(AtomicSharedPtrTest, ConcurrentReaders) {
+  constexpr int kNumReaders = 4;
+  constexpr int kNumUpdates = 1000;
+  AtomicSharedPtr<const std::vector<int>> ptr(
+      std::make_shared<const std::vector<int>>(10, 0));
+
+  std::vector<Thread> readers;
+  for (int i = 0; i < kNumReaders; ++i) {
+    readers.emplace_back([&ptr] {
+      for (int j = 0; j < kNumUpdates; ++j) {
+        // Every snapshot is internally consistent.
+        const std::shared_ptr<const std::vector<int>> snapshot = ptr.load();
+        for (const int value : *snapshot) {
+          EXPECT_EQ(value, snapshot->front());
+        }
+      }
+    });
+  }
+  for (int i = 1; i <= kNumUpdates; ++i) {
+    ptr.store(std::make_shared<const std::vector<int>>(10, i));
+  }
+  for (Thread &reader : readers) {
+    reader.Join();
+  }
+  EXPECT_EQ(ptr.load()->front(), kNumUpdates);
+}
+
+}  // namespace
+}  // namespace mozc
@@ -44,6 +44,7 @@
         'process_mutex.cc',
         'run_level.cc',
         'stopwatch.cc',
+        'trace.cc',
       ],
       'dependencies': [
         'base_core',
@@ -174,6 +175,9 @@
         'strings/internal/double_array.cc',
         'strings/internal/japanese_rules.cc',
       ],
+      'dependencies': [
+        'base_core',
+      ],
     },
     {
       'target_name': 'number_util',
@@ -59,6 +59,7 @@
         'cpu_stats_test.cc',
         'process_mutex_test.cc',
         'stopwatch_test.cc',
+        'trace_test.cc',
       ],
       'conditions': [
         ['OS=="mac"', {
@@ -29,13 +29,20 @@
 
 #include "base/strings/internal/double_array.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/strings/internal/utf8_internal.h"
 #include "base/strings/unicode.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc::japanese::internal {
 namespace {
@@ -83,6 +90,83 @@ inline int AdvanceInputBy(const char *ctable, const LookupResult result,
   return result.seekto - ctable[result.index + len + 1];
 }
 
+// Converts the longest prefix of `input` matching a rule, appends the result to
+// `output` and returns the number of consumed bytes.
+int ConvertPrefixUsingDoubleArray(const DoubleArray *da, const char *ctable,
+                                  const absl::string_view input,
+                                  std::string *output) {
+  const LookupResult result = LookupDoubleArray(da, input);
+  if (result.seekto > 0) {
+    // Each entry in ctable consists of:
+    // - null-terminated string
+    // - one byte offset to rewind the input
+    const absl::string_view s(ctable + result.index);
+    absl::StrAppend(output, s);
+    return AdvanceInputBy(ctable, result, s.size());
+  }
+  // Not found in the table. Copy from input.
+  const int mblen = OneCharLen(input[0]);
+  absl::StrAppend(output, input.substr(0, mblen));
+  return mblen;
+}
+
+// Returns the first non-ASCII position in [begin, end). Tests eight bytes at
+// once while the remaining input is long enough.
+const char *SkipAscii(const char *begin, const char *const end) {
+  constexpr uint64_t kHighBits = 0x8080808080808080;
+  constexpr ptrdiff_t kWordSize = sizeof(uint64_t);
+  while (end - begin >= kWordSize) {
+    uint64_t word;
+    std::memcpy(&word, begin, kWordSize);
+    if (word & kHighBits) {
+      break;
+    }
+    begin += kWordSize;
+  }
+  while (begin != end && static_cast<uint8_t>(*begin) < 0x80) {
+    ++begin;
+  }
+  return begin;
+}
+
+// Decodes an ASCII or a three-byte character at the beginning of [ptr, end).
+// Returns the byte length, or 0 for other characters and ill-formed input,
+// which are left to the double array.
+inline int DecodeOneOrThreeBytes(const char *ptr, const char *const end,
+                                 char32_t *cp) {
+  const uint8_t c0 = static_cast<uint8_t>(ptr[0]);
+  if (c0 < 0x80) {
+    *cp = c0;
+    return 1;
+  }
+  if ((c0 & 0xf0) != 0xe0 || end - ptr < 3) {
+    return 0;
+  }
+  const uint8_t c1 = static_cast<uint8_t>(ptr[1]);
+  const uint8_t c2 = static_cast<uint8_t>(ptr[2]);
+  if ((c1 & 0xc0) != 0x80 || (c2 & 0xc0) != 0x80) {
+    return 0;
+  }
+  *cp = ((c0 & 0x0f) << 12) | ((c1 & 0x3f) << 6) | (c2 & 0x3f);
+  // Rejects overlong forms.
+  return *cp < 0x800 ? 0 : 3;
+}
+
+// Writes `cp` in UTF-8 to `dest` and returns the end of the written bytes.
+inline char *WriteCodePoint(const char32_t cp, char *dest) {
+  if (cp < 0x80) {
+    *dest++ = static_cast<char>(cp);
+  } else if (cp >= 0x800 && cp < 0x10000) {
+    *dest++ = static_cast<char>(0xe0 | (cp >> 12));
+    *dest++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    *dest++ = static_cast<char>(0x80 | (cp & 0x3f));
+  } else {
+    const utf8_internal::EncodeResult encoded = utf8_internal::Encode(cp);
+    dest = std::copy_n(encoded.data(), encoded.size(), dest);
+  }
+  return dest;
+}
+
 }  // namespace
 
 std::string ConvertUsingDoubleArray(const DoubleArray *da, const char *ctable,
@@ -90,20 +174,61 @@ std::string ConvertUsingDoubleArray(const DoubleArray *da, const char *ctable,
   int mblen = 0;
   std::string output;
   for (size_t i = 0; i < input.size(); i += mblen) {
-    const LookupResult result = LookupDoubleArray(da, input.substr(i));
-    if (result.seekto > 0) {
-      // Each entry in ctable consists of:
-      // - null-terminated string
-      // - one byte offset to rewind the input
-      const absl::string_view s(ctable + result.index);
-      absl::StrAppend(&output, s);
-      mblen = AdvanceInputBy(ctable, result, s.size());
-    } else {
-      // Not found in the table. Copy from input.
-      mblen = OneCharLen(input[i]);
-      absl::StrAppend(&output, input.substr(i, mblen));
+    mblen = ConvertPrefixUsingDoubleArray(da, ctable, input.substr(i), &output);
+  }
+  return output;
+}
+
+std::string ConvertUsingCodePointOffsets(
+    const absl::Span<const CodePointOffset> offsets,
+    const bool ascii_passthrough, const DoubleArray *da, const char *ctable,
+    const absl::string_view input) {
+  std::string output;
+  output.reserve(input.size());
+  // Converted characters are written to `buffer` first, so `output` grows by
+  // chunks instead of by bytes.
+  char buffer[256];
+  char *buffer_end = buffer;
+  const auto flush = [&output, &buffer, &buffer_end]() {
+    output.append(buffer, buffer_end - buffer);
+    buffer_end = buffer;
+  };
+  const char *ptr = input.data();
+  const char *const end = ptr + input.size();
+  while (ptr != end) {
+    if (ascii_passthrough && static_cast<uint8_t>(*ptr) < 0x80) {
+      const char *ascii_end = SkipAscii(ptr, end);
+      flush();
+      output.append(ptr, ascii_end - ptr);
+      ptr = ascii_end;
+      continue;
+    }
+    char32_t cp = 0;
+    const int len = DecodeOneOrThreeBytes(ptr, end, &cp);
+    const CodePointOffset *range = nullptr;
+    if (len > 0) {
+      for (const CodePointOffset &r : offsets) {
+        if (r.first <= cp && cp <= r.last) {
+          range = &r;
+          break;
+        }
+      }
+    }
+    if (range != nullptr) {
+      if (buffer_end + utf8_internal::kMaxByteSize > std::end(buffer)) {
+        flush();
+      }
+      buffer_end = WriteCodePoint(cp + range->offset, buffer_end);
+      ptr += len;
+      continue;
     }
+    flush();
+    const absl::string_view rest(ptr, end - ptr);
+    // The length of a truncated character can exceed the rest.
+    ptr += std::min<size_t>(
+        ConvertPrefixUsingDoubleArray(da, ctable, rest, &output), rest.size());
   }
+  flush();
   return output;
 }
 
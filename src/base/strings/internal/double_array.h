@@ -36,6 +36,7 @@
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc::japanese::internal {
 
@@ -47,6 +48,25 @@ struct DoubleArray {
 std::string ConvertUsingDoubleArray(const DoubleArray *da, const char *table,
                                     absl::string_view input);
 
+// A run of code points [first, last] that a rule maps to
+// [first + offset, last + offset].
+struct CodePointOffset {
+  char32_t first;
+  char32_t last;
+  int32_t offset;
+};
+
+// Same as ConvertUsingDoubleArray(), but the characters covered by `offsets`
+// are converted by code point arithmetic without walking the double array.
+// If `ascii_passthrough` is true, runs of ASCII characters are copied as is,
+// eight bytes at a time. Other characters are converted with the double array.
+// REQUIRES: `offsets` agree with `da`, and `da` has no multi-character rule
+// starting with a character in `offsets` (or with an ASCII character if
+// `ascii_passthrough` is true).
+std::string ConvertUsingCodePointOffsets(
+    absl::Span<const CodePointOffset> offsets, bool ascii_passthrough,
+    const DoubleArray *da, const char *table, absl::string_view input);
+
 std::vector<std::pair<absl::string_view, absl::string_view>>
 AlignUsingDoubleArray(const DoubleArray *da, const char *ctable,
                       absl::string_view input);
@@ -0,0 +1,137 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Microbenchmark of the code point offset fast paths against the double array
+// conversions in base/strings/japanese.cc.
+//
+// Usage:
+//   japanese_rules_benchmark_main --iterations=100000 --length=32
+
+#include <cstdint>
+#include <iostream>
+#include <ostream>
+#include <string>
+
+#include "base/init_mozc.h"
+#include "base/stopwatch.h"
+#include "base/strings/internal/double_array.h"
+#include "base/strings/internal/japanese_rules.h"
+#include "base/strings/japanese.h"
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(int32_t, iterations, 100000, "number of conversions per case");
+ABSL_FLAG(int32_t, length, 32, "number of characters of each input");
+
+namespace mozc::japanese::internal {
+namespace {
+
+std::string Repeat(const absl::string_view unit, const int length) {
+  std::string result;
+  for (int i = 0; i < length; ++i) {
+    absl::StrAppend(&result, unit);
+  }
+  return result;
+}
+
+template <typename Function>
+absl::Duration Measure(Function f, const absl::string_view input) {
+  const int iterations = absl::GetFlag(FLAGS_iterations);
+  size_t total_size = 0;
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (int i = 0; i < iterations; ++i) {
+    total_size += f(input).size();
+  }
+  stopwatch.Stop();
+  // Prevents the loop from being optimized away.
+  if (total_size == 0) {
+    std::cout << "";
+  }
+  return stopwatch.GetElapsed() / iterations;
+}
+
+void Run(const absl::string_view name,
+         std::string (*fast_path)(absl::string_view), const DoubleArray *da,
+         const char *table, const absl::string_view input) {
+  const absl::Duration fast = Measure(fast_path, input);
+  const absl::Duration slow = Measure(
+      [da, table](absl::string_view s) {
+        return ConvertUsingDoubleArray(da, table, s);
+      },
+      input);
+  std::cout << absl::StrFormat(
+                   "%-32s double_array: %8.1f ns  offsets: %8.1f ns  x%.1f",
+                   name, absl::ToDoubleNanoseconds(slow),
+                   absl::ToDoubleNanoseconds(fast),
+                   absl::FDivDuration(slow, fast))
+            << std::endl;
+}
+
+}  // namespace
+}  // namespace mozc::japanese::internal
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+
+  namespace ja = ::mozc::japanese;
+  namespace internal = ::mozc::japanese::internal;
+  const int length = absl::GetFlag(FLAGS_length);
+  const std::string hiragana = internal::Repeat("あ", length);
+  const std::string katakana = internal::Repeat("ア", length);
+  const std::string halfwidth = internal::Repeat("a", length);
+  const std::string fullwidth = internal::Repeat("ａ", length);
+  const std::string mixed = internal::Repeat("かabＢア", length / 4);
+
+  internal::Run("HiraganaToKatakana", ja::HiraganaToKatakana,
+                internal::hiragana_to_katakana_da,
+                internal::hiragana_to_katakana_table, hiragana);
+  internal::Run("HiraganaToKatakana (mixed)", ja::HiraganaToKatakana,
+                internal::hiragana_to_katakana_da,
+                internal::hiragana_to_katakana_table, mixed);
+  internal::Run("KatakanaToHiragana", ja::KatakanaToHiragana,
+                internal::katakana_to_hiragana_da,
+                internal::katakana_to_hiragana_table, katakana);
+  internal::Run("HalfWidthAsciiToFullWidthAscii",
+                ja::HalfWidthAsciiToFullWidthAscii,
+                internal::halfwidthascii_to_fullwidthascii_da,
+                internal::halfwidthascii_to_fullwidthascii_table, halfwidth);
+  internal::Run("FullWidthAsciiToHalfWidthAscii",
+                ja::FullWidthAsciiToHalfWidthAscii,
+                internal::fullwidthascii_to_halfwidthascii_da,
+                internal::fullwidthascii_to_halfwidthascii_table, fullwidth);
+  internal::Run("FullWidthAsciiToHalfWidthAscii (ascii)",
+                ja::FullWidthAsciiToHalfWidthAscii,
+                internal::fullwidthascii_to_halfwidthascii_da,
+                internal::fullwidthascii_to_halfwidthascii_table, halfwidth);
+  return 0;
+}
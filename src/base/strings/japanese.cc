@@ -38,16 +38,54 @@
 #include "absl/strings/string_view.h"
 
 namespace mozc::japanese {
+namespace {
 
+using ::mozc::japanese::internal::CodePointOffset;
+using ::mozc::japanese::internal::ConvertUsingCodePointOffsets;
 using ::mozc::japanese::internal::ConvertUsingDoubleArray;
 
+// Regular parts of the rules, which are converted without the double array.
+// Characters outside of these ranges still go through the double array, e.g.
+// "う" because of the rule "う゛" -> "ヴ", and the irregular symbols such as
+// "-" -> "−" and "~" -> "〜".
+// These ranges must be kept in sync with data/preedit/*.tsv, which
+// japanese_test verifies for all characters in BMP.
+constexpr CodePointOffset kHiraganaToKatakanaOffsets[] = {
+    {0x3041, 0x3045, 0x60},  // ぁ-ぅ
+    {0x3047, 0x3094, 0x60},  // ぇ-ゔ
+};
+
+constexpr CodePointOffset kKatakanaToHiraganaOffsets[] = {
+    {0x30A1, 0x30F4, -0x60},  // ァ-ヴ
+};
+
+constexpr CodePointOffset kHalfWidthAsciiToFullWidthAsciiOffsets[] = {
+    {0x21, 0x21, 0xFEE0},  // !
+    {0x23, 0x26, 0xFEE0},  // #-&
+    {0x28, 0x2C, 0xFEE0},  // (-,
+    {0x2E, 0x5B, 0xFEE0},  // .-[
+    {0x5D, 0x7D, 0xFEE0},  // ]-}
+};
+
+constexpr CodePointOffset kFullWidthAsciiToHalfWidthAsciiOffsets[] = {
+    {0xFF01, 0xFF01, -0xFEE0},  // ！
+    {0xFF03, 0xFF06, -0xFEE0},  // ＃-＆
+    {0xFF08, 0xFF0C, -0xFEE0},  // （-，
+    {0xFF0E, 0xFF3B, -0xFEE0},  // ．-［
+    {0xFF3D, 0xFF5D, -0xFEE0},  // ］-｝
+};
+
+}  // namespace
+
 void HiraganaToKatakana(absl::string_view input, std::string *output) {
   *output = HiraganaToKatakana(input);
 }
 
 std::string HiraganaToKatakana(const absl::string_view input) {
-  return ConvertUsingDoubleArray(internal::hiragana_to_katakana_da,
-                                 internal::hiragana_to_katakana_table, input);
+  return ConvertUsingCodePointOffsets(
+      kHiraganaToKatakanaOffsets, /*ascii_passthrough=*/true,
+      internal::hiragana_to_katakana_da, internal::hiragana_to_katakana_table,
+      input);
 }
 
 void HiraganaToHalfwidthKatakana(absl::string_view input, std::string *output) {
@@ -74,7 +112,8 @@ void HalfWidthAsciiToFullWidthAscii(absl::string_view input,
 }
 
 std::string HalfWidthAsciiToFullWidthAscii(const absl::string_view input) {
-  return ConvertUsingDoubleArray(
+  return ConvertUsingCodePointOffsets(
+      kHalfWidthAsciiToFullWidthAsciiOffsets, /*ascii_passthrough=*/false,
       internal::halfwidthascii_to_fullwidthascii_da,
       internal::halfwidthascii_to_fullwidthascii_table, input);
 }
@@ -85,7 +124,8 @@ void FullWidthAsciiToHalfWidthAscii(absl::string_view input,
 }
 
 std::string FullWidthAsciiToHalfWidthAscii(const absl::string_view input) {
-  return ConvertUsingDoubleArray(
+  return ConvertUsingCodePointOffsets(
+      kFullWidthAsciiToHalfWidthAsciiOffsets, /*ascii_passthrough=*/true,
       internal::fullwidthascii_to_halfwidthascii_da,
       internal::fullwidthascii_to_halfwidthascii_table, input);
 }
@@ -112,8 +152,10 @@ void KatakanaToHiragana(absl::string_view input, std::string *output) {
 }
 
 std::string KatakanaToHiragana(absl::string_view input) {
-  return ConvertUsingDoubleArray(internal::katakana_to_hiragana_da,
-                                 internal::katakana_to_hiragana_table, input);
+  return ConvertUsingCodePointOffsets(
+      kKatakanaToHiraganaOffsets, /*ascii_passthrough=*/true,
+      internal::katakana_to_hiragana_da, internal::katakana_to_hiragana_table,
+      input);
 }
 
 void HalfWidthKatakanaToFullWidthKatakana(absl::string_view input,
@@ -34,7 +34,12 @@
 #include <utility>
 #include <vector>
 
+#include "base/strings/internal/double_array.h"
+#include "base/strings/internal/japanese_rules.h"
+#include "base/strings/internal/utf8_internal.h"
 #include "testing/gunit.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc::japanese {
 namespace {
@@ -215,5 +220,52 @@ TEST(JapaneseUtilTest, AlignTest) {
             AlignRomanjiToHiragana("resipinokalzenn"));
 }
 
+TEST(JapaneseUtilTest, CodePointOffsetsMatchDoubleArray) {
+  using ::mozc::japanese::internal::ConvertUsingDoubleArray;
+  struct Rule {
+    std::string (*convert)(absl::string_view);
+    const internal::DoubleArray *da;
+    const char *table;
+  };
+  const Rule kRules[] = {
+      {HiraganaToKatakana, internal::hiragana_to_katakana_da,
+       internal::hiragana_to_katakana_table},
+      {KatakanaToHiragana, internal::katakana_to_hiragana_da,
+       internal::katakana_to_hiragana_table},
+      {HalfWidthAsciiToFullWidthAscii,
+       internal::halfwidthascii_to_fullwidthascii_da,
+       internal::halfwidthascii_to_fullwidthascii_table},
+      {FullWidthAsciiToHalfWidthAscii,
+       internal::fullwidthascii_to_halfwidthascii_da,
+       internal::fullwidthascii_to_halfwidthascii_table},
+  };
+  // The fast paths must produce the same results as the double arrays for
+  // every character in BMP, alone and surrounded by other characters.
+  for (const Rule &rule : kRules) {
+    for (char32_t cp = 0; cp < 0x10000; ++cp) {
+      if (cp >= 0xD800 && cp <= 0xDFFF) {
+        continue;
+      }
+      const utf8_internal::EncodeResult encoded = utf8_internal::Encode(cp);
+      const absl::string_view ch(encoded.data(), encoded.size());
+      for (const std::string &input :
+           {std::string(ch), absl::StrCat("abcdefgh", ch, "う゛"),
+            absl::StrCat("あ", ch, ch, "Ａ1")}) {
+        EXPECT_EQ(rule.convert(input),
+                  ConvertUsingDoubleArray(rule.da, rule.table, input))
+            << absl::StrCat("U+", absl::Hex(cp));
+      }
+    }
+  }
+  // Ill-formed UTF-8 sequences are left to the double array.
+  for (const absl::string_view input :
+       {"\xE3\x81", "\xE3\x81\x41", "\xC0\xA1", "\xE0\x80\xA1", "\xFF"}) {
+    for (const Rule &rule : kRules) {
+      EXPECT_EQ(rule.convert(input),
+                ConvertUsingDoubleArray(rule.da, rule.table, input));
+    }
+  }
+}
+
 }  // namespace
 }  // namespace mozc::japanese
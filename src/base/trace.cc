@@ -0,0 +1,257 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/trace.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else  // _WIN32
+#include <unistd.h>
+#endif  // _WIN32
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+
+namespace mozc {
+namespace {
+
+// About 100 key events with a dozen of spans each.
+constexpr size_t kMaxSpansPerThread = 2048;
+
+ABSL_CONST_INIT std::atomic<bool> g_enabled = false;
+
+int64_t GetCurrentTimeMicros() { return absl::GetCurrentTimeNanos() / 1000; }
+
+int64_t GetProcessId() {
+#ifdef _WIN32
+  return ::GetCurrentProcessId();
+#else   // _WIN32
+  return ::getpid();
+#endif  // _WIN32
+}
+
+// Ring buffer of the spans recorded by one thread. Only the owner thread
+// writes to it while other threads may read it concurrently. Each slot is
+// guarded by a sequence number as a seqlock: it is odd while the slot is being
+// written and 2 * (index + 1) after the |index|-th span is written.
+class SpanBuffer {
+ public:
+  explicit SpanBuffer(int64_t tid) : tid_(tid) {}
+
+  SpanBuffer(const SpanBuffer &) = delete;
+  SpanBuffer &operator=(const SpanBuffer &) = delete;
+
+  void Add(const char *name, int64_t begin_us, int64_t duration_us,
+           int64_t index) {
+    const uint64_t position = size_.load(std::memory_order_relaxed);
+    Slot &slot = slots_[position % kMaxSpansPerThread];
+    slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.begin_us.store(begin_us, std::memory_order_relaxed);
+    slot.duration_us.store(duration_us, std::memory_order_relaxed);
+    slot.index.store(index, std::memory_order_relaxed);
+    slot.sequence.store(2 * (position + 1), std::memory_order_release);
+    size_.store(position + 1, std::memory_order_release);
+  }
+
+  // Hides the spans recorded so far from AppendChromeTraceEvents().
+  void Clear() {
+    cleared_size_.store(size_.load(std::memory_order_acquire),
+                        std::memory_order_relaxed);
+  }
+
+  void AppendChromeTraceEvents(int64_t pid, std::string *json) const {
+    const uint64_t size = size_.load(std::memory_order_acquire);
+    uint64_t position = cleared_size_.load(std::memory_order_relaxed);
+    if (size - position > kMaxSpansPerThread) {
+      position = size - kMaxSpansPerThread;
+    }
+    for (; position < size; ++position) {
+      const Slot &slot = slots_[position % kMaxSpansPerThread];
+      const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+      const char *name = slot.name.load(std::memory_order_relaxed);
+      const int64_t begin_us = slot.begin_us.load(std::memory_order_relaxed);
+      const int64_t duration_us =
+          slot.duration_us.load(std::memory_order_relaxed);
+      const int64_t index = slot.index.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence != 2 * (position + 1) ||
+          slot.sequence.load(std::memory_order_relaxed) != sequence) {
+        // Overwritten by the owner thread.
+        continue;
+      }
+      if (json->back() != '[') {
+        json->append(",");
+      }
+      absl::StrAppend(json, "\n{\"name\":\"", name,
+                      "\",\"cat\":\"mozc\",\"ph\":\"X\",\"ts\":", begin_us,
+                      ",\"dur\":", duration_us, ",\"pid\":", pid,
+                      ",\"tid\":", tid_);
+      if (index >= 0) {
+        absl::StrAppend(json, ",\"args\":{\"index\":", index, "}");
+      }
+      json->append("}");
+    }
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> sequence = 0;
+    std::atomic<const char *> name = nullptr;
+    std::atomic<int64_t> begin_us = 0;
+    std::atomic<int64_t> duration_us = 0;
+    std::atomic<int64_t> index = -1;
+  };
+
+  const int64_t tid_;
+  std::atomic<uint64_t> size_ = 0;
+  std::atomic<uint64_t> cleared_size_ = 0;
+  std::array<Slot, kMaxSpansPerThread> slots_;
+};
+
+// Owns all the span buffers. The buffer of a finished thread is kept with its
+// spans and reused by a new thread.
+class SpanBufferRegistry {
+ public:
+  SpanBuffer *Acquire() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    if (!free_buffers_.empty()) {
+      SpanBuffer *buffer = free_buffers_.back();
+      free_buffers_.pop_back();
+      return buffer;
+    }
+    buffers_.push_back(std::make_unique<SpanBuffer>(buffers_.size() + 1));
+    return buffers_.back().get();
+  }
+
+  void Release(SpanBuffer *buffer) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    free_buffers_.push_back(buffer);
+  }
+
+  void Clear() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    for (const std::unique_ptr<SpanBuffer> &buffer : buffers_) {
+      buffer->Clear();
+    }
+  }
+
+  std::string GetChromeTraceJson() ABSL_LOCKS_EXCLUDED(mutex_) {
+    const int64_t pid = GetProcessId();
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    {
+      absl::MutexLock lock(&mutex_);
+      for (const std::unique_ptr<SpanBuffer> &buffer : buffers_) {
+        buffer->AppendChromeTraceEvents(pid, &json);
+      }
+    }
+    json.append("\n]}\n");
+    return json;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::unique_ptr<SpanBuffer>> buffers_ ABSL_GUARDED_BY(mutex_);
+  std::vector<SpanBuffer *> free_buffers_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Intentionally leaked so that the buffers outlive the threads finishing after
+// the static destructors.
+SpanBufferRegistry *GetRegistry() {
+  static SpanBufferRegistry *registry = new SpanBufferRegistry();
+  return registry;
+}
+
+// Returns the buffer of the current thread to the registry on thread exit.
+class ThreadSpanBuffer {
+ public:
+  ThreadSpanBuffer() : buffer_(GetRegistry()->Acquire()) {}
+  ~ThreadSpanBuffer() { GetRegistry()->Release(buffer_); }
+
+  ThreadSpanBuffer(const ThreadSpanBuffer &) = delete;
+  ThreadSpanBuffer &operator=(const ThreadSpanBuffer &) = delete;
+
+  SpanBuffer *get() const { return buffer_; }
+
+ private:
+  SpanBuffer *buffer_;
+};
+
+SpanBuffer *GetThreadSpanBuffer() {
+  thread_local ThreadSpanBuffer buffer;
+  return buffer.get();
+}
+
+}  // namespace
+
+void Trace::SetEnabled(bool enabled) {
+  g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Trace::IsEnabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+void Trace::Clear() { GetRegistry()->Clear(); }
+
+std::string Trace::GetChromeTraceJson() {
+  return GetRegistry()->GetChromeTraceJson();
+}
+
+void Trace::AddSpan(const char *name, int64_t begin_us, int64_t duration_us,
+                    int64_t index) {
+  GetThreadSpanBuffer()->Add(name, begin_us, duration_us, index);
+}
+
+TraceSpan::TraceSpan(const char *name, int64_t index)
+    : name_(Trace::IsEnabled() ? name : nullptr), index_(index) {
+  if (name_ != nullptr) {
+    begin_us_ = GetCurrentTimeMicros();
+  }
+}
+
+TraceSpan::~TraceSpan() {
+  if (name_ != nullptr) {
+    Trace::AddSpan(name_, begin_us_, GetCurrentTimeMicros() - begin_us_,
+                   index_);
+  }
+}
+
+}  // namespace mozc
@@ -0,0 +1,102 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Opt-in latency tracing.
+//
+// TraceSpan records the wall time of a scope while tracing is enabled. The
+// spans are kept in a fixed-size ring buffer per thread without locking, and
+// Trace::GetChromeTraceJson() dumps them in the Chrome trace event format,
+// which can be loaded into chrome://tracing or https://ui.perfetto.dev.
+//
+// Usage:
+//   void Session::SendKey(...) {
+//     TraceSpan span("Session::SendKey");
+//     ...
+//   }
+
+#ifndef MOZC_BASE_TRACE_H_
+#define MOZC_BASE_TRACE_H_
+
+#include <cstdint>
+#include <string>
+
+namespace mozc {
+
+class Trace {
+ public:
+  Trace() = delete;
+
+  // Tracing is disabled by default. TraceSpan costs only an atomic load while
+  // disabled.
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled();
+
+  // Discards the spans recorded so far.
+  static void Clear();
+
+  // Returns the recorded spans as a JSON object in the Chrome trace event
+  // format. The oldest spans of a thread are dropped when its ring buffer is
+  // full.
+  static std::string GetChromeTraceJson();
+
+  // Records a span of |duration_us| microseconds beginning at |begin_us|,
+  // which is the number of microseconds since the Unix epoch. |name| must
+  // outlive the process, e.g., a string literal, and is dumped without
+  // escaping. |index| is dumped as an argument of the span if it is not
+  // negative.
+  static void AddSpan(const char *name, int64_t begin_us, int64_t duration_us,
+                      int64_t index = -1);
+};
+
+// Records the scope of the object as a span named |name| if tracing is enabled
+// at the construction. |name| must outlive the process, e.g., a string
+// literal.
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char *name) : TraceSpan(name, -1) {}
+  // |index| distinguishes spans of the same name, e.g., the index of a
+  // rewriter.
+  TraceSpan(const char *name, int64_t index);
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+  ~TraceSpan();
+
+ private:
+  // nullptr if tracing is disabled.
+  const char *name_;
+  int64_t index_;
+  int64_t begin_us_ = 0;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_TRACE_H_
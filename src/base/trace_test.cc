@@ -0,0 +1,122 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/trace.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "base/thread.h"
+#include "testing/gunit.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace {
+
+int CountSpans(absl::string_view json, absl::string_view name) {
+  const std::string pattern = absl::StrCat("\"name\":\"", name, "\"");
+  int count = 0;
+  for (size_t pos = json.find(pattern); pos != absl::string_view::npos;
+       pos = json.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+class TraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override { Trace::Clear(); }
+
+  void TearDown() override {
+    Trace::SetEnabled(false);
+    Trace::Clear();
+  }
+};
+
+TEST_F(TraceTest, DisabledByDefault) {
+  EXPECT_FALSE(Trace::IsEnabled());
+  { TraceSpan span("TraceTest::Disabled"); }
+  EXPECT_EQ(CountSpans(Trace::GetChromeTraceJson(), "TraceTest::Disabled"), 0);
+}
+
+TEST_F(TraceTest, RecordSpans) {
+  Trace::SetEnabled(true);
+  {
+    TraceSpan outer("TraceTest::Outer");
+    TraceSpan inner("TraceTest::Inner", 3);
+  }
+  const std::string json = Trace::GetChromeTraceJson();
+  EXPECT_TRUE(absl::StartsWith(json, "{")) << json;
+  EXPECT_TRUE(absl::StrContains(json, "\"traceEvents\":[")) << json;
+  EXPECT_EQ(CountSpans(json, "TraceTest::Outer"), 1);
+  EXPECT_EQ(CountSpans(json, "TraceTest::Inner"), 1);
+  EXPECT_TRUE(absl::StrContains(json, "\"args\":{\"index\":3}")) << json;
+
+  Trace::Clear();
+  EXPECT_EQ(CountSpans(Trace::GetChromeTraceJson(), "TraceTest::Outer"), 0);
+}
+
+TEST_F(TraceTest, SpansOfMultipleThreads) {
+  Trace::SetEnabled(true);
+  constexpr int kNumThreads = 4;
+  constexpr int kNumSpans = 100;
+  std::vector<Thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([] {
+      for (int j = 0; j < kNumSpans; ++j) {
+        TraceSpan span("TraceTest::Thread");
+      }
+    });
+  }
+  // Dumping while the spans are recorded is safe.
+  Trace::GetChromeTraceJson();
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  EXPECT_EQ(CountSpans(Trace::GetChromeTraceJson(), "TraceTest::Thread"),
+            kNumThreads * kNumSpans);
+}
+
+TEST_F(TraceTest, RingBufferKeepsLatestSpans) {
+  Trace::SetEnabled(true);
+  for (int i = 0; i < 10000; ++i) {
+    TraceSpan span("TraceTest::Old");
+  }
+  { TraceSpan span("TraceTest::Latest"); }
+  const std::string json = Trace::GetChromeTraceJson();
+  EXPECT_LT(CountSpans(json, "TraceTest::Old"), 10000);
+  EXPECT_EQ(CountSpans(json, "TraceTest::Latest"), 1);
+}
+
+}  // namespace
+}  // namespace mozc
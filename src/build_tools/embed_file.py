@@ -59,7 +59,8 @@ def main():
       '#error "%(name)s was already included or defined elsewhere"\n'
       '#else\n'
       '#define MOZC_EMBEDDED_FILE_%(name)s\n'
-      'constexpr uint64_t %(name)s_data[] = {'
+      # Aligned to cache lines for the data sections aligned to 512 bits.
+      'alignas(64) constexpr uint64_t %(name)s_data[] = {'
       % {'name': args.name}
   )
 
@@ -46,6 +46,7 @@
 #include "base/process.h"
 #include "base/singleton.h"
 #include "base/system_util.h"
+#include "base/trace.h"
 #include "base/version.h"
 #include "config/config_handler.h"
 #include "ipc/ipc.h"
@@ -107,9 +108,8 @@ Client::Client()
   client_factory_ = IPCClientFactory::GetIPCClientFactory();
 
   // Initialize direct_mode_keys_
-  config::Config config;
-  config::ConfigHandler::GetConfig(&config);
-  direct_mode_keys_ = KeyInfoUtil::ExtractSortedDirectModeKeys(config);
+  direct_mode_keys_ = KeyInfoUtil::ExtractSortedDirectModeKeys(
+      *config::ConfigHandler::GetSharedConfig());
 
 #ifdef MOZC_USE_SVS_JAPANESE
   InitRequestForSvsJapanese(true);
@@ -633,6 +633,7 @@ bool Client::CallAndCheckVersion(const commands::Input &input,
 }
 
 bool Client::Call(const commands::Input &input, commands::Output *output) {
+  const TraceSpan span("Client::Call");
   VLOG(2) << "commands::Input: " << std::endl << MOZC_LOG_PROTOBUF(input);
 
   // don't repeat Call() if the status is either
@@ -0,0 +1,422 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "client/in_process_client.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "base/clock.h"
+#include "base/config_file_stream.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "base/process_mutex.h"
+#include "base/run_level.h"
+#include "config/config_handler.h"
+#include "dictionary/user_dictionary_util.h"
+#include "engine/engine.h"
+#include "engine/engine_factory.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "session/key_info_util.h"
+#include "session/session_handler.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "client/client.h"
+#include "client/client_interface.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else  // _WIN32
+#include <unistd.h>
+#endif  // _WIN32
+
+namespace mozc {
+namespace client {
+namespace {
+
+// The name of the process lock taken by mozc_server. See
+// server/mozc_server.cc.
+constexpr char kServerMutexName[] = "server";
+
+std::optional<FileTimeStamp> GetModificationTime(const std::string &filename) {
+  absl::StatusOr<FileTimeStamp> time = FileUtil::GetModificationTime(filename);
+  if (!time.ok()) {
+    return std::nullopt;
+  }
+  return *time;
+}
+
+std::optional<FileTimeStamp> GetConfigModificationTime() {
+  return GetModificationTime(
+      ConfigFileStream::GetFileName(config::ConfigHandler::GetConfigFileName()));
+}
+
+std::optional<FileTimeStamp> GetDictionaryModificationTime() {
+  return GetModificationTime(UserDictionaryUtil::GetUserDictionaryFileName());
+}
+
+}  // namespace
+
+InProcessSessionHandler::InProcessSessionHandler(
+    std::unique_ptr<SessionHandlerInterface> handler,
+    std::unique_ptr<ProcessMutex> profile_lock)
+    : profile_lock_(std::move(profile_lock)),
+      handler_(std::move(handler)),
+      next_file_check_(Clock::GetAbslTime() + kFileCheckInterval),
+      config_time_(GetConfigModificationTime()),
+      dictionary_time_(GetDictionaryModificationTime()) {}
+
+bool InProcessSessionHandler::EvalCommand(commands::Command *command) {
+  absl::MutexLock lock(&mutex_);
+  MaybeReload();
+  const bool result = handler_->EvalCommand(command);
+  if (command->input().type() == commands::Input::SET_CONFIG) {
+    // The config file written by this engine doesn't need to be reloaded.
+    config_time_ = GetConfigModificationTime();
+  }
+  return result;
+}
+
+void InProcessSessionHandler::MaybeReload() {
+  const absl::Time now = Clock::GetAbslTime();
+  if (now < next_file_check_) {
+    return;
+  }
+  next_file_check_ = now + kFileCheckInterval;
+
+  const std::optional<FileTimeStamp> config_time = GetConfigModificationTime();
+  const std::optional<FileTimeStamp> dictionary_time =
+      GetDictionaryModificationTime();
+  if (config_time == config_time_ && dictionary_time == dictionary_time_) {
+    return;
+  }
+  if (config_time != config_time_) {
+    LOG(INFO) << "The config file has been updated by another process";
+    config::ConfigHandler::Reload();
+  }
+  config_time_ = config_time;
+  dictionary_time_ = dictionary_time;
+
+  // Same as RELOAD from mozc_tool. The engine reloads the user dictionary if
+  // the file has been updated.
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::RELOAD);
+  handler_->EvalCommand(&command);
+}
+
+InProcessClient::InProcessClient(
+    std::shared_ptr<InProcessSessionHandler> handler)
+    : handler_(std::move(handler)) {
+  direct_mode_keys_ = KeyInfoUtil::ExtractSortedDirectModeKeys(
+      *config::ConfigHandler::GetSharedConfig());
+
+#ifdef MOZC_USE_SVS_JAPANESE
+  InitRequestForSvsJapanese(true);
+#endif  // MOZC_USE_SVS_JAPANESE
+}
+
+InProcessClient::~InProcessClient() { DeleteSession(); }
+
+void InProcessClient::InitRequestForSvsJapanese(bool use_svs) {
+  request_ = std::make_unique<commands::Request>();
+
+  commands::DecoderExperimentParams params;
+  uint32_t variation_types = params.variation_character_types();
+  if (use_svs) {
+    variation_types |= commands::DecoderExperimentParams::SVS_JAPANESE;
+  } else {
+    variation_types &= ~commands::DecoderExperimentParams::SVS_JAPANESE;
+  }
+  request_->mutable_decoder_experiment_params()->set_variation_character_types(
+      variation_types);
+}
+
+bool InProcessClient::IsValidRunLevel() const {
+  return RunLevel::IsValidClientRunLevel();
+}
+
+bool InProcessClient::EnsureSession() {
+  if (id_ != 0) {
+    return true;
+  }
+  if (!CreateSession()) {
+    LOG(ERROR) << "CreateSession failed";
+    return false;
+  }
+
+  // Call SET_REQUEST if request_ is not nullptr.
+  if (request_) {
+    commands::Command command;
+    command.mutable_input()->set_id(id_);
+    command.mutable_input()->set_type(commands::Input::SET_REQUEST);
+    *command.mutable_input()->mutable_request() = *request_;
+    handler_->EvalCommand(&command);
+  }
+  return true;
+}
+
+bool InProcessClient::CreateSession() {
+  id_ = 0;
+  commands::Command command;
+  commands::Input *input = command.mutable_input();
+  input->set_type(commands::Input::CREATE_SESSION);
+  *input->mutable_capability() = client_capability_;
+
+  commands::ApplicationInfo *info = input->mutable_application_info();
+#ifdef _WIN32
+  info->set_process_id(static_cast<uint32_t>(::GetCurrentProcessId()));
+  info->set_thread_id(static_cast<uint32_t>(::GetCurrentThreadId()));
+#else   // _WIN32
+  info->set_process_id(static_cast<uint32_t>(getpid()));
+  info->set_thread_id(0);
+#endif  // _WIN32
+
+  if (!handler_->EvalCommand(&command) ||
+      command.output().error_code() != commands::Output::SESSION_SUCCESS) {
+    LOG(ERROR) << "Session handler returns an error";
+    return false;
+  }
+
+  id_ = command.output().id();
+  return true;
+}
+
+bool InProcessClient::DeleteSession() {
+  // No need to delete session
+  if (id_ == 0) {
+    return true;
+  }
+
+  commands::Command command;
+  command.mutable_input()->set_id(id_);
+  command.mutable_input()->set_type(commands::Input::DELETE_SESSION);
+  id_ = 0;
+  return handler_->EvalCommand(&command);
+}
+
+bool InProcessClient::EnsureCallCommand(commands::Command *command,
+                                        commands::Output *output) {
+  commands::Input *input = command->mutable_input();
+  for (int trial = 0; trial < 2; ++trial) {
+    if (!EnsureSession()) {
+      LOG(ERROR) << "EnsureSession failed";
+      return false;
+    }
+    input->set_id(id_);
+    if (preferences_ != nullptr) {
+      *input->mutable_config() = *preferences_;
+    }
+    command->clear_output();
+    if (!handler_->EvalCommand(command)) {
+      LOG(ERROR) << "EvalCommand failed";
+      return false;
+    }
+    if (command->output().id() == id_) {
+      output->Swap(command->mutable_output());
+      return true;
+    }
+    LOG(ERROR) << "Session id is void. re-issue session id";
+    id_ = 0;
+  }
+  return false;
+}
+
+bool InProcessClient::SendKeyWithContext(const commands::KeyEvent &key,
+                                         const commands::Context &context,
+                                         commands::Output *output) {
+  commands::Command command;
+  commands::Input *input = command.mutable_input();
+  input->set_type(commands::Input::SEND_KEY);
+  *input->mutable_key() = key;
+  // If the pointer of |context| is not the default_instance, update the data.
+  if (&context != &commands::Context::default_instance()) {
+    *input->mutable_context() = context;
+  }
+  return EnsureCallCommand(&command, output);
+}
+
+bool InProcessClient::TestSendKeyWithContext(const commands::KeyEvent &key,
+                                             const commands::Context &context,
+                                             commands::Output *output) {
+  commands::Command command;
+  commands::Input *input = command.mutable_input();
+  input->set_type(commands::Input::TEST_SEND_KEY);
+  *input->mutable_key() = key;
+  // If the pointer of |context| is not the default_instance, update the data.
+  if (&context != &commands::Context::default_instance()) {
+    *input->mutable_context() = context;
+  }
+  return EnsureCallCommand(&command, output);
+}
+
+bool InProcessClient::SendCommandWithContext(
+    const commands::SessionCommand &command, const commands::Context &context,
+    commands::Output *output) {
+  commands::Command session_command;
+  commands::Input *input = session_command.mutable_input();
+  input->set_type(commands::Input::SEND_COMMAND);
+  *input->mutable_command() = command;
+  // If the pointer of |context| is not the default_instance, update the data.
+  if (&context != &commands::Context::default_instance()) {
+    *input->mutable_context() = context;
+  }
+  return EnsureCallCommand(&session_command, output);
+}
+
+bool InProcessClient::IsDirectModeCommand(const commands::KeyEvent &key) const {
+  return KeyInfoUtil::ContainsKey(direct_mode_keys_, key);
+}
+
+bool InProcessClient::GetConfig(config::Config *config) {
+  commands::Command command;
+  command.mutable_input()->set_id(id_);
+  command.mutable_input()->set_type(commands::Input::GET_CONFIG);
+  if (!handler_->EvalCommand(&command) || !command.output().has_config()) {
+    return false;
+  }
+  config->Swap(command.mutable_output()->mutable_config());
+  return true;
+}
+
+bool InProcessClient::SetConfig(const config::Config &config) {
+  commands::Command command;
+  command.mutable_input()->set_id(id_);
+  command.mutable_input()->set_type(commands::Input::SET_CONFIG);
+  *command.mutable_input()->mutable_config() = config;
+  if (!handler_->EvalCommand(&command)) {
+    return false;
+  }
+
+  direct_mode_keys_ = KeyInfoUtil::ExtractSortedDirectModeKeys(config);
+  return true;
+}
+
+bool InProcessClient::ClearUserHistory() {
+  return CallCommand(commands::Input::CLEAR_USER_HISTORY);
+}
+
+bool InProcessClient::ClearUserPrediction() {
+  return CallCommand(commands::Input::CLEAR_USER_PREDICTION);
+}
+
+bool InProcessClient::ClearUnusedUserPrediction() {
+  return CallCommand(commands::Input::CLEAR_UNUSED_USER_PREDICTION);
+}
+
+bool InProcessClient::Shutdown() { return SyncData(); }
+
+bool InProcessClient::SyncData() {
+  return CallCommand(commands::Input::SYNC_DATA);
+}
+
+bool InProcessClient::Reload() { return CallCommand(commands::Input::RELOAD); }
+
+bool InProcessClient::Cleanup() {
+  return CallCommand(commands::Input::CLEANUP);
+}
+
+bool InProcessClient::NoOperation() {
+  return CallCommand(commands::Input::NO_OPERATION);
+}
+
+bool InProcessClient::CallCommand(commands::Input::CommandType type) {
+  commands::Command command;
+  command.mutable_input()->set_id(id_);
+  command.mutable_input()->set_type(type);
+  if (preferences_ != nullptr) {
+    *command.mutable_input()->mutable_config() = *preferences_;
+  }
+  return handler_->EvalCommand(&command);
+}
+
+void InProcessClient::EnableCascadingWindow(const bool enable) {
+  if (preferences_ == nullptr) {
+    preferences_ = std::make_unique<config::Config>();
+  }
+  preferences_->set_use_cascading_window(enable);
+}
+
+// mozc_tool and the browser are separate processes in any case. Client
+// launches them without connecting to the server.
+bool InProcessClient::LaunchTool(const std::string &mode,
+                                 const absl::string_view extra_arg) {
+  return Client().LaunchTool(mode, extra_arg);
+}
+
+bool InProcessClient::LaunchToolWithProtoBuf(const commands::Output &output) {
+  return Client().LaunchToolWithProtoBuf(output);
+}
+
+bool InProcessClient::OpenBrowser(const std::string &url) {
+  return Client().OpenBrowser(url);
+}
+
+std::unique_ptr<ClientInterface> InProcessClientFactory::NewClient() {
+  absl::MutexLock lock(&mutex_);
+  if (!initialized_) {
+    initialized_ = true;
+    auto profile_lock = std::make_unique<ProcessMutex>(kServerMutexName);
+    if (!profile_lock->Lock()) {
+      LOG(WARNING) << "The user profile is used by another engine. "
+                      "Connecting to mozc_server instead.";
+    } else if (absl::StatusOr<std::unique_ptr<SessionHandlerInterface>>
+                   handler = CreateSessionHandler();
+               !handler.ok()) {
+      LOG(ERROR) << "Failed to create the engine: " << handler.status()
+                 << ". Connecting to mozc_server instead.";
+    } else {
+      handler_ = std::make_shared<InProcessSessionHandler>(
+          *std::move(handler), std::move(profile_lock));
+    }
+  }
+
+  if (handler_ == nullptr) {
+    return std::make_unique<Client>();
+  }
+  return std::make_unique<InProcessClient>(handler_);
+}
+
+absl::StatusOr<std::unique_ptr<SessionHandlerInterface>>
+InProcessClientFactory::CreateSessionHandler() {
+  absl::StatusOr<std::unique_ptr<Engine>> engine = EngineFactory::Create();
+  if (!engine.ok()) {
+    return engine.status();
+  }
+  return std::make_unique<SessionHandler>(*std::move(engine));
+}
+
+}  // namespace client
+}  // namespace mozc
@@ -0,0 +1,217 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// A client running SessionHandler and its Engine in the calling process,
+// without IPC to mozc_server.
+
+#ifndef MOZC_CLIENT_IN_PROCESS_CLIENT_H_
+#define MOZC_CLIENT_IN_PROCESS_CLIENT_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/process_mutex.h"
+#include "composer/key_event_util.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "session/session_handler_interface.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "client/client_interface.h"
+
+namespace mozc {
+namespace client {
+
+// Serializes the commands from the InProcessClients of a process to the
+// SessionHandler they share. `profile_lock` (may be nullptr) is released
+// after the handler is destroyed.
+//
+// While the in-process engine owns the user profile, mozc_server can't start,
+// so mozc_tool's RELOAD doesn't reach any engine. The dictionary tool still
+// saves the user dictionary file before sending RELOAD. The handler checks the
+// modification times of the user dictionary and the config file at most once
+// per kFileCheckInterval, and reloads the config and the engine when they have
+// been updated outside of this engine.
+class InProcessSessionHandler {
+ public:
+  static constexpr absl::Duration kFileCheckInterval = absl::Seconds(5);
+
+  InProcessSessionHandler(std::unique_ptr<SessionHandlerInterface> handler,
+                          std::unique_ptr<ProcessMutex> profile_lock);
+  InProcessSessionHandler(const InProcessSessionHandler &) = delete;
+  InProcessSessionHandler &operator=(const InProcessSessionHandler &) = delete;
+
+  bool EvalCommand(commands::Command *command) ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void MaybeReload() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::unique_ptr<ProcessMutex> profile_lock_;
+  absl::Mutex mutex_;
+  std::unique_ptr<SessionHandlerInterface> handler_ ABSL_GUARDED_BY(mutex_);
+  absl::Time next_file_check_ ABSL_GUARDED_BY(mutex_);
+  // std::nullopt if the file doesn't exist.
+  std::optional<FileTimeStamp> config_time_ ABSL_GUARDED_BY(mutex_);
+  std::optional<FileTimeStamp> dictionary_time_ ABSL_GUARDED_BY(mutex_);
+};
+
+// ClientInterface implementation which evaluates the commands directly with
+// the SessionHandler in this process. Inputs and outputs are passed as
+// protobuf objects, so there is no serialization, socket round trip or
+// server launch. As there is no server, the methods about the connection and
+// the server program are no-ops.
+class InProcessClient : public ClientInterface {
+ public:
+  explicit InProcessClient(std::shared_ptr<InProcessSessionHandler> handler);
+  InProcessClient(const InProcessClient &) = delete;
+  InProcessClient &operator=(const InProcessClient &) = delete;
+  ~InProcessClient() override;
+
+  // Initializes `request_` with the flag. Same as Client.
+  void InitRequestForSvsJapanese(bool use_svs);
+
+  void SetIPCClientFactory(IPCClientFactoryInterface *client_factory) override {
+  }
+  void SetServerLauncher(
+      std::unique_ptr<ServerLauncherInterface> server_launcher) override {}
+
+  bool IsValidRunLevel() const override;
+
+  bool EnsureConnection() override { return true; }
+  bool EnsureSession() override;
+  bool CheckVersionOrRestartServer() override { return EnsureSession(); }
+
+  bool SendKeyWithContext(const commands::KeyEvent &key,
+                          const commands::Context &context,
+                          commands::Output *output) override;
+  bool TestSendKeyWithContext(const commands::KeyEvent &key,
+                              const commands::Context &context,
+                              commands::Output *output) override;
+  bool SendCommandWithContext(const commands::SessionCommand &command,
+                              const commands::Context &context,
+                              commands::Output *output) override;
+
+  bool IsDirectModeCommand(const commands::KeyEvent &key) const override;
+
+  bool GetConfig(config::Config *config) override;
+  bool SetConfig(const config::Config &config) override;
+
+  bool ClearUserHistory() override;
+  bool ClearUserPrediction() override;
+  bool ClearUnusedUserPrediction() override;
+  // There is no server process to shut down. Syncs the user data instead.
+  bool Shutdown() override;
+  bool SyncData() override;
+  bool Reload() override;
+  bool Cleanup() override;
+
+  void Reset() override {}
+  bool PingServer() const override { return true; }
+  bool NoOperation() override;
+
+  void EnableCascadingWindow(bool enable) override;
+
+  void set_timeout(absl::Duration timeout) override {}
+  void set_restricted(bool restricted) override {}
+  void set_server_program(absl::string_view program_path) override {}
+  void set_suppress_error_dialog(bool suppress) override {}
+  void set_client_capability(const commands::Capability &capability) override {
+    client_capability_ = capability;
+  }
+
+  bool LaunchTool(const std::string &mode,
+                  absl::string_view extra_arg) override;
+  bool LaunchToolWithProtoBuf(const commands::Output &output) override;
+  bool OpenBrowser(const std::string &url) override;
+
+ private:
+  bool CreateSession();
+  bool DeleteSession();
+
+  // Fills the session ID and the preferences of `command->input()`, evaluates
+  // it and moves the output to `output`. Re-creates the session and retries
+  // once if the session has been deleted, e.g. by Cleanup().
+  bool EnsureCallCommand(commands::Command *command, commands::Output *output);
+
+  bool CallCommand(commands::Input::CommandType type);
+
+  std::shared_ptr<InProcessSessionHandler> handler_;
+  uint64_t id_ = 0;
+  std::unique_ptr<config::Config> preferences_;
+  std::unique_ptr<commands::Request> request_;
+  // List of key combinations used in the direct input mode.
+  std::vector<KeyInformation> direct_mode_keys_;
+  commands::Capability client_capability_;
+};
+
+// Client factory which runs the engine in this process. The first client
+// creates the engine after taking the same process lock as mozc_server, so
+// only one engine reads and writes the user history and learning data of the
+// user profile. If mozc_server or another in-process frontend already holds
+// the lock, or the engine can't be created, the factory falls back to the IPC
+// Client.
+//
+// Usage:
+//   InProcessClientFactory factory;
+//   ClientFactory::SetClientFactory(&factory);
+class InProcessClientFactory : public ClientFactoryInterface {
+ public:
+  InProcessClientFactory() = default;
+  InProcessClientFactory(const InProcessClientFactory &) = delete;
+  InProcessClientFactory &operator=(const InProcessClientFactory &) = delete;
+
+  std::unique_ptr<ClientInterface> NewClient() override
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ protected:
+  // Creates the SessionHandler with a new engine. Called at most once, while
+  // holding the process lock. Virtual for testing.
+  virtual absl::StatusOr<std::unique_ptr<SessionHandlerInterface>>
+  CreateSessionHandler();
+
+ private:
+  absl::Mutex mutex_;
+  bool initialized_ ABSL_GUARDED_BY(mutex_) = false;
+  // nullptr when falling back to the IPC client.
+  std::shared_ptr<InProcessSessionHandler> handler_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace client
+}  // namespace mozc
+
+#endif  // MOZC_CLIENT_IN_PROCESS_CLIENT_H_
@@ -0,0 +1,284 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "client/in_process_client.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "base/clock.h"
+#include "base/clock_mock.h"
+#include "base/config_file_stream.h"
+#include "base/process_mutex.h"
+#include "config/config_handler.h"
+#include "engine/mock_data_engine_factory.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "session/session_handler.h"
+#include "session/session_handler_interface.h"
+#include "testing/gunit.h"
+#include "testing/mozctest.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "client/client_interface.h"
+
+namespace mozc {
+namespace client {
+namespace {
+
+class InProcessClientTest : public testing::TestWithTempUserProfile {
+ protected:
+  void SetUp() override {
+    handler_ = std::make_shared<InProcessSessionHandler>(
+        std::make_unique<SessionHandler>(
+            MockDataEngineFactory::Create().value()),
+        nullptr);
+  }
+
+  static commands::KeyEvent MakeKey(char c) {
+    commands::KeyEvent key;
+    key.set_key_code(c);
+    return key;
+  }
+
+  std::shared_ptr<InProcessSessionHandler> handler_;
+};
+
+TEST_F(InProcessClientTest, SendKey) {
+  InProcessClient client(handler_);
+  commands::Output output;
+  ASSERT_TRUE(client.SendKey(MakeKey('a'), &output));
+  EXPECT_TRUE(output.consumed());
+  ASSERT_TRUE(output.has_preedit());
+  EXPECT_EQ(output.preedit().segment(0).value(), "あ");
+
+  commands::SessionCommand command;
+  command.set_type(commands::SessionCommand::SUBMIT);
+  ASSERT_TRUE(client.SendCommand(command, &output));
+  EXPECT_FALSE(output.has_preedit());
+  EXPECT_EQ(output.result().value(), "あ");
+}
+
+TEST_F(InProcessClientTest, ClientsShareEngineWithSeparateSessions) {
+  InProcessClient client1(handler_);
+  InProcessClient client2(handler_);
+  commands::Output output1, output2;
+  ASSERT_TRUE(client1.SendKey(MakeKey('a'), &output1));
+  ASSERT_TRUE(client2.SendKey(MakeKey('i'), &output2));
+  EXPECT_NE(output1.id(), output2.id());
+
+  ASSERT_TRUE(client1.SendKey(MakeKey('i'), &output1));
+  EXPECT_EQ(output1.preedit().segment(0).value(), "あい");
+  EXPECT_EQ(output2.preedit().segment(0).value(), "い");
+}
+
+TEST_F(InProcessClientTest, RecreatesDeletedSession) {
+  InProcessClient client(handler_);
+  commands::Output output;
+  ASSERT_TRUE(client.SendKey(MakeKey('a'), &output));
+  const uint64_t id = output.id();
+
+  // Delete the session behind the client.
+  commands::Command command;
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->set_type(commands::Input::DELETE_SESSION);
+  ASSERT_TRUE(handler_->EvalCommand(&command));
+
+  ASSERT_TRUE(client.SendKey(MakeKey('i'), &output));
+  EXPECT_NE(output.id(), id);
+  EXPECT_EQ(output.preedit().segment(0).value(), "い");
+}
+
+TEST_F(InProcessClientTest, Config) {
+  InProcessClient client(handler_);
+  config::Config config;
+  ASSERT_TRUE(client.GetConfig(&config));
+  config.set_incognito_mode(true);
+  ASSERT_TRUE(client.SetConfig(config));
+
+  config::Config new_config;
+  ASSERT_TRUE(client.GetConfig(&new_config));
+  EXPECT_TRUE(new_config.incognito_mode());
+}
+
+TEST_F(InProcessClientTest, ReloadsConfigUpdatedByAnotherProcess) {
+  ScopedClockMock clock(Clock::GetAbslTime());
+  InProcessClient client1(handler_);
+  commands::Output output;
+  ASSERT_TRUE(client1.SendKey(MakeKey(','), &output));
+  EXPECT_EQ(output.preedit().segment(0).value(), "、");
+
+  // The config file is updated outside of this engine.
+  config::Config config;
+  config::ConfigHandler::GetDefaultConfig(&config);
+  config.set_punctuation_method(config::Config::COMMA_PERIOD);
+  ASSERT_TRUE(ConfigFileStream::AtomicUpdate(
+      config::ConfigHandler::GetConfigFileName(), config.SerializeAsString()));
+
+  // The file is not checked until the interval passes.
+  ASSERT_TRUE(client1.SendKey(MakeKey(','), &output));
+  EXPECT_EQ(output.preedit().segment(0).value(), "、、");
+
+  clock->Advance(InProcessSessionHandler::kFileCheckInterval);
+  commands::SessionCommand command;
+  command.set_type(commands::SessionCommand::REVERT);
+  ASSERT_TRUE(client1.SendCommand(command, &output));
+
+  // Both the existing session and a new client use the new config.
+  ASSERT_TRUE(client1.SendKey(MakeKey(','), &output));
+  EXPECT_EQ(output.preedit().segment(0).value(), "，");
+  InProcessClient client2(handler_);
+  ASSERT_TRUE(client2.SendKey(MakeKey(','), &output));
+  EXPECT_EQ(output.preedit().segment(0).value(), "，");
+
+  config::Config actual;
+  ASSERT_TRUE(client2.GetConfig(&actual));
+  EXPECT_EQ(actual.punctuation_method(), config::Config::COMMA_PERIOD);
+}
+
+// Counts the engines created by the factory. `T` is the SessionHandler the
+// engine runs in.
+template <typename T>
+class TestInProcessClientFactory : public InProcessClientFactory {
+ public:
+  int engines_created() const { return engines_created_; }
+
+ protected:
+  absl::StatusOr<std::unique_ptr<SessionHandlerInterface>>
+  CreateSessionHandler() override {
+    ++engines_created_;
+    return T::Create();
+  }
+
+ private:
+  int engines_created_ = 0;
+};
+
+class FakeSessionHandler : public SessionHandlerInterface {
+ public:
+  static std::unique_ptr<SessionHandlerInterface> Create() {
+    return std::make_unique<FakeSessionHandler>();
+  }
+
+  bool IsAvailable() const override { return true; }
+  bool EvalCommand(commands::Command *command) override { return true; }
+  void StartWatchDog() override {}
+  void AddObserver(session::SessionObserverInterface *observer) override {}
+  absl::string_view GetDataVersion() const override { return ""; }
+};
+
+class MockDataSessionHandler {
+ public:
+  static std::unique_ptr<SessionHandlerInterface> Create() {
+    return std::make_unique<SessionHandler>(
+        MockDataEngineFactory::Create().value());
+  }
+};
+
+class InProcessClientFactoryTest : public testing::TestWithTempUserProfile {
+ protected:
+  static commands::KeyEvent MakeKey(char c) {
+    commands::KeyEvent key;
+    key.set_key_code(c);
+    return key;
+  }
+
+  static commands::KeyEvent MakeSpecialKey(
+      commands::KeyEvent::SpecialKey special_key) {
+    commands::KeyEvent key;
+    key.set_special_key(special_key);
+    return key;
+  }
+};
+
+TEST_F(InProcessClientFactoryTest, OnlyOneEngineOwnsUserProfile) {
+  auto factory1 =
+      std::make_unique<TestInProcessClientFactory<FakeSessionHandler>>();
+  std::unique_ptr<ClientInterface> client1 = factory1->NewClient();
+  EXPECT_EQ(factory1->engines_created(), 1);
+
+  // Another frontend sharing the user profile doesn't load its own user
+  // history and learning data. It connects to mozc_server instead.
+  TestInProcessClientFactory<FakeSessionHandler> factory2;
+  std::unique_ptr<ClientInterface> client2 = factory2.NewClient();
+  EXPECT_EQ(factory2.engines_created(), 0);
+
+  // mozc_server doesn't start either.
+  ProcessMutex server_mutex("server");
+  EXPECT_FALSE(server_mutex.Lock());
+
+  // The lock is released with the engine.
+  client1.reset();
+  factory1.reset();
+  TestInProcessClientFactory<FakeSessionHandler> factory3;
+  std::unique_ptr<ClientInterface> client3 = factory3.NewClient();
+  EXPECT_EQ(factory3.engines_created(), 1);
+}
+
+TEST_F(InProcessClientFactoryTest, NextEngineKeepsLearning) {
+  std::string learned;
+  {
+    TestInProcessClientFactory<MockDataSessionHandler> factory;
+    std::unique_ptr<ClientInterface> client = factory.NewClient();
+    ASSERT_EQ(factory.engines_created(), 1);
+    commands::Output output;
+    ASSERT_TRUE(client->SendKey(MakeKey('a'), &output));
+    ASSERT_TRUE(client->SendKey(MakeKey('i'), &output));
+    ASSERT_TRUE(
+        client->SendKey(MakeSpecialKey(commands::KeyEvent::SPACE), &output));
+    const std::string top = output.preedit().segment(0).value();
+    ASSERT_TRUE(
+        client->SendKey(MakeSpecialKey(commands::KeyEvent::SPACE), &output));
+    learned = output.preedit().segment(0).value();
+    ASSERT_NE(learned, top);
+    ASSERT_TRUE(
+        client->SendKey(MakeSpecialKey(commands::KeyEvent::ENTER), &output));
+    EXPECT_EQ(output.result().value(), learned);
+    ASSERT_TRUE(client->SyncData());
+  }
+
+  // The frontend started next owns the profile and uses what the previous
+  // engine learned.
+  TestInProcessClientFactory<MockDataSessionHandler> factory;
+  std::unique_ptr<ClientInterface> client = factory.NewClient();
+  ASSERT_EQ(factory.engines_created(), 1);
+  commands::Output output;
+  ASSERT_TRUE(client->SendKey(MakeKey('a'), &output));
+  ASSERT_TRUE(client->SendKey(MakeKey('i'), &output));
+  ASSERT_TRUE(
+      client->SendKey(MakeSpecialKey(commands::KeyEvent::SPACE), &output));
+  EXPECT_EQ(output.preedit().segment(0).value(), learned);
+}
+
+}  // namespace
+}  // namespace client
+}  // namespace mozc
@@ -46,6 +46,7 @@
 #include "base/strings/assign.h"
 #include "base/strings/unicode.h"
 #include "base/util.h"
+#include "composer/internal/char_chunk.h"
 #include "composer/internal/composition.h"
 #include "composer/internal/composition_input.h"
 #include "composer/internal/mode_switching_handler.h"
@@ -289,6 +290,13 @@ void Composer::ReloadConfig() {
 
 bool Composer::Empty() const { return (GetLength() == 0); }
 
+size_t Composer::GetFootprint() const {
+  // The strings of a chunk are a few characters long and mostly stay in the
+  // small string buffer, so each chunk is counted by its struct size.
+  return sizeof(Composer) +
+         composition_.chunks().size() * sizeof(CharChunk);
+}
+
 void Composer::SetTable(const Table *table) {
   table_ = table;
   composition_.SetTable(table);
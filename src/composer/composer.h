@@ -142,6 +142,9 @@ class Composer final {
 
   size_t GetLength() const;
   size_t GetCursor() const;
+
+  // Returns the approximate memory held by the composition in bytes.
+  size_t GetFootprint() const;
   void EditErase();
 
   // Deletes a character at specified position.
@@ -46,6 +46,13 @@ IBUS_MOZC_PATH = "/usr/lib/ibus-mozc/ibus-engine-mozc"
 EMACS_MOZC_CLIENT_DIR = "/usr/share/emacs/site-lisp/emacs-mozc"
 EMACS_MOZC_HELPER_DIR = "/usr/bin"
 
+# If True, ibus_mozc and mozc_emacs_helper run the conversion engine in their
+# own process instead of connecting to mozc_server. Only one engine per user
+# profile loads the user history and learning data; the others keep using
+# mozc_server, which can't start while an in-process engine owns the profile.
+# Meant for single-frontend setups.
+LINUX_MOZC_IN_PROCESS_ENGINE = False
+
 MACOS_BUNDLE_ID_PREFIX = "org.mozc.inputmethod.Japanese"
 MACOS_MIN_OS_VER = "11.0"
 
@@ -36,6 +36,7 @@
 #include <string>
 #include <utility>
 
+#include "base/atomic_shared_ptr.h"
 #include "base/clock.h"
 #include "base/config_file_stream.h"
 #include "base/hash.h"
@@ -86,8 +87,9 @@ class ConfigHandlerImpl final {
     ConfigHandler::GetDefaultConfig(&default_config_);
   }
 
-  void GetConfig(Config *config) const ABSL_LOCKS_EXCLUDED(mutex_);
-  std::unique_ptr<config::Config> GetConfig() const ABSL_LOCKS_EXCLUDED(mutex_);
+  void GetConfig(Config *config) const;
+  std::unique_ptr<config::Config> GetConfig() const;
+  std::shared_ptr<const Config> GetSharedConfig() const;
   const Config &DefaultConfig() const;
   void SetConfig(const Config &config) ABSL_LOCKS_EXCLUDED(mutex_);
   void Reload() ABSL_LOCKS_EXCLUDED(mutex_);
@@ -96,13 +98,15 @@ class ConfigHandlerImpl final {
   const std::string &GetConfigFileName() ABSL_LOCKS_EXCLUDED(mutex_);
 
  private:
-  // copy config to config_ and do some
-  // platform dependent hooks/rewrites
+  // do some platform dependent hooks/rewrites on config and publish it as
+  // the new snapshot
   void SetConfigInternal(Config config) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void ReloadUnlocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   std::string filename_ ABSL_GUARDED_BY(mutex_);
-  Config config_ ABSL_GUARDED_BY(mutex_);
+  // Readers load the snapshot without mutex_. Writers replace it while
+  // holding mutex_.
+  AtomicSharedPtr<const Config> config_;
   Config default_config_;
   mutable absl::Mutex mutex_;
   uint64_t stored_config_hash_ ABSL_GUARDED_BY(mutex_) = 0;
@@ -114,48 +118,50 @@ ConfigHandlerImpl *GetConfigHandlerImpl() {
 
 // return current Config
 void ConfigHandlerImpl::GetConfig(Config *config) const {
-  absl::MutexLock lock(&mutex_);
-  *config = config_;
+  *config = *config_.load();
 }
 
 // return current Config as a unique_ptr.
 std::unique_ptr<config::Config> ConfigHandlerImpl::GetConfig() const {
-  absl::MutexLock lock(&mutex_);
-  return std::make_unique<config::Config>(config_);
+  return std::make_unique<config::Config>(*config_.load());
+}
+
+std::shared_ptr<const Config> ConfigHandlerImpl::GetSharedConfig() const {
+  return config_.load();
 }
 
 const Config &ConfigHandlerImpl::DefaultConfig() const {
   return default_config_;
 }
 
-// set config and rewrite internal data
+// rewrite internal data and publish config
 void ConfigHandlerImpl::SetConfigInternal(Config config) {
-  config_ = std::move(config);
-
 #ifdef MOZC_NO_LOGGING
   // Delete the optional field from the config.
-  config_.clear_verbose_level();
+  config.clear_verbose_level();
   // Fall back if the default value is not the expected value.
-  if (config_.verbose_level() != 0) {
-    config_.set_verbose_level(0);
+  if (config.verbose_level() != 0) {
+    config.set_verbose_level(0);
   }
 #endif  // MOZC_NO_LOGGING
 
-  Logging::SetConfigVerboseLevel(config_.verbose_level());
+  Logging::SetConfigVerboseLevel(config.verbose_level());
 
   // Initialize platform specific configuration.
-  if (config_.session_keymap() == Config::NONE) {
-    config_.set_session_keymap(ConfigHandler::GetDefaultKeyMap());
+  if (config.session_keymap() == Config::NONE) {
+    config.set_session_keymap(ConfigHandler::GetDefaultKeyMap());
   }
 
 #if defined(__ANDROID__) && defined(CHANNEL_DEV)
-  stored_config_.mutable_general_config()->set_upload_usage_stats(true);
+  config.mutable_general_config()->set_upload_usage_stats(true);
 #endif  // CHANNEL_DEV && __ANDROID__
 
   if (GetPlatformSpecificDefaultEmojiSetting() &&
-      !config_.has_use_emoji_conversion()) {
-    config_.set_use_emoji_conversion(true);
+      !config.has_use_emoji_conversion()) {
+    config.set_use_emoji_conversion(true);
   }
+
+  config_.store(std::make_shared<const Config>(std::move(config)));
 }
 
 void ConfigHandlerImpl::SetConfig(const Config &config) {
@@ -235,6 +241,10 @@ std::unique_ptr<config::Config> ConfigHandler::GetConfig() {
   return GetConfigHandlerImpl()->GetConfig();
 }
 
+std::shared_ptr<const Config> ConfigHandler::GetSharedConfig() {
+  return GetConfigHandlerImpl()->GetSharedConfig();
+}
+
 void ConfigHandler::SetConfig(const Config &config) {
   GetConfigHandlerImpl()->SetConfig(config);
 }
@@ -60,6 +60,12 @@ class ConfigHandler {
   // The same performance note as GetConfig(Config*) applies.
   static std::unique_ptr<config::Config> GetConfig();
 
+  // Returns current config as an immutable snapshot without copying it.
+  // SetConfig() and Reload() publish a new snapshot and never modify the
+  // published ones, so the returned config stays valid and unchanged while
+  // it is held.
+  static std::shared_ptr<const Config> GetSharedConfig();
+
   // Sets config.
   static void SetConfig(const Config &config);
 
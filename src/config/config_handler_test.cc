@@ -194,6 +194,42 @@ TEST_F(ConfigHandlerTest, SetConfig_IdentityCheck) {
   Clock::SetClockForUnitTest(nullptr);
 }
 
+TEST_F(ConfigHandlerTest, SharedConfig) {
+  TempDirectory temp_dir = testing::MakeTempDirectoryOrDie();
+  const std::string config_file =
+      FileUtil::JoinPath(temp_dir.path(), "mozc_config_test_tmp");
+  ASSERT_OK(FileUtil::UnlinkIfExists(config_file));
+  ConfigHandler::SetConfigFileName(config_file);
+
+  Config input;
+  ConfigHandler::GetDefaultConfig(&input);
+  input.set_incognito_mode(true);
+  ConfigHandler::SetConfig(input);
+
+  const std::shared_ptr<const Config> config1 =
+      ConfigHandler::GetSharedConfig();
+  EXPECT_TRUE(config1->incognito_mode());
+  // No new snapshot is published until the config is updated.
+  EXPECT_EQ(ConfigHandler::GetSharedConfig(), config1);
+
+  input.set_incognito_mode(false);
+  ConfigHandler::SetConfig(input);
+  const std::shared_ptr<const Config> config2 =
+      ConfigHandler::GetSharedConfig();
+  EXPECT_NE(config2, config1);
+  EXPECT_FALSE(config2->incognito_mode());
+  // The previous snapshot is not modified.
+  EXPECT_TRUE(config1->incognito_mode());
+
+  // Setting the identical config doesn't publish a new snapshot.
+  ConfigHandler::SetConfig(input);
+  EXPECT_EQ(ConfigHandler::GetSharedConfig(), config2);
+
+  ConfigHandler::Reload();
+  EXPECT_NE(ConfigHandler::GetSharedConfig(), config2);
+  EXPECT_FALSE(ConfigHandler::GetSharedConfig()->incognito_mode());
+}
+
 TEST_F(ConfigHandlerTest, ConfigFileNameConfig) {
   const std::string config_file = absl::StrCat("config", kConfigVersion, ".db");
   const std::string filename =
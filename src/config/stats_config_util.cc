@@ -223,9 +223,9 @@ bool MacStatsConfigUtilImpl::SetEnabled(bool val) {
 class AndroidStatsConfigUtilImpl : public StatsConfigUtilInterface {
  public:
   bool IsEnabled() override {
-    Config config;
-    ConfigHandler::GetConfig(&config);
-    return config.general_config().upload_usage_stats();
+    return ConfigHandler::GetSharedConfig()
+        ->general_config()
+        .upload_usage_stats();
   }
   bool SetEnabled(bool val) override {
     // TODO(horo): Implement this.
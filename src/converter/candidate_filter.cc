@@ -227,6 +227,7 @@ CandidateFilter::CandidateFilter(
     const SuppressionDictionary *suppression_dictionary,
     const PosMatcher *pos_matcher, const SuggestionFilter &suggestion_filter)
     : suppression_dictionary_(suppression_dictionary),
+      suppression_snapshot_(suppression_dictionary->GetSnapshot()),
       pos_matcher_(pos_matcher),
       suggestion_filter_(suggestion_filter),
       top_candidate_(nullptr) {
@@ -237,6 +238,7 @@ CandidateFilter::CandidateFilter(
 void CandidateFilter::Reset() {
   seen_.clear();
   top_candidate_ = nullptr;
+  suppression_snapshot_ = suppression_dictionary_->GetSnapshot();
 }
 
 CandidateFilter::ResultType CandidateFilter::CheckRequestType(
@@ -344,12 +346,11 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
   }
 
   // Remove "抑制単語" just in case.
-  if (suppression_dictionary_->SuppressEntry(candidate->key,
-                                             candidate->value) ||
+  if (suppression_snapshot_.SuppressEntry(candidate->key, candidate->value) ||
       (candidate->key != candidate->content_key &&
        candidate->value != candidate->content_value &&
-       suppression_dictionary_->SuppressEntry(candidate->content_key,
-                                              candidate->content_value))) {
+       suppression_snapshot_.SuppressEntry(candidate->content_key,
+                                           candidate->content_value))) {
     MOZC_CANDIDATE_LOG(candidate, "SuppressEntry");
     return CandidateFilter::BAD_CANDIDATE;
   }
@@ -125,6 +125,9 @@ class CandidateFilter {
                                      absl::Span<const Node *const> nodes);
 
   const dictionary::SuppressionDictionary *suppression_dictionary_;
+  // Taken at Reset() so that the candidates are checked without loading the
+  // entries for each of them.
+  dictionary::SuppressionDictionary::Snapshot suppression_snapshot_;
   const dictionary::PosMatcher *pos_matcher_;
   const SuggestionFilter &suggestion_filter_;
 
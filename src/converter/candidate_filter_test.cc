@@ -547,13 +547,12 @@ TEST_P(CandidateFilterTestWithParam, Regression3437022) {
   request_->set_request_type(type);
   EXPECT_EQ(filter->FilterCandidate(*request_, "test_key", c1, n, n),
             CandidateFilter::GOOD_CANDIDATE);
-  // Clear the internal set |seen_| to prevent "test_key" from being filtered by
-  // "seen" rule.
-  filter->Reset();
-
   suppression_dictionary_.Lock();
   suppression_dictionary_.AddEntry("test_key", "test_value");
   suppression_dictionary_.UnLock();
+  // Clear the internal set |seen_| to prevent "test_key" from being filtered by
+  // "seen" rule. The filter also sees the edits after Reset().
+  filter->Reset();
 
   EXPECT_EQ(filter->FilterCandidate(*request_, c1->key, c1, n, n),
             CandidateFilter::BAD_CANDIDATE);
@@ -569,6 +568,7 @@ TEST_P(CandidateFilterTestWithParam, Regression3437022) {
   suppression_dictionary_.Lock();
   suppression_dictionary_.Clear();
   suppression_dictionary_.UnLock();
+  filter->Reset();
 
   EXPECT_EQ(filter->FilterCandidate(*request_, "test_key_suffix", c1, n, n),
             CandidateFilter::GOOD_CANDIDATE);
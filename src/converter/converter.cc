@@ -40,6 +40,7 @@
 #include "base/japanese_util.h"
 #include "base/logging.h"
 #include "base/strings/assign.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/immutable_converter_interface.h"
@@ -52,6 +53,7 @@
 #include "rewriter/rewriter_interface.h"
 #include "transliteration/transliteration.h"
 #include "usage_stats/usage_stats.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 
@@ -74,6 +76,20 @@ size_t GetSegmentIndex(const Segments *segments, size_t segment_index) {
   return result;
 }
 
+// Appends the candidates of |source| whose values are not in |target| yet.
+void AppendNewCandidates(const Segment &source, Segment *target) {
+  absl::flat_hash_set<absl::string_view> values;
+  for (size_t i = 0; i < target->candidates_size(); ++i) {
+    values.insert(target->candidate(i).value);
+  }
+  for (size_t i = 0; i < source.candidates_size(); ++i) {
+    const Segment::Candidate &candidate = source.candidate(i);
+    if (values.insert(candidate.value).second) {
+      *target->add_candidate() = candidate;
+    }
+  }
+}
+
 void SetKey(Segments *segments, const absl::string_view key) {
   segments->set_max_history_segments_size(4);
   segments->clear_conversion_segments();
@@ -276,6 +292,7 @@ void ConverterImpl::Init(const PosMatcher *pos_matcher,
 
 bool ConverterImpl::StartConversionForRequest(
     const ConversionRequest &original_request, Segments *segments) const {
+  const TraceSpan span("ConverterImpl::StartConversion");
   ConversionRequest request = CreateConversionRequestWithType(
       original_request, ConversionRequest::CONVERSION);
   if (!request.has_composer()) {
@@ -303,6 +320,7 @@ bool ConverterImpl::StartConversionForRequest(
 
 bool ConverterImpl::StartConversion(Segments *segments,
                                     const absl::string_view key) const {
+  const TraceSpan span("ConverterImpl::StartConversion");
   if (key.empty()) {
     return false;
   }
@@ -860,6 +878,49 @@ bool ConverterImpl::ResizeSegment(
   return true;
 }
 
+bool ConverterImpl::ExpandCandidates(const ConversionRequest &original_request,
+                                     Segments *segments, size_t segment_index,
+                                     size_t size) const {
+  segment_index = GetSegmentIndex(segments, segment_index);
+  if (segment_index == kErrorIndex || size == 0) {
+    return false;
+  }
+  Segment *segment = segments->mutable_segment(segment_index);
+  Segment::CandidateGenerator *generator = segment->candidate_generator();
+  if (generator == nullptr) {
+    return false;
+  }
+  const ConversionRequest request = CreateConversionRequestWithType(
+      original_request, ConversionRequest::CONVERSION);
+
+  // The new candidates are generated and rewritten in a separate Segments
+  // having the same history, so that the rewriters don't touch the candidates
+  // already shown to the user.
+  Segments expanded_segments;
+  expanded_segments.set_resized(segments->resized());
+  for (size_t i = 0; i < segments->history_segments_size(); ++i) {
+    *expanded_segments.push_back_segment() = segments->history_segment(i);
+  }
+  Segment *expanded_segment = expanded_segments.push_back_segment();
+  expanded_segment->set_segment_type(segment->segment_type());
+  expanded_segment->set_key(segment->key());
+  if (generator->Generate(request, size, expanded_segment) == 0) {
+    segment->set_candidate_generator(nullptr);
+    return false;
+  }
+  RewriteAndSuppressCandidates(request, &expanded_segments);
+
+  const size_t old_size = segment->candidates_size();
+  AppendNewCandidates(expanded_segments.conversion_segment(0), segment);
+  const size_t expanded_size = segment->candidates_size();
+  TrimCandidates(request, segments);
+  if (segment->candidates_size() < expanded_size) {
+    // Reached the size limit of the request.
+    segment->set_candidate_generator(nullptr);
+  }
+  return segment->candidates_size() > old_size;
+}
+
 void ConverterImpl::CompletePosIds(Segment::Candidate *candidate) const {
   DCHECK(candidate);
   if (candidate->value.empty() || candidate->key.empty()) {
@@ -920,14 +981,44 @@ void ConverterImpl::CompletePosIds(Segment::Candidate *candidate) const {
            << "rid: " << candidate->rid;
 }
 
+void ConverterImpl::GenerateRequiredCandidates(
+    const ConversionRequest &request, Segments *segments) const {
+  for (size_t i = segments->history_segments_size();
+       i < segments->segments_size(); ++i) {
+    Segment *segment = segments->mutable_segment(i);
+    Segment::CandidateGenerator *generator = segment->candidate_generator();
+    if (generator == nullptr) {
+      continue;
+    }
+    const size_t required_size =
+        rewriter_->GetRequiredCandidatesSize(request, *segments, i);
+    if (required_size <= segment->candidates_size()) {
+      continue;
+    }
+    // The dummy candidates added after the initial ones may have the same
+    // values as the generated ones.
+    Segment generated_segment;
+    generated_segment.set_key(segment->key());
+    if (generator->Generate(request, required_size - segment->candidates_size(),
+                            &generated_segment) == 0) {
+      segment->set_candidate_generator(nullptr);
+      continue;
+    }
+    AppendNewCandidates(generated_segment, segment);
+  }
+}
+
 void ConverterImpl::RewriteAndSuppressCandidates(
     const ConversionRequest &request, Segments *segments) const {
+  GenerateRequiredCandidates(request, segments);
   if (!rewriter_->Rewrite(request, segments)) {
     return;
   }
   // Optimization for common use case: Since most of users don't use suppression
   // dictionary and we can skip the subsequent check.
-  if (suppression_dictionary_->IsEmpty()) {
+  const SuppressionDictionary::Snapshot suppression =
+      suppression_dictionary_->GetSnapshot();
+  if (suppression.IsEmpty()) {
     return;
   }
   // Although the suppression dictionary is applied at node-level in dictionary
@@ -938,7 +1029,7 @@ void ConverterImpl::RewriteAndSuppressCandidates(
     Segment *seg = segments->mutable_conversion_segment(i);
     for (size_t j = 0; j < seg->candidates_size();) {
       const Segment::Candidate &cand = seg->candidate(j);
-      if (suppression_dictionary_->SuppressEntry(cand.key, cand.value)) {
+      if (suppression.SuppressEntry(cand.key, cand.value)) {
         seg->erase_candidate(j);
       } else {
         ++j;
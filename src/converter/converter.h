@@ -130,6 +130,10 @@ class ConverterImpl final : public ConverterInterface {
       Segments *segments, const ConversionRequest &request,
       size_t start_segment_index, size_t segments_size,
       absl::Span<const uint8_t> new_size_array) const override;
+  ABSL_MUST_USE_RESULT bool ExpandCandidates(const ConversionRequest &request,
+                                             Segments *segments,
+                                             size_t segment_index,
+                                             size_t size) const override;
 
  private:
   FRIEND_TEST(ConverterTest, CompletePosIds);
@@ -159,6 +163,11 @@ class ConverterImpl final : public ConverterInterface {
   static void MaybeSetConsumedKeySizeToSegment(size_t consumed_key_size,
                                                Segment *segment);
 
+  // Generates the candidates of the lazily converted segments up to the size
+  // the rewriters require.
+  void GenerateRequiredCandidates(const ConversionRequest &request,
+                                  Segments *segments) const;
+
   // Rewrites and applies the suppression dictionary.
   void RewriteAndSuppressCandidates(const ConversionRequest &request,
                                     Segments *segments) const;
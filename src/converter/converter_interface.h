@@ -182,6 +182,14 @@ class ConverterInterface {
       size_t start_segment_index, size_t segments_size,
       absl::Span<const uint8_t> new_size_array) const = 0;
 
+  // Appends up to |size| candidates which were left ungenerated by the initial
+  // conversion (see ConversionRequest::initial_conversion_candidates_size()) to
+  // the segment_index-th conversion segment. Returns false when no candidate
+  // is added.
+  ABSL_MUST_USE_RESULT virtual bool ExpandCandidates(
+      const ConversionRequest &request, Segments *segments,
+      size_t segment_index, size_t size) const = 0;
+
  protected:
   ConverterInterface() = default;
 };
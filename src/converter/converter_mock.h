@@ -99,6 +99,10 @@ class StrictMockConverter : public ConverterInterface {
                size_t start_segment_index, size_t segments_size,
                absl::Span<const uint8_t> new_size_array),
               (const, override));
+  MOCK_METHOD(bool, ExpandCandidates,
+              (const ConversionRequest &request, Segments *segments,
+               size_t segment_index, size_t size),
+              (const, override));
 };
 
 typedef ::testing::NiceMock<StrictMockConverter> MockConverter;
@@ -1652,6 +1652,42 @@ TEST_F(ConverterTest, LimitCandidatesSize) {
             original_meta_candidates_size);
 }
 
+TEST_F(ConverterTest, LazyConversionPromotesLearnedCandidate) {
+  std::unique_ptr<EngineInterface> engine =
+      MockDataEngineFactory::Create().value();
+  ConverterInterface *converter = engine->GetConverter();
+
+  composer::Table table;
+  const config::Config &config = config::ConfigHandler::DefaultConfig();
+  mozc::commands::Request request_proto;
+  mozc::composer::Composer composer(&table, &request_proto, &config);
+  composer.InsertCharacterPreedit("し");
+  ConversionRequest request(&composer, &request_proto, &config);
+  request.set_initial_conversion_candidates_size(27);
+  constexpr size_t kLearnedIndex = 40;
+
+  // The user pages down to the 41st candidate and commits it.
+  std::string learned_value;
+  {
+    Segments segments;
+    ASSERT_TRUE(converter->StartConversionForRequest(request, &segments));
+    ASSERT_EQ(segments.conversion_segments_size(), 1);
+    ASSERT_LE(segments.conversion_segment(0).candidates_size(), kLearnedIndex);
+    while (segments.conversion_segment(0).candidates_size() <= kLearnedIndex) {
+      ASSERT_TRUE(converter->ExpandCandidates(request, &segments, 0, 27));
+    }
+    learned_value =
+        segments.conversion_segment(0).candidate(kLearnedIndex).value;
+    ASSERT_TRUE(converter->CommitSegmentValue(&segments, 0, kLearnedIndex));
+    converter->FinishConversion(request, &segments);
+  }
+
+  Segments segments;
+  ASSERT_TRUE(converter->StartConversionForRequest(request, &segments));
+  ASSERT_EQ(segments.conversion_segments_size(), 1);
+  EXPECT_EQ(segments.conversion_segment(0).candidate(0).value, learned_value);
+}
+
 TEST_F(ConverterTest, UserEntryShouldBePromoted) {
   using user_dictionary::UserDictionary;
   std::vector<UserDefinedEntry> user_defined_entries;
@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <climits>
 #include <cstddef>
 #include <cstdint>
@@ -43,6 +44,8 @@
 #include "base/container/trie.h"
 #include "base/japanese_util.h"
 #include "base/logging.h"
+#include "base/strings/unicode.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "converter/connector.h"
 #include "converter/key_corrector.h"
@@ -58,16 +61,22 @@
 #include "dictionary/pos_group.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/token_view.h"
 #include "prediction/suggestion_filter.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "absl/algorithm/container.h"
+#include "absl/flags/flag.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 
+ABSL_FLAG(int32_t, lattice_lookup_threads, 1,
+          "Number of threads sharing the dictionary lookups when the lattice "
+          "is built for a long key. 1 disables the parallel lookup.");
+
 namespace mozc {
 namespace {
 
@@ -76,6 +85,7 @@ using ::mozc::dictionary::PosGroup;
 using ::mozc::dictionary::PosMatcher;
 using ::mozc::dictionary::SuppressionDictionary;
 using ::mozc::dictionary::Token;
+using ::mozc::dictionary::TokenViewBuffer;
 
 constexpr size_t kMaxSegmentsSize = 256;
 constexpr size_t kMaxCharLength = 1024;
@@ -84,6 +94,12 @@ constexpr int kMaxCost = 32767;
 constexpr int kMinCost = -32767;
 constexpr int kDefaultNumberCost = 3000;
 
+// Parallel lookup is used only for keys of at least this size in bytes
+// (about 32 hiragana characters). For shorter keys, starting the threads costs
+// more than the lookups themselves.
+constexpr size_t kMinKeySizeForParallelLookup = 96;
+constexpr int kMaxLookupThreads = 8;
+
 bool IsMobileRequest(const ConversionRequest &request) {
   return request.request().mixed_conversion();
 }
@@ -246,12 +262,50 @@ void NormalizeHistorySegments(Segments *segments) {
   }
 }
 
+// Resumes the n-best search of a conversion segment when the candidates
+// beyond the initial ones are requested.
+class LazyNBestGenerator : public Segment::CandidateGenerator {
+ public:
+  LazyNBestGenerator(std::unique_ptr<NBestGenerator> nbest_generator,
+                     std::string original_key, size_t remaining_size)
+      : nbest_generator_(std::move(nbest_generator)),
+        original_key_(std::move(original_key)),
+        remaining_size_(remaining_size) {}
+
+  size_t Generate(const ConversionRequest &request, size_t size,
+                  Segment *segment) override {
+    const size_t expected_size = std::min(size, remaining_size_);
+    if (expected_size == 0) {
+      return 0;
+    }
+    const size_t old_size = segment->candidates_size();
+    nbest_generator_->SetCandidates(request, original_key_,
+                                    old_size + expected_size, segment);
+    const size_t generated_size = segment->candidates_size() - old_size;
+    // Fewer candidates than expected means the search space is exhausted.
+    remaining_size_ =
+        generated_size < expected_size ? 0 : remaining_size_ - generated_size;
+    return generated_size;
+  }
+
+ private:
+  std::unique_ptr<NBestGenerator> nbest_generator_;
+  const std::string original_key_;
+  size_t remaining_size_;
+};
+
 Lattice *GetLattice(Segments *segments, bool is_prediction) {
   Lattice *lattice = segments->mutable_cached_lattice();
   if (lattice == nullptr) {
     return nullptr;
   }
 
+  // The lazy generators point to the nodes of the lattice which is going to be
+  // modified or cleared.
+  for (size_t i = 0; i < segments->segments_size(); ++i) {
+    segments->mutable_segment(i)->set_candidate_generator(nullptr);
+  }
+
   const size_t history_segments_size = segments->history_segments_size();
 
   std::string history_key = "";
@@ -710,34 +764,11 @@ bool ImmutableConverterImpl::ResegmentPersonalName(size_t pos,
   return modified;
 }
 
-namespace {
-
-class NodeListBuilderWithCacheEnabled : public NodeListBuilderForLookupPrefix {
- public:
-  NodeListBuilderWithCacheEnabled(NodeAllocator *allocator,
-                                  size_t min_key_length,
-                                  const SpatialCostParams &spatial_cost_params)
-      : NodeListBuilderForLookupPrefix(allocator, allocator->max_nodes_size(),
-                                       min_key_length, spatial_cost_params) {
-    DCHECK(allocator);
-  }
-
-  ResultType OnToken(absl::string_view key, absl::string_view actual_key,
-                     const Token &token) override {
-    Node *node = NewNodeFromToken(token);
-    node->attributes |= Node::ENABLE_CACHE;
-    node->raw_wcost = node->wcost;
-    PrependNode(node);
-    return (limit_ <= 0) ? TRAVERSE_DONE : TRAVERSE_CONTINUE;
-  }
-};
-
-}  // namespace
-
 Node *ImmutableConverterImpl::Lookup(const int begin_pos, const int end_pos,
                                      const ConversionRequest &request,
                                      bool is_reverse, bool is_prediction,
-                                     Lattice *lattice) const {
+                                     Lattice *lattice,
+                                     TokenViewBuffer *tokens) const {
   CHECK_LE(begin_pos, end_pos);
   const char *begin = lattice->key().data() + begin_pos;
   const char *end = lattice->key().data() + end_pos;
@@ -753,27 +784,111 @@ Node *ImmutableConverterImpl::Lookup(const int begin_pos, const int end_pos,
                                &builder);
     result_node = builder.result();
   } else {
+    const size_t min_key_length =
+        is_prediction ? lattice->cache_info(begin_pos) + 1 : 0;
+    result_node = LookupPrefixNodes(absl::string_view(begin, len), request,
+                                    is_prediction, min_key_length,
+                                    lattice->node_allocator(), tokens);
     if (is_prediction) {
-      NodeListBuilderWithCacheEnabled builder(
-          lattice->node_allocator(), lattice->cache_info(begin_pos) + 1,
-          GetSpatialCostParams(request));
-      dictionary_->LookupPrefix(absl::string_view(begin, len), request,
-                                &builder);
-      result_node = builder.result();
       lattice->SetCacheInfo(begin_pos, len);
-    } else {
-      // When cache feature is not used, look up normally
-      BaseNodeListBuilder builder(lattice->node_allocator(),
-                                  lattice->node_allocator()->max_nodes_size(),
-                                  GetSpatialCostParams(request));
-      dictionary_->LookupPrefix(absl::string_view(begin, len), request,
-                                &builder);
-      result_node = builder.result();
     }
   }
   return AddCharacterTypeBasedNodes(begin, end, lattice, result_node);
 }
 
+Node *ImmutableConverterImpl::LookupPrefixNodes(
+    absl::string_view key, const ConversionRequest &request,
+    bool is_prediction, size_t min_key_length, NodeAllocator *allocator,
+    TokenViewBuffer *tokens) const {
+  allocator->set_max_nodes_size(8192);
+  if (min_key_length > key.size()) {
+    // All the prefixes were looked up by the previous request.
+    return nullptr;
+  }
+  // Tokens are looked up in a batch and then converted to nodes, which
+  // avoids virtual calls per dictionary entry. The buffer keeps its arena
+  // across positions, so the lookup doesn't allocate once it is warm.
+  tokens->Clear();
+  tokens->set_max_size(allocator->max_nodes_size());
+  tokens->set_min_key_length(min_key_length);
+  dictionary_->LookupPrefixBatch(key, request, tokens);
+  BaseNodeListBuilder builder(allocator, allocator->max_nodes_size(),
+                              GetSpatialCostParams(request));
+  builder.AddTokens(tokens->tokens());
+  if (is_prediction) {
+    for (Node *node = builder.result(); node != nullptr; node = node->bnext) {
+      node->attributes |= Node::ENABLE_CACHE;
+      node->raw_wcost = node->wcost;
+    }
+  }
+  return builder.result();
+}
+
+bool ImmutableConverterImpl::LookupPrefixNodesInParallel(
+    const ConversionRequest &request, bool is_prediction, size_t begin_pos,
+    Lattice *lattice, std::vector<Node *> *nodes,
+    std::vector<bool> *looked_up) const {
+  const std::string &key = lattice->key();
+  const int num_threads = std::min(absl::GetFlag(FLAGS_lattice_lookup_threads),
+                                   kMaxLookupThreads);
+  if (num_threads <= 1 ||
+      key.size() - begin_pos < kMinKeySizeForParallelLookup) {
+    return false;
+  }
+
+  // Every character boundary gets a node ending there from
+  // AddCharacterTypeBasedNodes(), so they are the positions looked up by the
+  // serial loop.
+  std::vector<size_t> positions;
+  for (size_t pos = begin_pos; pos < key.size();
+       pos += strings::OneCharLen(key.data() + pos)) {
+    positions.push_back(pos);
+  }
+  std::vector<size_t> min_key_lengths(positions.size(), 0);
+  if (is_prediction) {
+    for (size_t i = 0; i < positions.size(); ++i) {
+      min_key_lengths[i] = lattice->cache_info(positions[i]) + 1;
+    }
+  }
+
+  nodes->assign(key.size(), nullptr);
+  looked_up->assign(key.size(), false);
+  // std::vector<bool> can't be written from multiple threads, so each worker
+  // records the results in this array first.
+  std::vector<char> done(positions.size(), 0);
+  std::atomic<size_t> next_index = 0;
+  auto worker = [&](NodeAllocator *allocator) {
+    TokenViewBuffer tokens;
+    size_t num_lookups = 0;
+    for (size_t i = next_index++; i < positions.size(); i = next_index++) {
+      if (num_lookups++ % ConversionRequest::kDeadlineCheckInterval == 0 &&
+          request.IsDeadlineExceeded()) {
+        return;
+      }
+      const size_t pos = positions[i];
+      (*nodes)[pos] = LookupPrefixNodes(absl::string_view(key).substr(pos),
+                                        request, is_prediction,
+                                        min_key_lengths[i], allocator, &tokens);
+      done[i] = 1;
+    }
+  };
+  {
+    std::vector<Thread> threads;
+    threads.reserve(num_threads - 1);
+    for (int i = 1; i < num_threads; ++i) {
+      threads.emplace_back(worker, lattice->worker_node_allocator(i - 1));
+    }
+    worker(lattice->node_allocator());
+    for (Thread &thread : threads) {
+      thread.Join();
+    }
+  }
+  for (size_t i = 0; i < positions.size(); ++i) {
+    (*looked_up)[positions[i]] = done[i];
+  }
+  return true;
+}
+
 Node *ImmutableConverterImpl::AddCharacterTypeBasedNodes(const char *begin,
                                                          const char *end,
                                                          Lattice *lattice,
@@ -1108,6 +1223,8 @@ bool ImmutableConverterImpl::PredictionViterbi(const Segments &segments,
   }
   PredictionViterbiInternal(0, history_length, lattice);
   PredictionViterbiInternal(history_length, key_length, lattice);
+  // The forward costs are recorded for all the positions before the end.
+  lattice->set_viterbi_dirty_pos(key_length);
 
   Node *node = lattice->eos_nodes();
   CHECK(node->bnext == nullptr);
@@ -1172,6 +1289,31 @@ void ImmutableConverterImpl::PredictionViterbiInternal(int calc_begin_pos,
       }
     }
 
+    // When the lattice is updated by a key event, the best costs for each rid
+    // are likely to be the same as the last run at the positions before the
+    // updated part. The forward costs of the nodes starting there are then
+    // still valid, and only their prev needs to be redirected in case the
+    // best left node has been re-created. Note that the costs are recorded
+    // only for the positions inside [calc_begin_pos, calc_end_pos) so that
+    // the boundary position is not confused between the two passes.
+    bool reuse_costs = false;
+    if (pos < calc_end_pos) {
+      Lattice::ViterbiCosts *costs = lattice->mutable_viterbi_costs(pos);
+      reuse_costs =
+          pos < lattice->viterbi_dirty_pos() && costs->size() == lbest.size() &&
+          std::equal(lbest.begin(), lbest.end(), costs->begin(),
+                     [](const BestMap::value_type &l,
+                        const std::pair<int, int> &r) {
+                       return l.first == r.first && l.second.first == r.second;
+                     });
+      if (!reuse_costs) {
+        costs->clear();
+        for (const BestMap::value_type &best : lbest) {
+          costs->emplace_back(best.first, best.second.first);
+        }
+      }
+    }
+
     if (lbest.empty()) {
       continue;
     }
@@ -1182,6 +1324,14 @@ void ImmutableConverterImpl::PredictionViterbiInternal(int calc_begin_pos,
       if (rnode->end_pos > calc_end_pos) {
         continue;
       }
+      if (reuse_costs && rnode->prev != nullptr) {
+        const BestMap::iterator iter = LowerBound(
+            lbest, BestMap::value_type(rnode->prev->rid, kInvalidValue));
+        if (iter != lbest.end() && iter->first == rnode->prev->rid) {
+          rnode->prev = iter->second.second;
+          continue;
+        }
+      }
       const BestMap::value_type key(rnode->lid, kInvalidValue);
       const BestMap::const_iterator iter = LowerBound(rbest, key);
       if (iter == rbest.end() || iter->first != rnode->lid) {
@@ -1452,7 +1602,8 @@ bool ImmutableConverterImpl::MakeLattice(const ConversionRequest &request,
   // Note:
   // For mobile, we decided to stop adding predictive nodes based on
   // experiments.
-  if (is_prediction && !IsMobileRequest(request)) {
+  if (is_prediction && !IsMobileRequest(request) &&
+      !request.IsDeadlineExceeded()) {
     MakeLatticeNodesForPredictiveNodes(*segments, request, lattice);
   }
 
@@ -1554,8 +1705,9 @@ bool ImmutableConverterImpl::MakeLatticeNodesForHistorySegments(
         (request.request_type() == ConversionRequest::SUGGESTION ||
          request.request_type() == ConversionRequest::PREDICTION);
     if (!is_prediction && s + 1 == history_segments_size) {
+      TokenViewBuffer tokens;
       const Node *node = Lookup(segments_pos, key.size(), request, is_reverse,
-                                is_prediction, lattice);
+                                is_prediction, lattice, &tokens);
       for (const Node *compound_node = node; compound_node != nullptr;
            compound_node = compound_node->bnext) {
         // No overlapps
@@ -1652,10 +1804,50 @@ void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
   const bool is_prediction =
       (request.request_type() == ConversionRequest::SUGGESTION ||
        request.request_type() == ConversionRequest::PREDICTION);
+  // In the parallel mode, the dictionary lookups for all the positions are
+  // done up front by the workers. The nodes are then inserted in the order of
+  // positions as in the serial mode, so the resulting lattice is the same.
+  std::vector<Node *> looked_up_nodes;
+  std::vector<bool> looked_up;
+  const bool is_parallel =
+      !is_reverse &&
+      LookupPrefixNodesInParallel(request, is_prediction, history_key.size(),
+                                  lattice, &looked_up_nodes, &looked_up);
+  // Shared by the serial lookups of all the positions.
+  TokenViewBuffer tokens;
+  const bool has_deadline = request.has_deadline();
+  bool is_deadline_exceeded = false;
+  size_t num_lookups = 0;
   for (size_t pos = history_key.size(); pos < key.size(); ++pos) {
     if (lattice->end_nodes(pos) != nullptr) {
-      Node *rnode =
-          Lookup(pos, key.size(), request, is_reverse, is_prediction, lattice);
+      // The positions looked up by the previous requests cost no dictionary
+      // lookup, so they don't wait for the deadline.
+      const bool is_cached =
+          is_prediction && lattice->cache_info(pos) >= key.size() - pos;
+      if (!is_cached && has_deadline && !is_deadline_exceeded &&
+          num_lookups++ % ConversionRequest::kDeadlineCheckInterval == 0) {
+        is_deadline_exceeded = request.IsDeadlineExceeded();
+      }
+      // After the deadline, only the character type based nodes are added so
+      // that the lattice is still connected and Viterbi finds a path.
+      if (!is_cached && is_deadline_exceeded) {
+        lattice->Insert(pos, AddCharacterTypeBasedNodes(
+                                 key.data() + pos, key.data() + key.size(),
+                                 lattice, nullptr));
+        continue;
+      }
+      Node *rnode = nullptr;
+      if (is_parallel && looked_up[pos]) {
+        if (is_prediction) {
+          lattice->SetCacheInfo(pos, key.size() - pos);
+        }
+        rnode = AddCharacterTypeBasedNodes(key.data() + pos,
+                                           key.data() + key.size(), lattice,
+                                           looked_up_nodes[pos]);
+      } else {
+        rnode = Lookup(pos, key.size(), request, is_reverse, is_prediction,
+                       lattice, &tokens);
+      }
       // If history key is NOT empty and user input seems to starts with
       // a particle ("はにで..."), mark the node as STARTS_WITH_PARTICLE.
       // We change the segment boundary if STARTS_WITH_PARTICLE attribute
@@ -1688,12 +1880,21 @@ void ImmutableConverterImpl::ApplyPrefixSuffixPenalty(
     // If history-segments is non-empty, we can make the
     // penalty smaller so that history context is more likely
     // selected.
-    node->wcost += segmenter_->GetPrefixPenalty(node->lid);
+    const int penalty = segmenter_->GetPrefixPenalty(node->lid);
+    if (penalty != 0) {
+      node->wcost += penalty;
+      // Let PredictionViterbi recompute the forward cost of the cached node.
+      node->prev = nullptr;
+    }
   }
 
   for (Node *node = lattice->end_nodes(key.size()); node != nullptr;
        node = node->enext) {
-    node->wcost += segmenter_->GetSuffixPenalty(node->rid);
+    const int penalty = segmenter_->GetSuffixPenalty(node->rid);
+    if (penalty != 0) {
+      node->wcost += penalty;
+      node->prev = nullptr;
+    }
   }
 }
 
@@ -1885,6 +2086,14 @@ void ImmutableConverterImpl::InsertCandidates(const ConversionRequest &request,
   const size_t expand_size =
       std::max<size_t>(1, std::min<size_t>(512, max_candidates_size));
 
+  // For conversion, only the first |initial_size| candidates are generated
+  // here and the rest is left to the lazy generator set to each segment.
+  const size_t initial_size = request.initial_conversion_candidates_size();
+  const bool generate_lazily =
+      type == MULTI_SEGMENTS &&
+      request.request_type() == ConversionRequest::CONVERSION &&
+      initial_size > 0 && initial_size < expand_size;
+
   const bool is_single_segment =
       (type == SINGLE_SEGMENT || type == FIRST_INNER_SEGMENT);
   NBestGenerator nbest_generator(suppression_dictionary_, segmenter_,
@@ -1925,8 +2134,23 @@ void ImmutableConverterImpl::InsertCandidates(const ConversionRequest &request,
           NBestGenerator::BUILD_FROM_ONLY_FIRST_INNER_SEGMENT;
       options.candidate_mode |= NBestGenerator::FILL_INNER_SEGMENT_INFO;
     }
-    nbest_generator.Reset(prev, node->next, options);
-    nbest_generator.SetCandidates(request, original_key, expand_size, segment);
+    if (generate_lazily) {
+      auto lazy_nbest_generator = std::make_unique<NBestGenerator>(
+          suppression_dictionary_, segmenter_, connector_, pos_matcher_,
+          &lattice, suggestion_filter_);
+      lazy_nbest_generator->Reset(prev, node->next, options);
+      lazy_nbest_generator->SetCandidates(request, original_key, initial_size,
+                                          segment);
+      if (segment->candidates_size() >= initial_size) {
+        segment->set_candidate_generator(std::make_unique<LazyNBestGenerator>(
+            std::move(lazy_nbest_generator), original_key,
+            expand_size - segment->candidates_size()));
+      }
+    } else {
+      nbest_generator.Reset(prev, node->next, options);
+      nbest_generator.SetCandidates(request, original_key, expand_size,
+                                    segment);
+    }
 
     if (type == MULTI_SEGMENTS || type == SINGLE_SEGMENT) {
       InsertDummyCandidates(segment, expand_size);
@@ -2187,6 +2411,9 @@ bool ImmutableConverterImpl::ConvertForRequest(const ConversionRequest &request,
     return false;
   }
 
+  // If the deadline was exceeded, the cached lattice keeps the nodes looked up
+  // so far. The positions skipped have no cache info, so the next request,
+  // e.g. the next key event, resumes the lookup from them.
   return true;
 }
 
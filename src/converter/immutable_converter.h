@@ -40,16 +40,19 @@
 #include "converter/lattice.h"
 #include "converter/nbest_generator.h"
 #include "converter/node.h"
+#include "converter/node_allocator.h"
 #include "converter/segmenter.h"
 #include "converter/segments.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_group.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/token_view.h"
 #include "prediction/suggestion_filter.h"
 #include "request/conversion_request.h"
 #include "testing/gunit_prod.h"  //  for FRIEND_TEST()
 #include "absl/base/attributes.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 
 namespace mozc {
@@ -75,10 +78,13 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   FRIEND_TEST(ImmutableConverterTest, AddPredictiveNodes);
   FRIEND_TEST(ImmutableConverterTest, DummyCandidatesCost);
   FRIEND_TEST(ImmutableConverterTest, DummyCandidatesInnerSegmentBoundary);
+  FRIEND_TEST(ImmutableConverterTest, IncrementalPredictionViterbi);
   FRIEND_TEST(ImmutableConverterTest, NotConnectedTest);
+  FRIEND_TEST(ImmutableConverterTest, ParallelLatticeLookup);
   FRIEND_TEST(ImmutableConverterTest, PredictiveNodesOnlyForConversionKey);
   FRIEND_TEST(NBestGeneratorTest, InnerSegmentBoundary);
   FRIEND_TEST(NBestGeneratorTest, MultiSegmentConnectionTest);
+  FRIEND_TEST(NBestGeneratorTest, ResumedEnumeration);
   FRIEND_TEST(NBestGeneratorTest, SingleSegmentConnectionTest);
   friend class NBestGeneratorTest;
 
@@ -97,8 +103,27 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
                         const std::string &original_key, NBestGenerator *nbest,
                         Segment *segment, size_t expand_size) const;
   void InsertDummyCandidates(Segment *segment, size_t expand_size) const;
+  // `tokens` is the scratch buffer for the dictionary lookup, which is reused
+  // across the positions of a conversion.
   Node *Lookup(int begin_pos, int end_pos, const ConversionRequest &request,
-               bool is_reverse, bool is_prediction, Lattice *lattice) const;
+               bool is_reverse, bool is_prediction, Lattice *lattice,
+               dictionary::TokenViewBuffer *tokens) const;
+  // Looks up the dictionary for the prefixes of `key` and returns the nodes
+  // allocated from `allocator`. It doesn't touch the lattice, so it can be
+  // called from the lookup workers, each with its own `tokens`.
+  Node *LookupPrefixNodes(absl::string_view key,
+                          const ConversionRequest &request, bool is_prediction,
+                          size_t min_key_length, NodeAllocator *allocator,
+                          dictionary::TokenViewBuffer *tokens) const;
+  // Runs LookupPrefixNodes() for every character position in
+  // [begin_pos, key size) of the lattice key on multiple threads, and stores
+  // the results in (*nodes)[pos]. (*looked_up)[pos] is false for positions
+  // skipped due to the deadline. Returns false without doing anything if the
+  // parallel lookup is disabled or the key is short.
+  bool LookupPrefixNodesInParallel(const ConversionRequest &request,
+                                   bool is_prediction, size_t begin_pos,
+                                   Lattice *lattice, std::vector<Node *> *nodes,
+                                   std::vector<bool> *looked_up) const;
   Node *AddCharacterTypeBasedNodes(const char *begin, const char *end,
                                    Lattice *lattice, Node *nodes) const;
 
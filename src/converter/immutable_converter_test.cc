@@ -38,6 +38,8 @@
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/logging.h"
 #include "base/util.h"
 #include "converter/connector.h"
@@ -63,8 +65,14 @@
 #include "session/request_test_util.h"
 #include "testing/gmock.h"
 #include "testing/gunit.h"
+#include "absl/flags/declare.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/flags/flag.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+ABSL_DECLARE_FLAG(int32_t, lattice_lookup_threads);
 
 namespace mozc {
 namespace {
@@ -195,6 +203,122 @@ TEST(ImmutableConverterTest, KeepKeyForPrediction) {
   EXPECT_EQ(segments.segment(0).key(), kRequestKey);
 }
 
+TEST(ImmutableConverterTest, ExceededDeadline) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  const std::string kRequestKey = "よろしくおねがいします";
+  for (const ConversionRequest::RequestType type :
+       {ConversionRequest::CONVERSION, ConversionRequest::PREDICTION}) {
+    Segments segments;
+    ConversionRequest request;
+    request.set_request_type(type);
+    request.set_max_conversion_candidates_size(10);
+    request.set_deadline(absl::InfinitePast());
+    segments.add_segment()->set_key(kRequestKey);
+
+    // The best path is still returned without the dictionary lookup.
+    EXPECT_TRUE(data_and_converter->GetConverter()->ConvertForRequest(
+        request, &segments));
+    std::string value;
+    for (size_t i = 0; i < segments.segments_size(); ++i) {
+      ASSERT_GT(segments.segment(i).candidates_size(), 0);
+      value += segments.segment(i).candidate(0).value;
+    }
+    EXPECT_EQ(value, kRequestKey);
+    if (type == ConversionRequest::PREDICTION) {
+      // The lattice is kept, but no position is marked as looked up.
+      const Lattice &lattice = *segments.mutable_cached_lattice();
+      ASSERT_TRUE(lattice.has_lattice());
+      for (size_t pos = 0; pos < lattice.key().size(); ++pos) {
+        EXPECT_EQ(lattice.cache_info(pos), 0) << pos;
+      }
+    }
+  }
+}
+
+TEST(ImmutableConverterTest, ResumeLookupAfterDeadline) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  // Every clock read advances the time by a second, and the clock is read once
+  // every kDeadlineCheckInterval positions. So a deadline in N seconds allows
+  // about N * kDeadlineCheckInterval positions to be looked up.
+  ScopedClockMock clock(absl::FromUnixSeconds(1000));
+  clock->AutoAdvance(absl::Seconds(1));
+
+  const std::string kKey = "わたしのなまえはなかのですきょうはいいてんき";
+  Segments segments;
+  segments.add_segment()->set_key(kKey);
+  const Lattice &lattice = *segments.mutable_cached_lattice();
+  auto num_looked_up = [&lattice] {
+    size_t num = 0;
+    for (size_t pos = 0; pos < lattice.key().size(); ++pos) {
+      num += lattice.cache_info(pos) > 0;
+    }
+    return num;
+  };
+  ConversionRequest request;
+  request.set_request_type(ConversionRequest::PREDICTION);
+  request.set_max_conversion_candidates_size(10);
+
+  request.set_deadline(Clock::GetAbslTime() + absl::Seconds(3));
+  ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+  const size_t first = num_looked_up();
+  EXPECT_GT(first, 0);
+  EXPECT_LT(first, Util::CharsLen(kKey));
+
+  // The next request with the same budget skips the positions looked up and
+  // continues from the rest.
+  segments.mutable_segment(0)->clear_candidates();
+  request.set_deadline(Clock::GetAbslTime() + absl::Seconds(3));
+  ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+  EXPECT_GT(num_looked_up(), first);
+}
+
+TEST(ImmutableConverterTest, LazyConversionCandidates) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  const std::string kRequestKey = "きょう";
+  ConversionRequest request;
+  request.set_max_conversion_candidates_size(30);
+
+  Segments eager_segments;
+  eager_segments.add_segment()->set_key(kRequestKey);
+  ASSERT_TRUE(data_and_converter->GetConverter()->ConvertForRequest(
+      request, &eager_segments));
+  ASSERT_EQ(eager_segments.segments_size(), 1);
+  const Segment &eager_segment = eager_segments.segment(0);
+  EXPECT_EQ(eager_segment.candidate_generator(), nullptr);
+  ASSERT_GT(eager_segment.candidates_size(), 3);
+
+  request.set_initial_conversion_candidates_size(3);
+  Segments lazy_segments;
+  lazy_segments.add_segment()->set_key(kRequestKey);
+  ASSERT_TRUE(data_and_converter->GetConverter()->ConvertForRequest(
+      request, &lazy_segments));
+  ASSERT_EQ(lazy_segments.segments_size(), 1);
+  Segment *lazy_segment = lazy_segments.mutable_segment(0);
+  ASSERT_NE(lazy_segment->candidate_generator(), nullptr);
+  ASSERT_GE(lazy_segment->candidates_size(), 3);
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(lazy_segment->candidate(i).value,
+              eager_segment.candidate(i).value);
+  }
+
+  // The rest of the n-best candidates are generated on demand.
+  while (lazy_segment->candidate_generator()->Generate(request, 5,
+                                                       lazy_segment) > 0) {
+  }
+  absl::flat_hash_set<std::string> lazy_values;
+  for (size_t i = 0; i < lazy_segment->candidates_size(); ++i) {
+    lazy_values.insert(lazy_segment->candidate(i).value);
+  }
+  for (size_t i = 0; i < eager_segment.candidates_size(); ++i) {
+    EXPECT_TRUE(lazy_values.contains(eager_segment.candidate(i).value))
+        << eager_segment.candidate(i).value;
+  }
+}
+
 TEST(ImmutableConverterTest, DummyCandidatesCost) {
   std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
       new MockDataAndImmutableConverter);
@@ -422,6 +546,95 @@ TEST(ImmutableConverterTest, NotConnectedTest) {
   EXPECT_TRUE(tested);
 }
 
+TEST(ImmutableConverterTest, ParallelLatticeLookup) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+
+  // Long enough to enable the parallel lookup.
+  std::string key;
+  for (int i = 0; i < 8; ++i) {
+    key.append("わたしのなまえはなかのです");
+  }
+
+  auto make_lattice = [&](int num_threads, Lattice *lattice) {
+    absl::SetFlag(&FLAGS_lattice_lookup_threads, num_threads);
+    Segments segments;
+    Segment *segment = segments.add_segment();
+    segment->set_segment_type(Segment::FREE);
+    segment->set_key(key);
+    lattice->SetKey(key);
+    const ConversionRequest request;
+    EXPECT_TRUE(converter->MakeLattice(request, &segments, lattice));
+  };
+  const int original_threads = absl::GetFlag(FLAGS_lattice_lookup_threads);
+  Lattice serial_lattice, parallel_lattice;
+  make_lattice(1, &serial_lattice);
+  make_lattice(4, &parallel_lattice);
+  absl::SetFlag(&FLAGS_lattice_lookup_threads, original_threads);
+
+  // Both lattices have the same nodes in the same order.
+  for (size_t pos = 0; pos <= key.size(); ++pos) {
+    const Node *expected = serial_lattice.begin_nodes(pos);
+    const Node *actual = parallel_lattice.begin_nodes(pos);
+    for (; expected != nullptr && actual != nullptr;
+         expected = expected->bnext, actual = actual->bnext) {
+      EXPECT_EQ(actual->key, expected->key);
+      EXPECT_EQ(actual->value, expected->value);
+      EXPECT_EQ(actual->lid, expected->lid);
+      EXPECT_EQ(actual->rid, expected->rid);
+      EXPECT_EQ(actual->wcost, expected->wcost);
+      EXPECT_EQ(actual->end_pos, expected->end_pos);
+      EXPECT_EQ(actual->attributes, expected->attributes);
+    }
+    EXPECT_EQ(expected, nullptr) << pos;
+    EXPECT_EQ(actual, nullptr) << pos;
+  }
+}
+
+TEST(ImmutableConverterTest, IncrementalPredictionViterbi) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+
+  const std::string kKey = "わたしのなまえはなかのです";
+  Segments segments;
+  ConversionRequest request;
+  request.set_request_type(ConversionRequest::PREDICTION);
+  request.set_max_conversion_candidates_size(10);
+  Segment *segment = segments.add_segment();
+  Lattice *lattice = segments.mutable_cached_lattice();
+
+  // Types the key one character (3 bytes in UTF-8) at a time so that the
+  // cached lattice and its forward costs are reused.
+  for (size_t len = 6; len <= kKey.size(); len += 3) {
+    segment->clear_candidates();
+    segment->set_key(kKey.substr(0, len));
+    ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+    EXPECT_EQ(lattice->viterbi_dirty_pos(), len);
+
+    std::vector<std::pair<int, const Node *>> incremental;
+    for (size_t pos = 0; pos <= len; ++pos) {
+      for (const Node *node = lattice->begin_nodes(pos); node != nullptr;
+           node = node->bnext) {
+        incremental.emplace_back(node->cost, node->prev);
+      }
+    }
+
+    // The forward costs are the same as those computed from scratch.
+    lattice->set_viterbi_dirty_pos(0);
+    ASSERT_TRUE(converter->PredictionViterbi(segments, lattice));
+    std::vector<std::pair<int, const Node *>> full;
+    for (size_t pos = 0; pos <= len; ++pos) {
+      for (const Node *node = lattice->begin_nodes(pos); node != nullptr;
+           node = node->bnext) {
+        full.emplace_back(node->cost, node->prev);
+      }
+    }
+    EXPECT_EQ(incremental, full) << kKey.substr(0, len);
+  }
+}
+
 TEST(ImmutableConverterTest, HistoryKeyLengthIsVeryLong) {
   // "あ..." (100 times)
   const std::string kA100 =
@@ -156,12 +156,29 @@ void Lattice::SetKey(std::string key) {
   begin_nodes_.resize(size + 4, nullptr);
   end_nodes_.resize(size + 4, nullptr);
   cache_info_.resize(size + 4, 0);
+  viterbi_costs_.resize(size + 4);
 
   end_nodes_[0] = InitBOSNode(this, static_cast<uint16_t>(0));
   begin_nodes_[key_.size()] =
       InitEOSNode(this, static_cast<uint16_t>(key_.size()));
 }
 
+NodeAllocator *Lattice::worker_node_allocator(size_t index) {
+  while (worker_node_allocators_.size() <= index) {
+    worker_node_allocators_.push_back(std::make_unique<NodeAllocator>());
+  }
+  return worker_node_allocators_[index].get();
+}
+
+size_t Lattice::node_count() const {
+  size_t node_count = node_allocator_->node_count();
+  for (const std::unique_ptr<NodeAllocator> &allocator :
+       worker_node_allocators_) {
+    node_count += allocator->node_count();
+  }
+  return node_count;
+}
+
 void Lattice::Insert(size_t pos, Node *node) {
   for (Node *rnode = node; rnode != nullptr; rnode = rnode->bnext) {
     const size_t end_pos = std::min(rnode->key.size() + pos, key_.size());
@@ -192,8 +209,13 @@ void Lattice::Clear() {
   begin_nodes_.clear();
   end_nodes_.clear();
   node_allocator_->Free();
+  for (std::unique_ptr<NodeAllocator> &allocator : worker_node_allocators_) {
+    allocator->Free();
+  }
   cache_info_.clear();
   history_end_pos_ = 0;
+  viterbi_dirty_pos_ = 0;
+  viterbi_costs_.clear();
 }
 
 void Lattice::SetDebugDisplayNode(size_t begin_pos, size_t end_pos,
@@ -220,7 +242,7 @@ void Lattice::UpdateKey(const absl::string_view new_key) {
 
   // if node_allocator has many nodes, then clean up
   const size_t size_threshold = node_allocator_->max_nodes_size();
-  if (node_allocator_->node_count() > size_threshold) {
+  if (node_count() > size_threshold) {
     SetKey(std::string(new_key));
     return;
   }
@@ -253,6 +275,10 @@ void Lattice::AddSuffix(const absl::string_view suffix_key) {
   // update cache_info
   cache_info_.resize(new_size + 4, 0);
 
+  // The forward costs from the old end are no longer valid.
+  viterbi_costs_.resize(new_size + 4);
+  viterbi_dirty_pos_ = std::min(viterbi_dirty_pos_, old_size);
+
   // update key
   absl::StrAppend(&key_, suffix_key);
 }
@@ -299,6 +325,9 @@ void Lattice::ShrinkKey(const size_t new_len) {
   }
   std::fill(cache_info_.begin() + new_len, cache_info_.end(), 0);
 
+  // The nodes ending before new_len are kept as is, so are their costs.
+  viterbi_dirty_pos_ = std::min(viterbi_dirty_pos_, new_len);
+
   // update key
   key_.erase(new_len);
 }
@@ -316,7 +345,11 @@ void Lattice::ResetNodeCost() {
         // if the node has ENABLE_CACHE attribute, then revert its wcost.
         // Otherwise, erase the node from the lattice.
         if (node->attributes & Node::ENABLE_CACHE) {
-          node->wcost = node->raw_wcost;
+          if (node->wcost != node->raw_wcost) {
+            node->wcost = node->raw_wcost;
+            // Let Viterbi recompute the forward cost with the reverted wcost.
+            node->prev = nullptr;
+          }
         } else {
           if (node == begin_nodes_[i]) {
             if (node->bnext == nullptr) {
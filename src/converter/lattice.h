@@ -32,6 +32,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/logging.h"
@@ -49,6 +50,15 @@ class Lattice {
 
   NodeAllocator *node_allocator() const { return node_allocator_.get(); }
 
+  // Returns the node allocator for the `index`-th dictionary lookup worker,
+  // creating it if necessary. Each worker allocates nodes from its own
+  // allocator so that no locking is needed. The nodes belong to this lattice
+  // and are freed by Clear() together with those from node_allocator().
+  NodeAllocator *worker_node_allocator(size_t index);
+
+  // Returns the number of nodes allocated by all the allocators.
+  size_t node_count() const;
+
   // set key and initializes lattice with key.
   void SetKey(std::string key);
 
@@ -115,6 +125,22 @@ class Lattice {
   // process for some heuristic methods.
   void ResetNodeCost();
 
+  // Position from which Viterbi has to recompute the forward costs, i.e.
+  // Node::cost and Node::prev. Before this position, the costs recorded in
+  // viterbi_costs() by the last run are still valid, and so are the forward
+  // costs of the nodes except for those whose prev is reset to nullptr.
+  // ShrinkKey() and AddSuffix() move it back to the first changed position.
+  size_t viterbi_dirty_pos() const { return viterbi_dirty_pos_; }
+  void set_viterbi_dirty_pos(size_t pos) { viterbi_dirty_pos_ = pos; }
+
+  // Pairs of (rid, best forward cost) of the nodes ending at |pos|, sorted by
+  // rid, as recorded by the last Viterbi run.
+  using ViterbiCosts = std::vector<std::pair<int, int>>;
+  ViterbiCosts *mutable_viterbi_costs(size_t pos) {
+    DCHECK_LE(pos, key_.size());
+    return &viterbi_costs_[pos];
+  }
+
   // Dump the best path and the path that contains the designated string.
   std::string DebugString() const;
 
@@ -132,11 +158,15 @@ class Lattice {
   std::vector<Node *> begin_nodes_;
   std::vector<Node *> end_nodes_;
   std::unique_ptr<NodeAllocator> node_allocator_;
+  std::vector<std::unique_ptr<NodeAllocator>> worker_node_allocators_;
 
   // cache_info_ holds cache information about lookup.
   // If cache_info_[pos] equals to len, it means key.substr(pos, k)
   // (1 <= k <= len) is already looked up.
   std::vector<size_t> cache_info_;
+
+  size_t viterbi_dirty_pos_ = 0;
+  std::vector<ViterbiCosts> viterbi_costs_;
 };
 
 }  // namespace mozc
@@ -0,0 +1,119 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures the conversion time of long keys with the mock data engine while
+// changing the number of threads for the parallel lattice lookup
+// (--lattice_lookup_threads). 1 thread is the serial lookup.
+//
+// Usage:
+//   lattice_lookup_benchmark_main --iterations=20
+
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "base/init_mozc.h"
+#include "base/stopwatch.h"
+#include "base/util.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "engine/engine.h"
+#include "engine/mock_data_engine_factory.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "absl/log/check.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(int32_t, iterations, 20, "number of conversions per configuration");
+
+ABSL_DECLARE_FLAG(int32_t, lattice_lookup_threads);
+
+namespace mozc {
+namespace {
+
+constexpr int kKeyLengths[] = {16, 32, 64, 128, 256};
+constexpr int kThreads[] = {1, 2, 4, 8};
+
+// Returns a key of `length` characters by repeating a sentence.
+std::string MakeKey(int length) {
+  constexpr char32_t kSentence[] = U"わたしのなまえはなかのですきょうはいいてんき";
+  std::u32string key;
+  for (int i = 0; i < length; ++i) {
+    key.push_back(kSentence[i % (std::size(kSentence) - 1)]);
+  }
+  return Util::Utf32ToUtf8(key);
+}
+
+absl::Duration Measure(const ConverterInterface &converter,
+                       const std::string &key) {
+  const int iterations = absl::GetFlag(FLAGS_iterations);
+  Segments segments;
+  // Warm up.
+  CHECK(converter.StartConversion(&segments, key));
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (int i = 0; i < iterations; ++i) {
+    CHECK(converter.StartConversion(&segments, key));
+  }
+  return stopwatch.GetElapsed() / iterations;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+
+  std::unique_ptr<mozc::Engine> engine =
+      mozc::MockDataEngineFactory::Create().value();
+  const mozc::ConverterInterface *converter = engine->GetConverter();
+  CHECK(converter);
+
+  std::cout << absl::StrFormat("%8s", "chars");
+  for (const int threads : mozc::kThreads) {
+    std::cout << absl::StrFormat(" %9d th", threads);
+  }
+  std::cout << std::endl;
+  for (const int length : mozc::kKeyLengths) {
+    const std::string key = mozc::MakeKey(length);
+    std::cout << absl::StrFormat("%8d", length);
+    for (const int threads : mozc::kThreads) {
+      absl::SetFlag(&FLAGS_lattice_lookup_threads, threads);
+      const absl::Duration time = mozc::Measure(*converter, key);
+      std::cout << absl::StrFormat(" %9.1fus",
+                                   absl::ToDoubleMicroseconds(time));
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
@@ -33,6 +33,7 @@
 #include <string>
 
 #include "converter/node.h"
+#include "converter/node_allocator.h"
 #include "testing/gunit.h"
 #include "absl/container/btree_set.h"
 
@@ -67,6 +68,25 @@ TEST(LatticeTest, NewNodeTest) {
   EXPECT_EQ(node->rid, 0);
 }
 
+TEST(LatticeTest, WorkerNodeAllocatorTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+  NodeAllocator *allocator0 = lattice.worker_node_allocator(0);
+  NodeAllocator *allocator1 = lattice.worker_node_allocator(1);
+  EXPECT_NE(allocator0, allocator1);
+  EXPECT_NE(allocator0, lattice.node_allocator());
+  EXPECT_EQ(lattice.worker_node_allocator(0), allocator0);
+
+  Node *node = allocator1->NewNode();
+  node->key = "te";
+  lattice.Insert(0, node);
+  EXPECT_EQ(lattice.begin_nodes(0), node);
+  EXPECT_EQ(allocator1->node_count(), 1);
+
+  lattice.Clear();
+  EXPECT_EQ(allocator1->node_count(), 0);
+}
+
 TEST(LatticeTest, InsertTest) {
   Lattice lattice;
 
@@ -221,4 +241,62 @@ TEST(LatticeTest, ShrinkKeyTest) {
     }
   }
 }
+
+TEST(LatticeTest, ViterbiDirtyPosTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+  EXPECT_EQ(lattice.viterbi_dirty_pos(), 0);
+
+  lattice.set_viterbi_dirty_pos(4);
+  lattice.mutable_viterbi_costs(1)->emplace_back(10, 100);
+  lattice.AddSuffix("s");
+  EXPECT_EQ(lattice.viterbi_dirty_pos(), 4);
+  EXPECT_EQ(lattice.mutable_viterbi_costs(1)->size(), 1);
+
+  lattice.set_viterbi_dirty_pos(5);
+  lattice.ShrinkKey(2);
+  EXPECT_EQ(lattice.viterbi_dirty_pos(), 2);
+  lattice.AddSuffix("sts");
+  EXPECT_EQ(lattice.viterbi_dirty_pos(), 2);
+
+  // UpdateKey keeps the common prefix "tes".
+  lattice.set_viterbi_dirty_pos(5);
+  lattice.UpdateKey("tesla");
+  EXPECT_EQ(lattice.viterbi_dirty_pos(), 3);
+
+  lattice.Clear();
+  EXPECT_EQ(lattice.viterbi_dirty_pos(), 0);
+}
+
+TEST(LatticeTest, ResetNodeCostInvalidatesForwardCost) {
+  Lattice lattice;
+  lattice.SetKey("ab");
+
+  Node *cached = lattice.NewNode();
+  cached->key = "a";
+  cached->attributes |= Node::ENABLE_CACHE;
+  cached->raw_wcost = 100;
+  cached->wcost = 100;
+  cached->bnext = nullptr;
+  lattice.Insert(0, cached);
+
+  Node *penalized = lattice.NewNode();
+  penalized->key = "b";
+  penalized->attributes |= Node::ENABLE_CACHE;
+  penalized->raw_wcost = 100;
+  penalized->wcost = 100;
+  penalized->bnext = nullptr;
+  lattice.Insert(1, penalized);
+
+  cached->prev = lattice.bos_nodes();
+  penalized->prev = cached;
+  penalized->wcost += 500;
+
+  lattice.ResetNodeCost();
+  // The forward cost of the node whose wcost is unchanged stays valid.
+  EXPECT_EQ(cached->prev, lattice.bos_nodes());
+  EXPECT_EQ(penalized->wcost, 100);
+  EXPECT_EQ(penalized->prev, nullptr);
+}
+
 }  // namespace mozc
@@ -30,6 +30,7 @@
 #include "converter/nbest_generator.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <iterator>
@@ -47,6 +48,7 @@
 #include "dictionary/suppression_dictionary.h"
 #include "prediction/suggestion_filter.h"
 #include "request/conversion_request.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace {
@@ -128,6 +130,24 @@ void NBestGenerator::Reset(const Node *begin_node, const Node *end_node,
 
   begin_node_ = begin_node;
   end_node_ = end_node;
+  expansions_.clear();
+  expansion_ranges_.clear();
+
+  // Marks the positions from which |begin_node_| can be reached by following
+  // the lattice nodes leftwards.
+  const size_t left_pos = begin_node_->end_pos;
+  const size_t right_pos = std::max<size_t>(left_pos, end_node_->begin_pos);
+  reachable_.assign(right_pos - left_pos + 1, false);
+  reachable_[0] = true;
+  for (size_t pos = left_pos + 1; pos <= right_pos; ++pos) {
+    for (const Node *lnode = lattice_->end_nodes(pos); lnode != nullptr;
+         lnode = lnode->enext) {
+      if (IsReachable(lnode->begin_pos)) {
+        reachable_[pos - left_pos] = true;
+        break;
+      }
+    }
+  }
 
   for (Node *node = lattice_->begin_nodes(end_node_->begin_pos);
        node != nullptr; node = node->bnext) {
@@ -315,7 +335,16 @@ void NBestGenerator::SetCandidates(const ConversionRequest &request,
     return;
   }
 
+  const bool has_deadline = request.has_deadline();
+  size_t num_iterations = 0;
   while (segment->candidates_size() < expand_size) {
+    // Returns the candidates found so far once the deadline is exceeded. The
+    // first one is the Viterbi best result.
+    if (has_deadline && segment->candidates_size() > 0 &&
+        num_iterations++ % ConversionRequest::kDeadlineCheckInterval == 0 &&
+        request.IsDeadlineExceeded()) {
+      break;
+    }
     Segment::Candidate *candidate = segment->push_back_candidate();
     DCHECK(candidate);
 
@@ -425,120 +454,154 @@ bool NBestGenerator::Next(const ConversionRequest &request,
 
     DCHECK_NE(rnode->end_pos, begin_node_->end_pos);
 
-    const QueueElement *best_left_elm = nullptr;
-    const bool is_right_edge = rnode->begin_pos == end_node_->begin_pos;
-    const bool is_left_edge = rnode->begin_pos == begin_node_->end_pos;
-    DCHECK(!(is_right_edge && is_left_edge));
+    for (const Expansion &expansion : GetExpansions(rnode)) {
+      const int32_t gx = expansion.cost_diff + top->gx;
+      // |lnode->cost| is heuristics function of A* search, h(x).
+      // After Viterbi search, we already know an exact value of h(x).
+      // f(x) = h(x) + g(x): cost for the path
+      const int32_t fx = expansion.lnode->cost + gx;
+      const int32_t structure_gx =
+          expansion.structure_cost_diff + top->structure_gx;
+      const int32_t w_gx = expansion.wcost_diff + top->w_gx;
+      agenda_.Push(
+          CreateNewElement(expansion.lnode, top, fx, gx, structure_gx, w_gx));
+    }
+  }
 
-    // is_edge is true if current lnode/rnode has same boundary as
-    // begin/end node regardless of its value.
-    const bool is_edge = (is_right_edge || is_left_edge);
+  return false;
+}
 
-    for (Node *lnode = lattice_->end_nodes(rnode->begin_pos); lnode != nullptr;
-         lnode = lnode->enext) {
-      // is_invalid_position is true if the lnode's location is invalid
-      //  1.   |<-- begin_node_-->|
-      //                    |<--lnode-->|  <== overlapped.
-      //
-      //  2.   |<-- begin_node_-->|
-      //         |<--lnode-->|    <== exceeds begin_node.
-      // This case can't be happened because the |rnode| is always at just
-      // right of the |lnode|. By avoiding case1, this can't be happen.
-      //  2'.  |<-- begin_node_-->|
-      //         |<--lnode-->||<--rnode-->|
-      const bool is_valid_position =
-          !((lnode->begin_pos < begin_node_->end_pos &&
-             begin_node_->end_pos < lnode->end_pos));
-      if (!is_valid_position) {
-        continue;
-      }
+bool NBestGenerator::IsReachable(size_t pos) const {
+  const size_t left_pos = begin_node_->end_pos;
+  return pos >= left_pos && pos - left_pos < reachable_.size() &&
+         reachable_[pos - left_pos];
+}
 
-      // If left_node is left edge, there is a cost-based constraint.
-      const bool is_valid_cost = (lnode->cost - begin_node_->cost) <= kCostDiff;
-      if (is_left_edge && !is_valid_cost) {
-        continue;
-      }
+absl::Span<const NBestGenerator::Expansion> NBestGenerator::GetExpansions(
+    const Node *rnode) {
+  const auto [it, inserted] = expansion_ranges_.try_emplace(rnode);
+  if (inserted) {
+    it->second.first = expansions_.size();
+    AppendExpansions(rnode);
+    it->second.second = expansions_.size();
+  }
+  return absl::MakeConstSpan(expansions_)
+      .subspan(it->second.first, it->second.second - it->second.first);
+}
 
-      // We can omit the search for the node which has the
-      // same rid with |begin_node_| because:
-      //  1. |begin_node_| is the part of the best route.
-      //  2. The cost diff of 'LEFT_EDGE' is decided only by
-      //     transition_cost for lnode.
-      // Actually, checking for each rid once is enough.
-      const bool can_omit_search =
-          lnode->rid == begin_node_->rid && lnode != begin_node_;
-      if (is_left_edge && can_omit_search) {
-        continue;
-      }
+void NBestGenerator::AppendExpansions(const Node *rnode) {
+  const bool is_right_edge = rnode->begin_pos == end_node_->begin_pos;
+  const bool is_left_edge = rnode->begin_pos == begin_node_->end_pos;
+  DCHECK(!(is_right_edge && is_left_edge));
+
+  // is_edge is true if current lnode/rnode has same boundary as
+  // begin/end node regardless of its value.
+  const bool is_edge = (is_right_edge || is_left_edge);
+
+  Expansion best_left_expansion = {nullptr, 0, 0, 0};
+  for (Node *lnode = lattice_->end_nodes(rnode->begin_pos); lnode != nullptr;
+       lnode = lnode->enext) {
+    // is_invalid_position is true if the lnode's location is invalid
+    //  1.   |<-- begin_node_-->|
+    //                    |<--lnode-->|  <== overlapped.
+    //
+    //  2.   |<-- begin_node_-->|
+    //         |<--lnode-->|    <== exceeds begin_node.
+    // This case can't be happened because the |rnode| is always at just
+    // right of the |lnode|. By avoiding case1, this can't be happen.
+    //  2'.  |<-- begin_node_-->|
+    //         |<--lnode-->||<--rnode-->|
+    const bool is_valid_position =
+        !((lnode->begin_pos < begin_node_->end_pos &&
+           begin_node_->end_pos < lnode->end_pos));
+    if (!is_valid_position) {
+      continue;
+    }
 
-      const BoundaryCheckResult boundary_result =
-          BoundaryCheck(lnode, rnode, is_edge);
-      if (boundary_result == INVALID) {
-        continue;
-      }
+    // No path from |lnode| reaches |begin_node_|.
+    if (!is_left_edge && !IsReachable(lnode->begin_pos)) {
+      continue;
+    }
 
-      // We can expand candidates from |rnode| to |lnode|.
-      const int transition_cost = GetTransitionCost(lnode, rnode);
-
-      // How likely the costs get increased after expanding rnode.
-      int cost_diff = 0;
-      int structure_cost_diff = 0;
-      int wcost_diff = 0;
-
-      if (is_right_edge) {
-        // use |rnode->cost - end_node_->cost| is an approximation
-        // of marginalized word cost.
-        cost_diff = transition_cost + (rnode->cost - end_node_->cost);
-        structure_cost_diff = 0;
-        wcost_diff = 0;
-      } else if (is_left_edge) {
-        // use |lnode->cost - begin_node_->cost| is an approximation
-        // of marginalized word cost.
-        cost_diff =
-            transition_cost + rnode->wcost + (lnode->cost - begin_node_->cost);
-        structure_cost_diff = 0;
-        wcost_diff = rnode->wcost;
-      } else {
-        // use rnode->wcost.
-        cost_diff = transition_cost + rnode->wcost;
-        structure_cost_diff = transition_cost;
-        wcost_diff = transition_cost + rnode->wcost;
-      }
+    // If left_node is left edge, there is a cost-based constraint.
+    const bool is_valid_cost = (lnode->cost - begin_node_->cost) <= kCostDiff;
+    if (is_left_edge && !is_valid_cost) {
+      continue;
+    }
 
-      if (boundary_result == VALID_WEAK_CONNECTED) {
-        constexpr int kWeakConnectedPenalty = 3453;  // log prob of 1/1000
-        cost_diff += kWeakConnectedPenalty;
-        structure_cost_diff += kWeakConnectedPenalty / 2;
-        wcost_diff += kWeakConnectedPenalty / 2;
-      }
+    // We can omit the search for the node which has the
+    // same rid with |begin_node_| because:
+    //  1. |begin_node_| is the part of the best route.
+    //  2. The cost diff of 'LEFT_EDGE' is decided only by
+    //     transition_cost for lnode.
+    // Actually, checking for each rid once is enough.
+    const bool can_omit_search =
+        lnode->rid == begin_node_->rid && lnode != begin_node_;
+    if (is_left_edge && can_omit_search) {
+      continue;
+    }
 
-      const int32_t gx = cost_diff + top->gx;
-      // |lnode->cost| is heuristics function of A* search, h(x).
-      // After Viterbi search, we already know an exact value of h(x).
-      // f(x) = h(x) + g(x): cost for the path
-      const int32_t fx = lnode->cost + gx;
-      const int32_t structure_gx = structure_cost_diff + top->structure_gx;
-      const int32_t w_gx = wcost_diff + top->w_gx;
-      if (is_left_edge) {
-        // We only need to only 1 left node here.
-        // Even if expand all left nodes, all the |value| part should
-        // be identical. Here, we simply use the best left edge node.
-        // This hack reduces the number of redundant calls of pop().
-        if (best_left_elm == nullptr || best_left_elm->fx > fx) {
-          best_left_elm =
-              CreateNewElement(lnode, top, fx, gx, structure_gx, w_gx);
-        }
-      } else {
-        agenda_.Push(CreateNewElement(lnode, top, fx, gx, structure_gx, w_gx));
-      }
+    const BoundaryCheckResult boundary_result =
+        BoundaryCheck(lnode, rnode, is_edge);
+    if (boundary_result == INVALID) {
+      continue;
+    }
+
+    // We can expand candidates from |rnode| to |lnode|.
+    const int transition_cost = GetTransitionCost(lnode, rnode);
+
+    // How likely the costs get increased after expanding rnode.
+    int cost_diff = 0;
+    int structure_cost_diff = 0;
+    int wcost_diff = 0;
+
+    if (is_right_edge) {
+      // use |rnode->cost - end_node_->cost| is an approximation
+      // of marginalized word cost.
+      cost_diff = transition_cost + (rnode->cost - end_node_->cost);
+      structure_cost_diff = 0;
+      wcost_diff = 0;
+    } else if (is_left_edge) {
+      // use |lnode->cost - begin_node_->cost| is an approximation
+      // of marginalized word cost.
+      cost_diff =
+          transition_cost + rnode->wcost + (lnode->cost - begin_node_->cost);
+      structure_cost_diff = 0;
+      wcost_diff = rnode->wcost;
+    } else {
+      // use rnode->wcost.
+      cost_diff = transition_cost + rnode->wcost;
+      structure_cost_diff = transition_cost;
+      wcost_diff = transition_cost + rnode->wcost;
     }
 
-    if (best_left_elm != nullptr) {
-      agenda_.Push(best_left_elm);
+    if (boundary_result == VALID_WEAK_CONNECTED) {
+      constexpr int kWeakConnectedPenalty = 3453;  // log prob of 1/1000
+      cost_diff += kWeakConnectedPenalty;
+      structure_cost_diff += kWeakConnectedPenalty / 2;
+      wcost_diff += kWeakConnectedPenalty / 2;
+    }
+
+    const Expansion expansion = {lnode, cost_diff, structure_cost_diff,
+                                 wcost_diff};
+    if (is_left_edge) {
+      // We only need to only 1 left node here.
+      // Even if expand all left nodes, all the |value| part should
+      // be identical. Here, we simply use the best left edge node.
+      // This hack reduces the number of redundant calls of pop().
+      if (best_left_expansion.lnode == nullptr ||
+          best_left_expansion.lnode->cost + best_left_expansion.cost_diff >
+              lnode->cost + cost_diff) {
+        best_left_expansion = expansion;
+      }
+    } else {
+      expansions_.push_back(expansion);
     }
   }
 
-  return false;
+  if (best_left_expansion.lnode != nullptr) {
+    expansions_.push_back(best_left_expansion);
+  }
 }
 
 NBestGenerator::BoundaryCheckResult NBestGenerator::BoundaryCheck(
@@ -30,8 +30,10 @@
 #ifndef MOZC_CONVERTER_NBEST_GENERATOR_H_
 #define MOZC_CONVERTER_NBEST_GENERATOR_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/container/freelist.h"
@@ -45,6 +47,8 @@
 #include "dictionary/suppression_dictionary.h"
 #include "prediction/suggestion_filter.h"
 #include "request/conversion_request.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/span.h"
 
 #undef STRICT  // minwindef.h has the definition.
 
@@ -158,6 +162,23 @@ class NBestGenerator {
     std::vector<const QueueElement *> priority_queue_;
   };
 
+  // Transition from a node to one of its left nodes. The costs depend only on
+  // the pair of nodes, so they are computed once per right node and reused
+  // every time the node is popped from the agenda with a different suffix.
+  struct Expansion {
+    const Node *lnode;
+    int32_t cost_diff;
+    int32_t structure_cost_diff;
+    int32_t wcost_diff;
+  };
+
+  // Returns the valid expansions of |rnode| in the order to be pushed.
+  absl::Span<const Expansion> GetExpansions(const Node *rnode);
+  void AppendExpansions(const Node *rnode);
+
+  // Returns true if a path of lattice nodes connects |begin_node_| and |pos|.
+  bool IsReachable(size_t pos) const;
+
   // Iterator:
   // Can obtain N-best results by calling Next() in sequence.
   bool Next(const ConversionRequest &request, const std::string &original_key,
@@ -217,6 +238,16 @@ class NBestGenerator {
   bool viterbi_result_checked_ = false;
   Options options_;
 
+  // Memoized expansions. |expansion_ranges_| maps a right node to the range
+  // of its expansions in |expansions_|.
+  std::vector<Expansion> expansions_;
+  absl::flat_hash_map<const Node *, std::pair<size_t, size_t>>
+      expansion_ranges_;
+  // reachable_[i] is true if the position begin_node_->end_pos + i can be
+  // reached from |begin_node_|. Left nodes starting at unreachable positions
+  // are never completed to a candidate.
+  std::vector<bool> reachable_;
+
 #ifdef MOZC_CANDIDATE_DEBUG
   std::vector<Segment::Candidate> bad_candidates_;
 #endif  // MOZC_CANDIDATE_DEBUG
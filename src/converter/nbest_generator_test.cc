@@ -353,4 +353,53 @@ TEST_F(NBestGeneratorTest, InnerSegmentBoundary) {
   EXPECT_EQ(content_values[2], "行きたい");
 }
 
+TEST_F(NBestGeneratorTest, ResumedEnumeration) {
+  auto data_and_converter = std::make_unique<MockDataAndImmutableConverter>();
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+
+  Segments segments;
+  const std::string kInput = "きょうはいいてんきです";
+  segments.add_segment()->set_key(kInput);
+
+  Lattice lattice;
+  lattice.SetKey(kInput);
+  ConversionRequest request;
+  request.set_request_type(ConversionRequest::CONVERSION);
+  converter->MakeLattice(request, &segments, &lattice);
+
+  std::vector<uint16_t> group;
+  converter->MakeGroup(segments, &group);
+  converter->Viterbi(segments, &lattice);
+
+  std::unique_ptr<NBestGenerator> nbest_generator =
+      data_and_converter->CreateNBestGenerator(&lattice);
+
+  constexpr bool kSingleSegment = false;
+  const Node *begin_node = lattice.bos_nodes();
+  const Node *end_node = GetEndNode(request, *converter, segments, *begin_node,
+                                    group, kSingleSegment);
+  const NBestGenerator::Options options = {NBestGenerator::STRICT,
+                                           NBestGenerator::CANDIDATE_MODE_NONE};
+
+  nbest_generator->Reset(begin_node, end_node, options);
+  Segment expected_segment;
+  nbest_generator->SetCandidates(request, "", 20, &expected_segment);
+  ASSERT_GT(expected_segment.candidates_size(), 3);
+
+  // The memoized expansions are reset and reused across the calls.
+  nbest_generator->Reset(begin_node, end_node, options);
+  Segment actual_segment;
+  nbest_generator->SetCandidates(request, "", 3, &actual_segment);
+  EXPECT_EQ(actual_segment.candidates_size(), 3);
+  nbest_generator->SetCandidates(request, "", 20, &actual_segment);
+  ASSERT_EQ(actual_segment.candidates_size(),
+            expected_segment.candidates_size());
+  for (size_t i = 0; i < expected_segment.candidates_size(); ++i) {
+    EXPECT_EQ(actual_segment.candidate(i).value,
+              expected_segment.candidate(i).value);
+    EXPECT_EQ(actual_segment.candidate(i).cost,
+              expected_segment.candidate(i).cost);
+  }
+}
+
 }  // namespace mozc
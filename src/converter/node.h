@@ -34,6 +34,7 @@
 #include <string>
 
 #include "dictionary/dictionary_token.h"
+#include "dictionary/token_view.h"
 
 namespace mozc {
 
@@ -202,7 +203,9 @@ struct Node {
     value.clear();
   }
 
-  inline void InitFromToken(const dictionary::Token &token) {
+  // TokenType is either dictionary::Token or dictionary::TokenView.
+  template <typename TokenType>
+  inline void InitFromToken(const TokenType &token) {
     prev = nullptr;
     next = nullptr;
     bnext = nullptr;
@@ -227,9 +230,9 @@ struct Node {
       attributes |= USER_DICTIONARY;
       attributes |= NO_VARIANTS_EXPANSION;
     }
-    key = token.key;
+    key.assign(token.key.data(), token.key.size());
     actual_key.clear();
-    value = token.value;
+    value.assign(token.value.data(), token.value.size());
   }
 };
 
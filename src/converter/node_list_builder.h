@@ -38,9 +38,11 @@
 #include "converter/node_allocator.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/dictionary_token.h"
+#include "dictionary/token_view.h"
 #include "protocol/commands.pb.h"
 #include "request/conversion_request.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 
@@ -106,12 +108,28 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
     return (limit_ <= 0) ? TRAVERSE_DONE : TRAVERSE_CONTINUE;
   }
 
+  // Batched counterpart of OnActualKey() and OnToken() for the tokens looked
+  // up by DictionaryInterface::LookupPrefixBatch(). The resulting list is the
+  // same as the one built through the callback.
+  void AddTokens(absl::Span<const dictionary::TokenView> tokens) {
+    for (const dictionary::TokenView &token : tokens) {
+      if (limit_ <= 0) {
+        return;
+      }
+      penalty_ = token.num_expanded > 0
+                     ? spatial_cost_params_.GetPenalty(token.key)
+                     : 0;
+      PrependNode(NewNodeFromToken(token));
+    }
+  }
+
   int limit() const { return limit_; }
   int penalty() const { return penalty_; }
   Node *result() const { return result_; }
   NodeAllocator *allocator() { return allocator_; }
 
-  Node *NewNodeFromToken(const dictionary::Token &token) {
+  template <typename TokenType>
+  Node *NewNodeFromToken(const TokenType &token) {
     Node *new_node = allocator_->NewNode();
     new_node->InitFromToken(token);
     new_node->wcost += penalty_;
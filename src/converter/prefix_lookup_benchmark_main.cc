@@ -0,0 +1,204 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures the dictionary lookups of the lattice construction, i.e., the
+// prefix lookup at every character position of a long key, with the mock
+// data. Compares the callback based LookupPrefix() with LookupPrefixBatch()
+// into a buffer allocated per position and into one reused across positions.
+//
+// Usage:
+//   prefix_lookup_benchmark_main --iterations=100
+
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/init_mozc.h"
+#include "base/stopwatch.h"
+#include "base/strings/unicode.h"
+#include "base/util.h"
+#include "config/config_handler.h"
+#include "converter/node.h"
+#include "converter/node_allocator.h"
+#include "converter/node_list_builder.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "dictionary/dictionary_impl.h"
+#include "dictionary/dictionary_interface.h"
+#include "dictionary/pos_matcher.h"
+#include "dictionary/suppression_dictionary.h"
+#include "dictionary/system/system_dictionary.h"
+#include "dictionary/system/value_dictionary.h"
+#include "dictionary/token_view.h"
+#include "dictionary/user_dictionary_stub.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "absl/flags/flag.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(int32_t, iterations, 100, "number of lookups of each key");
+
+namespace mozc {
+namespace {
+
+using ::mozc::dictionary::DictionaryImpl;
+using ::mozc::dictionary::DictionaryInterface;
+using ::mozc::dictionary::PosMatcher;
+using ::mozc::dictionary::SuppressionDictionary;
+using ::mozc::dictionary::SystemDictionary;
+using ::mozc::dictionary::TokenViewBuffer;
+using ::mozc::dictionary::UserDictionaryStub;
+using ::mozc::dictionary::ValueDictionary;
+
+constexpr int kKeyLengths[] = {16, 64, 256};
+
+// Returns a key of `length` characters by repeating a sentence.
+std::string MakeKey(int length) {
+  constexpr char32_t kSentence[] = U"わたしのなまえはなかのですきょうはいいてんき";
+  std::u32string key;
+  for (int i = 0; i < length; ++i) {
+    key.push_back(kSentence[i % (std::size(kSentence) - 1)]);
+  }
+  return Util::Utf32ToUtf8(key);
+}
+
+// Returns the byte offsets of the characters of `key`.
+std::vector<size_t> GetPositions(absl::string_view key) {
+  std::vector<size_t> positions;
+  for (size_t pos = 0; pos < key.size();
+       pos += strings::OneCharLen(key.data() + pos)) {
+    positions.push_back(pos);
+  }
+  return positions;
+}
+
+class Benchmark {
+ public:
+  Benchmark() {
+    pos_matcher_.Set(data_manager_.GetPosMatcherData());
+    const char *data = nullptr;
+    int size = 0;
+    data_manager_.GetSystemDictionaryData(&data, &size);
+    std::unique_ptr<SystemDictionary> system_dictionary =
+        SystemDictionary::Builder(data, size).Build().value();
+    auto value_dictionary = std::make_unique<ValueDictionary>(
+        pos_matcher_, &system_dictionary->value_trie());
+    dictionary_ = std::make_unique<DictionaryImpl>(
+        std::move(system_dictionary), std::move(value_dictionary),
+        &user_dictionary_, &suppression_dictionary_, &pos_matcher_);
+    config::ConfigHandler::GetDefaultConfig(&config_);
+    request_.set_config(&config_);
+  }
+
+  // Runs `lookup(key, allocator)` for every position of `key` and returns the
+  // average time per key.
+  template <typename Lookup>
+  absl::Duration Measure(const std::string &key, Lookup lookup) {
+    const std::vector<size_t> positions = GetPositions(key);
+    const int iterations = absl::GetFlag(FLAGS_iterations);
+    NodeAllocator allocator;
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    for (int i = 0; i < iterations; ++i) {
+      for (const size_t pos : positions) {
+        lookup(absl::string_view(key).substr(pos), &allocator);
+      }
+      allocator.Free();
+    }
+    return stopwatch.GetElapsed() / iterations;
+  }
+
+  Node *LookupPrefix(absl::string_view key, NodeAllocator *allocator) const {
+    BaseNodeListBuilder builder(allocator, allocator->max_nodes_size(),
+                                GetSpatialCostParams(request_));
+    dictionary_->LookupPrefix(key, request_, &builder);
+    return builder.result();
+  }
+
+  Node *LookupPrefixBatch(absl::string_view key, NodeAllocator *allocator,
+                          TokenViewBuffer *tokens) const {
+    tokens->Clear();
+    tokens->set_max_size(allocator->max_nodes_size());
+    dictionary_->LookupPrefixBatch(key, request_, tokens);
+    BaseNodeListBuilder builder(allocator, allocator->max_nodes_size(),
+                                GetSpatialCostParams(request_));
+    builder.AddTokens(tokens->tokens());
+    return builder.result();
+  }
+
+ private:
+  const testing::MockDataManager data_manager_;
+  PosMatcher pos_matcher_;
+  SuppressionDictionary suppression_dictionary_;
+  UserDictionaryStub user_dictionary_;
+  std::unique_ptr<DictionaryInterface> dictionary_;
+  config::Config config_;
+  ConversionRequest request_;
+};
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+
+  mozc::Benchmark benchmark;
+  std::cout << absl::StrFormat("%8s %12s %12s %12s", "chars", "callback",
+                               "new buffer", "reused")
+            << std::endl;
+  for (const int length : mozc::kKeyLengths) {
+    const std::string key = mozc::MakeKey(length);
+    const absl::Duration callback = benchmark.Measure(
+        key, [&](absl::string_view suffix, mozc::NodeAllocator *allocator) {
+          return benchmark.LookupPrefix(suffix, allocator);
+        });
+    const absl::Duration new_buffer = benchmark.Measure(
+        key, [&](absl::string_view suffix, mozc::NodeAllocator *allocator) {
+          mozc::dictionary::TokenViewBuffer tokens;
+          return benchmark.LookupPrefixBatch(suffix, allocator, &tokens);
+        });
+    mozc::dictionary::TokenViewBuffer tokens;
+    const absl::Duration reused = benchmark.Measure(
+        key, [&](absl::string_view suffix, mozc::NodeAllocator *allocator) {
+          return benchmark.LookupPrefixBatch(suffix, allocator, &tokens);
+        });
+    std::cout << absl::StrFormat("%8d %10.1fus %10.1fus %10.1fus", length,
+                                 absl::ToDoubleMicroseconds(callback),
+                                 absl::ToDoubleMicroseconds(new_buffer),
+                                 absl::ToDoubleMicroseconds(reused))
+              << std::endl;
+  }
+  return 0;
+}
@@ -44,6 +44,8 @@
 
 #include "base/logging.h"
 #include "base/number_util.h"
+#include "converter/lattice.h"
+#include "converter/node.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 
@@ -53,7 +55,16 @@
 
 namespace mozc {
 namespace {
+
 constexpr size_t kMaxHistorySize = 32;
+
+// Returns the size of the heap buffer of `str`. Short strings are stored in
+// the object itself.
+size_t GetStringFootprint(const std::string &str) {
+  static const size_t kInlineCapacity = std::string().capacity();
+  return str.capacity() > kInlineCapacity ? str.capacity() + 1 : 0;
+}
+
 }  // namespace
 
 void Segment::Candidate::Clear() {
@@ -65,6 +76,7 @@ void Segment::Candidate::Clear() {
   prefix.clear();
   suffix.clear();
   description.clear();
+  a11y_description.clear();
   usage_title.clear();
   usage_description.clear();
   cost = 0;
@@ -75,9 +87,11 @@ void Segment::Candidate::Clear() {
   usage_id = 0;
   attributes = 0;
   source_info = SOURCE_INFO_NONE;
+  category = DEFAULT_CATEGORY;
   style = NumberUtil::NumberString::DEFAULT_STYLE;
   command = DEFAULT_COMMAND;
   inner_segment_boundary.clear();
+  cost_before_rescoring = 0;
 #ifndef NDEBUG
   log.clear();
 #endif  // NDEBUG
@@ -165,6 +179,17 @@ std::string Segment::Candidate::DebugString() const {
   return os.str();
 }
 
+size_t Segment::Candidate::GetFootprint() const {
+  return sizeof(Candidate) + GetStringFootprint(key) +
+         GetStringFootprint(value) + GetStringFootprint(content_key) +
+         GetStringFootprint(content_value) + GetStringFootprint(prefix) +
+         GetStringFootprint(suffix) + GetStringFootprint(description) +
+         GetStringFootprint(a11y_description) +
+         GetStringFootprint(usage_title) +
+         GetStringFootprint(usage_description) +
+         inner_segment_boundary.capacity() * sizeof(uint32_t);
+}
+
 void Segment::Candidate::InnerSegmentIterator::Next() {
   DCHECK_LT(index_, candidate_->inner_segment_boundary.size());
   const uint32_t encoded_lengths = candidate_->inner_segment_boundary[index_++];
@@ -235,6 +260,7 @@ Segment &Segment::operator=(const Segment &x) {
   segment_type_ = x.segment_type_;
   key_ = x.key_;
   meta_candidates_ = x.meta_candidates_;
+  candidate_generator_.reset();
 
   clear_candidates();
   DeepCopyCandidates(x.candidates_);
@@ -242,25 +268,104 @@ Segment &Segment::operator=(const Segment &x) {
   return *this;
 }
 
+namespace {
+
+void ReleaseLongString(std::string &str, const size_t max_capacity) {
+  if (str.capacity() > max_capacity) {
+    std::string().swap(str);
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<Segment::Candidate> Segment::CandidateFreeList::Pop() {
+  if (candidates_.empty()) {
+    return nullptr;
+  }
+  std::unique_ptr<Candidate> candidate = std::move(candidates_.back());
+  candidates_.pop_back();
+  return candidate;
+}
+
+void Segment::CandidateFreeList::Push(std::unique_ptr<Candidate> candidate) {
+  if (candidates_.size() >= kMaxSize) {
+    return;
+  }
+  // Candidate::Clear() keeps the capacity of the strings. Long ones, e.g. the
+  // descriptions of a few symbols, are rare and not worth keeping.
+  candidate->Clear();
+  ReleaseLongString(candidate->key, kMaxStringCapacity);
+  ReleaseLongString(candidate->value, kMaxStringCapacity);
+  ReleaseLongString(candidate->content_key, kMaxStringCapacity);
+  ReleaseLongString(candidate->content_value, kMaxStringCapacity);
+  ReleaseLongString(candidate->prefix, kMaxStringCapacity);
+  ReleaseLongString(candidate->suffix, kMaxStringCapacity);
+  ReleaseLongString(candidate->description, kMaxStringCapacity);
+  ReleaseLongString(candidate->a11y_description, kMaxStringCapacity);
+  ReleaseLongString(candidate->usage_title, kMaxStringCapacity);
+  ReleaseLongString(candidate->usage_description, kMaxStringCapacity);
+  candidates_.push_back(std::move(candidate));
+}
+
+size_t Segment::CandidateFreeList::GetFootprint() const {
+  size_t footprint =
+      candidates_.capacity() * sizeof(std::unique_ptr<Candidate>);
+  for (const std::unique_ptr<Candidate> &candidate : candidates_) {
+    footprint += candidate->GetFootprint();
+  }
+  return footprint;
+}
+
+size_t Segment::GetFootprint() const {
+  // The Segment itself is counted by the pool of the Segments.
+  size_t footprint = GetStringFootprint(key_) +
+                     pool_.capacity() * sizeof(std::unique_ptr<Candidate>);
+  for (const std::unique_ptr<Candidate> &candidate : pool_) {
+    if (candidate != nullptr) {
+      footprint += candidate->GetFootprint();
+    }
+  }
+  // Meta candidates are stored in the vector. Count its unused slots too.
+  footprint += (meta_candidates_.capacity() - meta_candidates_.size()) *
+               sizeof(Candidate);
+  for (const Candidate &candidate : meta_candidates_) {
+    footprint += candidate.GetFootprint();
+  }
+  return footprint;
+}
+
 void Segment::clear_candidates() {
-  pool_.clear();
   candidates_.clear();
+  if (free_list_ != nullptr) {
+    for (std::unique_ptr<Candidate> &candidate : pool_) {
+      if (candidate != nullptr) {
+        free_list_->Push(std::move(candidate));
+      }
+    }
+  }
+  pool_.clear();
+}
+
+Segment::Candidate *Segment::NewCandidate() {
+  if (free_list_ != nullptr) {
+    if (std::unique_ptr<Candidate> candidate = free_list_->Pop();
+        candidate != nullptr) {
+      return pool_.emplace_back(std::move(candidate)).get();
+    }
+  }
+  return pool_.emplace_back(std::make_unique<Candidate>()).get();
 }
 
 Segment::Candidate *Segment::push_back_candidate() {
-  auto candidate = std::make_unique<Candidate>();
-  Candidate *ptr = candidate.get();
-  pool_.push_back(std::move(candidate));
-  candidates_.push_back(ptr);
-  return ptr;
+  Candidate *candidate = NewCandidate();
+  candidates_.push_back(candidate);
+  return candidate;
 }
 
 Segment::Candidate *Segment::push_front_candidate() {
-  auto candidate = std::make_unique<Candidate>();
-  Candidate *ptr = candidate.get();
-  pool_.push_back(std::move(candidate));
-  candidates_.push_front(ptr);
-  return ptr;
+  Candidate *candidate = NewCandidate();
+  candidates_.push_front(candidate);
+  return candidate;
 }
 
 Segment::Candidate *Segment::insert_candidate(int i) {
@@ -274,8 +379,7 @@ Segment::Candidate *Segment::insert_candidate(int i) {
                 << candidates_.size();
     i = static_cast<int>(candidates_.size());
   }
-  Candidate *candidate =
-      pool_.emplace_back(std::make_unique<Candidate>()).get();
+  Candidate *candidate = NewCandidate();
   candidates_.insert(candidates_.begin() + i, candidate);
   return candidate;
 }
@@ -398,6 +502,7 @@ void Segment::Clear() {
   clear_candidates();
   key_.clear();
   meta_candidates_.clear();
+  candidate_generator_.reset();
   segment_type_ = FREE;
 }
 
@@ -405,9 +510,9 @@ void Segment::DeepCopyCandidates(const std::deque<Candidate *> &candidates) {
   DCHECK(pool_.empty());
   pool_.reserve(candidates.size());
   for (const Candidate *cand : candidates) {
-    auto new_cand = std::make_unique<Candidate>(*cand);
-    candidates_.push_back(new_cand.get());
-    pool_.push_back(std::move(new_cand));
+    Candidate *new_cand = NewCandidate();
+    *new_cand = *cand;
+    candidates_.push_back(new_cand);
   }
 }
 
@@ -458,23 +563,32 @@ Segments &Segments::operator=(const Segments &x) {
   return *this;
 }
 
-Segment *Segments::insert_segment(size_t i) {
+Segment *Segments::NewSegment() {
   Segment *segment = pool_.Alloc();
+  segment->free_list_ = &free_list_;
+  segment->Clear();
+  return segment;
+}
+
+void Segments::ReleaseSegment(Segment *segment) {
   segment->Clear();
+  pool_.Release(segment);
+}
+
+Segment *Segments::insert_segment(size_t i) {
+  Segment *segment = NewSegment();
   segments_.insert(segments_.begin() + i, segment);
   return segment;
 }
 
 Segment *Segments::push_back_segment() {
-  Segment *segment = pool_.Alloc();
-  segment->Clear();
+  Segment *segment = NewSegment();
   segments_.push_back(segment);
   return segment;
 }
 
 Segment *Segments::push_front_segment() {
-  Segment *segment = pool_.Alloc();
-  segment->Clear();
+  Segment *segment = NewSegment();
   segments_.push_front(segment);
   return segment;
 }
@@ -495,7 +609,7 @@ void Segments::erase_segment(size_t i) {
   if (i >= segments_size()) {
     return;
   }
-  pool_.Release(mutable_segment(i));
+  ReleaseSegment(mutable_segment(i));
   segments_.erase(segments_.begin() + i);
 }
 
@@ -505,23 +619,21 @@ void Segments::erase_segments(size_t i, size_t size) {
     return;
   }
   for (size_t j = i; j < end; ++j) {
-    pool_.Release(mutable_segment(j));
+    ReleaseSegment(mutable_segment(j));
   }
   segments_.erase(segments_.begin() + i, segments_.begin() + end);
 }
 
 void Segments::pop_front_segment() {
   if (!segments_.empty()) {
-    Segment *seg = segments_.front();
-    pool_.Release(seg);
+    ReleaseSegment(segments_.front());
     segments_.pop_front();
   }
 }
 
 void Segments::pop_back_segment() {
   if (!segments_.empty()) {
-    Segment *seg = segments_.back();
-    pool_.Release(seg);
+    ReleaseSegment(segments_.back());
     segments_.pop_back();
   }
 }
@@ -531,7 +643,47 @@ void Segments::Clear() {
   clear_revert_entries();
 }
 
+size_t Segments::GetFootprint() const {
+  // The capacity of the pool includes the released segments.
+  size_t footprint = sizeof(Segments) + pool_.capacity() * sizeof(Segment) +
+                     free_list_.GetFootprint();
+  for (const Segment *segment : segments_) {
+    footprint += segment->GetFootprint();
+  }
+  for (const auto &[id, cache] : rewriter_caches_) {
+    footprint += cache->GetFootprint();
+  }
+  return footprint + cached_lattice_.node_count() * sizeof(Node);
+}
+
+Segments::RewriterCache *Segments::mutable_rewriter_cache(const uint64_t id) {
+  for (const auto &[cache_id, cache] : rewriter_caches_) {
+    if (cache_id == id) {
+      return cache.get();
+    }
+  }
+  return nullptr;
+}
+
+void Segments::set_rewriter_cache(const uint64_t id,
+                                  std::unique_ptr<RewriterCache> cache) {
+  for (auto &[cache_id, old_cache] : rewriter_caches_) {
+    if (cache_id == id) {
+      old_cache = std::move(cache);
+      return;
+    }
+  }
+  if (rewriter_caches_.size() >= kMaxRewriterCaches) {
+    rewriter_caches_.erase(rewriter_caches_.begin());
+  }
+  rewriter_caches_.emplace_back(id, std::move(cache));
+}
+
 void Segments::clear_segments() {
+  // Keeps the candidates for reuse before the segments are destroyed.
+  for (Segment *segment : segments_) {
+    segment->clear_candidates();
+  }
   pool_.Free();
   resized_ = false;
   segments_.clear();
@@ -551,7 +703,7 @@ void Segments::clear_history_segments() {
 void Segments::clear_conversion_segments() {
   const size_t size = history_segments_size();
   for (size_t i = size; i < segments_size(); ++i) {
-    pool_.Release(mutable_segment(i));
+    ReleaseSegment(mutable_segment(i));
   }
   resized_ = false;
   segments_.resize(size);
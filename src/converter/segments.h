@@ -59,6 +59,8 @@
 
 namespace mozc {
 
+class ConversionRequest;
+
 class Segment final {
  public:
   enum SegmentType {
@@ -315,12 +317,28 @@ class Segment final {
     bool IsValid() const;
     std::string DebugString() const;
 
+    // Returns the approximate memory held by the candidate in bytes,
+    // including the heap buffers of its strings.
+    size_t GetFootprint() const;
+
     friend std::ostream &operator<<(std::ostream &os,
                                     const Candidate &candidate) {
       return os << candidate.DebugString();
     }
   };
 
+  // Produces further candidates of a segment on demand, e.g., by resuming the
+  // n-best search which generated the initial candidates.
+  class CandidateGenerator {
+   public:
+    virtual ~CandidateGenerator() = default;
+
+    // Appends up to |size| candidates to |segment| and returns the number of
+    // appended candidates. Returns 0 once the generator is exhausted.
+    virtual size_t Generate(const ConversionRequest &request, size_t size,
+                            Segment *segment) = 0;
+  };
+
   Segment() : segment_type_(FREE), pool_(kCandidatesPoolSize) {}
 
   Segment(const Segment &x);
@@ -387,6 +405,15 @@ class Segment final {
   // move old_idx-th-candidate to new_index
   void move_candidate(int old_idx, int new_idx);
 
+  // Generator of the candidates not materialized yet. It is kept across
+  // clear_candidates() but is neither copied nor kept by Clear().
+  CandidateGenerator *candidate_generator() const {
+    return candidate_generator_.get();
+  }
+  void set_candidate_generator(std::unique_ptr<CandidateGenerator> generator) {
+    candidate_generator_ = std::move(generator);
+  }
+
   void Clear();
 
   // Keep clear() method as other modules are still using the old method
@@ -404,8 +431,43 @@ class Segment final {
   std::vector<Candidate> removed_candidates_for_debug_;
 
  private:
+  friend class Segments;
+
+  // Cleared candidates shared by the segments of a Segments, so that their
+  // string buffers are reused by the next conversion. The number of the
+  // candidates and the capacity of each string are bounded, so the memory kept
+  // by a Segments stays small regardless of how many segments it has used.
+  class CandidateFreeList {
+   public:
+    static constexpr size_t kMaxSize = 128;
+    // Longer strings are released instead of kept for reuse.
+    static constexpr size_t kMaxStringCapacity = 64;
+
+    // Returns a cleared candidate, or nullptr if the list is empty.
+    std::unique_ptr<Candidate> Pop();
+
+    // Clears `candidate` and keeps it if the list is not full.
+    void Push(std::unique_ptr<Candidate> candidate);
+
+    size_t size() const { return candidates_.size(); }
+
+    // Returns the approximate memory held by the kept candidates in bytes.
+    size_t GetFootprint() const;
+
+   private:
+    std::vector<std::unique_ptr<Candidate>> candidates_;
+  };
+
   void DeepCopyCandidates(const std::deque<Candidate *> &candidates);
 
+  // Returns the approximate memory held by the candidates in bytes.
+  size_t GetFootprint() const;
+
+  // Returns a default candidate owned by |pool_|. Candidates released by
+  // clear_candidates() are taken from |free_list_| if available, so their
+  // string buffers don't have to be allocated again in the next conversion.
+  Candidate *NewCandidate();
+
   static constexpr int kCandidatesPoolSize = 16;
 
   // LINT.IfChange
@@ -422,6 +484,11 @@ class Segment final {
   std::vector<Candidate> meta_candidates_;
   std::vector<std::unique_ptr<Candidate>> pool_;
   // LINT.ThenChange(//converter/segments_matchers.h)
+  // Owned by the Segments this segment belongs to. Null for a standalone
+  // segment, whose candidates are not recycled. Not copied.
+  CandidateFreeList *free_list_ = nullptr;
+  // Not copied.
+  std::unique_ptr<CandidateGenerator> candidate_generator_;
 };
 
 // Segments is basically an array of Segment.
@@ -528,6 +595,15 @@ class Segments final {
   // clear segments
   void Clear();
 
+  // Returns the approximate memory held by the segments, including the pooled
+  // segments and the candidates kept for reuse, the rewriter caches and the
+  // cached lattice in bytes. The string buffers of the candidates are counted by their
+  // capacities; lattice nodes are counted by their struct size.
+  size_t GetFootprint() const;
+
+  // Returns the number of the cleared candidates kept for reuse.
+  size_t free_candidates_size() const { return free_list_.size(); }
+
   // Dump Segments structure
   std::string DebugString() const;
 
@@ -545,7 +621,32 @@ class Segments final {
   // setter
   Lattice *mutable_cached_lattice() { return &cached_lattice_; }
 
+  // Data that a rewriter keeps across the conversions of this Segments, e.g.,
+  // the results replayed by MemoizingRewriter. As a Segments lives as long as
+  // its session, the data is per session. Rewriter caches are neither copied
+  // nor cleared by Clear().
+  class RewriterCache {
+   public:
+    virtual ~RewriterCache() = default;
+
+    // Returns the approximate memory held by the cache in bytes.
+    virtual size_t GetFootprint() const = 0;
+  };
+
+  // Returns the cache stored for the rewriter identified by `id`, or nullptr.
+  RewriterCache *mutable_rewriter_cache(uint64_t id);
+  // Stores `cache` for `id`, replacing the previous one. Drops the oldest
+  // cache if kMaxRewriterCaches caches are already stored.
+  void set_rewriter_cache(uint64_t id, std::unique_ptr<RewriterCache> cache);
+
+  static constexpr size_t kMaxRewriterCaches = 8;
+
  private:
+  // Returns a cleared segment from |pool_|.
+  Segment *NewSegment();
+  // Returns `segment` to |pool_|. Its candidates go to |free_list_|.
+  void ReleaseSegment(Segment *segment);
+
   // LINT.IfChange
   size_t max_history_segments_size_;
   bool resized_;
@@ -555,6 +656,11 @@ class Segments final {
   std::vector<RevertEntry> revert_entries_;
   Lattice cached_lattice_;
   // LINT.ThenChange(//converter/segments_matchers.h)
+  // Shared by the segments in |pool_|. Not copied.
+  Segment::CandidateFreeList free_list_;
+  // In the order of insertion. Not copied.
+  std::vector<std::pair<uint64_t, std::unique_ptr<RewriterCache>>>
+      rewriter_caches_;
 };
 
 // Inlining basic accessors here.
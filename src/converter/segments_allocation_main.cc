@@ -0,0 +1,150 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Counts the heap allocations of conversions with the mock data engine.
+// Compares conversions into a fresh Segments with conversions into a reused
+// Segments, whose candidates and their string buffers are recycled. Build it
+// at an older revision to compare the numbers across changes.
+//
+// Usage:
+//   segments_allocation_main --iterations=100
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <ostream>
+
+#include "base/init_mozc.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "engine/engine.h"
+#include "engine/mock_data_engine_factory.h"
+#include "absl/flags/flag.h"
+#include "absl/log/check.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+
+ABSL_FLAG(int32_t, iterations, 100, "number of conversions per key");
+
+namespace {
+
+std::atomic<size_t> g_num_allocations = 0;
+std::atomic<size_t> g_allocated_bytes = 0;
+
+void *CountedAlloc(size_t size) {
+  g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+}  // namespace
+
+void *operator new(size_t size) { return CountedAlloc(size); }
+void *operator new[](size_t size) { return CountedAlloc(size); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace mozc {
+namespace {
+
+constexpr absl::string_view kKeys[] = {
+    "わたしのなまえはなかのです",
+    "きょうはいいてんきですね",
+    "かいぎしつのよやくをおねがいします",
+    "あした",
+    "にほんごにゅうりょく",
+};
+
+struct AllocationStats {
+  size_t num_allocations = 0;
+  size_t bytes = 0;
+};
+
+template <typename Function>
+AllocationStats Measure(Function f) {
+  const int iterations = absl::GetFlag(FLAGS_iterations);
+  const size_t num_allocations = g_num_allocations.load();
+  const size_t bytes = g_allocated_bytes.load();
+  for (int i = 0; i < iterations; ++i) {
+    for (const absl::string_view key : kKeys) {
+      f(key);
+    }
+  }
+  const size_t num_conversions = iterations * std::size(kKeys);
+  return {
+      .num_allocations =
+          (g_num_allocations.load() - num_allocations) / num_conversions,
+      .bytes = (g_allocated_bytes.load() - bytes) / num_conversions,
+  };
+}
+
+void Print(const absl::string_view name, const AllocationStats &stats) {
+  std::cout << absl::StrFormat("%-16s %8d allocations %10d bytes / conversion",
+                               name, stats.num_allocations, stats.bytes)
+            << std::endl;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+
+  std::unique_ptr<mozc::Engine> engine =
+      mozc::MockDataEngineFactory::Create().value();
+  const mozc::ConverterInterface *converter = engine->GetConverter();
+  CHECK(converter);
+
+  const mozc::AllocationStats fresh =
+      mozc::Measure([converter](absl::string_view key) {
+        mozc::Segments segments;
+        CHECK(converter->StartConversion(&segments, key));
+      });
+
+  mozc::Segments segments;
+  const mozc::AllocationStats reused =
+      mozc::Measure([converter, &segments](absl::string_view key) {
+        CHECK(converter->StartConversion(&segments, key));
+      });
+
+  mozc::Print("fresh Segments", fresh);
+  mozc::Print("reused Segments", reused);
+  return 0;
+}
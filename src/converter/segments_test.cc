@@ -29,12 +29,15 @@
 
 #include "converter/segments.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/number_util.h"
+#include "converter/lattice.h"
 #include "testing/gunit.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
@@ -357,6 +360,79 @@ TEST(SegmentsTest, RevertEntryTest) {
   EXPECT_EQ(segments.revert_entries_size(), 0);
 }
 
+TEST(SegmentsTest, GetFootprint) {
+  Segments segments;
+  const size_t empty = segments.GetFootprint();
+
+  Segment *segment = segments.add_segment();
+  const size_t one_segment = segments.GetFootprint();
+  EXPECT_GT(one_segment, empty);
+
+  for (int i = 0; i < 10; ++i) {
+    segment->add_candidate();
+  }
+  EXPECT_GE(segments.GetFootprint(),
+            one_segment + 10 * sizeof(Segment::Candidate));
+
+  Lattice *lattice = segments.mutable_cached_lattice();
+  lattice->SetKey("test");
+  const size_t with_lattice = segments.GetFootprint();
+  lattice->NewNode();
+  EXPECT_GT(segments.GetFootprint(), with_lattice);
+
+  // Long strings are counted by their capacities.
+  const size_t before_long_value = segments.GetFootprint();
+  segment->mutable_candidate(0)->value = std::string(1000, 'a');
+  EXPECT_GE(segments.GetFootprint(), before_long_value + 1000);
+
+  // The candidates kept for reuse are still counted after Clear().
+  segments.Clear();
+  lattice->Clear();
+  EXPECT_EQ(segments.free_candidates_size(), 10);
+  EXPECT_GE(segments.GetFootprint(), empty + 10 * sizeof(Segment::Candidate));
+}
+
+TEST(SegmentsTest, GetFootprintCountsReleasedSegments) {
+  Segments segments;
+  segments.add_segment()->set_segment_type(Segment::HISTORY);
+  segments.add_segment();
+
+  // The released segment stays in the pool for reuse.
+  segments.clear_history_segments();
+  EXPECT_EQ(segments.segments_size(), 1);
+  EXPECT_GE(segments.GetFootprint(), sizeof(Segments) + 2 * sizeof(Segment));
+}
+
+class TestRewriterCache : public Segments::RewriterCache {
+ public:
+  size_t GetFootprint() const override { return 1000; }
+};
+
+TEST(SegmentsTest, RewriterCache) {
+  Segments segments;
+  EXPECT_EQ(segments.mutable_rewriter_cache(1), nullptr);
+  const size_t empty = segments.GetFootprint();
+
+  auto cache = std::make_unique<TestRewriterCache>();
+  Segments::RewriterCache *cache_ptr = cache.get();
+  segments.set_rewriter_cache(1, std::move(cache));
+  EXPECT_EQ(segments.mutable_rewriter_cache(1), cache_ptr);
+  EXPECT_EQ(segments.GetFootprint(), empty + 1000);
+
+  // Kept by Clear() and assignment, but not copied.
+  segments.Clear();
+  segments = Segments();
+  EXPECT_EQ(segments.mutable_rewriter_cache(1), cache_ptr);
+  EXPECT_EQ(Segments(segments).mutable_rewriter_cache(1), nullptr);
+
+  // The oldest cache is dropped.
+  for (uint64_t id = 2; id <= Segments::kMaxRewriterCaches + 1; ++id) {
+    segments.set_rewriter_cache(id, std::make_unique<TestRewriterCache>());
+  }
+  EXPECT_EQ(segments.mutable_rewriter_cache(1), nullptr);
+  EXPECT_NE(segments.mutable_rewriter_cache(2), nullptr);
+}
+
 TEST(SegmentsTest, CopyTest) {
   Segments src;
 
@@ -541,6 +617,69 @@ TEST(SegmentTest, Copy) {
   EXPECT_EQ(dest.meta_candidate(0).key, src.meta_candidate(0).key);
 }
 
+TEST(SegmentTest, ReuseClearedCandidates) {
+  Segments segments;
+  Segment *segment = segments.add_segment();
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->key = "a long enough key to be allocated on the heap";
+  candidate->value = "a long enough value to be allocated on the heap";
+  candidate->a11y_description = "a11y";
+  candidate->cost = 100;
+  candidate->cost_before_rescoring = 200;
+  candidate->category = Segment::Candidate::SYMBOL;
+  candidate->inner_segment_boundary.push_back(1);
+  const size_t key_capacity = candidate->key.capacity();
+
+  segment->clear_candidates();
+  EXPECT_EQ(segment->candidates_size(), 0);
+  EXPECT_EQ(segments.free_candidates_size(), 1);
+
+  // The cleared candidate is reused with its buffers.
+  Segment::Candidate *reused = segment->push_front_candidate();
+  EXPECT_EQ(reused, candidate);
+  EXPECT_GE(reused->key.capacity(), key_capacity);
+  EXPECT_TRUE(reused->key.empty());
+  EXPECT_TRUE(reused->value.empty());
+  EXPECT_TRUE(reused->a11y_description.empty());
+  EXPECT_EQ(reused->cost, 0);
+  EXPECT_EQ(reused->cost_before_rescoring, 0);
+  EXPECT_EQ(reused->category, Segment::Candidate::DEFAULT_CATEGORY);
+  EXPECT_TRUE(reused->inner_segment_boundary.empty());
+
+  // The candidates of the removed segments are shared by the other segments,
+  // even after Segments::Clear().
+  segment->insert_candidate(1)->key = "key";
+  segments.Clear();
+  EXPECT_EQ(segments.free_candidates_size(), 2);
+  segment = segments.add_segment();
+  EXPECT_TRUE(segment->add_candidate()->key.empty());
+  EXPECT_TRUE(segment->add_candidate()->key.empty());
+  EXPECT_TRUE(segment->add_candidate()->key.empty());
+  EXPECT_EQ(segment->candidates_size(), 3);
+  EXPECT_EQ(segments.free_candidates_size(), 0);
+
+  // Long strings are not kept.
+  segment->mutable_candidate(0)->description = std::string(1000, 'a');
+  segments.pop_back_segment();
+  EXPECT_EQ(segments.free_candidates_size(), 3);
+  segment = segments.add_segment();
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_LT(segment->add_candidate()->description.capacity(), 1000);
+  }
+}
+
+TEST(SegmentTest, FreeCandidatesAreBoundedPerSegments) {
+  Segments segments;
+  for (int i = 0; i < 10; ++i) {
+    Segment *segment = segments.add_segment();
+    for (int j = 0; j < 100; ++j) {
+      segment->add_candidate();
+    }
+  }
+  segments.clear_conversion_segments();
+  EXPECT_EQ(segments.free_candidates_size(), 128);
+}
+
 TEST(SegmentTest, MetaCandidateTest) {
   Segment segment;
 
@@ -166,11 +166,11 @@ def mozc_dataset(
         "pos_matcher:32:$(@D)/pos_matcher.data " +
         "user_pos_token:32:$(@D)/user_pos_token_array.data " +
         "user_pos_string:32:$(@D)/user_pos_string_array.data " +
-        "coll:32:$(location :" + name + "@collocation) " +
-        "cols:32:$(location :" + name + "@collocation_suppression) " +
+        "coll:512:$(location :" + name + "@collocation) " +
+        "cols:512:$(location :" + name + "@collocation_suppression) " +
         "conn:32:$(location :" + name + "@connection) " +
         "dict:32:$(location :" + name + "@dictionary) " +
-        "sugg:32:$(location :" + name + "@suggestion_filter) " +
+        "sugg:512:$(location :" + name + "@suggestion_filter) " +
         "posg:32:$(location :" + name + "@pos_group) " +
         "bdry:32:$(location :" + name + "@boundary) " +
         "segmenter_sizeinfo:32:$(@D)/segmenter_sizeinfo.data " +
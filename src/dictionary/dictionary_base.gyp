@@ -167,6 +167,7 @@
       'sources': [
         '<(gen_out_dir)/pos_map.inc',
         'user_dictionary.cc',
+        'user_dictionary_cache.cc',
         'user_dictionary_importer.cc',
         'user_dictionary_session.cc',
         'user_dictionary_session_handler.cc',
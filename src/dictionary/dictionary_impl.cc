@@ -39,6 +39,7 @@
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/token_view.h"
 #include "protocol/config.pb.h"
 #include "absl/strings/string_view.h"
 
@@ -88,20 +89,56 @@ bool DictionaryImpl::HasValue(absl::string_view value) const {
 
 namespace {
 
+// Implements the token filtering rules shared by all the lookup methods.
+class TokenFilter : public TokenViewBuffer::Filter {
+ public:
+  TokenFilter(const ConversionRequest &conversion_request,
+              const PosMatcher *pos_matcher,
+              const SuppressionDictionary *suppression_dictionary)
+      : use_spelling_correction_(
+            conversion_request.config().use_spelling_correction()),
+        use_zip_code_conversion_(
+            conversion_request.config().use_zip_code_conversion()),
+        use_t13n_conversion_(conversion_request.config().use_t13n_conversion()),
+        pos_matcher_(pos_matcher),
+        suppression_snapshot_(suppression_dictionary->GetSnapshot()) {}
+
+  // Returns true if the token should be removed from the lookup results.
+  bool IsFiltered(absl::string_view key, absl::string_view value, int lid,
+                  Token::AttributesBitfield attributes) const {
+    if (!(attributes & Token::USER_DICTIONARY)) {
+      if (!use_spelling_correction_ &&
+          (attributes & Token::SPELLING_CORRECTION)) {
+        return true;
+      }
+      if (!use_zip_code_conversion_ && pos_matcher_->IsZipcode(lid)) {
+        return true;
+      }
+      if (!use_t13n_conversion_ && Util::IsEnglishTransliteration(value)) {
+        return true;
+      }
+    }
+    return suppression_snapshot_.SuppressEntry(key, value);
+  }
+
+  bool IsFiltered(const Token &token) const override {
+    return IsFiltered(token.key, token.value, token.lid, token.attributes);
+  }
+
+ private:
+  const bool use_spelling_correction_;
+  const bool use_zip_code_conversion_;
+  const bool use_t13n_conversion_;
+  const PosMatcher *pos_matcher_;
+  // Loaded once per lookup rather than per token.
+  const SuppressionDictionary::Snapshot suppression_snapshot_;
+};
+
 class CallbackWithFilter : public DictionaryInterface::Callback {
  public:
-  CallbackWithFilter(const bool use_spelling_correction,
-                     const bool use_zip_code_conversion,
-                     const bool use_t13n_conversion,
-                     const PosMatcher *pos_matcher,
-                     const SuppressionDictionary *suppression_dictionary,
+  CallbackWithFilter(const TokenFilter &filter,
                      DictionaryInterface::Callback *callback)
-      : use_spelling_correction_(use_spelling_correction),
-        use_zip_code_conversion_(use_zip_code_conversion),
-        use_t13n_conversion_(use_t13n_conversion),
-        pos_matcher_(pos_matcher),
-        suppression_dictionary_(suppression_dictionary),
-        callback_(callback) {}
+      : filter_(filter), callback_(callback) {}
 
   ResultType OnKey(absl::string_view key) override {
     return callback_->OnKey(key);
@@ -114,31 +151,15 @@ class CallbackWithFilter : public DictionaryInterface::Callback {
 
   ResultType OnToken(absl::string_view key, absl::string_view actual_key,
                      const Token &token) override {
-    if (!(token.attributes & Token::USER_DICTIONARY)) {
-      if (!use_spelling_correction_ &&
-          (token.attributes & Token::SPELLING_CORRECTION)) {
-        return TRAVERSE_CONTINUE;
-      }
-      if (!use_zip_code_conversion_ && pos_matcher_->IsZipcode(token.lid)) {
-        return TRAVERSE_CONTINUE;
-      }
-      if (!use_t13n_conversion_ &&
-          Util::IsEnglishTransliteration(token.value)) {
-        return TRAVERSE_CONTINUE;
-      }
-    }
-    if (suppression_dictionary_->SuppressEntry(token.key, token.value)) {
+    if (filter_.IsFiltered(token.key, token.value, token.lid,
+                           token.attributes)) {
       return TRAVERSE_CONTINUE;
     }
     return callback_->OnToken(key, actual_key, token);
   }
 
  private:
-  const bool use_spelling_correction_;
-  const bool use_zip_code_conversion_;
-  const bool use_t13n_conversion_;
-  const PosMatcher *pos_matcher_;
-  const SuppressionDictionary *suppression_dictionary_;
+  const TokenFilter &filter_;
   DictionaryInterface::Callback *callback_;
 };
 
@@ -147,11 +168,9 @@ class CallbackWithFilter : public DictionaryInterface::Callback {
 void DictionaryImpl::LookupPredictive(
     absl::string_view key, const ConversionRequest &conversion_request,
     Callback *callback) const {
-  CallbackWithFilter callback_with_filter(
-      conversion_request.config().use_spelling_correction(),
-      conversion_request.config().use_zip_code_conversion(),
-      conversion_request.config().use_t13n_conversion(), pos_matcher_,
-      suppression_dictionary_, callback);
+  const TokenFilter filter(conversion_request, pos_matcher_,
+                           suppression_dictionary_);
+  CallbackWithFilter callback_with_filter(filter, callback);
   for (size_t i = 0; i < dics_.size(); ++i) {
     dics_[i]->LookupPredictive(key, conversion_request, &callback_with_filter);
   }
@@ -160,24 +179,35 @@ void DictionaryImpl::LookupPredictive(
 void DictionaryImpl::LookupPrefix(absl::string_view key,
                                   const ConversionRequest &conversion_request,
                                   Callback *callback) const {
-  CallbackWithFilter callback_with_filter(
-      conversion_request.config().use_spelling_correction(),
-      conversion_request.config().use_zip_code_conversion(),
-      conversion_request.config().use_t13n_conversion(), pos_matcher_,
-      suppression_dictionary_, callback);
+  const TokenFilter filter(conversion_request, pos_matcher_,
+                           suppression_dictionary_);
+  CallbackWithFilter callback_with_filter(filter, callback);
   for (size_t i = 0; i < dics_.size(); ++i) {
     dics_[i]->LookupPrefix(key, conversion_request, &callback_with_filter);
   }
 }
 
+void DictionaryImpl::LookupPrefixBatch(
+    absl::string_view key, const ConversionRequest &conversion_request,
+    TokenViewBuffer *buffer) const {
+  const TokenFilter filter(conversion_request, pos_matcher_,
+                           suppression_dictionary_);
+  // Filtered tokens are dropped while the buffer is filled, so they don't
+  // count toward its capacity as in LookupPrefix().
+  DCHECK(buffer->filter() == nullptr);
+  buffer->set_filter(&filter);
+  for (size_t i = 0; i < dics_.size() && !buffer->full(); ++i) {
+    dics_[i]->LookupPrefixBatch(key, conversion_request, buffer);
+  }
+  buffer->set_filter(nullptr);
+}
+
 void DictionaryImpl::LookupExact(absl::string_view key,
                                  const ConversionRequest &conversion_request,
                                  Callback *callback) const {
-  CallbackWithFilter callback_with_filter(
-      conversion_request.config().use_spelling_correction(),
-      conversion_request.config().use_zip_code_conversion(),
-      conversion_request.config().use_t13n_conversion(), pos_matcher_,
-      suppression_dictionary_, callback);
+  const TokenFilter filter(conversion_request, pos_matcher_,
+                           suppression_dictionary_);
+  CallbackWithFilter callback_with_filter(filter, callback);
   for (size_t i = 0; i < dics_.size(); ++i) {
     dics_[i]->LookupExact(key, conversion_request, &callback_with_filter);
   }
@@ -186,11 +216,9 @@ void DictionaryImpl::LookupExact(absl::string_view key,
 void DictionaryImpl::LookupReverse(absl::string_view str,
                                    const ConversionRequest &conversion_request,
                                    Callback *callback) const {
-  CallbackWithFilter callback_with_filter(
-      conversion_request.config().use_spelling_correction(),
-      conversion_request.config().use_zip_code_conversion(),
-      conversion_request.config().use_t13n_conversion(), pos_matcher_,
-      suppression_dictionary_, callback);
+  const TokenFilter filter(conversion_request, pos_matcher_,
+                           suppression_dictionary_);
+  CallbackWithFilter callback_with_filter(filter, callback);
   for (size_t i = 0; i < dics_.size(); ++i) {
     dics_[i]->LookupReverse(str, conversion_request, &callback_with_filter);
   }
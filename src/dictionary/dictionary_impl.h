@@ -72,6 +72,9 @@ class DictionaryImpl : public DictionaryInterface {
   void LookupPrefix(absl::string_view key,
                     const ConversionRequest &conversion_request,
                     Callback *callback) const override;
+  void LookupPrefixBatch(absl::string_view key,
+                         const ConversionRequest &conversion_request,
+                         TokenViewBuffer *buffer) const override;
 
   void LookupExact(absl::string_view key,
                    const ConversionRequest &conversion_request,
@@ -29,11 +29,13 @@
 
 #include "dictionary/dictionary_impl.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/system_util.h"
 #include "base/util.h"
@@ -46,6 +48,7 @@
 #include "dictionary/suppression_dictionary.h"
 #include "dictionary/system/system_dictionary.h"
 #include "dictionary/system/value_dictionary.h"
+#include "dictionary/token_view.h"
 #include "dictionary/user_dictionary_stub.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
@@ -237,6 +240,48 @@ TEST_F(DictionaryImplTest, WordSuppressionTest) {
   }
 }
 
+TEST_F(DictionaryImplTest, LookupPrefixBatchWithSuppression) {
+  std::unique_ptr<DictionaryData> data = CreateDictionaryData();
+  DictionaryInterface *d = data->dictionary.get();
+  SuppressionDictionary *s = data->suppression_dictionary.get();
+
+  constexpr char kQuery[] = "ぐーぐるは";
+  s->Lock();
+  s->Clear();
+  s->AddEntry("ぐーぐる", "グーグル");
+  s->UnLock();
+
+  class Collector : public DictionaryInterface::Callback {
+   public:
+    ResultType OnToken(absl::string_view key, absl::string_view actual_key,
+                       const Token &token) override {
+      tokens_.emplace_back(token.key, token.value);
+      return TRAVERSE_CONTINUE;
+    }
+    std::vector<std::pair<std::string, std::string>> tokens_;
+  };
+  Collector collector;
+  d->LookupPrefix(kQuery, convreq_, &collector);
+  const std::vector<std::pair<std::string, std::string>> &expected =
+      collector.tokens_;
+  ASSERT_FALSE(expected.empty());
+
+  // The suppressed token doesn't take a slot of the buffer, so the buffer of
+  // any capacity gets the same tokens as LookupPrefix().
+  TokenViewBuffer buffer;
+  for (size_t max_size = 1; max_size <= expected.size() + 1; ++max_size) {
+    buffer.Clear();
+    buffer.set_max_size(max_size);
+    d->LookupPrefixBatch(kQuery, convreq_, &buffer);
+    ASSERT_EQ(buffer.size(), std::min(max_size, expected.size()));
+    for (size_t i = 0; i < buffer.size(); ++i) {
+      EXPECT_EQ(buffer[i].key, expected[i].first);
+      EXPECT_EQ(buffer[i].value, expected[i].second);
+    }
+    EXPECT_EQ(buffer.filter(), nullptr);
+  }
+}
+
 TEST_F(DictionaryImplTest, DisableSpellingCorrectionTest) {
   std::unique_ptr<DictionaryData> data = CreateDictionaryData();
   DictionaryInterface *d = data->dictionary.get();
@@ -34,6 +34,7 @@
 #include <vector>
 
 #include "dictionary/dictionary_token.h"
+#include "dictionary/token_view.h"
 #include "request/conversion_request.h"
 #include "absl/strings/string_view.h"
 
@@ -128,6 +129,15 @@ class DictionaryInterface {
                             const ConversionRequest &conversion_request,
                             Callback *callback) const = 0;
 
+  // Batched variant of LookupPrefix(). Appends the found tokens to `buffer` in
+  // the order LookupPrefix() would call back OnToken(), honoring
+  // buffer->min_key_length() and stopping when the buffer gets full. The
+  // default implementation adapts LookupPrefix(); dictionaries on the hot path
+  // override it to fill the buffer without going through the callback.
+  virtual void LookupPrefixBatch(absl::string_view key,
+                                 const ConversionRequest &conversion_request,
+                                 TokenViewBuffer *buffer) const;
+
   // Looks up values whose keys are same with the key.
   // (e.g. key = "abc" -> {"abc": "ABC"})
   virtual void LookupExact(absl::string_view key,
@@ -166,6 +176,45 @@ class DictionaryInterface {
   DictionaryInterface() = default;
 };
 
+// Callback that collects tokens into a TokenViewBuffer. Used to implement
+// LookupPrefixBatch() on top of LookupPrefix().
+class TokenViewBufferCallback : public DictionaryInterface::Callback {
+ public:
+  explicit TokenViewBufferCallback(TokenViewBuffer *buffer)
+      : buffer_(buffer) {}
+
+  ResultType OnKey(absl::string_view key) override {
+    if (buffer_->full()) {
+      return TRAVERSE_DONE;
+    }
+    return key.size() < buffer_->min_key_length() ? TRAVERSE_NEXT_KEY
+                                                  : TRAVERSE_CONTINUE;
+  }
+
+  ResultType OnActualKey(absl::string_view key, absl::string_view actual_key,
+                         int num_expanded) override {
+    num_expanded_ = num_expanded;
+    return TRAVERSE_CONTINUE;
+  }
+
+  ResultType OnToken(absl::string_view key, absl::string_view actual_key,
+                     const Token &token) override {
+    buffer_->Add(token, num_expanded_);
+    return buffer_->full() ? TRAVERSE_DONE : TRAVERSE_CONTINUE;
+  }
+
+ private:
+  TokenViewBuffer *buffer_;
+  int num_expanded_ = 0;
+};
+
+inline void DictionaryInterface::LookupPrefixBatch(
+    absl::string_view key, const ConversionRequest &conversion_request,
+    TokenViewBuffer *buffer) const {
+  TokenViewBufferCallback callback(buffer);
+  LookupPrefix(key, conversion_request, &callback);
+}
+
 }  // namespace dictionary
 }  // namespace mozc
 
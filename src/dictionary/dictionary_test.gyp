@@ -40,10 +40,12 @@
         'dictionary_impl_test.cc',
         'single_kanji_dictionary_test.cc',
         'suffix_dictionary_test.cc',
+        'token_view_test.cc',
         'user_dictionary_importer_test.cc',
         'user_dictionary_session_handler_test.cc',
         'user_dictionary_session_test.cc',
         'user_dictionary_storage_test.cc',
+        'user_dictionary_cache_test.cc',
         'user_dictionary_test.cc',
         'user_dictionary_util_test.cc',
         'user_pos_test.cc',
@@ -30,6 +30,8 @@
 #include "dictionary/single_kanji_dictionary.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <memory>
 #include <string>
@@ -155,21 +157,33 @@ class Uint32ArrayIterator
 
 SingleKanjiDictionary::SingleKanjiDictionary(
     const DataManagerInterface &data_manager) {
+  absl::string_view single_kanji_token_array;
   absl::string_view string_array_data;
   absl::string_view variant_type_array_data;
   absl::string_view variant_string_array_data;
   absl::string_view noun_prefix_token_array_data;
   absl::string_view noun_prefix_string_array_data;
   data_manager.GetSingleKanjiRewriterData(
-      &single_kanji_token_array_, &string_array_data, &variant_type_array_data,
+      &single_kanji_token_array, &string_array_data, &variant_type_array_data,
       &variant_token_array_, &variant_string_array_data,
       &noun_prefix_token_array_data, &noun_prefix_string_array_data);
 
   // Single Kanji token array is an array of uint32_t.  Its size must be
   // multiple of 2; see the comment above LookupKanjiEntries.
-  DCHECK_EQ(0, single_kanji_token_array_.size() % (2 * sizeof(uint32_t)));
+  DCHECK_EQ(0, single_kanji_token_array.size() % (2 * sizeof(uint32_t)));
   DCHECK(SerializedStringArray::VerifyData(string_array_data));
   single_kanji_string_array_.Set(string_array_data);
+  const uint32_t *token_array =
+      reinterpret_cast<const uint32_t *>(single_kanji_token_array.data());
+  const size_t token_array_size =
+      single_kanji_token_array.size() / sizeof(uint32_t);
+  single_kanji_entries_.reserve(token_array_size / 2);
+  for (size_t i = 0; i + 1 < token_array_size; i += 2) {
+    const absl::string_view key = single_kanji_string_array_[token_array[i]];
+    const absl::string_view values =
+        single_kanji_string_array_[token_array[i + 1]];
+    single_kanji_entries_.emplace(key, values);
+  }
 
   DCHECK(SerializedStringArray::VerifyData(variant_type_array_data));
   variant_type_array_.Set(variant_type_array_data);
@@ -186,7 +200,7 @@ SingleKanjiDictionary::SingleKanjiDictionary(
       noun_prefix_token_array_data, noun_prefix_string_array_data);
 }
 
-// The underlying token array, |single_kanji_token_array_|, has the following
+// The underlying token array, |single_kanji_token_array|, has the following
 // format:
 //
 // +------------------+
@@ -201,26 +215,17 @@ SingleKanjiDictionary::SingleKanjiDictionary(
 // | ...              |
 //
 // Here, each element is of uint32_t type.  Each of actual string values are
-// stored in |single_kanji_string_array_| at its index.
+// stored in |single_kanji_string_array_| at its index.  The constructor indexes
+// these pairs into |single_kanji_entries_|.
 bool SingleKanjiDictionary::LookupKanjiEntries(
     absl::string_view key, bool use_svs,
     std::vector<std::string> *kanji_list) const {
   DCHECK(kanji_list);
-  const uint32_t *token_array =
-      reinterpret_cast<const uint32_t *>(single_kanji_token_array_.data());
-  const size_t token_array_size =
-      single_kanji_token_array_.size() / sizeof(uint32_t);
-
-  const Uint32ArrayIterator<2> end(token_array + token_array_size);
-  const auto iter = std::lower_bound(
-      Uint32ArrayIterator<2>(token_array), end, key,
-      [this](uint32_t index, const absl::string_view target_key) {
-        return this->single_kanji_string_array_[index] < target_key;
-      });
-  if (iter == end || single_kanji_string_array_[iter[0]] != key) {
+  const auto it = single_kanji_entries_.find(key);
+  if (it == single_kanji_entries_.end()) {
     return false;
   }
-  const absl::string_view values = single_kanji_string_array_[iter[1]];
+  const absl::string_view values = it->second;
   if (use_svs) {
     std::string svs_values;
     if (TextNormalizer::NormalizeTextToSvs(values, &svs_values)) {
@@ -39,6 +39,7 @@
 #include "base/container/serialized_string_array.h"
 #include "data_manager/data_manager_interface.h"
 #include "data_manager/serialized_dictionary.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 
 namespace mozc {
@@ -73,8 +74,12 @@ class SingleKanjiDictionary {
                            std::string *desc) const;
 
  private:
-  absl::string_view single_kanji_token_array_;
   SerializedStringArray single_kanji_string_array_;
+  // Maps a reading to the concatenated single kanji list, both pointing into
+  // single_kanji_string_array_.  Built once from the sorted token array so
+  // that each lookup is a hash of the key instead of a binary search.
+  absl::flat_hash_map<absl::string_view, absl::string_view>
+      single_kanji_entries_;
   SerializedStringArray variant_type_array_;
   absl::string_view variant_token_array_;
   SerializedStringArray variant_string_array_;
@@ -29,9 +29,8 @@
 
 #include "dictionary/suffix_dictionary.h"
 
-#include <algorithm>
+#include <cstddef>
 #include <cstdint>
-#include <string>
 #include <utility>
 
 #include "base/container/serialized_string_array.h"
@@ -43,29 +42,46 @@ namespace mozc {
 namespace dictionary {
 namespace {
 
-class ComparePrefix {
- public:
-  explicit ComparePrefix(size_t max_len) : max_len_(max_len) {}
-
-  bool operator()(absl::string_view x, absl::string_view y) const {
-    return x.substr(0, max_len_) < y.substr(0, max_len_);
-  }
-
- private:
-  const size_t max_len_;
-};
+bool IsCharBoundary(absl::string_view str, size_t pos) {
+  // UTF-8 continuation bytes are 10xxxxxx.
+  return pos == str.size() || (static_cast<uint8_t>(str[pos]) & 0xC0) != 0x80;
+}
 
 }  // namespace
 
 SuffixDictionary::SuffixDictionary(absl::string_view key_array_data,
                                    absl::string_view value_array_data,
-                                   const uint32_t *token_array)
-    : token_array_(token_array) {
+                                   const uint32_t *token_array) {
   DCHECK(SerializedStringArray::VerifyData(key_array_data));
   DCHECK(SerializedStringArray::VerifyData(value_array_data));
-  DCHECK(token_array_);
-  key_array_.Set(key_array_data);
-  value_array_.Set(value_array_data);
+  DCHECK(token_array);
+  SerializedStringArray key_array, value_array;
+  key_array.Set(key_array_data);
+  value_array.Set(value_array_data);
+  DCHECK_EQ(key_array.size(), value_array.size());
+
+  entries_.reserve(key_array.size());
+  for (size_t i = 0; i < key_array.size(); ++i) {
+    DCHECK(i == 0 || key_array[i - 1] <= key_array[i]);
+    Entry &entry = entries_.emplace_back();
+    entry.key = key_array[i];
+    entry.value = value_array[i].empty() ? key_array[i] : value_array[i];
+    entry.lid = token_array[3 * i];
+    entry.rid = token_array[3 * i + 1];
+    entry.cost = token_array[3 * i + 2];
+
+    const uint32_t index = static_cast<uint32_t>(i);
+    for (size_t len = 1; len <= entry.key.size(); ++len) {
+      if (!IsCharBoundary(entry.key, len)) {
+        continue;
+      }
+      const auto [it, inserted] = prefix_ranges_.try_emplace(
+          entry.key.substr(0, len), index, index + 1);
+      if (!inserted) {
+        it->second.second = index + 1;
+      }
+    }
+  }
 }
 
 bool SuffixDictionary::HasKey(absl::string_view key) const {
@@ -89,13 +105,19 @@ bool SuffixDictionary::HasValue(absl::string_view value) const {
 void SuffixDictionary::LookupPredictive(
     absl::string_view key, const ConversionRequest &conversion_request,
     Callback *callback) const {
-  using Iter = SerializedStringArray::const_iterator;
-  std::pair<Iter, Iter> range = std::equal_range(
-      key_array_.begin(), key_array_.end(), key, ComparePrefix(key.size()));
+  std::pair<uint32_t, uint32_t> range(0, entries_.size());
+  if (!key.empty()) {
+    const auto it = prefix_ranges_.find(key);
+    if (it == prefix_ranges_.end()) {
+      return;
+    }
+    range = it->second;
+  }
   Token token;
   token.attributes = Token::SUFFIX_DICTIONARY;
-  for (; range.first != range.second; ++range.first) {
-    token.key.assign((*range.first).data(), (*range.first).size());
+  for (uint32_t i = range.first; i < range.second; ++i) {
+    const Entry &entry = entries_[i];
+    token.key.assign(entry.key.data(), entry.key.size());
     switch (callback->OnKey(token.key)) {
       case Callback::TRAVERSE_DONE:
         return;
@@ -106,16 +128,10 @@ void SuffixDictionary::LookupPredictive(
       default:
         break;
     }
-    const size_t index = range.first - key_array_.begin();
-    if (value_array_[index].empty()) {
-      token.value = token.key;
-    } else {
-      token.value.assign(value_array_[index].data(),
-                         value_array_[index].size());
-    }
-    token.lid = token_array_[3 * index];
-    token.rid = token_array_[3 * index + 1];
-    token.cost = token_array_[3 * index + 2];
+    token.value.assign(entry.value.data(), entry.value.size());
+    token.lid = entry.lid;
+    token.rid = entry.rid;
+    token.cost = entry.cost;
     if (callback->OnToken(token.key, token.key, token) !=
         Callback::TRAVERSE_CONTINUE) {
       break;
@@ -31,9 +31,11 @@
 #define MOZC_DICTIONARY_SUFFIX_DICTIONARY_H_
 
 #include <cstdint>
+#include <utility>
+#include <vector>
 
-#include "base/container/serialized_string_array.h"
 #include "dictionary/dictionary_interface.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 
 namespace mozc {
@@ -81,9 +83,25 @@ class SuffixDictionary : public DictionaryInterface {
                      Callback *callback) const override {}
 
  private:
-  SerializedStringArray key_array_;
-  SerializedStringArray value_array_;
-  const uint32_t *token_array_;
+  // Token record decoded from the serialized arrays at construction.
+  struct Entry {
+    absl::string_view key;
+    absl::string_view value;
+    uint16_t lid;
+    uint16_t rid;
+    int32_t cost;
+  };
+
+  // Entries sorted by key.
+  std::vector<Entry> entries_;
+
+  // Maps every prefix of the keys, split at character boundaries, to the
+  // range [first, second) of entries_ starting with it.  Since the keys are
+  // sorted, entries sharing a prefix are contiguous.  This makes
+  // LookupPredictive() a single hash lookup instead of a binary search with
+  // string comparisons.
+  absl::flat_hash_map<absl::string_view, std::pair<uint32_t, uint32_t>>
+      prefix_ranges_;
 };
 
 }  // namespace dictionary
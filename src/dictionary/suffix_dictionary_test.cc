@@ -32,6 +32,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/util.h"
 #include "data_manager/testing/mock_data_manager.h"
@@ -91,6 +92,39 @@ TEST(SuffixDictionaryTest, LookupPredictive) {
       EXPECT_EQ(token.attributes, Token::SUFFIX_DICTIONARY);
     }
   }
+  {
+    // Every prefix of every key returns exactly the tokens whose keys start
+    // with it, in the same order as the full enumeration.
+    CollectTokenCallback all;
+    dic->LookupPredictive("", convreq, &all);
+    for (const Token &entry : all.tokens()) {
+      std::vector<std::string> chars;
+      Util::SplitStringToUtf8Chars(entry.key, &chars);
+      std::string prefix;
+      for (const std::string &c : chars) {
+        prefix.append(c);
+        std::vector<std::string> expected;
+        for (const Token &token : all.tokens()) {
+          if (absl::StartsWith(token.key, prefix)) {
+            expected.push_back(token.value);
+          }
+        }
+        CollectTokenCallback callback;
+        dic->LookupPredictive(prefix, convreq, &callback);
+        std::vector<std::string> actual;
+        for (const Token &token : callback.tokens()) {
+          actual.push_back(token.value);
+        }
+        EXPECT_EQ(actual, expected) << prefix;
+      }
+    }
+  }
+  {
+    // Keys that no entry starts with.
+    CollectTokenCallback callback;
+    dic->LookupPredictive("ゔゔゔゔ", convreq, &callback);
+    EXPECT_TRUE(callback.tokens().empty());
+  }
 }
 
 }  // namespace
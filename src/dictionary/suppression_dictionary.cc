@@ -29,6 +29,7 @@
 
 #include "dictionary/suppression_dictionary.h"
 
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -40,6 +41,9 @@
 namespace mozc {
 namespace dictionary {
 
+SuppressionDictionary::SuppressionDictionary()
+    : entries_(std::make_shared<const Entries>()) {}
+
 bool SuppressionDictionary::AddEntry(std::string key, std::string value)
     ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
   if (key.empty() && value.empty()) {
@@ -47,21 +51,23 @@ bool SuppressionDictionary::AddEntry(std::string key, std::string value)
     return false;
   }
 
+  if (pending_ == nullptr) {
+    // Copies the current entries on the first edit.
+    pending_ = std::make_unique<Entries>(*entries_.load());
+  }
   if (key.empty()) {
-    values_only_.insert(std::move(value));
+    pending_->values_only.insert(std::move(value));
   } else if (value.empty()) {
-    keys_only_.insert(std::move(key));
+    pending_->keys_only.insert(std::move(key));
   } else {
-    keys_values_.emplace(std::move(key), std::move(value));
+    pending_->keys_values.emplace(std::move(key), std::move(value));
   }
 
   return true;
 }
 
 void SuppressionDictionary::Clear() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
-  keys_values_.clear();
-  keys_only_.clear();
-  values_only_.clear();
+  pending_ = std::make_unique<Entries>();
 }
 
 void SuppressionDictionary::Lock() ABSL_EXCLUSIVE_LOCK_FUNCTION(mutex_) {
@@ -69,37 +75,33 @@ void SuppressionDictionary::Lock() ABSL_EXCLUSIVE_LOCK_FUNCTION(mutex_) {
 }
 
 void SuppressionDictionary::UnLock() ABSL_UNLOCK_FUNCTION(mutex_) {
+  if (pending_ != nullptr) {
+    entries_.store(std::move(pending_));
+  }
   mutex_.Unlock();
 }
 
-bool SuppressionDictionary::IsEmpty() const {
-  if (mutex_.TryLock()) {
-    bool is_empty =
-        keys_only_.empty() && values_only_.empty() && keys_values_.empty();
-    mutex_.Unlock();
-    return is_empty;
-  }
-
-  return true;
+SuppressionDictionary::Snapshot SuppressionDictionary::GetSnapshot() const {
+  return Snapshot(entries_.load());
 }
 
+bool SuppressionDictionary::IsEmpty() const { return entries_.load()->empty(); }
+
 bool SuppressionDictionary::SuppressEntry(const absl::string_view key,
                                           const absl::string_view value) const {
-  if (mutex_.TryLock()) {
-    if (keys_only_.empty() && values_only_.empty() && keys_values_.empty()) {
-      // Almost all users don't use word suppression function.
-      // We can return false as early as possible.
-      mutex_.Unlock();
-      return false;
-    }
-
-    bool suppress = keys_values_.contains(std::make_pair(key, value)) ||
-                    keys_only_.contains(key) || values_only_.contains(value);
-    mutex_.Unlock();
-    return suppress;
-  }
+  return GetSnapshot().SuppressEntry(key, value);
+}
 
-  return false;
+bool SuppressionDictionary::Snapshot::SuppressEntry(
+    const absl::string_view key, const absl::string_view value) const {
+  if (entries_->empty()) {
+    // Almost all users don't use word suppression function.
+    // We can return false as early as possible.
+    return false;
+  }
+  return entries_->keys_values.contains(std::make_pair(key, value)) ||
+         entries_->keys_only.contains(key) ||
+         entries_->values_only.contains(value);
 }
 
 }  // namespace dictionary
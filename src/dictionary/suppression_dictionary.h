@@ -31,9 +31,11 @@
 #define MOZC_DICTIONARY_SUPPRESSION_DICTIONARY_H_
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <utility>
 
+#include "base/atomic_shared_ptr.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/hash/hash.h"
@@ -44,13 +46,14 @@ namespace mozc {
 namespace dictionary {
 
 // Provides a functionality to test if a word should be suppressed in conversion
-// results. This class is not thread safe in general use but is safe under
-// single-producer single-consumer model, provided that the usage is correct. In
-// our usage, the producer is UserDictionary::UserDictionaryReloader thread and
-// the consumer is the main converter thread.
+// results. The entries are kept in an immutable snapshot, which is replaced as
+// a whole on update (read-copy-update). Readers never take a lock and always
+// see a complete snapshot, so any number of converter threads can call the
+// reader methods while the producer (UserDictionary::UserDictionaryReloader
+// thread) updates the dictionary.
 class ABSL_LOCKABLE SuppressionDictionary final {
  public:
-  SuppressionDictionary() = default;
+  SuppressionDictionary();
   SuppressionDictionary(const SuppressionDictionary &) = delete;
   SuppressionDictionary &operator=(const SuppressionDictionary &) = delete;
 
@@ -58,15 +61,15 @@ class ABSL_LOCKABLE SuppressionDictionary final {
   //
   // Lock();
   // Calls of AddEntry() and/or Clear()
-  // Unlock();
+  // UnLock();
   //
-  // The producer thread must not call the other methods.
+  // The edits are published to the readers at UnLock().
 
-  // Locks the dictionary (the producer thread is blocked until it gets the
-  // lock). Should not be called recursively.
+  // Locks the dictionary for editing. Other producers are blocked until
+  // UnLock(). Should not be called recursively.
   void Lock() ABSL_EXCLUSIVE_LOCK_FUNCTION();
 
-  // Unlocks the dictionary.
+  // Publishes the edits and unlocks the dictionary.
   void UnLock() ABSL_UNLOCK_FUNCTION();
 
   // Adds an entry into the dictionary.
@@ -76,15 +79,20 @@ class ABSL_LOCKABLE SuppressionDictionary final {
   // Clears the dictionary.
   void Clear() ABSL_EXCLUSIVE_LOCKS_REQUIRED(this);
 
-  // Methods for the consumer thread. If the producer thread is updating the
-  // dictionary contents, the following methods behave as if the dictionary is
-  // empty.
+  // Methods for the reader threads. If the producer thread is updating the
+  // dictionary contents, the following methods see the last published
+  // contents.
+
+  class Snapshot;
+
+  // Returns the last published contents. Readers checking many words, e.g.
+  // all the tokens of a lookup, should check them against one snapshot.
+  Snapshot GetSnapshot() const;
 
   // Returns true if SuppressionDictionary doesn't have any entries.
   bool IsEmpty() const;
 
   // Returns true if a word having `key` and `value` should be suppressed.
-  // Returns false if the dictionary is locked.
   bool SuppressEntry(absl::string_view key, absl::string_view value) const;
 
  private:
@@ -97,12 +105,40 @@ class ABSL_LOCKABLE SuppressionDictionary final {
     using is_transparent = void;
   };
 
-  absl::flat_hash_set<KeyValue, KeyValueHash, KeyValueEq> keys_values_
-      ABSL_GUARDED_BY(mutex_);
-  absl::flat_hash_set<std::string> keys_only_ ABSL_GUARDED_BY(mutex_);
-  absl::flat_hash_set<std::string> values_only_ ABSL_GUARDED_BY(mutex_);
+  // Immutable once published.
+  struct Entries {
+    bool empty() const {
+      return keys_values.empty() && keys_only.empty() && values_only.empty();
+    }
+
+    absl::flat_hash_set<KeyValue, KeyValueHash, KeyValueEq> keys_values;
+    absl::flat_hash_set<std::string> keys_only;
+    absl::flat_hash_set<std::string> values_only;
+  };
+
+  AtomicSharedPtr<const Entries> entries_;
+  // Entries being edited by the producer. Created on the first edit.
+  std::unique_ptr<Entries> pending_ ABSL_GUARDED_BY(mutex_);
+  absl::Mutex mutex_;
+};
+
+// The contents of SuppressionDictionary at a point in time. Later edits are not
+// visible. Cheap to copy.
+class SuppressionDictionary::Snapshot final {
+ public:
+  // Returns true if the snapshot doesn't have any entries.
+  bool IsEmpty() const { return entries_->empty(); }
+
+  // Returns true if a word having `key` and `value` should be suppressed.
+  bool SuppressEntry(absl::string_view key, absl::string_view value) const;
+
+ private:
+  friend class SuppressionDictionary;
+
+  explicit Snapshot(std::shared_ptr<const Entries> entries)
+      : entries_(std::move(entries)) {}
 
-  mutable absl::Mutex mutex_;
+  std::shared_ptr<const Entries> entries_;
 };
 
 class ABSL_SCOPED_LOCKABLE SuppressionDictionaryLock final {
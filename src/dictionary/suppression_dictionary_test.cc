@@ -51,7 +51,7 @@ TEST(SuppressionDictionary, BasicTest) {
 
   // repeat 10 times
   for (int i = 0; i < 10; ++i) {
-    // IsEmpty() returns always true when dic is locked
+    // Edits are not visible until the lock is released.
     {
       const SuppressionDictionaryLock l(&dic);
       EXPECT_TRUE(dic.IsEmpty());
@@ -68,10 +68,19 @@ TEST(SuppressionDictionary, BasicTest) {
 
     EXPECT_FALSE(dic.IsEmpty());
 
-    // locked now => SuppressEntry always returns false
+    // Readers see the published entries while the dictionary is being edited.
     {
       const SuppressionDictionaryLock l(&dic);
-      EXPECT_FALSE(dic.SuppressEntry("key1", "value1"));
+      dic.Clear();
+      EXPECT_FALSE(dic.IsEmpty());
+      EXPECT_TRUE(dic.SuppressEntry("key1", "value1"));
+      EXPECT_TRUE(dic.AddEntry("key1", "value1"));
+      EXPECT_TRUE(dic.AddEntry("key2", "value2"));
+      EXPECT_TRUE(dic.AddEntry("key3", "value3"));
+      EXPECT_TRUE(dic.AddEntry("key4", ""));
+      EXPECT_TRUE(dic.AddEntry("key5", ""));
+      EXPECT_TRUE(dic.AddEntry("", "value4"));
+      EXPECT_TRUE(dic.AddEntry("", "value5"));
     }
 
     EXPECT_TRUE(dic.SuppressEntry("key1", "value1"));
@@ -102,6 +111,32 @@ TEST(SuppressionDictionary, BasicTest) {
   }
 }
 
+TEST(SuppressionDictionary, SnapshotTest) {
+  SuppressionDictionary dic;
+  const SuppressionDictionary::Snapshot empty = dic.GetSnapshot();
+  {
+    const SuppressionDictionaryLock l(&dic);
+    EXPECT_TRUE(dic.AddEntry("key1", "value1"));
+    EXPECT_TRUE(dic.AddEntry("key2", ""));
+  }
+
+  // A snapshot keeps the contents at the time it was taken.
+  const SuppressionDictionary::Snapshot snapshot = dic.GetSnapshot();
+  EXPECT_TRUE(empty.IsEmpty());
+  EXPECT_FALSE(empty.SuppressEntry("key1", "value1"));
+  EXPECT_FALSE(snapshot.IsEmpty());
+  EXPECT_TRUE(snapshot.SuppressEntry("key1", "value1"));
+  EXPECT_TRUE(snapshot.SuppressEntry("key2", "value2"));
+  EXPECT_FALSE(snapshot.SuppressEntry("key1", "value2"));
+
+  {
+    const SuppressionDictionaryLock l(&dic);
+    dic.Clear();
+  }
+  EXPECT_FALSE(dic.SuppressEntry("key1", "value1"));
+  EXPECT_TRUE(snapshot.SuppressEntry("key1", "value1"));
+}
+
 TEST(SuppressionDictionary, ThreadTest) {
   // Keys and values for testing.
   std::vector<std::string> keys, values;
@@ -137,6 +172,35 @@ TEST(SuppressionDictionary, ThreadTest) {
   }
 }
 
+TEST(SuppressionDictionary, ConcurrentReadersTest) {
+  SuppressionDictionary dic;
+  {
+    const SuppressionDictionaryLock l(&dic);
+    EXPECT_TRUE(dic.AddEntry("key", "value"));
+  }
+
+  // Readers always see a complete snapshot while the producer replaces it.
+  std::vector<Thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&dic] {
+      for (int j = 0; j < 1000; ++j) {
+        EXPECT_TRUE(dic.SuppressEntry("key", "value"));
+      }
+    });
+  }
+  for (int iter = 0; iter < 100; ++iter) {
+    const SuppressionDictionaryLock l(&dic);
+    dic.Clear();
+    EXPECT_TRUE(dic.AddEntry("key", "value"));
+    EXPECT_TRUE(dic.AddEntry(absl::StrCat("key", iter), ""));
+  }
+  for (Thread &reader : readers) {
+    reader.Join();
+  }
+  EXPECT_TRUE(dic.SuppressEntry("key99", "value"));
+  EXPECT_FALSE(dic.SuppressEntry("key98", "value"));
+}
+
 }  // namespace
 }  // namespace dictionary
 }  // namespace mozc
@@ -97,6 +97,10 @@ constexpr size_t kKeyTrieLb1CacheSize = 1 * 1024;
 constexpr size_t kKeyTrieSelect0CacheSize = 4 * 1024;
 constexpr size_t kKeyTrieSelect1CacheSize = 4 * 1024;
 constexpr size_t kKeyTrieTermvecCacheSize = 1 * 1024;
+// Every lookup starts from the root and its children, which have many
+// children each (one per leading byte of the encoded key). Dense jump tables
+// for these two levels take about 512 bytes per node.
+constexpr int kKeyTrieJumpTableLevels = 2;
 
 constexpr size_t kValueTrieLb0CacheSize = 1 * 1024;
 constexpr size_t kValueTrieLb1CacheSize = 1 * 1024;
@@ -460,6 +464,7 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
     LOG(ERROR) << "cannot open key trie";
     return false;
   }
+  key_trie_.BuildJumpTable(kKeyTrieJumpTableLevels);
 
   BuildHiraganaExpansionTable(*codec_, &hiragana_expansion_table_);
 
@@ -948,6 +953,43 @@ void SystemDictionary::LookupPrefix(absl::string_view key,
       LoudsTrie::Node(), 0, false, actual_key_buffer, &actual_prefix);
 }
 
+void SystemDictionary::LookupPrefixBatch(
+    absl::string_view key, const ConversionRequest &conversion_request,
+    TokenViewBuffer *buffer) const {
+  if (conversion_request.IsKanaModifierInsensitiveConversion()) {
+    DictionaryInterface::LookupPrefixBatch(key, conversion_request, buffer);
+    return;
+  }
+
+  // Same traversal as RunCallbackOnEachPrefix() but the tokens are copied
+  // directly into the buffer, without virtual calls per key and token.
+  std::string encoded_key;
+  codec_->EncodeKey(key, &encoded_key);
+  LoudsTrie::Node node;
+  for (absl::string_view::size_type i = 0; i < encoded_key.size();) {
+    if (!key_trie_.MoveToChildByLabel(encoded_key[i], &node)) {
+      return;
+    }
+    ++i;
+    if (!key_trie_.IsTerminalNode(node)) {
+      continue;
+    }
+    const absl::string_view prefix(
+        key.data(), codec_->GetDecodedKeyLength(encoded_key.substr(0, i)));
+    if (prefix.size() < buffer->min_key_length()) {
+      continue;
+    }
+    const int key_id = key_trie_.GetKeyIdOfTerminalNode(node);
+    for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_, prefix,
+                                  GetTokenArrayPtr(token_array_, key_id));
+         !iter.Done(); iter.Next()) {
+      if (!buffer->Add(*iter.Get().token, 0)) {
+        return;
+      }
+    }
+  }
+}
+
 void SystemDictionary::LookupExact(absl::string_view key,
                                    const ConversionRequest &conversion_request,
                                    Callback *callback) const {
@@ -42,6 +42,7 @@
 #include "dictionary/system/codec_interface.h"
 #include "dictionary/system/key_expansion_table.h"
 #include "dictionary/system/words_info.h"
+#include "dictionary/token_view.h"
 #include "request/conversion_request.h"
 #include "storage/louds/bit_vector_based_array.h"
 #include "storage/louds/louds_trie.h"
@@ -146,6 +147,10 @@ class SystemDictionary : public DictionaryInterface {
                     const ConversionRequest &conversion_request,
                     Callback *callback) const override;
 
+  void LookupPrefixBatch(absl::string_view key,
+                         const ConversionRequest &conversion_request,
+                         TokenViewBuffer *buffer) const override;
+
   void LookupExact(absl::string_view key,
                    const ConversionRequest &conversion_request,
                    Callback *callback) const override;
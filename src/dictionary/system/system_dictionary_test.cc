@@ -50,6 +50,7 @@
 #include "dictionary/pos_matcher.h"
 #include "dictionary/system/system_dictionary_builder.h"
 #include "dictionary/text_dictionary_loader.h"
+#include "dictionary/token_view.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
@@ -458,6 +459,57 @@ TEST_F(SystemDictionaryTest, LookupPrefix) {
   }
 }
 
+TEST_F(SystemDictionaryTest, LookupPrefixBatch) {
+  std::vector<Token> tokens = {
+      {"か", "可"},     {"かき", "牡蠣"}, {"かき", "夏季"},
+      {"がき", "餓鬼"}, {"かきく", "柿久"},
+  };
+  std::unique_ptr<SystemDictionary> system_dic =
+      BuildSystemDictionary(MakeTokenPointers(&tokens), tokens.size());
+  ASSERT_TRUE(system_dic);
+
+  for (const bool kana_modifier_insensitive : {false, true}) {
+    request_.set_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+    config_.set_use_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+
+    // The batch contains the same tokens in the same order as the callback.
+    CollectTokenCallback callback;
+    system_dic->LookupPrefix("かきくけこ", convreq_, &callback);
+    TokenViewBuffer buffer;
+    system_dic->LookupPrefixBatch("かきくけこ", convreq_, &buffer);
+    ASSERT_EQ(buffer.size(), callback.tokens().size());
+    for (size_t i = 0; i < buffer.size(); ++i) {
+      const Token &expected = callback.tokens()[i];
+      EXPECT_EQ(buffer[i].key, expected.key);
+      EXPECT_EQ(buffer[i].value, expected.value);
+      EXPECT_EQ(buffer[i].cost, expected.cost);
+      EXPECT_EQ(buffer[i].lid, expected.lid);
+      EXPECT_EQ(buffer[i].rid, expected.rid);
+      EXPECT_EQ(buffer[i].attributes, expected.attributes);
+      EXPECT_EQ(buffer[i].num_expanded > 0, buffer[i].key == "がき");
+    }
+    if (kana_modifier_insensitive) {
+      EXPECT_EQ(buffer.size(), tokens.size());
+    }
+
+    // Keys shorter than min_key_length are skipped.
+    buffer.Clear();
+    buffer.set_min_key_length(absl::string_view("かき").size());
+    system_dic->LookupPrefixBatch("かきくけこ", convreq_, &buffer);
+    ASSERT_FALSE(buffer.empty());
+    for (const TokenView &token : buffer.tokens()) {
+      EXPECT_NE(token.key, "か");
+    }
+
+    // Lookup stops when the buffer gets full.
+    TokenViewBuffer small_buffer(2);
+    system_dic->LookupPrefixBatch("かきくけこ", convreq_, &small_buffer);
+    EXPECT_EQ(small_buffer.size(), 2);
+  }
+}
+
 TEST_F(SystemDictionaryTest, LookupPredictive) {
   Token tokens[] = {
       {"まみむめもや", "value0", 0, 0, 0, Token::NONE},
@@ -0,0 +1,188 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_DICTIONARY_TOKEN_VIEW_H_
+#define MOZC_DICTIONARY_TOKEN_VIEW_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "dictionary/dictionary_token.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+namespace dictionary {
+
+// Non-owning counterpart of Token used by the batched lookup API. The strings
+// point into the TokenViewBuffer that produced the view, and they stay valid
+// until the buffer is cleared or destroyed.
+struct TokenView {
+  absl::string_view key;
+  absl::string_view value;
+  int cost = 0;
+  int lid = 0;
+  int rid = 0;
+  // The number of characters that differ between the lookup key and `key`,
+  // i.e., non-zero only for tokens found by key expansion.
+  int num_expanded = 0;
+  Token::AttributesBitfield attributes = Token::NONE;
+
+  Token ToToken() const {
+    return Token(key, value, cost, lid, rid, attributes);
+  }
+};
+
+// Caller-provided storage for a batch of looked up tokens. The strings of the
+// tokens are copied into arena blocks owned by the buffer, so a lookup doesn't
+// allocate per token, and the blocks are reused after Clear(). A buffer is
+// meant to be reused by a single thread across lookups.
+//
+// Example:
+//   TokenViewBuffer buffer;
+//   dictionary->LookupPrefixBatch(key, request, &buffer);
+//   for (const TokenView &token : buffer.tokens()) {
+//     ...
+//   }
+class TokenViewBuffer {
+ public:
+  // Decides the tokens dropped by Add(), e.g., the suppressed ones.
+  class Filter {
+   public:
+    virtual ~Filter() = default;
+
+    // Returns true if `token` should not be added.
+    virtual bool IsFiltered(const Token &token) const = 0;
+  };
+
+  TokenViewBuffer() = default;
+  explicit TokenViewBuffer(size_t max_size) : max_size_(max_size) {}
+
+  TokenViewBuffer(const TokenViewBuffer &) = delete;
+  TokenViewBuffer &operator=(const TokenViewBuffer &) = delete;
+
+  // Lookup stops once this many tokens are stored.
+  size_t max_size() const { return max_size_; }
+  void set_max_size(size_t max_size) { max_size_ = max_size; }
+
+  // Keys shorter than this (in bytes) are skipped during prefix lookup. This
+  // is the equivalent of returning TRAVERSE_NEXT_KEY from Callback::OnKey().
+  size_t min_key_length() const { return min_key_length_; }
+  void set_min_key_length(size_t length) { min_key_length_ = length; }
+
+  // The filter applied by Add(), or nullptr to add all the tokens. Not owned.
+  const Filter *filter() const { return filter_; }
+  void set_filter(const Filter *filter) { filter_ = filter; }
+
+  bool full() const { return tokens_.size() >= max_size_; }
+  bool empty() const { return tokens_.empty(); }
+  size_t size() const { return tokens_.size(); }
+
+  absl::Span<const TokenView> tokens() const { return tokens_; }
+  const TokenView &operator[](size_t i) const { return tokens_[i]; }
+
+  // Copies the token and appends its view. Returns false without adding the
+  // token if the buffer is already full. A token rejected by the filter is
+  // dropped and doesn't count toward max_size(), as LookupPrefix() skips it.
+  bool Add(const Token &token, int num_expanded) {
+    if (full()) {
+      return false;
+    }
+    if (filter_ != nullptr && filter_->IsFiltered(token)) {
+      return true;
+    }
+    TokenView &view = tokens_.emplace_back();
+    // Consecutive tokens usually share the key, so the copy in the arena is
+    // shared as well.
+    if (tokens_.size() >= 2 && tokens_[tokens_.size() - 2].key == token.key) {
+      view.key = tokens_[tokens_.size() - 2].key;
+    } else {
+      view.key = Intern(token.key);
+    }
+    // So is the value of a token written in the reading, e.g., hiragana.
+    view.value = token.value == token.key ? view.key : Intern(token.value);
+    view.cost = token.cost;
+    view.lid = token.lid;
+    view.rid = token.rid;
+    view.num_expanded = num_expanded;
+    view.attributes = token.attributes;
+    return true;
+  }
+
+  // Removes all the tokens. The allocated memory is kept for reuse.
+  void Clear() {
+    tokens_.clear();
+    block_index_ = 0;
+    block_used_ = 0;
+  }
+
+ private:
+  static constexpr size_t kBlockSize = 4096;
+
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  absl::string_view Intern(absl::string_view s) {
+    if (s.empty()) {
+      return absl::string_view();
+    }
+    while (block_index_ < blocks_.size() &&
+           blocks_[block_index_].size - block_used_ < s.size()) {
+      ++block_index_;
+      block_used_ = 0;
+    }
+    if (block_index_ == blocks_.size()) {
+      const size_t size = std::max(kBlockSize, s.size());
+      blocks_.push_back({std::make_unique<char[]>(size), size});
+      block_used_ = 0;
+    }
+    char *dest = blocks_[block_index_].data.get() + block_used_;
+    std::copy(s.begin(), s.end(), dest);
+    block_used_ += s.size();
+    return absl::string_view(dest, s.size());
+  }
+
+  size_t max_size_ = std::numeric_limits<size_t>::max();
+  size_t min_key_length_ = 0;
+  const Filter *filter_ = nullptr;
+  std::vector<TokenView> tokens_;
+  std::vector<Block> blocks_;
+  size_t block_index_ = 0;
+  size_t block_used_ = 0;
+};
+
+}  // namespace dictionary
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_TOKEN_VIEW_H_
@@ -0,0 +1,137 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/token_view.h"
+
+#include <string>
+
+#include "dictionary/dictionary_token.h"
+#include "testing/gunit.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+TEST(TokenViewBufferTest, AddAndClear) {
+  TokenViewBuffer buffer;
+  EXPECT_TRUE(buffer.empty());
+
+  Token token("かき", "柿", 100, 1, 2, Token::SPELLING_CORRECTION);
+  EXPECT_TRUE(buffer.Add(token, 0));
+  token.value = "牡蠣";
+  EXPECT_TRUE(buffer.Add(token, 1));
+  token.key = "がき";
+  EXPECT_TRUE(buffer.Add(token, 0));
+
+  // The views don't depend on the lifetime of the source strings.
+  token.key = "xxxxxx";
+  token.value = "xxxxxx";
+
+  ASSERT_EQ(buffer.size(), 3);
+  EXPECT_EQ(buffer[0].key, "かき");
+  EXPECT_EQ(buffer[0].value, "柿");
+  EXPECT_EQ(buffer[0].cost, 100);
+  EXPECT_EQ(buffer[0].lid, 1);
+  EXPECT_EQ(buffer[0].rid, 2);
+  EXPECT_EQ(buffer[0].num_expanded, 0);
+  EXPECT_EQ(buffer[0].attributes, Token::SPELLING_CORRECTION);
+  EXPECT_EQ(buffer[1].key, "かき");
+  EXPECT_EQ(buffer[1].value, "牡蠣");
+  EXPECT_EQ(buffer[1].num_expanded, 1);
+  EXPECT_EQ(buffer[2].key, "がき");
+  EXPECT_EQ(buffer[2].value, "牡蠣");
+
+  const Token copied = buffer[1].ToToken();
+  EXPECT_EQ(copied.key, "かき");
+  EXPECT_EQ(copied.value, "牡蠣");
+  EXPECT_EQ(copied.cost, 100);
+
+  buffer.Clear();
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_TRUE(buffer.Add(Token("a", "A"), 0));
+  EXPECT_EQ(buffer[0].value, "A");
+}
+
+TEST(TokenViewBufferTest, MaxSize) {
+  TokenViewBuffer buffer(2);
+  const Token token("a", "A");
+  EXPECT_FALSE(buffer.full());
+  EXPECT_TRUE(buffer.Add(token, 0));
+  EXPECT_TRUE(buffer.Add(token, 0));
+  EXPECT_TRUE(buffer.full());
+  EXPECT_FALSE(buffer.Add(token, 0));
+  EXPECT_EQ(buffer.size(), 2);
+}
+
+TEST(TokenViewBufferTest, LongStringsAcrossBlocks) {
+  TokenViewBuffer buffer;
+  const std::string long_value(10000, 'v');
+  for (int i = 0; i < 100; ++i) {
+    const std::string key(i + 1, 'k');
+    const Token token(key, i % 10 == 0 ? long_value : key);
+    ASSERT_TRUE(buffer.Add(token, 0));
+  }
+  ASSERT_EQ(buffer.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(buffer[i].key, std::string(i + 1, 'k'));
+    EXPECT_EQ(buffer[i].value,
+              i % 10 == 0 ? long_value : std::string(i + 1, 'k'));
+  }
+}
+
+TEST(TokenViewBufferTest, Filter) {
+  class ValueFilter : public TokenViewBuffer::Filter {
+   public:
+    bool IsFiltered(const Token &token) const override {
+      return token.value == "a" || token.value == "c";
+    }
+  };
+  const ValueFilter filter;
+  TokenViewBuffer buffer(2);
+  buffer.set_filter(&filter);
+  // The filtered tokens don't make the buffer full.
+  EXPECT_TRUE(buffer.Add(Token("k", "a"), 0));
+  EXPECT_TRUE(buffer.Add(Token("k", "b"), 0));
+  EXPECT_TRUE(buffer.Add(Token("k", "c"), 0));
+  EXPECT_TRUE(buffer.Add(Token("k", "k"), 0));
+  EXPECT_FALSE(buffer.Add(Token("k", "e"), 0));
+  ASSERT_EQ(buffer.size(), 2);
+  EXPECT_EQ(buffer[0].value, "b");
+  EXPECT_EQ(buffer[1].value, "k");
+
+  buffer.set_filter(nullptr);
+  buffer.Clear();
+  EXPECT_TRUE(buffer.Add(Token("k", "a"), 0));
+  EXPECT_EQ(buffer[0].value, "a");
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
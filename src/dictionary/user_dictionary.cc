@@ -34,6 +34,7 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <numeric>
 #include <optional>
 #include <string>
 #include <utility>
@@ -51,6 +52,7 @@
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary_cache.h"
 #include "dictionary/user_dictionary_storage.h"
 #include "dictionary/user_dictionary_util.h"
 #include "dictionary/user_pos.h"
@@ -60,6 +62,7 @@
 #include "request/conversion_request.h"
 #include "usage_stats/usage_stats.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -100,6 +103,89 @@ struct OrderByKeyThenById {
   }
 };
 
+constexpr absl::string_view kAndroidShortcutsDictionaryName =
+    "__auto_imported_android_shortcuts_dictionary";
+
+// Identifies an entry as it is written in the storage. Used to find the
+// entries added or removed since the last load without normalizing them.
+uint64_t EntryFingerprint(
+    const UserDictionaryStorage::UserDictionaryEntry &entry,
+    bool is_android_shortcuts) {
+  const char flags[] = {static_cast<char>(entry.pos()),
+                        entry.has_pos() ? '1' : '0',
+                        is_android_shortcuts ? '1' : '0'};
+  return Fingerprint(absl::StrCat(entry.key(), "\t", entry.value(), "\t",
+                                  entry.comment(), "\t",
+                                  absl::string_view(flags, sizeof(flags))));
+}
+
+// Returns true if `lhs` and `rhs` have the same EntryFingerprint() in the same
+// dictionary. Cheaper than fingerprinting, as no string is built.
+bool IsSameEntry(const UserDictionaryStorage::UserDictionaryEntry &lhs,
+                 const UserDictionaryStorage::UserDictionaryEntry &rhs) {
+  return lhs.pos() == rhs.pos() && lhs.has_pos() == rhs.has_pos() &&
+         lhs.key() == rhs.key() && lhs.value() == rhs.value() &&
+         lhs.comment() == rhs.comment();
+}
+
+std::string NormalizeEntryReading(absl::string_view key) {
+  // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
+  // because the normalization is user-visible.
+  // http://b/2480844
+  return japanese::NormalizeVoicedSoundMark(
+      UserDictionaryUtil::NormalizeReading(key));
+}
+
+// Identifies the tokens compiled from an entry.
+uint64_t TokensFingerprint(
+    absl::string_view reading,
+    const UserDictionaryStorage::UserDictionaryEntry &entry) {
+  DCHECK(user_dictionary::UserDictionary_PosType_IsValid(entry.pos()));
+  static_assert(user_dictionary::UserDictionary_PosType_PosType_MAX <=
+                std::numeric_limits<char>::max());
+  const char pos_type_as_char[] = {static_cast<char>(entry.pos())};
+  return Fingerprint(absl::StrCat(reading, "\t", entry.value(), "\t",
+                                  absl::string_view(pos_type_as_char, 1)));
+}
+
+// Compiles a valid entry other than suppression words into `tokens`.
+void CompileEntry(const UserPosInterface &user_pos,
+                  const UserDictionaryStorage::UserDictionaryEntry &entry,
+                  absl::string_view reading, bool is_android_shortcuts,
+                  std::vector<UserPos::Token> *tokens) {
+  tokens->clear();
+  const absl::string_view comment = absl::StripAsciiWhitespace(entry.comment());
+  if (entry.pos() == user_dictionary::UserDictionary::NO_POS) {
+    // In theory NO_POS works without this implementation, as it is
+    // covered in the UserPos::GetTokens function. However, that function
+    // is depending on the user_pos_*.data in the dictionary and there
+    // will not be corresponding POS tag. To avoid invalid behavior, this
+    // special treatment is added here.
+    // "品詞なし"
+    UserPos::Token token{.key = entry.key(),
+                         .value = entry.value(),
+                         .id = 0,
+                         .attributes = UserPos::Token::SHORTCUT,
+                         .comment = std::string(comment)};
+    // NO_POS has '名詞サ変' id as in user_pos.def
+    user_pos.GetPosIds("名詞サ変", &token.id);
+    tokens->push_back(std::move(token));
+    return;
+  }
+  user_pos.GetTokens(reading, entry.value(),
+                     UserDictionaryUtil::GetStringPosType(entry.pos()), tokens);
+  for (auto &token : *tokens) {
+    strings::Assign(token.comment, comment);
+    if (is_android_shortcuts &&
+        token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
+      // TODO(b/295964970): This special implementation is planned to be
+      // removed after validating the safety of NO_POS implementation.
+      token.remove_attribute(UserPos::Token::SUGGESTION_ONLY);
+      token.add_attribute(UserPos::Token::SHORTCUT);
+    }
+  }
+}
+
 class UserDictionaryFileManager {
  public:
   UserDictionaryFileManager() = default;
@@ -130,122 +216,660 @@ class UserDictionaryFileManager {
 
 }  // namespace
 
+// Book-keeping of the last loaded storage, used to find the entries changed by
+// the next load.
+struct UserDictionary::EntryTable {
+  struct Entry {
+    // TokensFingerprint() of the entry. Valid entries sharing it are
+    // duplicates, and only the first one of them is compiled.
+    uint64_t tokens_fp = 0;
+    bool valid = false;
+    // The number of the same entries in the storage. As only the first one of
+    // duplicates is compiled, removing one of them may change the tokens.
+    uint32_t count = 0;
+  };
+
+  bool empty() const { return entries.empty(); }
+  void clear() {
+    entries.clear();
+    num_tokens.clear();
+    tokens_refs.clear();
+    storage.Clear();
+    entry_fps.clear();
+  }
+
+  // Records a new valid entry or removes one from `tokens_refs`.
+  void AddTokensRef(uint64_t tokens_fp) { ++tokens_refs[tokens_fp]; }
+  void RemoveTokensRef(uint64_t tokens_fp) {
+    const auto it = tokens_refs.find(tokens_fp);
+    DCHECK(it != tokens_refs.end());
+    if (it != tokens_refs.end() && --it->second == 0) {
+      tokens_refs.erase(it);
+    }
+  }
+
+  // Keyed by EntryFingerprint().
+  absl::flat_hash_map<uint64_t, Entry> entries;
+  // The number of tokens in the index compiled for each tokens_fp.
+  absl::flat_hash_map<uint64_t, uint32_t> num_tokens;
+  // The number of valid entries with distinct EntryFingerprint() for each
+  // tokens_fp. The tokens of a tokens_fp referred to by one entry can be
+  // recompiled without searching the storage for the first duplicate.
+  absl::flat_hash_map<uint64_t, uint32_t> tokens_refs;
+  // The last loaded storage and the EntryFingerprint() of its entries.
+  // `entry_fps[i]` is empty for the disabled dictionaries. The next load
+  // compares its entries with these in the storage order and reuses the
+  // fingerprints of the unchanged ones.
+  user_dictionary::UserDictionaryStorage storage;
+  std::vector<std::vector<uint64_t>> entry_fps;
+};
+
+// Immutable once published. An index consists of a large base, which can be
+// shared by subsequent indexes, and a small overlay. Incremental loads copy
+// the overlay, add the tokens of changed entries to it and hide the stale
+// tokens of the base, so the cost is proportional to the changes.
 class UserDictionary::TokensIndex {
  public:
+  class Cursor;
+
   TokensIndex(const UserPosInterface *user_pos,
               SuppressionDictionary *suppression_dictionary)
-      : user_pos_(user_pos), suppression_dictionary_(suppression_dictionary) {}
+      : user_pos_(user_pos),
+        suppression_dictionary_(suppression_dictionary),
+        base_(std::make_shared<const Segment>()) {}
 
   ~TokensIndex() = default;
 
-  bool empty() const { return user_pos_tokens_.empty(); }
-  size_t size() const { return user_pos_tokens_.size(); }
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
 
-  std::vector<UserPos::Token>::const_iterator begin() const {
-    return user_pos_tokens_.begin();
-  }
-  std::vector<UserPos::Token>::const_iterator end() const {
-    return user_pos_tokens_.end();
+  // Returns the number of tokens held by the overlay, including the hidden
+  // ones of the base.
+  size_t overlay_size() const {
+    return overlay_.tokens.size() + removed_.size();
   }
 
-  void Load(const user_dictionary::UserDictionaryStorage &storage) {
-    user_pos_tokens_.clear();
-    absl::flat_hash_set<uint64_t> seen;
+  // Returns the tokens whose key is `key`.
+  Cursor EqualRange(absl::string_view key) const;
+  // Returns the tokens whose key starts with `prefix`.
+  Cursor PrefixRange(absl::string_view prefix) const;
+  // Returns the tokens whose key is not less than `key`.
+  Cursor LowerBound(absl::string_view key) const;
+
+  // Compiles all the entries of `storage`, and records them to `table`.
+  void Load(const user_dictionary::UserDictionaryStorage &storage,
+            EntryTable *table);
+
+  // Loads the tokens compiled by a previous Load(). The tokens are already
+  // sorted, so no normalization or POS expansion is performed.
+  void Load(UserDictionaryCache::Contents contents);
+
+  // Records the entries of `storage` to `table` as Load() does, without
+  // compiling them. Used after loading the tokens from the cache, so that the
+  // next Update() applies incrementally. Returns false and leaves `table`
+  // empty if the tokens do not match `storage`.
+  bool BuildEntryTable(const user_dictionary::UserDictionaryStorage &storage,
+                       EntryTable *table) const;
+
+  // Returns the index updated with the entries added to or removed from
+  // `storage` since the load recorded in `table`. Returns nullptr if `table`
+  // is empty or the changes are too large to apply incrementally.
+  std::unique_ptr<TokensIndex> Update(
+      const user_dictionary::UserDictionaryStorage &storage,
+      EntryTable *table) const;
+
+  // Returns the index whose base contains all the tokens of this index.
+  std::unique_ptr<TokensIndex> Compact() const;
+
+  UserDictionaryCache::Contents ToCacheContents() const;
+
+ private:
+  // Tokens sorted by key and then by POS ID. `tokens_fps[i]` is the
+  // TokensFingerprint() of the entry `tokens[i]` comes from.
+  struct Segment {
+    void Sort();
+
     std::vector<UserPos::Token> tokens;
+    std::vector<uint64_t> tokens_fps;
+  };
+
+  template <typename Compare>
+  Cursor Range(absl::string_view key, Compare comp) const;
+
+  // Compiles `entry` into `segment` and the suppression entries.
+  void AddEntry(const UserDictionaryStorage::UserDictionaryEntry &entry,
+                std::string reading, uint64_t tokens_fp,
+                bool is_android_shortcuts, Segment *segment, EntryTable *table,
+                std::vector<UserPos::Token> *buffer);
+
+  void PublishSuppressionEntries() const;
+
+  const UserPosInterface *user_pos_;
+  SuppressionDictionary *suppression_dictionary_;
+  std::shared_ptr<const Segment> base_;
+  Segment overlay_;
+  // TokensFingerprint() of the base tokens hidden by the overlay.
+  absl::flat_hash_set<uint64_t> removed_;
+  size_t size_ = 0;
+  // Kept to update them incrementally and to persist them in the cache.
+  std::vector<std::pair<std::string, std::string>> suppression_entries_;
+  std::vector<uint64_t> suppression_fps_;
+};
+
+// Iterates over the tokens of the base and the overlay in the order of
+// OrderByKeyThenById, skipping the base tokens hidden by the overlay.
+class UserDictionary::TokensIndex::Cursor {
+ public:
+  // Returns the next token, or nullptr at the end. `tokens_fp` receives the
+  // fingerprint of the entry the token comes from, if available.
+  const UserPos::Token *Next(uint64_t *tokens_fp = nullptr) {
+    const Segment &base = *index_->base_;
+    const Segment &overlay = index_->overlay_;
+    if (!index_->removed_.empty()) {
+      while (base_pos_ < base_end_ &&
+             index_->removed_.contains(base.tokens_fps[base_pos_])) {
+        ++base_pos_;
+      }
+    }
+    const bool has_base = base_pos_ < base_end_;
+    if (overlay_pos_ < overlay_end_ &&
+        (!has_base || OrderByKeyThenById()(overlay.tokens[overlay_pos_],
+                                           base.tokens[base_pos_]))) {
+      return Take(overlay, overlay_pos_++, tokens_fp);
+    }
+    if (has_base) {
+      return Take(base, base_pos_++, tokens_fp);
+    }
+    return nullptr;
+  }
+
+ private:
+  friend class TokensIndex;
+
+  Cursor(const TokensIndex *index, std::pair<size_t, size_t> base_range,
+         std::pair<size_t, size_t> overlay_range)
+      : index_(index),
+        base_pos_(base_range.first),
+        base_end_(base_range.second),
+        overlay_pos_(overlay_range.first),
+        overlay_end_(overlay_range.second) {}
+
+  static const UserPos::Token *Take(const Segment &segment, size_t pos,
+                                    uint64_t *tokens_fp) {
+    if (tokens_fp != nullptr && !segment.tokens_fps.empty()) {
+      *tokens_fp = segment.tokens_fps[pos];
+    }
+    return &segment.tokens[pos];
+  }
+
+  const TokensIndex *index_;
+  size_t base_pos_;
+  size_t base_end_;
+  size_t overlay_pos_;
+  size_t overlay_end_;
+};
 
-    const SuppressionDictionaryLock l(suppression_dictionary_);
-    suppression_dictionary_->Clear();
+void UserDictionary::TokensIndex::Segment::Sort() {
+  DCHECK_EQ(tokens.size(), tokens_fps.size());
+  std::vector<uint32_t> order(tokens.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+    return OrderByKeyThenById()(tokens[lhs], tokens[rhs]);
+  });
+  std::vector<UserPos::Token> sorted_tokens;
+  std::vector<uint64_t> sorted_fps;
+  sorted_tokens.reserve(tokens.size());
+  sorted_fps.reserve(tokens.size());
+  for (const uint32_t i : order) {
+    sorted_tokens.push_back(std::move(tokens[i]));
+    sorted_fps.push_back(tokens_fps[i]);
+  }
+  tokens = std::move(sorted_tokens);
+  tokens_fps = std::move(sorted_fps);
+}
+
+template <typename Compare>
+UserDictionary::TokensIndex::Cursor UserDictionary::TokensIndex::Range(
+    absl::string_view key, Compare comp) const {
+  auto range = [&](const Segment &segment) {
+    const auto [begin, end] = std::equal_range(
+        segment.tokens.begin(), segment.tokens.end(), key, comp);
+    return std::make_pair<size_t, size_t>(begin - segment.tokens.begin(),
+                                          end - segment.tokens.begin());
+  };
+  return Cursor(this, range(*base_), range(overlay_));
+}
+
+UserDictionary::TokensIndex::Cursor UserDictionary::TokensIndex::EqualRange(
+    absl::string_view key) const {
+  return Range(key, OrderByKey());
+}
+
+UserDictionary::TokensIndex::Cursor UserDictionary::TokensIndex::PrefixRange(
+    absl::string_view prefix) const {
+  return Range(prefix, OrderByKeyPrefix());
+}
+
+UserDictionary::TokensIndex::Cursor UserDictionary::TokensIndex::LowerBound(
+    absl::string_view key) const {
+  auto range = [&](const Segment &segment) {
+    const auto it = std::lower_bound(segment.tokens.begin(),
+                                     segment.tokens.end(), key, OrderByKey());
+    return std::make_pair<size_t, size_t>(it - segment.tokens.begin(),
+                                          segment.tokens.size());
+  };
+  return Cursor(this, range(*base_), range(overlay_));
+}
 
-    for (const UserDictionaryStorage::UserDictionary &dic :
-         storage.dictionaries()) {
-      if (!dic.enabled() || dic.entries_size() == 0) {
+void UserDictionary::TokensIndex::AddEntry(
+    const UserDictionaryStorage::UserDictionaryEntry &entry,
+    std::string reading, uint64_t tokens_fp, bool is_android_shortcuts,
+    Segment *segment, EntryTable *table, std::vector<UserPos::Token> *buffer) {
+  if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
+    // "抑制単語"
+    suppression_entries_.emplace_back(std::move(reading), entry.value());
+    suppression_fps_.push_back(tokens_fp);
+    table->num_tokens[tokens_fp] = 0;
+    return;
+  }
+  CompileEntry(*user_pos_, entry, reading, is_android_shortcuts, buffer);
+  for (UserPos::Token &token : *buffer) {
+    segment->tokens.push_back(std::move(token));
+    segment->tokens_fps.push_back(tokens_fp);
+  }
+  table->num_tokens[tokens_fp] = buffer->size();
+  size_ += buffer->size();
+}
+
+void UserDictionary::TokensIndex::PublishSuppressionEntries() const {
+  const SuppressionDictionaryLock l(suppression_dictionary_);
+  suppression_dictionary_->Clear();
+  for (const auto &[key, value] : suppression_entries_) {
+    suppression_dictionary_->AddEntry(key, value);
+  }
+}
+
+void UserDictionary::TokensIndex::Load(
+    const user_dictionary::UserDictionaryStorage &storage, EntryTable *table) {
+  table->clear();
+  table->entry_fps.resize(storage.dictionaries_size());
+  Segment base;
+  std::vector<UserPos::Token> tokens;
+
+  for (int i = 0; i < storage.dictionaries_size(); ++i) {
+    const UserDictionaryStorage::UserDictionary &dic = storage.dictionaries(i);
+    if (!dic.enabled() || dic.entries_size() == 0) {
+      continue;
+    }
+    const bool is_android_shortcuts =
+        (dic.name() == kAndroidShortcutsDictionaryName);
+    std::vector<uint64_t> &entry_fps = table->entry_fps[i];
+    entry_fps.reserve(dic.entries_size());
+
+    for (const UserDictionaryStorage::UserDictionaryEntry &entry :
+         dic.entries()) {
+      entry_fps.push_back(EntryFingerprint(entry, is_android_shortcuts));
+      const auto [it, inserted] = table->entries.try_emplace(entry_fps.back());
+      ++it->second.count;
+      if (!inserted) {
+        VLOG(1) << "Found dup item";
         continue;
       }
-      const bool is_android_shortcuts =
-          (dic.name() == "__auto_imported_android_shortcuts_dictionary");
+      if (!UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
+        continue;
+      }
+      std::string reading = NormalizeEntryReading(entry.key());
+      EntryTable::Entry &info = it->second;
+      info.valid = true;
+      info.tokens_fp = TokensFingerprint(reading, entry);
+      table->AddTokensRef(info.tokens_fp);
+      if (table->num_tokens.contains(info.tokens_fp)) {
+        VLOG(1) << "Found dup item";
+        continue;
+      }
+      AddEntry(entry, std::move(reading), info.tokens_fp, is_android_shortcuts,
+               &base, table, &tokens);
+    }
+  }
+  base.Sort();
+  base.tokens.shrink_to_fit();
+  base.tokens_fps.shrink_to_fit();
+  base_ = std::make_shared<const Segment>(std::move(base));
+  PublishSuppressionEntries();
 
-      for (const UserDictionaryStorage::UserDictionaryEntry &entry :
-           dic.entries()) {
-        if (!UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
-          continue;
-        }
+  VLOG(1) << size_ << " user dic entries loaded";
 
-        // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
-        // because the normalization is user-visible.
-        // http://b/2480844
-        std::string reading = japanese::NormalizeVoicedSoundMark(
-            UserDictionaryUtil::NormalizeReading(entry.key()));
-
-        DCHECK(user_dictionary::UserDictionary_PosType_IsValid(entry.pos()));
-        static_assert(user_dictionary::UserDictionary_PosType_PosType_MAX <=
-                      std::numeric_limits<char>::max());
-        const char pos_type_as_char[] = {static_cast<char>(entry.pos())};
-        const uint64_t fp =
-            Fingerprint(absl::StrCat(reading, "\t", entry.value(), "\t",
-                                     absl::string_view(pos_type_as_char, 1)));
-        if (!seen.insert(fp).second) {
-          VLOG(1) << "Found dup item";
-          continue;
-        }
+  usage_stats::UsageStats::SetInteger("UserRegisteredWord",
+                                      static_cast<int>(size_));
+}
+
+void UserDictionary::TokensIndex::Load(UserDictionaryCache::Contents contents) {
+  DCHECK(std::is_sorted(contents.tokens.begin(), contents.tokens.end(),
+                        OrderByKeyThenById()));
+  DCHECK_EQ(contents.tokens.size(), contents.tokens_fps.size());
+  size_ = contents.tokens.size();
+  base_ = std::make_shared<const Segment>(
+      Segment{.tokens = std::move(contents.tokens),
+              .tokens_fps = std::move(contents.tokens_fps)});
+  suppression_entries_ = std::move(contents.suppression_entries);
+  suppression_fps_ = std::move(contents.suppression_fps);
+  PublishSuppressionEntries();
+
+  VLOG(1) << size_ << " user dic entries loaded from cache";
+
+  usage_stats::UsageStats::SetInteger("UserRegisteredWord",
+                                      static_cast<int>(size_));
+}
+
+bool UserDictionary::TokensIndex::BuildEntryTable(
+    const user_dictionary::UserDictionaryStorage &storage,
+    EntryTable *table) const {
+  table->clear();
+  if (overlay_size() > 0 || base_->tokens_fps.size() != base_->tokens.size()) {
+    return false;
+  }
+  // The tokens not claimed by any entry yet, counted for each tokens_fp.
+  absl::flat_hash_map<uint64_t, uint32_t> unclaimed;
+  for (const uint64_t tokens_fp : base_->tokens_fps) {
+    ++unclaimed[tokens_fp];
+  }
+  absl::flat_hash_set<uint64_t> unclaimed_suppression(suppression_fps_.begin(),
+                                                      suppression_fps_.end());
+  auto mismatch = [table] {
+    table->clear();
+    return false;
+  };
 
-        if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
-          // "抑制単語"
-          suppression_dictionary_->AddEntry(std::move(reading), entry.value());
-        } else if (entry.pos() == user_dictionary::UserDictionary::NO_POS) {
-          // In theory NO_POS works without this implementation, as it is
-          // covered in the UserPos::GetTokens function. However, that function
-          // is depending on the user_pos_*.data in the dictionary and there
-          // will not be corresponding POS tag. To avoid invalid behavior, this
-          // special treatment is added here.
-          // "品詞なし"
-          const absl::string_view comment =
-              absl::StripAsciiWhitespace(entry.comment());
-          UserPos::Token token{.key = entry.key(),
-                               .value = entry.value(),
-                               .id = 0,
-                               .attributes = UserPos::Token::SHORTCUT,
-                               .comment = std::string(comment)};
-          // NO_POS has '名詞サ変' id as in user_pos.def
-          user_pos_->GetPosIds("名詞サ変", &token.id);
-          user_pos_tokens_.push_back(std::move(token));
-        } else {
-          tokens.clear();
-          user_pos_->GetTokens(
-              reading, entry.value(),
-              UserDictionaryUtil::GetStringPosType(entry.pos()), &tokens);
-          const absl::string_view comment =
-              absl::StripAsciiWhitespace(entry.comment());
-          for (auto &token : tokens) {
-            strings::Assign(token.comment, comment);
-            if (is_android_shortcuts &&
-                token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
-              // TODO(b/295964970): This special implementation is planned to be
-              // removed after validating the safety of NO_POS implementation.
-              token.remove_attribute(UserPos::Token::SUGGESTION_ONLY);
-              token.add_attribute(UserPos::Token::SHORTCUT);
-            }
-            user_pos_tokens_.push_back(std::move(token));
-          }
+  table->entry_fps.resize(storage.dictionaries_size());
+  for (int i = 0; i < storage.dictionaries_size(); ++i) {
+    const UserDictionaryStorage::UserDictionary &dic = storage.dictionaries(i);
+    if (!dic.enabled() || dic.entries_size() == 0) {
+      continue;
+    }
+    const bool is_android_shortcuts =
+        (dic.name() == kAndroidShortcutsDictionaryName);
+    std::vector<uint64_t> &entry_fps = table->entry_fps[i];
+    entry_fps.reserve(dic.entries_size());
+
+    for (const UserDictionaryStorage::UserDictionaryEntry &entry :
+         dic.entries()) {
+      entry_fps.push_back(EntryFingerprint(entry, is_android_shortcuts));
+      const auto [it, inserted] = table->entries.try_emplace(entry_fps.back());
+      ++it->second.count;
+      if (!inserted || !UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
+        continue;
+      }
+      EntryTable::Entry &info = it->second;
+      info.valid = true;
+      info.tokens_fp = TokensFingerprint(NormalizeEntryReading(entry.key()),
+                                         entry);
+      table->AddTokensRef(info.tokens_fp);
+      if (table->num_tokens.contains(info.tokens_fp)) {
+        continue;
+      }
+      if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
+        if (unclaimed_suppression.erase(info.tokens_fp) == 0) {
+          return mismatch();
         }
+        table->num_tokens[info.tokens_fp] = 0;
+        continue;
+      }
+      const auto tokens = unclaimed.find(info.tokens_fp);
+      if (tokens == unclaimed.end()) {
+        return mismatch();
+      }
+      table->num_tokens[info.tokens_fp] = tokens->second;
+      unclaimed.erase(tokens);
+    }
+  }
+  if (!unclaimed.empty() || !unclaimed_suppression.empty()) {
+    return mismatch();
+  }
+  return true;
+}
+
+std::unique_ptr<UserDictionary::TokensIndex>
+UserDictionary::TokensIndex::Update(
+    const user_dictionary::UserDictionaryStorage &storage,
+    EntryTable *table) const {
+  if (table->empty()) {
+    return nullptr;
+  }
+
+  // Finds the entries added or removed by comparing the entries with those of
+  // the last load in the storage order. Unchanged entries reuse their
+  // fingerprints, so only the added ones are fingerprinted.
+  struct AddedEntry {
+    const UserDictionaryStorage::UserDictionaryEntry *entry;
+    uint64_t entry_fp;
+    bool is_android_shortcuts;
+  };
+  std::vector<AddedEntry> added;
+  std::vector<uint64_t> removed;
+  std::vector<std::vector<uint64_t>> entry_fps(storage.dictionaries_size());
+  size_t num_entries = 0;
+
+  // Indices of the previous dictionaries not matched yet, keyed by ID.
+  absl::flat_hash_map<uint64_t, int> previous_dics;
+  for (int i = 0; i < table->storage.dictionaries_size(); ++i) {
+    if (!table->entry_fps[i].empty()) {
+      previous_dics.emplace(table->storage.dictionaries(i).id(), i);
+    }
+  }
+  for (int i = 0; i < storage.dictionaries_size(); ++i) {
+    const UserDictionaryStorage::UserDictionary &dic = storage.dictionaries(i);
+    if (!dic.enabled() || dic.entries_size() == 0) {
+      continue;
+    }
+    const bool is_android_shortcuts =
+        (dic.name() == kAndroidShortcutsDictionaryName);
+
+    const UserDictionaryStorage::UserDictionary *previous_dic = nullptr;
+    const std::vector<uint64_t> *previous_fps = nullptr;
+    if (const auto it = previous_dics.find(dic.id());
+        it != previous_dics.end()) {
+      const UserDictionaryStorage::UserDictionary &candidate =
+          table->storage.dictionaries(it->second);
+      // The fingerprints depend on whether it is the shortcuts dictionary.
+      if ((candidate.name() == kAndroidShortcutsDictionaryName) ==
+          is_android_shortcuts) {
+        previous_dic = &candidate;
+        previous_fps = &table->entry_fps[it->second];
+        previous_dics.erase(it);
       }
     }
-    user_pos_tokens_.shrink_to_fit();
+    const int previous_size =
+        previous_dic == nullptr ? 0 : previous_dic->entries_size();
+
+    // Realigns after a few removed entries by looking ahead. Entries moved
+    // further are treated as removals and additions.
+    constexpr int kMaxLookahead = 16;
+    std::vector<uint64_t> &fps = entry_fps[i];
+    fps.reserve(dic.entries_size());
+    int j = 0;
+    for (const UserDictionaryStorage::UserDictionaryEntry &entry :
+         dic.entries()) {
+      int k = j;
+      while (k < std::min(previous_size, j + kMaxLookahead) &&
+             !IsSameEntry(entry, previous_dic->entries(k))) {
+        ++k;
+      }
+      if (k == std::min(previous_size, j + kMaxLookahead)) {
+        fps.push_back(EntryFingerprint(entry, is_android_shortcuts));
+        added.push_back({&entry, fps.back(), is_android_shortcuts});
+        continue;
+      }
+      removed.insert(removed.end(), previous_fps->begin() + j,
+                     previous_fps->begin() + k);
+      fps.push_back((*previous_fps)[k]);
+      j = k + 1;
+    }
+    for (; j < previous_size; ++j) {
+      removed.push_back((*previous_fps)[j]);
+    }
+    num_entries += fps.size();
+  }
+  for (const auto &[id, index] : previous_dics) {
+    removed.insert(removed.end(), table->entry_fps[index].begin(),
+                   table->entry_fps[index].end());
+  }
+  if ((added.size() + removed.size()) * 2 > num_entries) {
+    // Rebuilding is as fast as updating.
+    return nullptr;
+  }
 
-    // Sort first by key and then by POS ID.
-    std::sort(user_pos_tokens_.begin(), user_pos_tokens_.end(),
-              OrderByKeyThenById());
+  // TokensFingerprint() of the entries whose tokens need to be recompiled.
+  absl::flat_hash_set<uint64_t> changed;
+  for (const uint64_t entry_fp : removed) {
+    const auto it = table->entries.find(entry_fp);
+    DCHECK(it != table->entries.end());
+    if (it == table->entries.end()) {
+      continue;
+    }
+    const EntryTable::Entry info = it->second;
+    if (info.valid) {
+      changed.insert(info.tokens_fp);
+    }
+    if (--it->second.count == 0) {
+      if (info.valid) {
+        table->RemoveTokensRef(info.tokens_fp);
+      }
+      table->entries.erase(it);
+    }
+  }
+  // The added entries referring to the changed tokens_fp, in the storage
+  // order.
+  absl::flat_hash_map<uint64_t, const AddedEntry *> first_added;
+  for (const AddedEntry &added_entry : added) {
+    const auto [it, inserted] =
+        table->entries.try_emplace(added_entry.entry_fp);
+    EntryTable::Entry &info = it->second;
+    ++info.count;
+    if (inserted && UserDictionaryUtil::IsValidEntry(*user_pos_,
+                                                     *added_entry.entry)) {
+      info.valid = true;
+      info.tokens_fp = TokensFingerprint(
+          NormalizeEntryReading(added_entry.entry->key()), *added_entry.entry);
+      table->AddTokensRef(info.tokens_fp);
+    }
+    if (info.valid) {
+      changed.insert(info.tokens_fp);
+      first_added.try_emplace(info.tokens_fp, &added_entry);
+    }
+  }
 
-    VLOG(1) << user_pos_tokens_.size() << " user dic entries loaded";
+  auto index =
+      std::make_unique<TokensIndex>(user_pos_, suppression_dictionary_);
+  index->base_ = base_;
+  index->removed_ = removed_;
+  index->size_ = size_;
+  for (const uint64_t tokens_fp : changed) {
+    if (const auto it = table->num_tokens.find(tokens_fp);
+        it != table->num_tokens.end()) {
+      index->size_ -= it->second;
+      table->num_tokens.erase(it);
+    }
+    index->removed_.insert(tokens_fp);
+  }
+  for (size_t i = 0; i < overlay_.tokens.size(); ++i) {
+    if (!changed.contains(overlay_.tokens_fps[i])) {
+      index->overlay_.tokens.push_back(overlay_.tokens[i]);
+      index->overlay_.tokens_fps.push_back(overlay_.tokens_fps[i]);
+    }
+  }
+  for (size_t i = 0; i < suppression_entries_.size(); ++i) {
+    if (!changed.contains(suppression_fps_[i])) {
+      index->suppression_entries_.push_back(suppression_entries_[i]);
+      index->suppression_fps_.push_back(suppression_fps_[i]);
+    }
+  }
 
-    usage_stats::UsageStats::SetInteger(
-        "UserRegisteredWord", static_cast<int>(user_pos_tokens_.size()));
+  // Recompiles the first entry of each changed tokens_fp as Load() does. When
+  // a single entry refers to the tokens_fp and it was added, it is the first
+  // one. Otherwise, i.e. when duplicates remain, the storage is searched.
+  std::vector<UserPos::Token> tokens;
+  absl::flat_hash_set<uint64_t> duplicated;
+  for (const uint64_t tokens_fp : changed) {
+    const auto refs = table->tokens_refs.find(tokens_fp);
+    if (refs == table->tokens_refs.end()) {
+      continue;
+    }
+    const auto it = first_added.find(tokens_fp);
+    if (refs->second > 1 || it == first_added.end()) {
+      duplicated.insert(tokens_fp);
+      continue;
+    }
+    const AddedEntry &added_entry = *it->second;
+    index->AddEntry(*added_entry.entry,
+                    NormalizeEntryReading(added_entry.entry->key()), tokens_fp,
+                    added_entry.is_android_shortcuts, &index->overlay_, table,
+                    &tokens);
+  }
+  for (int i = 0; !duplicated.empty() && i < storage.dictionaries_size();
+       ++i) {
+    const UserDictionaryStorage::UserDictionary &dic = storage.dictionaries(i);
+    for (int j = 0; j < entry_fps[i].size() && !duplicated.empty(); ++j) {
+      const EntryTable::Entry &info = table->entries.at(entry_fps[i][j]);
+      if (!info.valid || !duplicated.contains(info.tokens_fp)) {
+        continue;
+      }
+      duplicated.erase(info.tokens_fp);
+      const UserDictionaryStorage::UserDictionaryEntry &entry = dic.entries(j);
+      index->AddEntry(entry, NormalizeEntryReading(entry.key()),
+                      info.tokens_fp,
+                      dic.name() == kAndroidShortcutsDictionaryName,
+                      &index->overlay_, table, &tokens);
+    }
+  }
+  index->overlay_.Sort();
+  table->entry_fps = std::move(entry_fps);
+  if (!changed.empty()) {
+    index->PublishSuppressionEntries();
   }
 
- private:
-  const UserPosInterface *user_pos_;
-  SuppressionDictionary *suppression_dictionary_;
-  std::vector<UserPos::Token> user_pos_tokens_;
-};
+  VLOG(1) << changed.size() << " user dic entries updated";
+
+  usage_stats::UsageStats::SetInteger("UserRegisteredWord",
+                                      static_cast<int>(index->size_));
+  return index;
+}
+
+std::unique_ptr<UserDictionary::TokensIndex>
+UserDictionary::TokensIndex::Compact() const {
+  Segment base;
+  base.tokens.reserve(size_);
+  base.tokens_fps.reserve(size_);
+  Cursor cursor = LowerBound("");
+  uint64_t tokens_fp = 0;
+  while (const UserPos::Token *token = cursor.Next(&tokens_fp)) {
+    base.tokens.push_back(*token);
+    base.tokens_fps.push_back(tokens_fp);
+  }
+
+  auto index =
+      std::make_unique<TokensIndex>(user_pos_, suppression_dictionary_);
+  index->base_ = std::make_shared<const Segment>(std::move(base));
+  index->size_ = size_;
+  index->suppression_entries_ = suppression_entries_;
+  index->suppression_fps_ = suppression_fps_;
+  return index;
+}
+
+UserDictionaryCache::Contents UserDictionary::TokensIndex::ToCacheContents()
+    const {
+  UserDictionaryCache::Contents contents;
+  contents.tokens.reserve(size_);
+  contents.tokens_fps.reserve(size_);
+  Cursor cursor = LowerBound("");
+  uint64_t tokens_fp = 0;
+  while (const UserPos::Token *token = cursor.Next(&tokens_fp)) {
+    contents.tokens.push_back(*token);
+    contents.tokens_fps.push_back(tokens_fp);
+  }
+  contents.suppression_entries = suppression_entries_;
+  contents.suppression_fps = suppression_fps_;
+  return contents;
+}
 
 class UserDictionary::UserDictionaryReloader {
  public:
@@ -295,10 +919,49 @@ class UserDictionary::UserDictionaryReloader {
     }
   }
 
+  // Saves the cache deferred by incremental loads. Call after Wait().
+  void SavePendingCache() {
+    if (!pending_cache_stamp_.has_value()) {
+      return;
+    }
+    const std::string filename =
+        Singleton<UserDictionaryFileManager>::get()->GetFileName();
+    if (GetStamp(filename) == pending_cache_stamp_) {
+      SaveCache(filename, *pending_cache_stamp_);
+    }
+    pending_cache_stamp_.reset();
+  }
+
  private:
   void ThreadMain() {
-    UserDictionaryStorage storage(
-        Singleton<UserDictionaryFileManager>::get()->GetFileName());
+    const std::string filename =
+        Singleton<UserDictionaryFileManager>::get()->GetFileName();
+    const std::string cache_filename =
+        UserDictionaryCache::GetCacheFileName(filename);
+
+    // If the source is unchanged since the cache was compiled, load the cache
+    // instead of parsing and compiling the whole storage.
+    const std::optional<UserDictionaryCache::Stamp> stamp = GetStamp(filename);
+    if (stamp.has_value()) {
+      absl::StatusOr<UserDictionaryCache::Contents> contents =
+          UserDictionaryCache::Load(cache_filename, *stamp);
+      if (contents.ok()) {
+        dic_->LoadFromCache(*std::move(contents));
+        pending_cache_stamp_.reset();
+        // The tokens are already available. Parses the storage afterwards so
+        // that the next edit is applied incrementally, unless the file was
+        // rewritten since the cache was loaded.
+        UserDictionaryStorage storage(filename);
+        if (absl::Status s = storage.Load();
+            s.ok() && GetStamp(filename) == stamp) {
+          dic_->LoadEntryTable(std::move(storage.GetProto()));
+        }
+        return;
+      }
+      VLOG(1) << "Cannot use the user dictionary cache: " << contents.status();
+    }
+
+    UserDictionaryStorage storage(filename);
 
     // Load from file
     if (absl::Status s = storage.Load(); !s.ok()) {
@@ -306,8 +969,10 @@ class UserDictionary::UserDictionaryReloader {
       return;
     }
 
+    bool converted = false;
     if (storage.ConvertSyncDictionariesToNormalDictionaries()) {
       LOG(INFO) << "Syncable dictionaries are converted to normal dictionaries";
+      converted = true;
       if (storage.Lock()) {
         if (absl::Status s = storage.Save(); !s.ok()) {
           LOG(ERROR) << "Failed to save to storage: " << s;
@@ -316,12 +981,56 @@ class UserDictionary::UserDictionaryReloader {
       }
     }
 
-    dic_->Load(storage.GetProto());
+    dic_->Load(std::move(storage.GetProto()));
+    pending_cache_stamp_.reset();
+
+    // Don't persist the result if the file was rewritten while loading;
+    // otherwise the cache could be stamped with stale contents.
+    if (!stamp.has_value() || converted || GetStamp(filename) != stamp) {
+      return;
+    }
+    // Rewriting the whole cache would dominate an incremental load, so it is
+    // deferred until the overlay is compacted or the dictionary is destroyed.
+    if (dic_->tokens_.load()->overlay_size() > 0) {
+      pending_cache_stamp_ = stamp;
+      return;
+    }
+    SaveCache(filename, *stamp);
+  }
+
+  void SaveCache(const std::string &filename,
+                 const UserDictionaryCache::Stamp &stamp) {
+    if (absl::Status s = UserDictionaryCache::Save(
+            UserDictionaryCache::GetCacheFileName(filename), stamp,
+            dic_->tokens_.load()->ToCacheContents());
+        !s.ok()) {
+      LOG(WARNING) << "Failed to save the user dictionary cache: " << s;
+    }
+  }
+
+  std::optional<UserDictionaryCache::Stamp> GetStamp(
+      const std::string &filename) {
+    absl::StatusOr<std::string> source = FileUtil::GetContents(filename);
+    if (!source.ok()) {
+      return std::nullopt;
+    }
+    if (!user_pos_fingerprint_.has_value()) {
+      user_pos_fingerprint_ =
+          UserDictionaryCache::FingerprintUserPos(*dic_->user_pos_);
+    }
+    return UserDictionaryCache::Stamp{
+        .source_fingerprint = Fingerprint(*source),
+        .user_pos_fingerprint = *user_pos_fingerprint_,
+    };
   }
 
   std::optional<BackgroundFuture<void>> reload_;
   FileTimeStamp modified_at_;
   UserDictionary *dic_;
+  // Computed on the reloader thread when first needed.
+  std::optional<uint64_t> user_pos_fingerprint_;
+  // The stamp of the last incremental load whose cache is not saved yet.
+  std::optional<UserDictionaryCache::Stamp> pending_cache_stamp_;
   std::string key_;
   std::string value_;
 };
@@ -333,14 +1042,18 @@ UserDictionary::UserDictionary(std::unique_ptr<const UserPosInterface> user_pos,
       user_pos_(std::move(user_pos)),
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
-      tokens_(std::make_unique<TokensIndex>(user_pos_.get(),
+      entry_table_(std::make_unique<EntryTable>()),
+      tokens_(std::make_shared<TokensIndex>(user_pos_.get(),
                                             suppression_dictionary)) {
   DCHECK(user_pos_.get());
   DCHECK(suppression_dictionary_);
   Reload();
 }
 
-UserDictionary::~UserDictionary() = default;
+UserDictionary::~UserDictionary() {
+  reloader_->Wait();
+  reloader_->SavePendingCache();
+}
 
 bool UserDictionary::HasKey(absl::string_view key) const {
   // TODO(noriyukit): Currently, we don't support HasKey() for user dictionary
@@ -360,13 +1073,13 @@ bool UserDictionary::HasValue(absl::string_view value) const {
 void UserDictionary::LookupPredictive(
     absl::string_view key, const ConversionRequest &conversion_request,
     Callback *callback) const {
-  absl::ReaderMutexLock l(&mutex_);
+  const std::shared_ptr<const TokensIndex> tokens = tokens_.load();
 
   if (key.empty()) {
     VLOG(2) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  if (tokens->empty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
@@ -375,10 +1088,9 @@ void UserDictionary::LookupPredictive(
 
   // Find the starting point of iteration over dictionary contents.
   Token token;
-  for (auto [begin, end] = std::equal_range(tokens_->begin(), tokens_->end(),
-                                            key, OrderByKeyPrefix());
-       begin != end; ++begin) {
-    const UserPos::Token &user_pos_token = *begin;
+  for (TokensIndex::Cursor cursor = tokens->PrefixRange(key);
+       const UserPos::Token *it = cursor.Next();) {
+    const UserPos::Token &user_pos_token = *it;
     switch (callback->OnKey(user_pos_token.key)) {
       case Callback::TRAVERSE_DONE:
         return;
@@ -400,13 +1112,13 @@ void UserDictionary::LookupPredictive(
 void UserDictionary::LookupPrefix(absl::string_view key,
                                   const ConversionRequest &conversion_request,
                                   Callback *callback) const {
-  absl::ReaderMutexLock l(&mutex_);
+  const std::shared_ptr<const TokensIndex> tokens = tokens_.load();
 
   if (key.empty()) {
     LOG(WARNING) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  if (tokens->empty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
@@ -416,9 +1128,8 @@ void UserDictionary::LookupPrefix(absl::string_view key,
   // Find the starting point for iteration over dictionary contents.
   const absl::string_view first_char = Utf8AsChars(key).front();
   Token token;
-  for (auto it = std::lower_bound(tokens_->begin(), tokens_->end(), first_char,
-                                  OrderByKey());
-       it != tokens_->end(); ++it) {
+  for (TokensIndex::Cursor cursor = tokens->LowerBound(first_char);
+       const UserPos::Token *it = cursor.Next();) {
     const UserPos::Token &user_pos_token = *it;
     if (user_pos_token.key > key) {
       break;
@@ -456,14 +1167,14 @@ void UserDictionary::LookupPrefix(absl::string_view key,
 void UserDictionary::LookupExact(absl::string_view key,
                                  const ConversionRequest &conversion_request,
                                  Callback *callback) const {
-  absl::ReaderMutexLock l(&mutex_);
-  if (key.empty() || tokens_->empty() ||
+  const std::shared_ptr<const TokensIndex> tokens = tokens_.load();
+  if (key.empty() || tokens->empty() ||
       conversion_request.config().incognito_mode()) {
     return;
   }
-  auto [begin, end] =
-      std::equal_range(tokens_->begin(), tokens_->end(), key, OrderByKey());
-  if (begin == end) {
+  TokensIndex::Cursor cursor = tokens->EqualRange(key);
+  const UserPos::Token *it = cursor.Next();
+  if (it == nullptr) {
     return;
   }
   if (callback->OnKey(key) != Callback::TRAVERSE_CONTINUE) {
@@ -471,8 +1182,8 @@ void UserDictionary::LookupExact(absl::string_view key,
   }
 
   Token token;
-  for (; begin != end; ++begin) {
-    const UserPos::Token &user_pos_token = *begin;
+  for (; it != nullptr; it = cursor.Next()) {
+    const UserPos::Token &user_pos_token = *it;
     if (user_pos_token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
       continue;
     }
@@ -495,16 +1206,15 @@ bool UserDictionary::LookupComment(absl::string_view key,
     return false;
   }
 
-  absl::ReaderMutexLock l(&mutex_);
-  if (tokens_->empty()) {
+  const std::shared_ptr<const TokensIndex> tokens = tokens_.load();
+  if (tokens->empty()) {
     return false;
   }
 
   // Set the comment that was found first.
-  for (auto [begin, end] = std::equal_range(tokens_->begin(), tokens_->end(),
-                                            key, OrderByKey());
-       begin != end; ++begin) {
-    const UserPos::Token &token = *begin;
+  for (TokensIndex::Cursor cursor = tokens->EqualRange(key);
+       const UserPos::Token *it = cursor.Next();) {
+    const UserPos::Token &token = *it;
     if (token.value == value && !token.comment.empty()) {
       comment->assign(token.comment);
       return true;
@@ -550,18 +1260,30 @@ void UserDictionary::WaitForReloader() { reloader_->Wait(); }
 
 void UserDictionary::Swap(std::unique_ptr<TokensIndex> new_tokens) {
   DCHECK(new_tokens);
-  absl::WriterMutexLock l(&mutex_);
-  tokens_.swap(new_tokens);
+  tokens_.store(std::move(new_tokens));
 }
 
-bool UserDictionary::Load(
-    const user_dictionary::UserDictionaryStorage &storage) {
-  size_t size = 0;
-  {
-    absl::ReaderMutexLock l(&mutex_);
-    size = tokens_->size();
+bool UserDictionary::Load(user_dictionary::UserDictionaryStorage storage) {
+  absl::MutexLock l(&load_mutex_);
+  const std::shared_ptr<const TokensIndex> current = tokens_.load();
+
+  // Applies the changes since the last load to a copy of the overlay when they
+  // are small. The overlay is merged into the base once it grows.
+  if (std::unique_ptr<TokensIndex> updated =
+          current->Update(storage, entry_table_.get());
+      updated != nullptr) {
+    constexpr size_t kMinCompactionSize = 1024;
+    if (updated->overlay_size() >
+        std::max(kMinCompactionSize, updated->size() / 8)) {
+      updated = updated->Compact();
+    }
+    Swap(std::move(updated));
+    entry_table_->storage = std::move(storage);
+    return true;
   }
 
+  const size_t size = current->size();
+
   // If UserDictionary is pretty big, we first remove the
   // current dictionary to save memory usage.
 #ifdef __ANDROID__
@@ -578,11 +1300,41 @@ bool UserDictionary::Load(
 
   auto tokens =
       std::make_unique<TokensIndex>(user_pos_.get(), suppression_dictionary_);
-  tokens->Load(storage);
+  tokens->Load(storage, entry_table_.get());
   Swap(std::move(tokens));
+  entry_table_->storage = std::move(storage);
   return true;
 }
 
+void UserDictionary::LoadFromCache(UserDictionaryCache::Contents contents) {
+  absl::MutexLock l(&load_mutex_);
+  // The entries are recorded later by LoadEntryTable(). Until then, the next
+  // load rebuilds the index.
+  entry_table_->clear();
+  auto tokens =
+      std::make_unique<TokensIndex>(user_pos_.get(), suppression_dictionary_);
+  tokens->Load(std::move(contents));
+  Swap(std::move(tokens));
+}
+
+void UserDictionary::LoadEntryTable(
+    user_dictionary::UserDictionaryStorage storage) {
+  absl::MutexLock l(&load_mutex_);
+  if (!entry_table_->empty()) {
+    // Loaded from the storage in the meantime.
+    return;
+  }
+  if (!tokens_.load()->BuildEntryTable(storage, entry_table_.get())) {
+    LOG(WARNING) << "The user dictionary cache does not match the storage";
+    return;
+  }
+  entry_table_->storage = std::move(storage);
+}
+
+size_t UserDictionary::GetOverlaySizeForTest() const {
+  return tokens_.load()->overlay_size();
+}
+
 std::vector<std::string> UserDictionary::GetPosList() const {
   std::vector<std::string> pos_list;
   user_pos_->GetPosList(&pos_list);
@@ -30,14 +30,17 @@
 #ifndef MOZC_DICTIONARY_USER_DICTIONARY_H_
 #define MOZC_DICTIONARY_USER_DICTIONARY_H_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "base/atomic_shared_ptr.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary_cache.h"
 #include "dictionary/user_pos_interface.h"
 #include "protocol/user_dictionary_storage.pb.h"
 #include "request/conversion_request.h"
@@ -86,7 +89,8 @@ class UserDictionary : public DictionaryInterface {
 
   // Loads dictionary from UserDictionaryStorage.
   // mainly for unittesting
-  bool Load(const user_dictionary::UserDictionaryStorage &storage);
+  // The storage is kept to apply the next load incrementally.
+  bool Load(user_dictionary::UserDictionaryStorage storage);
 
   // Reloads dictionary asynchronously
   bool Reload() override;
@@ -97,6 +101,10 @@ class UserDictionary : public DictionaryInterface {
   // Gets the user POS list.
   std::vector<std::string> GetPosList() const;
 
+  // Returns the number of tokens not compacted into the base index yet, i.e.
+  // zero after a full load.
+  size_t GetOverlaySizeForTest() const;
+
   // Sets user dicitonary filename for unittesting
   static void SetUserDictionaryName(absl::string_view filename);
 
@@ -110,18 +118,29 @@ class UserDictionary : public DictionaryInterface {
       Token *token) const;
 
  private:
+  struct EntryTable;
   class TokensIndex;
   class UserDictionaryReloader;
 
-  // Swaps internal tokens index to |new_tokens|.
+  // Publishes |new_tokens| as the tokens index. Lookups that have already
+  // started keep using the previous index.
   void Swap(std::unique_ptr<TokensIndex> new_tokens);
 
+  // Publishes the tokens restored from the compiled cache.
+  void LoadFromCache(UserDictionaryCache::Contents contents);
+  // Records the entries of `storage`, which the tokens loaded from the cache
+  // are compiled from, so that the next load is incremental.
+  void LoadEntryTable(user_dictionary::UserDictionaryStorage storage);
+
   std::unique_ptr<UserDictionaryReloader> reloader_;
   std::unique_ptr<const UserPosInterface> user_pos_;
   const PosMatcher pos_matcher_;
   SuppressionDictionary *suppression_dictionary_;
-  std::unique_ptr<TokensIndex> tokens_ ABSL_GUARDED_BY(mutex_);
-  mutable absl::Mutex mutex_;
+  // Serializes loads, which read and update `entry_table_`.
+  absl::Mutex load_mutex_;
+  std::unique_ptr<EntryTable> entry_table_ ABSL_GUARDED_BY(load_mutex_);
+  // Immutable snapshot of the tokens. Lookups load it without locking.
+  AtomicSharedPtr<const TokensIndex> tokens_;
 
   friend class UserDictionaryTest;
 };
@@ -0,0 +1,253 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/user_dictionary_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/container/serialized_string_array.h"
+#include "base/file_util.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/mmap.h"
+#include "dictionary/user_pos_interface.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+constexpr char kMagic[8] = {'M', 'Z', 'U', 'D', 'I', 'C', 'A', 'C'};
+
+// Bump this whenever the binary format or the way tokens are compiled from
+// UserDictionaryStorage changes.
+constexpr uint32_t kFormatVersion = 2;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_tokens;
+  uint64_t source_fingerprint;
+  uint64_t user_pos_fingerprint;
+  uint32_t num_suppression_entries;
+  uint32_t padding;
+};
+static_assert(sizeof(Header) == 40);
+
+constexpr size_t kTokenByteLength = 4;
+constexpr size_t kFingerprintByteLength = 8;
+
+// Appends `fps`, or `size` zeros if `fps` is empty.
+void AppendFingerprints(const std::vector<uint64_t> &fps, size_t size,
+                        std::string *result) {
+  if (fps.empty()) {
+    result->append(size * kFingerprintByteLength, '\0');
+    return;
+  }
+  DCHECK_EQ(fps.size(), size);
+  result->append(reinterpret_cast<const char *>(fps.data()),
+                 fps.size() * kFingerprintByteLength);
+}
+
+// Reads `size` fingerprints from the front of `data`.
+bool ReadFingerprints(size_t size, absl::string_view *data,
+                      std::vector<uint64_t> *fps) {
+  const size_t byte_length = size * kFingerprintByteLength;
+  if (data->size() < byte_length) {
+    return false;
+  }
+  fps->resize(size);
+  std::memcpy(fps->data(), data->data(), byte_length);
+  data->remove_prefix(byte_length);
+  return true;
+}
+
+}  // namespace
+
+std::string UserDictionaryCache::GetCacheFileName(
+    absl::string_view user_dictionary_file) {
+  return absl::StrCat(user_dictionary_file, ".cache");
+}
+
+uint64_t UserDictionaryCache::FingerprintUserPos(
+    const UserPosInterface &user_pos) {
+  // Expands a probe entry with every POS so that the fingerprint covers POS
+  // IDs as well as inflection suffixes.
+  std::vector<std::string> pos_list;
+  user_pos.GetPosList(&pos_list);
+  std::string buf;
+  std::vector<UserPosInterface::Token> tokens;
+  for (const std::string &pos : pos_list) {
+    absl::StrAppend(&buf, pos, "\n");
+    tokens.clear();
+    user_pos.GetTokens("あ", "亜", pos, &tokens);
+    for (const UserPosInterface::Token &token : tokens) {
+      absl::StrAppend(&buf, token.key, "\t", token.value, "\t", token.id, "\t",
+                      token.attributes, "\n");
+    }
+  }
+  uint16_t no_pos_id = 0;
+  user_pos.GetPosIds("名詞サ変", &no_pos_id);
+  absl::StrAppend(&buf, no_pos_id);
+  return Fingerprint(buf);
+}
+
+std::string UserDictionaryCache::Serialize(const Stamp &stamp,
+                                           const Contents &contents) {
+  Header header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kFormatVersion;
+  header.num_tokens = contents.tokens.size();
+  header.source_fingerprint = stamp.source_fingerprint;
+  header.user_pos_fingerprint = stamp.user_pos_fingerprint;
+  header.num_suppression_entries = contents.suppression_entries.size();
+
+  std::vector<absl::string_view> strs;
+  strs.reserve(contents.tokens.size() * 3 +
+               contents.suppression_entries.size() * 2);
+  std::string result(reinterpret_cast<const char *>(&header), sizeof(header));
+  result.reserve(sizeof(header) +
+                 contents.tokens.size() *
+                     (kTokenByteLength + kFingerprintByteLength) +
+                 contents.suppression_entries.size() * kFingerprintByteLength);
+  for (const UserPosInterface::Token &token : contents.tokens) {
+    const uint16_t fields[] = {token.id, token.attributes};
+    result.append(reinterpret_cast<const char *>(fields), sizeof(fields));
+    strs.push_back(token.key);
+    strs.push_back(token.value);
+    strs.push_back(token.comment);
+  }
+  AppendFingerprints(contents.tokens_fps, contents.tokens.size(), &result);
+  AppendFingerprints(contents.suppression_fps,
+                     contents.suppression_entries.size(), &result);
+  for (const auto &[key, value] : contents.suppression_entries) {
+    strs.push_back(key);
+    strs.push_back(value);
+  }
+
+  std::unique_ptr<uint32_t[]> buffer;
+  absl::StrAppend(&result,
+                  SerializedStringArray::SerializeToBuffer(strs, &buffer));
+  return result;
+}
+
+absl::StatusOr<UserDictionaryCache::Contents> UserDictionaryCache::Deserialize(
+    absl::string_view data, const Stamp &stamp) {
+  Header header;
+  if (data.size() < sizeof(header)) {
+    return absl::DataLossError("Header is missing");
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kFormatVersion) {
+    return absl::FailedPreconditionError("Unknown cache format");
+  }
+  if (header.source_fingerprint != stamp.source_fingerprint ||
+      header.user_pos_fingerprint != stamp.user_pos_fingerprint) {
+    return absl::FailedPreconditionError("Cache is stale");
+  }
+  data.remove_prefix(sizeof(header));
+
+  const size_t token_array_size =
+      static_cast<size_t>(header.num_tokens) * kTokenByteLength;
+  if (data.size() < token_array_size) {
+    return absl::DataLossError("Token array is truncated");
+  }
+  const absl::string_view token_array = data.substr(0, token_array_size);
+  data.remove_prefix(token_array_size);
+
+  Contents contents;
+  if (!ReadFingerprints(header.num_tokens, &data, &contents.tokens_fps) ||
+      !ReadFingerprints(header.num_suppression_entries, &data,
+                        &contents.suppression_fps)) {
+    return absl::DataLossError("Fingerprint array is truncated");
+  }
+
+  SerializedStringArray strs;
+  if (!strs.Init(data) ||
+      strs.size() != static_cast<size_t>(header.num_tokens) * 3 +
+                         static_cast<size_t>(header.num_suppression_entries) *
+                             2) {
+    return absl::DataLossError("String array is broken");
+  }
+
+  contents.tokens.resize(header.num_tokens);
+  for (uint32_t i = 0; i < header.num_tokens; ++i) {
+    uint16_t fields[2];
+    std::memcpy(fields, token_array.data() + i * kTokenByteLength,
+                sizeof(fields));
+    UserPosInterface::Token &token = contents.tokens[i];
+    token.key = std::string(strs[3 * i]);
+    token.value = std::string(strs[3 * i + 1]);
+    token.comment = std::string(strs[3 * i + 2]);
+    token.id = fields[0];
+    token.attributes = fields[1];
+  }
+  const uint32_t offset = header.num_tokens * 3;
+  contents.suppression_entries.reserve(header.num_suppression_entries);
+  for (uint32_t i = 0; i < header.num_suppression_entries; ++i) {
+    contents.suppression_entries.emplace_back(strs[offset + 2 * i],
+                                              strs[offset + 2 * i + 1]);
+  }
+  return contents;
+}
+
+absl::StatusOr<UserDictionaryCache::Contents> UserDictionaryCache::Load(
+    const std::string &filename, const Stamp &stamp) {
+  absl::StatusOr<Mmap> mmap = Mmap::Map(filename, Mmap::READ_ONLY);
+  if (!mmap.ok()) {
+    return std::move(mmap).status();
+  }
+  return Deserialize(absl::string_view(mmap->begin(), mmap->size()), stamp);
+}
+
+absl::Status UserDictionaryCache::Save(const std::string &filename,
+                                       const Stamp &stamp,
+                                       const Contents &contents) {
+  const std::string tmp_filename = absl::StrCat(filename, ".tmp");
+  if (absl::Status s =
+          FileUtil::SetContents(tmp_filename, Serialize(stamp, contents));
+      !s.ok()) {
+    FileUtil::UnlinkOrLogError(tmp_filename);
+    return s;
+  }
+  return FileUtil::AtomicRename(tmp_filename, filename);
+}
+
+}  // namespace dictionary
+}  // namespace mozc
@@ -0,0 +1,136 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_DICTIONARY_USER_DICTIONARY_CACHE_H_
+#define MOZC_DICTIONARY_USER_DICTIONARY_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dictionary/user_pos_interface.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+
+// Persists the compiled form of the user dictionary, i.e., the POS-expanded
+// tokens sorted by key and the suppression entries, so that a later start can
+// skip parsing, normalizing and expanding the whole UserDictionaryStorage when
+// the source file has not changed.
+//
+// * Prerequisite
+// Little endian is assumed.
+//
+// * Binary format
+//
+// +-----------------------------------------------------------+
+// | Header (40 bytes)                                         |
+// +-----------------------------------------------------------+
+// | Token array (4 bytes * num_tokens)                        |
+// +-----------------------------------------------------------+
+// | Token fingerprint array (8 bytes * num_tokens)            |
+// +-----------------------------------------------------------+
+// | Suppression fingerprint array (8 bytes * num_suppression) |
+// +-----------------------------------------------------------+
+// | String array (SerializedStringArray)                      |
+// +-----------------------------------------------------------+
+//
+// Header layout: magic (8 bytes), format version (4 bytes), number of tokens
+// (4 bytes), fingerprint of the source file (8 bytes), fingerprint of the POS
+// data (8 bytes), number of suppression entries (4 bytes) and padding
+// (4 bytes).
+//
+// Each token is stored as POS ID (2 bytes) followed by attributes (2 bytes).
+// The fingerprint arrays identify the entry each token and suppression entry
+// is compiled from, so that later edits can be applied incrementally.
+// The key, value and comment of the i-th token are the (3i)-th, (3i+1)-th and
+// (3i+2)-th strings of the string array, which are followed by key and value
+// pairs of suppression entries.
+class UserDictionaryCache {
+ public:
+  struct Stamp {
+    // Fingerprint of the serialized UserDictionaryStorage.
+    uint64_t source_fingerprint = 0;
+    // Fingerprint of the POS expansion rules; see FingerprintUserPos().
+    uint64_t user_pos_fingerprint = 0;
+
+    friend bool operator==(const Stamp &lhs, const Stamp &rhs) {
+      return lhs.source_fingerprint == rhs.source_fingerprint &&
+             lhs.user_pos_fingerprint == rhs.user_pos_fingerprint;
+    }
+  };
+
+  struct Contents {
+    // Sorted by key and then by POS ID.
+    std::vector<UserPosInterface::Token> tokens;
+    // Pairs of (key, value) registered as suppression words.
+    std::vector<std::pair<std::string, std::string>> suppression_entries;
+    // Fingerprints of the entries `tokens` and `suppression_entries` are
+    // compiled from, in the same order. Serialize() writes zeros if they are
+    // empty.
+    std::vector<uint64_t> tokens_fps;
+    std::vector<uint64_t> suppression_fps;
+  };
+
+  UserDictionaryCache() = delete;
+  UserDictionaryCache(const UserDictionaryCache &) = delete;
+  UserDictionaryCache &operator=(const UserDictionaryCache &) = delete;
+
+  // Returns the path of the cache file placed next to `user_dictionary_file`.
+  static std::string GetCacheFileName(absl::string_view user_dictionary_file);
+
+  // Returns a fingerprint that changes whenever `user_pos` expands an entry
+  // differently, e.g., after the data set is updated.
+  static uint64_t FingerprintUserPos(const UserPosInterface &user_pos);
+
+  // Returns the binary image of `contents` stamped with `stamp`.
+  static std::string Serialize(const Stamp &stamp, const Contents &contents);
+
+  // Decodes the binary image. Returns an error if `data` is broken or was not
+  // created with `stamp`.
+  static absl::StatusOr<Contents> Deserialize(absl::string_view data,
+                                              const Stamp &stamp);
+
+  // Maps the cache file and decodes it.
+  static absl::StatusOr<Contents> Load(const std::string &filename,
+                                       const Stamp &stamp);
+
+  // Writes the cache file atomically.
+  static absl::Status Save(const std::string &filename, const Stamp &stamp,
+                           const Contents &contents);
+};
+
+}  // namespace dictionary
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_USER_DICTIONARY_CACHE_H_
@@ -0,0 +1,196 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/user_dictionary_cache.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/file/temp_dir.h"
+#include "base/file_util.h"
+#include "dictionary/user_pos_interface.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+#include "testing/mozctest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+// Expands "verb" into the base form and "-ing" form whose POS ID is given by
+// the constructor.
+class UserPosMock : public UserPosInterface {
+ public:
+  explicit UserPosMock(uint16_t ing_id) : ing_id_(ing_id) {}
+
+  bool IsValidPos(absl::string_view pos) const override { return true; }
+
+  bool GetPosIds(absl::string_view pos, uint16_t *id) const override {
+    *id = 100;
+    return true;
+  }
+
+  bool GetTokens(absl::string_view key, absl::string_view value,
+                 absl::string_view pos, absl::string_view locale,
+                 std::vector<Token> *tokens) const override {
+    tokens->clear();
+    tokens->push_back(
+        {.key = std::string(key), .value = std::string(value), .id = 200});
+    if (pos == "verb") {
+      tokens->push_back({.key = absl::StrCat(key, "ing"),
+                         .value = absl::StrCat(value, "ing"),
+                         .id = ing_id_});
+    }
+    return true;
+  }
+
+  void GetPosList(std::vector<std::string> *pos_list) const override {
+    *pos_list = {"noun", "verb"};
+  }
+
+ private:
+  const uint16_t ing_id_;
+};
+
+UserDictionaryCache::Contents MakeContents() {
+  UserDictionaryCache::Contents contents;
+  contents.tokens.push_back({.key = "かお",
+                             .value = "顔",
+                             .id = 10,
+                             .attributes = UserPosInterface::Token::SHORTCUT});
+  contents.tokens.push_back(
+      {.key = "かお", .value = "カオ", .id = 20, .comment = "コメント"});
+  contents.tokens.push_back({.key = "はな", .value = "", .id = 30});
+  contents.suppression_entries.emplace_back("めも", "メモ");
+  contents.tokens_fps = {1, 1, 0xfedcba9876543210};
+  contents.suppression_fps = {2};
+  return contents;
+}
+
+void ExpectContentsEq(const UserDictionaryCache::Contents &expected,
+                      const UserDictionaryCache::Contents &actual) {
+  ASSERT_EQ(actual.tokens.size(), expected.tokens.size());
+  for (size_t i = 0; i < expected.tokens.size(); ++i) {
+    EXPECT_EQ(actual.tokens[i].key, expected.tokens[i].key);
+    EXPECT_EQ(actual.tokens[i].value, expected.tokens[i].value);
+    EXPECT_EQ(actual.tokens[i].id, expected.tokens[i].id);
+    EXPECT_EQ(actual.tokens[i].attributes, expected.tokens[i].attributes);
+    EXPECT_EQ(actual.tokens[i].comment, expected.tokens[i].comment);
+  }
+  EXPECT_EQ(actual.suppression_entries, expected.suppression_entries);
+  EXPECT_EQ(actual.tokens_fps, expected.tokens_fps);
+  EXPECT_EQ(actual.suppression_fps, expected.suppression_fps);
+}
+
+TEST(UserDictionaryCacheTest, SerializeAndDeserialize) {
+  const UserDictionaryCache::Stamp stamp = {.source_fingerprint = 1,
+                                            .user_pos_fingerprint = 2};
+  const UserDictionaryCache::Contents contents = MakeContents();
+  const std::string data = UserDictionaryCache::Serialize(stamp, contents);
+
+  absl::StatusOr<UserDictionaryCache::Contents> actual =
+      UserDictionaryCache::Deserialize(data, stamp);
+  ASSERT_OK(actual);
+  ExpectContentsEq(contents, *actual);
+
+  const UserDictionaryCache::Contents empty;
+  actual = UserDictionaryCache::Deserialize(
+      UserDictionaryCache::Serialize(stamp, empty), stamp);
+  ASSERT_OK(actual);
+  EXPECT_TRUE(actual->tokens.empty());
+  EXPECT_TRUE(actual->suppression_entries.empty());
+
+  // Unknown fingerprints are written as zeros.
+  UserDictionaryCache::Contents without_fps = MakeContents();
+  without_fps.tokens_fps.clear();
+  without_fps.suppression_fps.clear();
+  actual = UserDictionaryCache::Deserialize(
+      UserDictionaryCache::Serialize(stamp, without_fps), stamp);
+  ASSERT_OK(actual);
+  EXPECT_THAT(actual->tokens_fps, ElementsAre(0, 0, 0));
+  EXPECT_THAT(actual->suppression_fps, ElementsAre(0));
+}
+
+TEST(UserDictionaryCacheTest, RejectsStaleOrBrokenData) {
+  const UserDictionaryCache::Stamp stamp = {.source_fingerprint = 1,
+                                            .user_pos_fingerprint = 2};
+  const std::string data =
+      UserDictionaryCache::Serialize(stamp, MakeContents());
+
+  EXPECT_FALSE(UserDictionaryCache::Deserialize(
+                   data, {.source_fingerprint = 3, .user_pos_fingerprint = 2})
+                   .ok());
+  EXPECT_FALSE(UserDictionaryCache::Deserialize(
+                   data, {.source_fingerprint = 1, .user_pos_fingerprint = 3})
+                   .ok());
+  EXPECT_FALSE(UserDictionaryCache::Deserialize("", stamp).ok());
+  EXPECT_FALSE(
+      UserDictionaryCache::Deserialize(data.substr(0, data.size() / 2), stamp)
+          .ok());
+  std::string broken_magic = data;
+  broken_magic[0] = 'X';
+  EXPECT_FALSE(UserDictionaryCache::Deserialize(broken_magic, stamp).ok());
+}
+
+TEST(UserDictionaryCacheTest, SaveAndLoad) {
+  TempDirectory temp_dir = testing::MakeTempDirectoryOrDie();
+  const std::string filename = UserDictionaryCache::GetCacheFileName(
+      FileUtil::JoinPath(temp_dir.path(), "user_dictionary.db"));
+  const UserDictionaryCache::Stamp stamp = {.source_fingerprint = 1,
+                                            .user_pos_fingerprint = 2};
+  EXPECT_FALSE(UserDictionaryCache::Load(filename, stamp).ok());
+
+  const UserDictionaryCache::Contents contents = MakeContents();
+  ASSERT_OK(UserDictionaryCache::Save(filename, stamp, contents));
+  absl::StatusOr<UserDictionaryCache::Contents> actual =
+      UserDictionaryCache::Load(filename, stamp);
+  ASSERT_OK(actual);
+  ExpectContentsEq(contents, *actual);
+  EXPECT_THAT(actual->suppression_entries, ElementsAre(Pair("めも", "メモ")));
+}
+
+TEST(UserDictionaryCacheTest, FingerprintUserPos) {
+  const UserPosMock user_pos1(210), user_pos2(210), user_pos3(220);
+  EXPECT_EQ(UserDictionaryCache::FingerprintUserPos(user_pos1),
+            UserDictionaryCache::FingerprintUserPos(user_pos2));
+  EXPECT_NE(UserDictionaryCache::FingerprintUserPos(user_pos1),
+            UserDictionaryCache::FingerprintUserPos(user_pos3));
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
@@ -33,25 +33,26 @@
 #include <cstdint>
 #include <cstring>
 #include <iterator>
-#include <limits>
 #include <map>
-#include <set>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
-#include "base/hash.h"
 #include "base/japanese_util.h"
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/number_util.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "dictionary/user_dictionary_util.h"
 #include "protocol/user_dictionary_storage.pb.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 
@@ -60,12 +61,25 @@ using user_dictionary::UserDictionaryCommandStatus;
 
 namespace {
 
-uint64_t EntryFingerprint(const UserDictionary::Entry &entry) {
+// Raw entries are read from the input iterator in batches of this size. The
+// entries of a batch are converted in parallel and then appended to the
+// dictionary in the input order.
+constexpr size_t kImportBatchSize = 4096;
+
+// Conversion of a batch is split across at most kMaxConvertThreads threads,
+// each of which converts at least kMinEntriesPerThread entries. Smaller
+// batches are converted on the calling thread.
+constexpr int kMaxConvertThreads = 4;
+constexpr size_t kMinEntriesPerThread = 512;
+
+// Identifies an entry for deduplication. The views point into the entries
+// owned by the dictionary, which stay at the same address while new entries
+// are added.
+using EntryKey = std::tuple<absl::string_view, absl::string_view, int>;
+
+EntryKey GetEntryKey(const UserDictionary::Entry &entry) {
   DCHECK(UserDictionary::PosType_IsValid(entry.pos()));
-  static_assert(UserDictionary::PosType_MAX <=
-                std::numeric_limits<char>::max());
-  return Fingerprint(entry.key() + "\t" + entry.value() + "\t" +
-                     static_cast<char>(entry.pos()));
+  return {entry.key(), entry.value(), entry.pos()};
 }
 
 void NormalizePos(const absl::string_view input, std::string *output) {
@@ -176,10 +190,42 @@ bool ConvertEntryInternal(const PosMap *pos_map, size_t map_size,
   return true;
 }
 
+// Converts from[i] into to[i] and sets converted[i] to whether it succeeded.
+void ConvertEntries(absl::Span<const UserDictionaryImporter::RawEntry> from,
+                    absl::Span<UserDictionary::Entry> to,
+                    absl::Span<char> converted) {
+  DCHECK_EQ(from.size(), to.size());
+  DCHECK_EQ(from.size(), converted.size());
+  auto convert = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      converted[i] = UserDictionaryImporter::ConvertEntry(from[i], &to[i]);
+    }
+  };
+
+  const size_t num_threads = std::min<size_t>(
+      kMaxConvertThreads, from.size() / kMinEntriesPerThread);
+  if (num_threads <= 1) {
+    convert(0, from.size());
+    return;
+  }
+
+  const size_t slice = (from.size() + num_threads - 1) / num_threads;
+  std::vector<Thread> threads;
+  threads.reserve(num_threads - 1);
+  for (size_t begin = slice; begin < from.size(); begin += slice) {
+    threads.emplace_back(convert, begin, std::min(begin + slice, from.size()));
+  }
+  convert(0, slice);
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+}
+
 }  // namespace
 
 UserDictionaryImporter::ErrorType UserDictionaryImporter::ImportFromIterator(
-    InputIteratorInterface *iter, UserDictionary *user_dic) {
+    InputIteratorInterface *iter, UserDictionary *user_dic,
+    const ProgressCallback &progress) {
   if (iter == nullptr || user_dic == nullptr) {
     LOG(ERROR) << "iter or user_dic is nullptr";
     return IMPORT_FATAL;
@@ -189,40 +235,79 @@ UserDictionaryImporter::ErrorType UserDictionaryImporter::ImportFromIterator(
 
   ErrorType ret = IMPORT_NO_ERROR;
 
-  std::set<uint64_t> existent_entries;
-  for (size_t i = 0; i < user_dic->entries_size(); ++i) {
-    existent_entries.insert(EntryFingerprint(user_dic->entries(i)));
-  }
-
-  UserDictionary::Entry entry;
-  RawEntry raw_entry;
-  while (iter->Next(&raw_entry)) {
-    if (user_dic->entries_size() >= max_size) {
-      LOG(WARNING) << "Too many words in one dictionary";
-      return IMPORT_TOO_MANY_WORDS;
+  absl::flat_hash_set<EntryKey> existent_entries;
+  existent_entries.reserve(user_dic->entries_size());
+  for (const UserDictionary::Entry &entry : user_dic->entries()) {
+    existent_entries.insert(GetEntryKey(entry));
+  }
+
+  // The buffers grow up to kImportBatchSize and are reused across batches.
+  std::vector<RawEntry> raw_entries;
+  std::vector<UserDictionary::Entry> entries;
+  // std::vector<bool> can't be written from multiple threads.
+  std::vector<char> converted;
+  size_t num_read = 0;
+  bool has_next = true;
+  while (has_next) {
+    size_t size = 0;
+    while (size < kImportBatchSize) {
+      if (size == raw_entries.size()) {
+        raw_entries.emplace_back();
+      }
+      raw_entries[size].Clear();
+      if (!iter->Next(&raw_entries[size])) {
+        has_next = false;
+        break;
+      }
+      ++size;
     }
-
-    if (raw_entry.key.empty() && raw_entry.value.empty() &&
-        raw_entry.comment.empty()) {
-      // Empty entry is just skipped. It could be annoying if we show a
-      // warning dialog when these empty candidates exist.
-      continue;
+    if (size == 0) {
+      break;
     }
-
-    if (!ConvertEntry(raw_entry, &entry)) {
-      LOG(WARNING) << "Entry is not valid";
-      ret = IMPORT_INVALID_ENTRIES;
-      continue;
+    if (entries.size() < size) {
+      entries.resize(size);
+      converted.resize(size);
     }
 
-    // Don't register words if it is aleady in the current dictionary.
-    if (!existent_entries.insert(EntryFingerprint(entry)).second) {
-      continue;
+    ConvertEntries(absl::MakeConstSpan(raw_entries.data(), size),
+                   absl::MakeSpan(entries.data(), size),
+                   absl::MakeSpan(converted.data(), size));
+
+    for (size_t i = 0; i < size; ++i) {
+      if (user_dic->entries_size() >= max_size) {
+        LOG(WARNING) << "Too many words in one dictionary";
+        return IMPORT_TOO_MANY_WORDS;
+      }
+
+      const RawEntry &raw_entry = raw_entries[i];
+      if (raw_entry.key.empty() && raw_entry.value.empty() &&
+          raw_entry.comment.empty()) {
+        // Empty entry is just skipped. It could be annoying if we show a
+        // warning dialog when these empty candidates exist.
+        continue;
+      }
+
+      if (!converted[i]) {
+        LOG(WARNING) << "Entry is not valid";
+        ret = IMPORT_INVALID_ENTRIES;
+        continue;
+      }
+
+      // Don't register words if it is aleady in the current dictionary.
+      if (existent_entries.contains(GetEntryKey(entries[i]))) {
+        continue;
+      }
+
+      UserDictionary::Entry *new_entry = user_dic->add_entries();
+      DCHECK(new_entry);
+      *new_entry = std::move(entries[i]);
+      existent_entries.insert(GetEntryKey(*new_entry));
     }
 
-    UserDictionary::Entry *new_entry = user_dic->add_entries();
-    DCHECK(new_entry);
-    *new_entry = entry;
+    num_read += size;
+    if (progress) {
+      progress(num_read);
+    }
   }
 
   return ret;
@@ -230,14 +315,14 @@ UserDictionaryImporter::ErrorType UserDictionaryImporter::ImportFromIterator(
 
 UserDictionaryImporter::ErrorType
 UserDictionaryImporter::ImportFromTextLineIterator(
-    IMEType ime_type, TextLineIteratorInterface *iter,
-    UserDictionary *user_dic) {
+    IMEType ime_type, TextLineIteratorInterface *iter, UserDictionary *user_dic,
+    const ProgressCallback &progress) {
   TextInputIterator text_iter(ime_type, iter);
   if (text_iter.ime_type() == NUM_IMES) {
     return IMPORT_NOT_SUPPORTED;
   }
 
-  return ImportFromIterator(&text_iter, user_dic);
+  return ImportFromIterator(&text_iter, user_dic, progress);
 }
 
 UserDictionaryImporter::StringTextLineIterator::StringTextLineIterator(
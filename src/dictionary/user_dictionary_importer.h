@@ -31,6 +31,7 @@
 #define MOZC_DICTIONARY_USER_DICTIONARY_IMPORTER_H_
 
 #include <cstddef>
+#include <functional>
 #include <string>
 
 #include "protocol/user_dictionary_storage.pb.h"
@@ -188,15 +189,22 @@ class UserDictionaryImporter {
   static bool ConvertEntry(const RawEntry &from,
                            user_dictionary::UserDictionary::Entry *to);
 
+  // Called with the number of entries read from the input so far.
+  using ProgressCallback = std::function<void(size_t num_read)>;
+
   // Import a dictionary from InputIteratorInterface.
-  // This is the most generic interface.
-  static ErrorType ImportFromIterator(InputIteratorInterface *iter,
-                                      user_dictionary::UserDictionary *dic);
+  // This is the most generic interface. Entries are read in batches and
+  // converted on multiple threads for large inputs; they are added to |dic| in
+  // the input order. |progress| is called after each batch if set.
+  static ErrorType ImportFromIterator(
+      InputIteratorInterface *iter, user_dictionary::UserDictionary *dic,
+      const ProgressCallback &progress = nullptr);
 
   // Import a dictionary from TextLineIterator.
   static ErrorType ImportFromTextLineIterator(
       IMEType ime_type, TextLineIteratorInterface *iter,
-      user_dictionary::UserDictionary *dic);
+      user_dictionary::UserDictionary *dic,
+      const ProgressCallback &progress = nullptr);
 };
 
 }  // namespace mozc
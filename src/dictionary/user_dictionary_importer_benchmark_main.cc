@@ -0,0 +1,111 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures UserDictionaryImporter on a synthetic MS-IME export, first into an
+// empty dictionary and then again into the filled one, where every entry is a
+// duplicate.
+//
+// Usage:
+//   user_dictionary_importer_benchmark_main --num_lines=1000000
+
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <ostream>
+#include <string>
+
+#include "base/init_mozc.h"
+#include "base/stopwatch.h"
+#include "dictionary/user_dictionary_importer.h"
+#include "protocol/user_dictionary_storage.pb.h"
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(int32_t, num_lines, 1000000, "number of entries in the input");
+
+namespace mozc {
+namespace {
+
+using user_dictionary::UserDictionary;
+
+// Returns the input in the MS-IME text format. Every 20th entry repeats an
+// earlier one.
+std::string MakeInput(int num_lines) {
+  constexpr absl::string_view kKana[] = {
+      "あ", "い", "う", "え", "お", "か", "き", "く", "け", "こ", "さ",
+      "し", "す", "せ", "そ", "た", "ち", "つ", "て", "と", "な", "に",
+      "ぬ", "ね", "の", "は", "ひ", "ふ", "へ", "ほ", "ま", "み"};
+  constexpr absl::string_view kPos[] = {"名詞", "人名", "地名"};
+  std::string input = "!Microsoft IME Dictionary Tool\r\n";
+  for (int i = 0; i < num_lines; ++i) {
+    const int id = i % 20 == 19 ? i - 10 : i;
+    std::string key;
+    for (int n = id; n > 0 || key.empty(); n /= std::size(kKana)) {
+      absl::StrAppend(&key, kKana[n % std::size(kKana)]);
+    }
+    absl::StrAppend(&input, key, "\t単語", id, "\t",
+                    kPos[id % std::size(kPos)], "\r\n");
+  }
+  return input;
+}
+
+void Import(const std::string &input, UserDictionary *dic) {
+  UserDictionaryImporter::StringTextLineIterator iter(input);
+  const int old_size = dic->entries_size();
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  const UserDictionaryImporter::ErrorType error =
+      UserDictionaryImporter::ImportFromTextLineIterator(
+          UserDictionaryImporter::MSIME, &iter, dic);
+  const absl::Duration time = stopwatch.GetElapsed();
+  std::cout << absl::StrFormat(
+                   "%10.1fms %9d added  error=%d  %.0f lines/s",
+                   absl::ToDoubleMilliseconds(time),
+                   dic->entries_size() - old_size, static_cast<int>(error),
+                   absl::GetFlag(FLAGS_num_lines) / absl::ToDoubleSeconds(time))
+            << std::endl;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+
+  const std::string input = mozc::MakeInput(absl::GetFlag(FLAGS_num_lines));
+  mozc::user_dictionary::UserDictionary dic;
+  std::cout << "empty dictionary: ";
+  mozc::Import(input, &dic);
+  std::cout << "same entries:     ";
+  mozc::Import(input, &dic);
+  return 0;
+}
@@ -439,6 +439,53 @@ TEST(UserDictionaryImporter, ImportFromIteratorDupTest) {
   EXPECT_EQ(user_dic.entries_size(), 2);
 }
 
+TEST(UserDictionaryImporter, ImportFromIteratorLargeInputTest) {
+  // Large enough to be read in several batches and converted on multiple
+  // threads.
+  constexpr size_t kSize = 20000;
+  std::vector<UserDictionaryImporter::RawEntry> entries;
+  for (size_t j = 0; j < kSize; ++j) {
+    UserDictionaryImporter::RawEntry entry;
+    // Every key appears twice, 10000 entries apart.
+    entry.key = "key" + std::to_string(j % (kSize / 2));
+    entry.value = "value" + std::to_string(j % (kSize / 2));
+    if (j % 7 != 0) {
+      entry.pos = "名詞";
+    }
+    entries.push_back(entry);
+  }
+
+  TestInputIterator iter;
+  iter.set_available(true);
+  iter.set_entries(&entries);
+  UserDictionaryStorage::UserDictionary user_dic;
+  std::vector<size_t> progress;
+  EXPECT_EQ(UserDictionaryImporter::ImportFromIterator(
+                &iter, &user_dic,
+                [&progress](size_t num_read) { progress.push_back(num_read); }),
+            UserDictionaryImporter::IMPORT_INVALID_ENTRIES);
+
+  // An entry is added the first time its key appears with a valid POS, which
+  // keeps the input order.
+  std::vector<std::string> expected;
+  std::vector<bool> added(kSize / 2);
+  for (size_t j = 0; j < kSize; ++j) {
+    if (j % 7 != 0 && !added[j % (kSize / 2)]) {
+      added[j % (kSize / 2)] = true;
+      expected.push_back(entries[j].key);
+    }
+  }
+  ASSERT_EQ(user_dic.entries_size(), expected.size());
+  for (size_t j = 0; j < expected.size(); ++j) {
+    EXPECT_EQ(user_dic.entries(j).key(), expected[j]);
+    EXPECT_EQ(user_dic.entries(j).pos(), user_dictionary::UserDictionary::NOUN);
+  }
+
+  ASSERT_FALSE(progress.empty());
+  EXPECT_TRUE(std::is_sorted(progress.begin(), progress.end()));
+  EXPECT_EQ(progress.back(), kSize);
+}
+
 TEST(UserDictionaryImporter, GuessIMETypeTest) {
   EXPECT_EQ(UserDictionaryImporter::GuessIMEType(""),
             UserDictionaryImporter::NUM_IMES);
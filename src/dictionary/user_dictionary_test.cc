@@ -41,6 +41,7 @@
 
 #include "base/file/temp_dir.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/random.h"
 #include "base/singleton.h"
@@ -51,6 +52,7 @@
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary_cache.h"
 #include "dictionary/user_dictionary_storage.h"
 #include "dictionary/user_pos.h"
 #include "dictionary/user_pos_interface.h"
@@ -62,6 +64,7 @@
 #include "testing/mozctest.h"
 #include "usage_stats/usage_stats.h"
 #include "usage_stats/usage_stats_testing_util.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
@@ -319,6 +322,32 @@ class UserDictionaryTest : public testing::TestWithTempUserProfile {
     return comment;
   }
 
+  // Expects `dic` to look up the same tokens as a dictionary fully loaded from
+  // `storage`.
+  void ExpectSameAsFullLoad(
+      const UserDictionary &dic,
+      const user_dictionary::UserDictionaryStorage &storage) {
+    SuppressionDictionary suppression_dictionary;
+    UserDictionary expected(
+        std::make_unique<UserPosMock>(),
+        dictionary::PosMatcher(mock_data_manager_.GetPosMatcherData()),
+        &suppression_dictionary);
+    expected.WaitForReloader();
+    expected.Load(storage);
+    EXPECT_EQ(expected.GetOverlaySizeForTest(), 0);
+    for (const UserDictionaryStorage::UserDictionary &user_dic :
+         storage.dictionaries()) {
+      for (const UserDictionaryStorage::UserDictionaryEntry &entry :
+           user_dic.entries()) {
+        EXPECT_THAT(LookupExact(entry.key(), dic),
+                    UnorderedElementsAreArray(
+                        LookupExact(entry.key(), expected)));
+        EXPECT_EQ(LookupComment(dic, entry.key(), entry.value()),
+                  LookupComment(expected, entry.key(), entry.value()));
+      }
+    }
+  }
+
   std::unique_ptr<SuppressionDictionary> suppression_dictionary_;
   ConversionRequest convreq_;
   config::Config config_;
@@ -479,6 +508,107 @@ TEST_F(UserDictionaryTest, TestLookupExact) {
               ElementsAre(Entry{"水雲", "value", 100, 100}));
 }
 
+TEST_F(UserDictionaryTest, IncrementalLoad) {
+  std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+
+  UserDictionaryStorage storage("");
+  LoadFromString(kUserDictionary0, &storage);
+  dic->Load(storage.GetProto());
+  EXPECT_EQ(dic->GetOverlaySizeForTest(), 0);
+  UserDictionaryStorage::UserDictionary *user_dic =
+      storage.GetProto().mutable_dictionaries(0);
+
+  // Add an entry.
+  UserDictionaryStorage::UserDictionaryEntry *entry = user_dic->add_entries();
+  entry->set_key("end");
+  entry->set_value("end");
+  entry->set_pos(user_dictionary::UserDictionary::NOUN);
+  entry->set_comment("comment");
+  dic->Load(storage.GetProto());
+  // Incremental loads keep the changes in the overlay.
+  EXPECT_GT(dic->GetOverlaySizeForTest(), 0);
+  ExpectSameAsFullLoad(*dic, storage.GetProto());
+  EXPECT_THAT(LookupExact("end", *dic),
+              ElementsAre(Entry{"end", "end", 100, 100}));
+  EXPECT_EQ(LookupComment(*dic, "end", "end"), "comment");
+  EXPECT_THAT(LookupPrefix("start", *dic), Not(IsEmpty()));
+
+  // Edit the entry.
+  entry->set_pos(user_dictionary::UserDictionary::WA_GROUP1_VERB);
+  entry->clear_comment();
+  dic->Load(storage.GetProto());
+  EXPECT_GT(dic->GetOverlaySizeForTest(), 0);
+  ExpectSameAsFullLoad(*dic, storage.GetProto());
+  EXPECT_THAT(LookupExact("end", *dic),
+              ElementsAre(Entry{"end", "end", 200, 200}));
+  EXPECT_THAT(LookupPredictive("end", *dic),
+              UnorderedElementsAreArray({Entry{"end", "end", 200, 200},
+                                         Entry{"ended", "ended", 210, 210},
+                                         Entry{"ending", "ending", 220, 220}}));
+  EXPECT_EQ(LookupComment(*dic, "end", "end"), "");
+
+  // Turn an existing entry into a suppression word.
+  user_dic->mutable_entries(1)->set_pos(
+      user_dictionary::UserDictionary::SUPPRESSION_WORD);
+  dic->Load(storage.GetProto());
+  EXPECT_GT(dic->GetOverlaySizeForTest(), 0);
+  ExpectSameAsFullLoad(*dic, storage.GetProto());
+  EXPECT_THAT(LookupExact("star", *dic), IsEmpty());
+  EXPECT_TRUE(suppression_dictionary_->SuppressEntry("star", "star"));
+
+  // Delete the entries.
+  user_dic->mutable_entries()->DeleteSubrange(0, 2);
+  user_dic->mutable_entries()->RemoveLast();
+  dic->Load(storage.GetProto());
+  EXPECT_GT(dic->GetOverlaySizeForTest(), 0);
+  ExpectSameAsFullLoad(*dic, storage.GetProto());
+  EXPECT_THAT(LookupExact("end", *dic), IsEmpty());
+  EXPECT_THAT(LookupExact("star", *dic), IsEmpty());
+  EXPECT_FALSE(suppression_dictionary_->SuppressEntry("star", "star"));
+  // "start" is still registered as the duplicate entry.
+  EXPECT_THAT(LookupExact("start", *dic),
+              ElementsAre(Entry{"start", "start", 200, 200}));
+  EXPECT_EQ(LookupComment(*dic, "comment_key2", "comment_value2"), "comment");
+}
+
+TEST_F(UserDictionaryTest, IncrementalLoadCompaction) {
+  std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+
+  UserDictionaryStorage storage("");
+  UserDictionaryStorage::UserDictionary *user_dic =
+      storage.GetProto().add_dictionaries();
+  auto add_entries = [user_dic](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      UserDictionaryStorage::UserDictionaryEntry *entry =
+          user_dic->add_entries();
+      entry->set_key(absl::StrCat("key", i));
+      entry->set_value(absl::StrCat("value", i));
+      entry->set_pos(user_dictionary::UserDictionary::NOUN);
+    }
+  };
+  add_entries(0, 3000);
+  dic->Load(storage.GetProto());
+  EXPECT_EQ(dic->GetOverlaySizeForTest(), 0);
+
+  // Small enough to be applied incrementally.
+  add_entries(3000, 3500);
+  dic->Load(storage.GetProto());
+  EXPECT_EQ(dic->GetOverlaySizeForTest(), 500);
+  ExpectSameAsFullLoad(*dic, storage.GetProto());
+
+  // The overlay grows beyond the threshold and is compacted into the base.
+  add_entries(3500, 4100);
+  user_dic->mutable_entries()->DeleteSubrange(0, 10);
+  dic->Load(storage.GetProto());
+  EXPECT_EQ(dic->GetOverlaySizeForTest(), 0);
+  ExpectSameAsFullLoad(*dic, storage.GetProto());
+  EXPECT_THAT(LookupExact("key0", *dic), IsEmpty());
+  EXPECT_THAT(LookupExact("key4099", *dic),
+              ElementsAre(Entry{"key4099", "value4099", 100, 100}));
+}
+
 TEST_F(UserDictionaryTest, TestLookupExactWithSuggestionOnlyWords) {
   std::unique_ptr<UserDictionary> user_dic(CreateDictionary());
   user_dic->WaitForReloader();
@@ -649,6 +779,126 @@ TEST_F(UserDictionaryTest, AsyncLoadTest) {
   }
 }
 
+TEST_F(UserDictionaryTest, ReloadUsesCompiledCache) {
+  TempDirectory temp_dir = testing::MakeTempDirectoryOrDie();
+  const std::string filename =
+      FileUtil::JoinPath(temp_dir.path(), "compiled_cache_test.db");
+  const std::string cache_filename =
+      UserDictionaryCache::GetCacheFileName(filename);
+  {
+    UserDictionaryStorage storage(filename);
+    LoadFromString(kUserDictionary1, &storage);
+    EXPECT_TRUE(storage.Lock());
+    EXPECT_OK(storage.Save());
+    EXPECT_TRUE(storage.UnLock());
+  }
+  UserDictionary::SetUserDictionaryName(filename);
+
+  // The first load compiles the storage and persists the result.
+  {
+    std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+    dic->WaitForReloader();
+    EXPECT_THAT(LookupExact("end", *dic),
+                ElementsAre(Entry{"end", "end", 200, 200}));
+  }
+  ASSERT_OK(FileUtil::FileExists(cache_filename));
+
+  // Overwrite the cache with different tokens to see that an unchanged
+  // source is loaded from the cache.
+  absl::StatusOr<std::string> source = FileUtil::GetContents(filename);
+  ASSERT_OK(source);
+  const UserDictionaryCache::Stamp stamp = {
+      .source_fingerprint = Fingerprint(*source),
+      .user_pos_fingerprint =
+          UserDictionaryCache::FingerprintUserPos(UserPosMock()),
+  };
+  UserDictionaryCache::Contents contents;
+  contents.tokens.push_back({.key = "end", .value = "cached", .id = 300});
+  contents.suppression_entries.emplace_back("suppress_key", "suppress_value");
+  ASSERT_OK(UserDictionaryCache::Save(cache_filename, stamp, contents));
+  {
+    std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+    dic->WaitForReloader();
+    EXPECT_THAT(LookupExact("end", *dic),
+                ElementsAre(Entry{"end", "cached", 300, 300}));
+    EXPECT_TRUE(suppression_dictionary_->SuppressEntry("suppress_key",
+                                                       "suppress_value"));
+  }
+
+  // Once the source is modified, the cache is rebuilt.
+  {
+    UserDictionaryStorage storage(filename);
+    LoadFromString(kUserDictionary0, &storage);
+    EXPECT_TRUE(storage.Lock());
+    EXPECT_OK(storage.Save());
+    EXPECT_TRUE(storage.UnLock());
+  }
+  {
+    std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+    dic->WaitForReloader();
+    EXPECT_THAT(LookupExact("end", *dic), IsEmpty());
+    EXPECT_THAT(LookupExact("start", *dic),
+                ElementsAre(Entry{"start", "start", 200, 200}));
+    EXPECT_FALSE(suppression_dictionary_->SuppressEntry("suppress_key",
+                                                        "suppress_value"));
+  }
+  source = FileUtil::GetContents(filename);
+  ASSERT_OK(source);
+  EXPECT_OK(UserDictionaryCache::Load(
+      cache_filename,
+      {.source_fingerprint = Fingerprint(*source),
+       .user_pos_fingerprint = stamp.user_pos_fingerprint}));
+
+  UserDictionary::SetUserDictionaryName("");
+}
+
+TEST_F(UserDictionaryTest, IncrementalLoadAfterCompiledCache) {
+  TempDirectory temp_dir = testing::MakeTempDirectoryOrDie();
+  const std::string filename =
+      FileUtil::JoinPath(temp_dir.path(), "compiled_cache_test.db");
+  UserDictionaryStorage storage(filename);
+  LoadFromString(kUserDictionary0, &storage);
+  EXPECT_TRUE(storage.Lock());
+  EXPECT_OK(storage.Save());
+  EXPECT_TRUE(storage.UnLock());
+  UserDictionary::SetUserDictionaryName(filename);
+
+  // The first dictionary compiles the storage and persists the result.
+  {
+    std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+    dic->WaitForReloader();
+  }
+  ASSERT_OK(
+      FileUtil::FileExists(UserDictionaryCache::GetCacheFileName(filename)));
+
+  // The second one starts from the cache, and still applies the first edit
+  // incrementally.
+  std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+  EXPECT_THAT(LookupExact("stamp", *dic),
+              ElementsAre(Entry{"stamp", "stamp", 100, 100}));
+  UserDictionaryStorage::UserDictionary *user_dic =
+      storage.GetProto().mutable_dictionaries(0);
+  UserDictionaryStorage::UserDictionaryEntry *entry = user_dic->add_entries();
+  entry->set_key("end");
+  entry->set_value("end");
+  entry->set_pos(user_dictionary::UserDictionary::NOUN);
+  dic->Load(storage.GetProto());
+  EXPECT_GT(dic->GetOverlaySizeForTest(), 0);
+  ExpectSameAsFullLoad(*dic, storage.GetProto());
+  EXPECT_THAT(LookupExact("end", *dic),
+              ElementsAre(Entry{"end", "end", 100, 100}));
+
+  // The tokens loaded from the cache can be removed incrementally as well.
+  user_dic->mutable_entries()->DeleteSubrange(3, 1);
+  dic->Load(storage.GetProto());
+  EXPECT_GT(dic->GetOverlaySizeForTest(), 0);
+  ExpectSameAsFullLoad(*dic, storage.GetProto());
+  EXPECT_THAT(LookupExact("stamp", *dic), IsEmpty());
+
+  UserDictionary::SetUserDictionaryName("");
+}
+
 TEST_F(UserDictionaryTest, TestSuppressionDictionary) {
   std::unique_ptr<UserDictionary> user_dic(CreateDictionaryWithMockPos());
   user_dic->WaitForReloader();
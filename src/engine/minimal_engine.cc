@@ -207,6 +207,11 @@ class MinimalConverter : public ConverterInterface {
                      absl::Span<const uint8_t> new_size_array) const override {
     return true;
   }
+
+  bool ExpandCandidates(const ConversionRequest &request, Segments *segments,
+                        size_t segment_index, size_t size) const override {
+    return false;
+  }
 };
 
 class MinimalPredictor : public PredictorInterface {
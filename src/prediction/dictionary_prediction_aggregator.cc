@@ -622,6 +622,12 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
     selected_types |= REALTIME;
   }
 
+  // The realtime conversion results are good enough when the deadline is
+  // exceeded.
+  if (request.IsDeadlineExceeded() && !results->empty()) {
+    return selected_types;
+  }
+
   // In partial suggestion or prediction, only realtime candidates are used.
   if (request.request_type() == ConversionRequest::PARTIAL_SUGGESTION ||
       request.request_type() == ConversionRequest::PARTIAL_PREDICTION) {
@@ -636,6 +642,10 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
     selected_types |= type;
   }
 
+  if (request.IsDeadlineExceeded() && !results->empty()) {
+    return selected_types;
+  }
+
   if (IsMixedConversionEnabled(request.request()) && key_len > 0 &&
       AggregateNumberCandidates(request, segments, results)) {
     selected_types |= NUMBER;
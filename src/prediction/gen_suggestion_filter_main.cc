@@ -59,6 +59,7 @@ ABSL_FLAG(std::string, safe_list_files, "",
 namespace {
 using ::mozc::storage::ExistenceFilter;
 using ::mozc::storage::ExistenceFilterBuilder;
+using ::mozc::storage::ExistenceFilterFormat;
 
 void ReadHashList(const std::string &name, std::vector<uint64_t> *words) {
   std::string line;
@@ -95,8 +96,8 @@ ExistenceFilterBuilder GetFilter(const size_t num_bytes,
                                  const std::vector<uint64_t> &hash_list) {
   LOG(INFO) << "num_bytes: " << num_bytes;
 
-  ExistenceFilterBuilder filter(
-      ExistenceFilterBuilder::CreateOptimal(num_bytes, hash_list.size()));
+  ExistenceFilterBuilder filter(ExistenceFilterBuilder::CreateOptimal(
+      num_bytes, hash_list.size(), ExistenceFilterFormat::kBlocked));
   for (size_t i = 0; i < hash_list.size(); ++i) {
     filter.Insert(hash_list[i]);
   }
@@ -120,7 +121,8 @@ ExistenceFilterBuilder SetupFilter(
     const size_t num_bytes, const std::vector<uint64_t> &hash_list,
     const std::vector<std::string> &safe_word_list) {
   constexpr int kNumRetryMax = 10;
-  constexpr int kSizeOffset = 8;
+  // One block of the blocked format.
+  constexpr int kSizeOffset = 64;
   // Prevent filtering of common words by false positive.
   for (int i = 0; i < kNumRetryMax; ++i) {
     ExistenceFilterBuilder filter =
@@ -155,7 +157,8 @@ int main(int argc, char **argv) {
   static constexpr float kErrorRate = 0.00001;
   const size_t num_bytes =
       std::max(ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(
-                   kErrorRate, hash_list.size()),
+                   kErrorRate, hash_list.size(),
+                   ExistenceFilterFormat::kBlocked),
                kMinimumFilterBytes);
 
   std::vector<std::string> safe_word_list;
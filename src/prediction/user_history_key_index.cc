@@ -0,0 +1,193 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "prediction/user_history_key_index.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/japanese_util.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc::prediction {
+
+void UserHistoryKeyIndex::Insert(uint32_t fp, absl::string_view key,
+                                 absl::string_view value) {
+  Erase(fp);
+  if (key.empty()) {
+    return;
+  }
+  Record &record = entries_[fp];
+  record.key = std::string(key);
+  japanese_util::HiraganaToRomanji(key, &record.roman);
+  record.value = std::string(value);
+  record.recency = ++next_recency_;
+  keys_.emplace(record.key, fp);
+  romans_.emplace(record.roman, fp);
+  values_.emplace(record.value, fp);
+}
+
+void UserHistoryKeyIndex::Erase(uint32_t fp) {
+  const auto it = entries_.find(fp);
+  if (it == entries_.end()) {
+    return;
+  }
+  EraseFromKeyMap(it->second.key, fp, &keys_);
+  EraseFromKeyMap(it->second.roman, fp, &romans_);
+  EraseFromKeyMap(it->second.value, fp, &values_);
+  entries_.erase(it);
+}
+
+void UserHistoryKeyIndex::Clear() {
+  entries_.clear();
+  keys_.clear();
+  romans_.clear();
+  values_.clear();
+  next_recency_ = 0;
+}
+
+void UserHistoryKeyIndex::AppendPrefixMatches(
+    absl::string_view key, std::vector<uint32_t> *fps) const {
+  // Entries whose key is a proper prefix of |key|.
+  for (size_t len = 1; len < key.size(); ++len) {
+    const auto [begin, end] = keys_.equal_range(key.substr(0, len));
+    for (auto it = begin; it != end; ++it) {
+      fps->push_back(it->second);
+    }
+  }
+  // Entries whose key starts with |key|, including |key| itself.
+  AppendStartsWith(keys_, key, fps);
+}
+
+void UserHistoryKeyIndex::AppendRomanFuzzyMatches(
+    absl::string_view roman_prefix, std::vector<uint32_t> *fps) const {
+  // RomanFuzzyPrefixMatch() accepts |str| when it agrees with |roman_prefix|
+  // up to some position i and one edit at i makes |roman_prefix| a prefix of
+  // |str|.  Collects the candidates for every i; the caller verifies them.
+  for (size_t i = 0; i < roman_prefix.size(); ++i) {
+    const absl::string_view head = roman_prefix.substr(0, i);
+    const absl::string_view tail = roman_prefix.substr(i);
+
+    // Deletion: |str| = head + c + tail for any character c.  Enumerates the
+    // distinct characters following |head| by jumping over their ranges.
+    auto it = romans_.lower_bound(head);
+    while (it != romans_.end() && absl::StartsWith(it->first, head)) {
+      if (it->first.size() == head.size()) {
+        ++it;
+        continue;
+      }
+      const uint8_t c = static_cast<uint8_t>(it->first[i]);
+      const std::string next_head = absl::StrCat(head, std::string(1, c));
+      AppendStartsWith(romans_, absl::StrCat(next_head, tail), fps);
+      if (c == 0xFF) {
+        break;
+      }
+      it = romans_.lower_bound(
+          absl::StrCat(head, std::string(1, static_cast<char>(c + 1))));
+    }
+
+    // Swap of the i-th and (i + 1)-th characters.
+    if (i + 1 < roman_prefix.size()) {
+      std::string swapped(roman_prefix);
+      std::swap(swapped[i], swapped[i + 1]);
+      AppendStartsWith(romans_, swapped, fps);
+    }
+
+    // Voice sound mark '-' matched to a non-alphanumeric character.
+    if (!absl::ascii_isalnum(roman_prefix[i])) {
+      std::string replaced(roman_prefix);
+      replaced[i] = '-';
+      AppendStartsWith(romans_, replaced, fps);
+    }
+  }
+}
+
+void UserHistoryKeyIndex::AppendValueSuffixMatches(
+    absl::string_view value, std::vector<uint32_t> *fps) const {
+  for (size_t pos = 0; pos < value.size(); ++pos) {
+    // A valid UTF-8 value never starts with a continuation byte (10xxxxxx).
+    if ((static_cast<uint8_t>(value[pos]) & 0xC0) == 0x80) {
+      continue;
+    }
+    const auto [begin, end] = values_.equal_range(value.substr(pos));
+    for (auto it = begin; it != end; ++it) {
+      fps->push_back(it->second);
+    }
+  }
+}
+
+void UserHistoryKeyIndex::SortByRecency(std::vector<uint32_t> *fps) const {
+  std::vector<std::pair<uint64_t, uint32_t>> sorted;
+  sorted.reserve(fps->size());
+  for (const uint32_t fp : *fps) {
+    if (const auto it = entries_.find(fp); it != entries_.end()) {
+      sorted.emplace_back(it->second.recency, fp);
+    }
+  }
+  // Recency is unique per entry, so sorting also groups the duplicates.
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto &lhs, const auto &rhs) { return lhs > rhs; });
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+  fps->clear();
+  for (const auto &[recency, fp] : sorted) {
+    fps->push_back(fp);
+  }
+}
+
+// static
+void UserHistoryKeyIndex::EraseFromKeyMap(absl::string_view key, uint32_t fp,
+                                          KeyMap *key_map) {
+  auto [it, end] = key_map->equal_range(key);
+  for (; it != end; ++it) {
+    if (it->second == fp) {
+      key_map->erase(it);
+      return;
+    }
+  }
+}
+
+// static
+void UserHistoryKeyIndex::AppendStartsWith(const KeyMap &key_map,
+                                           absl::string_view prefix,
+                                           std::vector<uint32_t> *fps) {
+  for (auto it = key_map.lower_bound(prefix);
+       it != key_map.end() && absl::StartsWith(it->first, prefix); ++it) {
+    fps->push_back(it->second);
+  }
+}
+
+}  // namespace mozc::prediction
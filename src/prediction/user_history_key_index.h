@@ -0,0 +1,118 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_PREDICTION_USER_HISTORY_KEY_INDEX_H_
+#define MOZC_PREDICTION_USER_HISTORY_KEY_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc::prediction {
+
+// Secondary index of the user history entries, keyed by their readings and
+// values.
+//
+// UserHistoryPredictor keeps the entries in an LRU cache, which can only be
+// walked from the most recently used entry.  This index lets the predictor
+// visit only the entries whose reading can match the input and then replay
+// them in the LRU order, so that the cost of a lookup depends on the number
+// of matching entries rather than on the size of the history.
+//
+// Entries are identified by their fingerprints in the LRU cache.  The owner is
+// responsible for calling Insert() and Erase() whenever the cache changes.
+class UserHistoryKeyIndex {
+ public:
+  UserHistoryKeyIndex() = default;
+  UserHistoryKeyIndex(const UserHistoryKeyIndex &) = delete;
+  UserHistoryKeyIndex &operator=(const UserHistoryKeyIndex &) = delete;
+
+  // Adds or updates the entry |fp| with reading |key| and |value|, and marks
+  // it as the most recently used one.  Entries with an empty key are removed
+  // from the index since they never match an input.
+  void Insert(uint32_t fp, absl::string_view key, absl::string_view value);
+
+  void Erase(uint32_t fp);
+  void Clear();
+
+  size_t size() const { return entries_.size(); }
+  bool Contains(uint32_t fp) const { return entries_.contains(fp); }
+
+  // Appends the entries whose key is a non-empty prefix of |key| or starts
+  // with |key|.  These are all the candidates of prefix, exact and expanded
+  // key matches against |key|.
+  void AppendPrefixMatches(absl::string_view key,
+                           std::vector<uint32_t> *fps) const;
+
+  // Appends a superset of the entries whose romanized key can fuzzy-prefix
+  // match |roman_prefix|, allowing one deletion, one swap or one voice sound
+  // mark substitution (see UserHistoryPredictor::RomanFuzzyPrefixMatch).
+  void AppendRomanFuzzyMatches(absl::string_view roman_prefix,
+                               std::vector<uint32_t> *fps) const;
+
+  // Appends the entries whose value is a suffix of |value|, including |value|
+  // itself.
+  void AppendValueSuffixMatches(absl::string_view value,
+                                std::vector<uint32_t> *fps) const;
+
+  // Sorts |fps| from the most recently used to the least recently used one.
+  // Duplicates and entries not in the index are removed.
+  void SortByRecency(std::vector<uint32_t> *fps) const;
+
+ private:
+  struct Record {
+    std::string key;
+    std::string roman;
+    std::string value;
+    uint64_t recency = 0;
+  };
+
+  using KeyMap = absl::btree_multimap<std::string, uint32_t>;
+
+  static void EraseFromKeyMap(absl::string_view key, uint32_t fp,
+                              KeyMap *key_map);
+  static void AppendStartsWith(const KeyMap &key_map, absl::string_view prefix,
+                               std::vector<uint32_t> *fps);
+
+  absl::flat_hash_map<uint32_t, Record> entries_;
+  KeyMap keys_;
+  KeyMap romans_;
+  KeyMap values_;
+  uint64_t next_recency_ = 0;
+};
+
+}  // namespace mozc::prediction
+
+#endif  // MOZC_PREDICTION_USER_HISTORY_KEY_INDEX_H_
@@ -0,0 +1,164 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "prediction/user_history_key_index.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc::prediction {
+namespace {
+
+using ::testing::Contains;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Not;
+
+std::vector<uint32_t> PrefixMatches(const UserHistoryKeyIndex &index,
+                                    absl::string_view key) {
+  std::vector<uint32_t> fps;
+  index.AppendPrefixMatches(key, &fps);
+  index.SortByRecency(&fps);
+  return fps;
+}
+
+std::vector<uint32_t> RomanFuzzyMatches(const UserHistoryKeyIndex &index,
+                                        absl::string_view roman_prefix) {
+  std::vector<uint32_t> fps;
+  index.AppendRomanFuzzyMatches(roman_prefix, &fps);
+  index.SortByRecency(&fps);
+  return fps;
+}
+
+TEST(UserHistoryKeyIndexTest, PrefixMatches) {
+  UserHistoryKeyIndex index;
+  index.Insert(1, "か", "可");
+  index.Insert(2, "かな", "仮名");
+  index.Insert(3, "かなだ", "カナダ");
+  index.Insert(4, "かに", "蟹");
+  index.Insert(5, "き", "木");
+  index.Insert(6, "かな", "かな");  // Same key, different value.
+  EXPECT_EQ(index.size(), 6);
+
+  // Most recently inserted first.
+  EXPECT_THAT(PrefixMatches(index, "かな"), ElementsAre(6, 3, 2, 1));
+  EXPECT_THAT(PrefixMatches(index, "かなだい"), ElementsAre(6, 3, 2, 1));
+  EXPECT_THAT(PrefixMatches(index, "か"), ElementsAre(6, 4, 3, 2, 1));
+  EXPECT_THAT(PrefixMatches(index, "く"), IsEmpty());
+
+  // Re-inserting moves the entry to the front.
+  index.Insert(2, "かな", "仮名");
+  EXPECT_THAT(PrefixMatches(index, "かな"), ElementsAre(2, 6, 3, 1));
+  EXPECT_EQ(index.size(), 6);
+}
+
+TEST(UserHistoryKeyIndexTest, EraseAndClear) {
+  UserHistoryKeyIndex index;
+  index.Insert(1, "あ", "亜");
+  index.Insert(2, "あい", "愛");
+  index.Insert(3, "あいう", "アイウ");
+
+  index.Erase(2);
+  EXPECT_FALSE(index.Contains(2));
+  EXPECT_THAT(PrefixMatches(index, "あいう"), ElementsAre(3, 1));
+
+  // Erasing an unknown entry is no-op.
+  index.Erase(100);
+  EXPECT_EQ(index.size(), 2);
+
+  // Entries with empty key are not indexed.
+  index.Insert(3, "", "");
+  EXPECT_FALSE(index.Contains(3));
+  EXPECT_THAT(PrefixMatches(index, "あいう"), ElementsAre(1));
+
+  index.Clear();
+  EXPECT_EQ(index.size(), 0);
+  EXPECT_THAT(PrefixMatches(index, "あ"), IsEmpty());
+}
+
+TEST(UserHistoryKeyIndexTest, SortByRecencyRemovesDuplicates) {
+  UserHistoryKeyIndex index;
+  index.Insert(1, "あ", "亜");
+  index.Insert(2, "い", "胃");
+  std::vector<uint32_t> fps = {1, 2, 1, 3, 2};
+  index.SortByRecency(&fps);
+  EXPECT_THAT(fps, ElementsAre(2, 1));
+}
+
+TEST(UserHistoryKeyIndexTest, RomanFuzzyMatches) {
+  UserHistoryKeyIndex index;
+  index.Insert(1, "かんじ", "漢字");     // kanzi
+  index.Insert(2, "かんじょう", "感情");   // kanzyou
+  index.Insert(3, "しんぶん", "新聞");    // sinbun
+  index.Insert(4, "らーめん", "ラーメン");  // ra-men
+
+  // Deletion.
+  EXPECT_THAT(RomanFuzzyMatches(index, "kazi"), ElementsAre(1));
+  EXPECT_THAT(RomanFuzzyMatches(index, "kaz"), ElementsAre(2, 1));
+  EXPECT_THAT(RomanFuzzyMatches(index, "anzi"), Contains(1));
+  // Swap.
+  EXPECT_THAT(RomanFuzzyMatches(index, "knaz"), ElementsAre(2, 1));
+  // Voice sound mark.
+  EXPECT_THAT(RomanFuzzyMatches(index, "ra,m"), ElementsAre(4));
+
+  EXPECT_THAT(RomanFuzzyMatches(index, "kazi"), Not(Contains(3)));
+  EXPECT_THAT(RomanFuzzyMatches(index, "xyz"), IsEmpty());
+}
+
+TEST(UserHistoryKeyIndexTest, ValueSuffixMatches) {
+  UserHistoryKeyIndex index;
+  index.Insert(1, "わたしの", "私の");
+  index.Insert(2, "なまえ", "名前");
+  index.Insert(3, "の", "の");
+  index.Insert(4, "わたしのなまえ", "私の名前");
+  index.Insert(5, "まえ", "前");
+
+  std::vector<uint32_t> fps;
+  index.AppendValueSuffixMatches("私の名前", &fps);
+  index.SortByRecency(&fps);
+  EXPECT_THAT(fps, ElementsAre(5, 4, 2));
+
+  fps.clear();
+  index.AppendValueSuffixMatches("あなたの", &fps);
+  index.SortByRecency(&fps);
+  EXPECT_THAT(fps, ElementsAre(3));
+
+  index.Erase(3);
+  fps.clear();
+  index.AppendValueSuffixMatches("あなたの", &fps);
+  EXPECT_THAT(fps, IsEmpty());
+}
+
+}  // namespace
+}  // namespace mozc::prediction
@@ -84,14 +84,10 @@ using ::mozc::dictionary::PosMatcher;
 using ::mozc::dictionary::SuppressionDictionary;
 using ::mozc::usage_stats::UsageStats;
 
-// Finds suggestion candidates from the most recent 3000 history in LRU.
-// We don't check all history, since suggestion is called every key event
+// Checks at most 3000 suggestion candidates from the history, since
+// suggestion is called every key event.
 constexpr size_t kMaxSuggestionTrial = 3000;
 
-// Finds suffix matches of history_segments from the most recent 500 histories
-// in LRU.
-constexpr size_t kMaxPrevValueTrial = 500;
-
 // Cache size
 // Typically memory/storage footprint becomes kLruCacheSize * 70 bytes.
 #ifdef __ANDROID__
@@ -447,6 +443,7 @@ bool UserHistoryPredictor::Load() {
 
 bool UserHistoryPredictor::Load(const UserHistoryStorage &history) {
   dic_->Clear();
+  key_index_.Clear();
   for (const Entry &entry : history.GetProto().entries()) {
     // Workaround for b/116826494: Some garbled characters are suggested
     // from user history. This filters such entries.
@@ -455,7 +452,11 @@ bool UserHistoryPredictor::Load(const UserHistoryStorage &history) {
                  << protobuf::Utf8Format(entry);
       continue;
     }
-    dic_->Insert(EntryFingerprint(entry), entry);
+    if (DicElement *e = InsertToDic(EntryFingerprint(entry), entry.key(),
+                                    entry.value());
+        e != nullptr) {
+      e->value = entry;
+    }
   }
 
   VLOG(1) << "Loaded user history, size=" << history.GetProto().entries_size();
@@ -506,6 +507,7 @@ bool UserHistoryPredictor::ClearAllHistory() {
   // Renews DicCache as LruCache tries to reuse the internal value by
   // using FreeList
   dic_ = std::make_unique<DicCache>(UserHistoryPredictor::cache_size());
+  key_index_.Clear();
 
   // insert a dummy event entry.
   InsertEvent(Entry::CLEAN_ALL_EVENT);
@@ -538,7 +540,7 @@ bool UserHistoryPredictor::ClearUnusedHistory() {
 
   for (const uint32_t key : keys) {
     VLOG(2) << "Removing: " << key;
-    if (!dic_->Erase(key)) {
+    if (!EraseFromDic(key)) {
       LOG(ERROR) << "cannot erase " << key;
     }
   }
@@ -1238,25 +1240,23 @@ const UserHistoryPredictor::Entry *UserHistoryPredictor::LookupPrevEntry(
   }
 
   // When |prev_entry| is nullptr or |prev_entry| has no valid next_entries,
-  // do linear-search over the LRU.
+  // look up the most recent entry whose value equals to or is a SUFFIX of
+  // prev_value.
   if ((prev_entry == nullptr && history_segment.candidates_size() > 0) ||
       (prev_entry != nullptr && prev_entry->next_entries_size() == 0)) {
     const std::string &prev_value = prev_entry == nullptr
                                         ? history_segment.candidate(0).value
                                         : prev_entry->value();
-    int trial = 0;
-    for (const DicElement *elm = dic_->Head();
-         trial++ < kMaxPrevValueTrial && elm != nullptr; elm = elm->next) {
-      const Entry *entry = &(elm->value);
-      // entry->value() equals to the prev_value or
-      // entry->value() is a SUFFIX of prev_value.
+    std::vector<uint32_t> fps;
+    key_index_.AppendValueSuffixMatches(prev_value, &fps);
+    key_index_.SortByRecency(&fps);
+    for (const uint32_t fp : fps) {
+      const Entry *entry = dic_->LookupWithoutInsert(fp);
       // length of entry->value() must be >= 2, as single-length
       // match would be noisy.
-      if (IsValidEntry(*entry) && entry != prev_entry &&
+      if (entry != nullptr && IsValidEntry(*entry) && entry != prev_entry &&
           entry->next_entries_size() > 0 &&
-          Util::CharsLen(entry->value()) >= 2 &&
-          (entry->value() == prev_value ||
-           absl::EndsWith(prev_value, entry->value()))) {
+          Util::CharsLen(entry->value()) >= 2) {
         prev_entry = entry;
         break;
       }
@@ -1300,36 +1300,99 @@ void UserHistoryPredictor::GetResultsFromHistoryDictionary(
 
   const absl::Time now = Clock::GetAbslTime();
   int trial = 0;
-  for (const DicElement *elm = dic_->Head(); elm != nullptr; elm = elm->next) {
-    if (!IsValidEntryIgnoringRemovedField(elm->value)) {
-      continue;
+  // Returns false when no more entries need to be looked up.
+  auto lookup = [&](const Entry &entry) {
+    if (!IsValidEntryIgnoringRemovedField(entry)) {
+      return true;
     }
-    if (absl::FromUnixSeconds(elm->value.last_access_time()) + k62Days < now) {
+    if (absl::FromUnixSeconds(entry.last_access_time()) + k62Days < now) {
       updated_ = true;  // We found an entry to be deleted at next save.
-      continue;
+      return true;
     }
     if (request.request_type() == ConversionRequest::SUGGESTION &&
         trial++ >= kMaxSuggestionTrial) {
       VLOG(2) << "too many trials";
-      break;
+      return false;
     }
 
     // Lookup key from elm_value and prev_entry.
     // If a new entry is found, the entry is pushed to the results.
     // TODO(team): make KanaFuzzyLookupEntry().
-    if (!LookupEntry(request_type, input_key, base_key, expanded.get(),
-                     &(elm->value), prev_entry, results) &&
-        !RomanFuzzyLookupEntry(roman_input_key, &(elm->value), results)) {
-      continue;
+    if (!LookupEntry(request_type, input_key, base_key, expanded.get(), &entry,
+                     prev_entry, results) &&
+        !RomanFuzzyLookupEntry(roman_input_key, &entry, results)) {
+      return true;
     }
 
     // already found enough results.
-    if (results->size() >= max_results_size) {
+    return results->size() < max_results_size;
+  };
+
+  std::vector<uint32_t> fps;
+  if (!GetLookupCandidates(base_key, expanded.get(), roman_input_key,
+                           prev_entry, &fps)) {
+    for (const DicElement *elm = dic_->Head(); elm != nullptr;
+         elm = elm->next) {
+      if (!lookup(elm->value)) {
+        break;
+      }
+    }
+    return;
+  }
+  for (const uint32_t fp : fps) {
+    const Entry *entry = dic_->LookupWithoutInsert(fp);
+    DCHECK(entry);
+    if (entry != nullptr && !lookup(*entry)) {
       break;
     }
   }
 }
 
+bool UserHistoryPredictor::GetLookupCandidates(
+    absl::string_view base_key, const Trie<std::string> *expanded,
+    absl::string_view roman_input_key, const Entry *prev_entry,
+    std::vector<uint32_t> *fps) const {
+  if (!base_key.empty()) {
+    // Prefix, exact and expanded key matches all share |base_key|.
+    key_index_.AppendPrefixMatches(base_key, fps);
+  } else if (expanded != nullptr) {
+    // Any key starting with one of the expansions; not indexed.
+    return false;
+  } else if (prev_entry != nullptr) {
+    // Zero query suggestion only matches the bigram entries of |prev_entry|.
+    for (const NextEntry &next_entry : prev_entry->next_entries()) {
+      fps->push_back(next_entry.entry_fp());
+    }
+  }
+  if (!roman_input_key.empty()) {
+    key_index_.AppendRomanFuzzyMatches(roman_input_key, fps);
+  }
+  // Visits the candidates in the same order as the LRU list.
+  key_index_.SortByRecency(fps);
+  return true;
+}
+
+UserHistoryPredictor::DicElement *UserHistoryPredictor::InsertToDic(
+    uint32_t dic_key, absl::string_view key, absl::string_view value) {
+  // LruCache evicts its tail silently when it is full.
+  const DicElement *tail = dic_->Tail();
+  const std::optional<uint32_t> tail_key =
+      tail == nullptr ? std::nullopt : std::make_optional(tail->key);
+  DicElement *e = dic_->Insert(dic_key);
+  if (tail_key.has_value() && !dic_->HasKey(*tail_key)) {
+    key_index_.Erase(*tail_key);
+  }
+  if (e != nullptr) {
+    key_index_.Insert(dic_key, key, value);
+  }
+  return e;
+}
+
+bool UserHistoryPredictor::EraseFromDic(uint32_t dic_key) {
+  key_index_.Erase(dic_key);
+  return dic_->Erase(dic_key);
+}
+
 // static
 void UserHistoryPredictor::GetInputKeyFromSegments(
     const ConversionRequest &request, const Segments &segments,
@@ -1528,7 +1591,7 @@ void UserHistoryPredictor::InsertEvent(EntryType type) {
   const uint32_t dic_key = Fingerprint("", "", type);
 
   CHECK(dic_.get());
-  DicElement *e = dic_->Insert(dic_key);
+  DicElement *e = InsertToDic(dic_key, "", "");
   if (e == nullptr) {
     VLOG(2) << "insert failed";
     return;
@@ -1593,7 +1656,7 @@ void UserHistoryPredictor::Insert(std::string key, std::string value,
     // add a treatment for UPDATE_ENTRY mode
   }
 
-  DicElement *e = dic_->Insert(dic_key);
+  DicElement *e = InsertToDic(dic_key, key, value);
   if (e == nullptr) {
     VLOG(2) << "insert failed";
     return;
@@ -1931,7 +1994,7 @@ void UserHistoryPredictor::Revert(Segments *segments) {
         revert_entry.revert_entry_type == Segments::RevertEntry::CREATE_ENTRY) {
       const uint32_t key = LoadUnaligned<uint32_t>(revert_entry.key.data());
       VLOG(2) << "Erasing the key: " << key;
-      dic_->Erase(key);
+      EraseFromDic(key);
     }
   }
 }
@@ -48,6 +48,7 @@
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
 #include "prediction/predictor_interface.h"
+#include "prediction/user_history_key_index.h"
 #include "prediction/user_history_predictor.pb.h"
 #include "request/conversion_request.h"
 #include "storage/encrypted_string_storage.h"
@@ -364,6 +365,15 @@ class UserHistoryPredictor : public PredictorInterface {
                                  Entry entry,
                                  EntryPriorityQueue *results) const;
 
+  // Collects the fingerprints of the entries which can match the input, in
+  // the LRU order.  Returns false if the input cannot be looked up in
+  // |key_index_| and the whole LRU list needs to be scanned.
+  bool GetLookupCandidates(absl::string_view base_key,
+                           const Trie<std::string> *expanded,
+                           absl::string_view roman_input_key,
+                           const Entry *prev_entry,
+                           std::vector<uint32_t> *fps) const;
+
   void GetResultsFromHistoryDictionary(RequestType request_type,
                                        const ConversionRequest &request,
                                        const Segments &segments,
@@ -443,6 +453,15 @@ class UserHistoryPredictor : public PredictorInterface {
                  bool is_suggestion_selected, uint32_t next_fp,
                  uint64_t last_access_time, Segments *segments);
 
+  // Inserts |dic_key| into |dic_| and updates |key_index_| with |key| and
+  // |value|, including the entry evicted by the LRU policy.  The caller fills
+  // the value of the returned element.
+  DicElement *InsertToDic(uint32_t dic_key, absl::string_view key,
+                          absl::string_view value);
+
+  // Erases |dic_key| from |dic_| and |key_index_|.
+  bool EraseFromDic(uint32_t dic_key);
+
   // Inserts event entry (CLEAN_ALL_EVENT|CLEAN_UNUSED_EVENT).
   void InsertEvent(EntryType type);
 
@@ -474,6 +493,9 @@ class UserHistoryPredictor : public PredictorInterface {
   bool content_word_learning_enabled_;
   mutable std::atomic<bool> updated_;
   std::unique_ptr<DicCache> dic_;
+  // Secondary index of |dic_| by reading and value.  Kept in sync on every
+  // insertion and erasure of |dic_|.
+  UserHistoryKeyIndex key_index_;
   mutable std::optional<BackgroundFuture<void>> sync_;
 };
 
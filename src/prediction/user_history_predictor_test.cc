@@ -158,7 +158,8 @@ class UserHistoryPredictorTest : public testing::TestWithTempUserProfile {
       UserHistoryPredictor *predictor, const absl::string_view key,
       const absl::string_view value) {
     UserHistoryPredictor::Entry *e =
-        &predictor->dic_->Insert(predictor->Fingerprint(key, value))->value;
+        &predictor->InsertToDic(predictor->Fingerprint(key, value), key, value)
+             ->value;
     e->set_key(std::string(key));
     e->set_value(std::string(value));
     e->set_removed(false);
@@ -177,6 +178,10 @@ class UserHistoryPredictorTest : public testing::TestWithTempUserProfile {
     return predictor.dic_->Size();
   }
 
+  static size_t KeyIndexSize(const UserHistoryPredictor &predictor) {
+    return predictor.key_index_.size();
+  }
+
   static bool LoadStorage(UserHistoryPredictor *predictor,
                           const UserHistoryStorage &history) {
     return predictor->Load(history);
@@ -931,6 +936,28 @@ TEST_F(UserHistoryPredictorTest, UserHistoryPredictorClearTest) {
   }
 }
 
+TEST_F(UserHistoryPredictorTest, KeyIndexFollowsLruEviction) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  const uint64_t now = absl::ToUnixSeconds(absl::Now());
+
+  // Fill the cache beyond its capacity so that the oldest entries are evicted.
+  const size_t cache_size = UserHistoryPredictor::cache_size();
+  for (size_t i = 0; i < cache_size + 10; ++i) {
+    InsertEntry(predictor, absl::StrCat("key", i, "end"),
+                absl::StrCat("value", i))
+        ->set_last_access_time(now);
+  }
+  EXPECT_EQ(EntrySize(*predictor), cache_size);
+  EXPECT_EQ(KeyIndexSize(*predictor), cache_size);
+
+  // Old entries are found even if they are far from the head of the LRU list.
+  EXPECT_TRUE(IsSuggestedAndPredicted(predictor, "key20end", "value20"));
+  EXPECT_TRUE(IsSuggestedAndPredicted(predictor, "key4000end", "value4000"));
+  // Evicted entries are gone from the index as well.
+  EXPECT_FALSE(IsSuggested(predictor, "key5end", "value5"));
+  EXPECT_FALSE(IsPredicted(predictor, "key5end", "value5"));
+}
+
 TEST_F(UserHistoryPredictorTest, UserHistoryPredictorTrailingPunctuation) {
   UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
 
@@ -1225,6 +1252,34 @@ TEST_F(UserHistoryPredictorTest, ZeroQuerySuggestionTest) {
   }
 }
 
+TEST_F(UserHistoryPredictorTest, ZeroQuerySuggestionFromValueSuffix) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  request_->set_zero_query_suggestion(true);
+
+  Segments segments;
+  SetUpInputForConversion("たろうは", composer_.get(), &segments);
+  AddCandidate(0, "太郎は", &segments);
+  predictor->Finish(*convreq_, &segments);
+
+  SetUpInputForConversionWithHistory("はなこに", "たろうは", "太郎は",
+                                     composer_.get(), &segments);
+  AddCandidate(1, "花子に", &segments);
+  predictor->Finish(*convreq_, &segments);
+
+  // Pushes "太郎は" far from the head of the LRU list.
+  const uint64_t now = absl::ToUnixSeconds(absl::Now());
+  for (int i = 0; i < 1000; ++i) {
+    InsertEntry(predictor, absl::StrCat("key", i), absl::StrCat("value", i))
+        ->set_last_access_time(now);
+  }
+
+  // "山田太郎は" is not in the history, but ends with "太郎は".
+  SetUpInputForSuggestionWithHistory("", "やまだたろうは", "山田太郎は",
+                                     composer_.get(), &segments);
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_TRUE(FindCandidateByValue("花子に", segments));
+}
+
 TEST_F(UserHistoryPredictorTest, MultiSegmentsMultiInput) {
   UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
 
@@ -0,0 +1,145 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "renderer/async_renderer_client.h"
+
+#include <deque>
+#include <memory>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/thread.h"
+#include "client/client_interface.h"
+#include "protocol/renderer_command.pb.h"
+#include "renderer/renderer_interface.h"
+#include "absl/synchronization/mutex.h"
+
+namespace mozc {
+namespace renderer {
+
+AsyncRendererClient::AsyncRendererClient(
+    std::unique_ptr<RendererInterface> renderer)
+    : renderer_(std::move(renderer)),
+      is_available_(renderer_->IsAvailable()),
+      sender_([this] { ThreadMain(); }) {}
+
+AsyncRendererClient::~AsyncRendererClient() {
+  {
+    absl::MutexLock lock(&mutex_);
+    quit_ = true;
+  }
+  sender_.Join();
+}
+
+bool AsyncRendererClient::Activate() {
+  absl::MutexLock lock(&mutex_);
+  activate_requested_ = true;
+  return true;
+}
+
+bool AsyncRendererClient::IsAvailable() const {
+  return is_available_.load(std::memory_order_relaxed);
+}
+
+bool AsyncRendererClient::ExecCommand(
+    const commands::RendererCommand &command) {
+  // Copies the command outside of the lock not to block the sender thread.
+  commands::RendererCommand new_command = command;
+  absl::MutexLock lock(&mutex_);
+  if (new_command.type() == commands::RendererCommand::UPDATE &&
+      !commands_.empty() &&
+      commands_.back().type() == commands::RendererCommand::UPDATE) {
+    // The last writer wins.
+    commands_.back().Swap(&new_command);
+  } else {
+    commands_.push_back(std::move(new_command));
+  }
+  return true;
+}
+
+void AsyncRendererClient::SetSendCommandInterface(
+    client::SendCommandInterface *send_command_interface) {
+  absl::MutexLock lock(&mutex_, absl::Condition(
+                                    +[](bool *sending) { return !*sending; },
+                                    &sending_));
+  renderer_->SetSendCommandInterface(send_command_interface);
+}
+
+void AsyncRendererClient::Flush() {
+  absl::MutexLock lock(&mutex_,
+                       absl::Condition(
+                           +[](AsyncRendererClient *self)
+                               ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+                                 return self->commands_.empty() &&
+                                        !self->activate_requested_ &&
+                                        !self->sending_;
+                               },
+                           this));
+}
+
+void AsyncRendererClient::ThreadMain() {
+  while (true) {
+    bool activate = false;
+    std::deque<commands::RendererCommand> commands;
+    {
+      absl::MutexLock lock(
+          &mutex_, absl::Condition(
+                       +[](AsyncRendererClient *self)
+                           ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+                             return self->quit_ || self->activate_requested_ ||
+                                    !self->commands_.empty();
+                           },
+                       this));
+      if (!activate_requested_ && commands_.empty()) {
+        // |quit_| is set and all the commands have been sent.
+        return;
+      }
+      activate = std::exchange(activate_requested_, false);
+      commands.swap(commands_);
+      sending_ = true;
+    }
+
+    if (activate && !renderer_->Activate()) {
+      VLOG(1) << "Renderer is not activated";
+    }
+    for (const commands::RendererCommand &command : commands) {
+      if (!renderer_->ExecCommand(command)) {
+        LOG(ERROR) << "ExecCommand failed";
+      }
+    }
+    is_available_.store(renderer_->IsAvailable(), std::memory_order_relaxed);
+
+    absl::MutexLock lock(&mutex_);
+    sending_ = false;
+  }
+}
+
+}  // namespace renderer
+}  // namespace mozc
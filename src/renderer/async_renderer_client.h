@@ -0,0 +1,96 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_RENDERER_ASYNC_RENDERER_CLIENT_H_
+#define MOZC_RENDERER_ASYNC_RENDERER_CLIENT_H_
+
+#include <atomic>
+#include <deque>
+#include <memory>
+
+#include "base/thread.h"
+#include "client/client_interface.h"
+#include "protocol/renderer_command.pb.h"
+#include "renderer/renderer_interface.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace mozc {
+namespace renderer {
+
+// Forwards renderer commands to another renderer, typically RendererClient,
+// on a dedicated sender thread so that ExecCommand() never blocks the caller
+// on IPC.  As the renderer only shows the latest state, consecutive UPDATE
+// commands which have not been sent yet are coalesced and only the last one
+// is sent.  The other commands are sent in order.
+//
+// The wrapped renderer is used only by the sender thread once constructed.
+class AsyncRendererClient : public RendererInterface {
+ public:
+  explicit AsyncRendererClient(std::unique_ptr<RendererInterface> renderer);
+  AsyncRendererClient(const AsyncRendererClient &) = delete;
+  AsyncRendererClient &operator=(const AsyncRendererClient &) = delete;
+  // Sends the remaining commands and stops the sender thread.
+  ~AsyncRendererClient() override;
+
+  // Requests the renderer to be activated and returns without waiting.
+  bool Activate() override;
+
+  // Returns the availability of the renderer observed by the sender thread
+  // after it sent the last commands.
+  bool IsAvailable() const override;
+
+  // Queues |command| and returns true without waiting.
+  bool ExecCommand(const commands::RendererCommand &command) override;
+
+  void SetSendCommandInterface(
+      client::SendCommandInterface *send_command_interface) override;
+
+  // Waits until all the queued commands are sent.
+  void Flush();
+
+ private:
+  void ThreadMain();
+
+  std::unique_ptr<RendererInterface> renderer_;
+  std::atomic<bool> is_available_;
+  absl::Mutex mutex_;
+  std::deque<commands::RendererCommand> commands_ ABSL_GUARDED_BY(mutex_);
+  bool activate_requested_ ABSL_GUARDED_BY(mutex_) = false;
+  // True while the sender thread uses |renderer_|.
+  bool sending_ ABSL_GUARDED_BY(mutex_) = false;
+  bool quit_ ABSL_GUARDED_BY(mutex_) = false;
+  Thread sender_;
+};
+
+}  // namespace renderer
+}  // namespace mozc
+
+#endif  // MOZC_RENDERER_ASYNC_RENDERER_CLIENT_H_
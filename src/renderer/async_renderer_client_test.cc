@@ -0,0 +1,136 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "renderer/async_renderer_client.h"
+
+#include <memory>
+#include <utility>
+
+#include "protocol/renderer_command.pb.h"
+#include "renderer/renderer_mock.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+#include "absl/synchronization/notification.h"
+
+namespace mozc {
+namespace renderer {
+namespace {
+
+using ::mozc::commands::RendererCommand;
+using ::testing::AllOf;
+using ::testing::InSequence;
+using ::testing::Property;
+using ::testing::Return;
+
+RendererCommand MakeCommand(RendererCommand::CommandType type,
+                            bool visible = false) {
+  RendererCommand command;
+  command.set_type(type);
+  command.set_visible(visible);
+  return command;
+}
+
+auto IsCommand(RendererCommand::CommandType type, bool visible = false) {
+  return AllOf(Property(&RendererCommand::type, type),
+               Property(&RendererCommand::visible, visible));
+}
+
+TEST(AsyncRendererClientTest, CoalesceUpdates) {
+  auto renderer = std::make_unique<RendererMock>();
+  RendererMock &mock = *renderer;
+  EXPECT_CALL(mock, IsAvailable()).WillRepeatedly(Return(true));
+
+  absl::Notification sending, resume;
+  {
+    InSequence seq;
+    EXPECT_CALL(mock, ExecCommand(IsCommand(RendererCommand::NOOP)))
+        .WillOnce([&](const RendererCommand &) {
+          sending.Notify();
+          resume.WaitForNotification();
+          return true;
+        });
+    // Only the last one of the consecutive updates is sent.
+    EXPECT_CALL(mock, ExecCommand(IsCommand(RendererCommand::UPDATE, true)))
+        .WillOnce(Return(true));
+    EXPECT_CALL(mock, ExecCommand(IsCommand(RendererCommand::SHUTDOWN)))
+        .WillOnce(Return(true));
+    EXPECT_CALL(mock, ExecCommand(IsCommand(RendererCommand::UPDATE, false)))
+        .WillOnce(Return(true));
+  }
+
+  AsyncRendererClient client(std::move(renderer));
+  EXPECT_TRUE(client.IsAvailable());
+
+  // Blocks the sender thread while sending the first command.
+  EXPECT_TRUE(client.ExecCommand(MakeCommand(RendererCommand::NOOP)));
+  sending.WaitForNotification();
+
+  EXPECT_TRUE(client.ExecCommand(MakeCommand(RendererCommand::UPDATE)));
+  EXPECT_TRUE(client.ExecCommand(MakeCommand(RendererCommand::UPDATE)));
+  EXPECT_TRUE(client.ExecCommand(MakeCommand(RendererCommand::UPDATE, true)));
+  EXPECT_TRUE(client.ExecCommand(MakeCommand(RendererCommand::SHUTDOWN)));
+  EXPECT_TRUE(client.ExecCommand(MakeCommand(RendererCommand::UPDATE)));
+  resume.Notify();
+  client.Flush();
+}
+
+TEST(AsyncRendererClientTest, Activate) {
+  auto renderer = std::make_unique<RendererMock>();
+  RendererMock &mock = *renderer;
+  {
+    InSequence seq;
+    EXPECT_CALL(mock, IsAvailable()).WillOnce(Return(false));
+    EXPECT_CALL(mock, Activate()).WillOnce(Return(true));
+    EXPECT_CALL(mock, IsAvailable()).WillOnce(Return(true));
+  }
+
+  AsyncRendererClient client(std::move(renderer));
+  EXPECT_FALSE(client.IsAvailable());
+  EXPECT_TRUE(client.Activate());
+  client.Flush();
+  EXPECT_TRUE(client.IsAvailable());
+}
+
+TEST(AsyncRendererClientTest, SendRemainingCommandsOnDestruction) {
+  auto renderer = std::make_unique<RendererMock>();
+  RendererMock &mock = *renderer;
+  EXPECT_CALL(mock, IsAvailable()).WillRepeatedly(Return(true));
+  EXPECT_CALL(mock, ExecCommand(IsCommand(RendererCommand::UPDATE, true)))
+      .WillOnce(Return(true));
+
+  {
+    AsyncRendererClient client(std::move(renderer));
+    client.ExecCommand(MakeCommand(RendererCommand::UPDATE, true));
+  }
+}
+
+}  // namespace
+}  // namespace renderer
+}  // namespace mozc
@@ -76,6 +76,18 @@
         '<(mozc_src_dir)/protocol/protocol.gyp:renderer_proto',
       ],
     },
+    {
+      'target_name': 'async_renderer_client',
+      'type': 'static_library',
+      'sources': [
+        'async_renderer_client.cc',
+      ],
+      'dependencies': [
+        '<(mozc_src_dir)/base/absl.gyp:absl_synchronization',
+        '<(mozc_src_dir)/base/base.gyp:base',
+        '<(mozc_src_dir)/protocol/protocol.gyp:renderer_proto',
+      ],
+    },
     {
       'target_name': 'renderer_server',
       'type': 'static_library',
@@ -166,9 +166,8 @@ RendererServer::RendererServer()
   VLOG(2) << "timeout is set to be : " << timeout_;
 
 #ifndef MOZC_NO_LOGGING
-  config::Config config;
-  config::ConfigHandler::GetConfig(&config);
-  Logging::SetConfigVerboseLevel(config.verbose_level());
+  Logging::SetConfigVerboseLevel(
+      config::ConfigHandler::GetSharedConfig()->verbose_level());
 #endif  // MOZC_NO_LOGGING
 }
 
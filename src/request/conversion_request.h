@@ -30,13 +30,16 @@
 #ifndef MOZC_REQUEST_CONVERSION_REQUEST_H_
 #define MOZC_REQUEST_CONVERSION_REQUEST_H_
 
+#include <cstddef>
 #include <type_traits>
 
+#include "base/clock.h"
 #include "base/logging.h"
 #include "composer/composer.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 inline constexpr size_t kMaxConversionCandidatesSize = 200;
@@ -156,6 +159,17 @@ class ConversionRequest {
     max_conversion_candidates_size_ = value;
   }
 
+  // When positive and smaller than max_conversion_candidates_size(), the
+  // converter materializes only this many candidates per segment at first and
+  // keeps the n-best search alive so that the rest can be produced on demand
+  // by ConverterInterface::ExpandCandidates().
+  size_t initial_conversion_candidates_size() const {
+    return initial_conversion_candidates_size_;
+  }
+  void set_initial_conversion_candidates_size(size_t value) {
+    initial_conversion_candidates_size_ = value;
+  }
+
   size_t max_user_history_prediction_candidates_size() const {
     return max_user_history_prediction_candidates_size_;
   }
@@ -189,6 +203,22 @@ class ConversionRequest {
     kana_modifier_insensitive_conversion_ = value;
   }
 
+  // Once the deadline is exceeded, the converter and the predictors skip the
+  // remaining optional work and return the best results found so far.
+  absl::Time deadline() const { return deadline_; }
+  void set_deadline(absl::Time deadline) { deadline_ = deadline; }
+  bool has_deadline() const { return deadline_ != absl::InfiniteFuture(); }
+  // Doesn't read the clock when no deadline is set.
+  bool IsDeadlineExceeded() const {
+    if (!has_deadline()) {
+      return false;
+    }
+    return Clock::GetAbslTime() >= deadline_;
+  }
+  // Loops over lattice positions or candidates check the deadline once every
+  // this many iterations to amortize the clock reads.
+  static constexpr size_t kDeadlineCheckInterval = 4;
+
  private:
   RequestType request_type_ = CONVERSION;
 
@@ -207,6 +237,7 @@ class ConversionRequest {
   ComposerKeySelection composer_key_selection_ = CONVERSION_KEY;
 
   int max_conversion_candidates_size_ = kMaxConversionCandidatesSize;
+  int initial_conversion_candidates_size_ = 0;
   int max_user_history_prediction_candidates_size_ = 3;
   int max_user_history_prediction_candidates_size_for_zero_query_ = 4;
   int max_dictionary_prediction_candidates_size_ = 20;
@@ -237,6 +268,9 @@ class ConversionRequest {
   // If true, enable kana modifier insensitive conversion.
   bool kana_modifier_insensitive_conversion_ = true;
 
+  // No deadline by default.
+  absl::Time deadline_ = absl::InfiniteFuture();
+
   // TODO(noriyukit): Moves all the members of Segments that are irrelevant to
   // this structure, e.g., Segments::request_type_.
   // Also, a key for conversion is eligible to live in this class.
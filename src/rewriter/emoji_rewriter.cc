@@ -152,12 +152,31 @@ int EmojiRewriter::capability(const ConversionRequest &request) const {
   return request.request().emoji_rewriter_capability();
 }
 
-bool EmojiRewriter::Rewrite(const ConversionRequest &request,
-                            Segments *segments) const {
+bool EmojiRewriter::IsEnabled(const ConversionRequest &request) const {
   if (!request.config().use_emoji_conversion()) {
     VLOG(2) << "no use_emoji_conversion";
     return false;
   }
+  return true;
+}
+
+void EmojiRewriter::AppendCacheKey(const ConversionRequest &request,
+                                   const Segments &segments,
+                                   CacheKey *key) const {
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &segment = segments.conversion_segment(i);
+    key->AddString(segment.key());
+    key->AddInt(GetEmojiCost(segment));
+    key->AddInt(
+        RewriterUtil::CalculateInsertPosition(segment, kDefaultInsertPos));
+  }
+}
+
+bool EmojiRewriter::Rewrite(const ConversionRequest &request,
+                            Segments *segments) const {
+  if (!IsEnabled(request)) {
+    return false;
+  }
 
   CHECK(segments != nullptr);
   return RewriteCandidates(segments);
@@ -31,6 +31,7 @@
 #define MOZC_REWRITER_EMOJI_REWRITER_H_
 
 #include <cstddef>
+#include <string>
 #include <utility>
 
 #include "base/container/serialized_string_array.h"
@@ -38,6 +39,7 @@
 #include "data_manager/data_manager_interface.h"
 #include "data_manager/emoji_data.h"
 #include "request/conversion_request.h"
+#include "rewriter/memoizing_rewriter.h"
 #include "rewriter/rewriter_interface.h"
 #include "absl/strings/string_view.h"
 
@@ -66,7 +68,7 @@ namespace mozc {
 //   for (size_t i = 0; i < segment->candidate_size(); ++i) {
 //     LOG(INFO) << segment->candidate(i).value;
 //   }
-class EmojiRewriter : public RewriterInterface {
+class EmojiRewriter : public MemoizableRewriterInterface {
  public:
   static constexpr size_t kEmojiDataByteLength = 28;
   using IteratorRange = std::pair<EmojiDataIterator, EmojiDataIterator>;
@@ -85,6 +87,15 @@ class EmojiRewriter : public RewriterInterface {
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
+  // Returns false when user settings are set not to use EmojiRewriter.
+  bool IsEnabled(const ConversionRequest &request) const override;
+
+  // Emoji candidates depend only on the segment keys, the cost of the top
+  // candidates and the insert positions.
+  void AppendCacheKey(const ConversionRequest &request,
+                      const Segments &segments,
+                      CacheKey *key) const override;
+
   // Counts the number of segments in which emoji candidates are selected,
   // and stores the result as usage stats.
   // NOTE: This method is expected to be called after the segments are processed
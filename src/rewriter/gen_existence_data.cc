@@ -47,15 +47,18 @@ namespace mozc {
 namespace {
 
 using ::mozc::storage::ExistenceFilterBuilder;
+using ::mozc::storage::ExistenceFilterFormat;
 
 std::string GenExistenceData(const absl::Span<const std::string> entries,
                              double error_rate) {
   const int n = entries.size();
-  const int m =
-      ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(error_rate, n);
+  // The blocked format is sized for the same error rate as the modulo format.
+  const int m = ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(
+      error_rate, n, ExistenceFilterFormat::kBlocked);
   LOG(INFO) << "entry: " << n << " err: " << error_rate << " bytes: " << m;
 
-  ExistenceFilterBuilder builder(ExistenceFilterBuilder::CreateOptimal(m, n));
+  ExistenceFilterBuilder builder(ExistenceFilterBuilder::CreateOptimal(
+      m, n, ExistenceFilterFormat::kBlocked));
 
   for (const std::string &entry : entries) {
     const uint64_t id = Fingerprint(entry);
@@ -0,0 +1,303 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/memoizing_rewriter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+#include "rewriter/rewriter_interface.h"
+#include "storage/lru_cache.h"
+#include "absl/hash/hash.h"
+
+namespace mozc {
+namespace {
+
+std::atomic<uint64_t> next_rewriter_id = 1;
+
+// Candidates are generated on demand for segments with a generator, so their
+// contents can't be captured by the cache key.
+bool HasCandidateGenerator(const Segments &segments) {
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    if (segments.conversion_segment(i).candidate_generator() != nullptr) {
+      return true;
+    }
+  }
+  return false;
+}
+
+struct SegmentShape {
+  Segment::SegmentType type;
+  std::string key;
+  size_t meta_candidates_size;
+
+  bool operator==(const SegmentShape &other) const {
+    return type == other.type && key == other.key &&
+           meta_candidates_size == other.meta_candidates_size;
+  }
+};
+
+std::vector<SegmentShape> GetShape(const Segments &segments) {
+  std::vector<SegmentShape> shape;
+  shape.reserve(segments.segments_size());
+  for (size_t i = 0; i < segments.segments_size(); ++i) {
+    const Segment &segment = segments.segment(i);
+    shape.push_back({segment.segment_type(), segment.key(),
+                     segment.meta_candidates_size()});
+  }
+  return shape;
+}
+
+struct Insertion {
+  // Index in the rewritten segment.
+  size_t position;
+  Segment::Candidate candidate;
+};
+
+struct Annotation {
+  // Index in the segment before Rewrite().
+  size_t index;
+  std::string description;
+};
+
+// Changes made to a conversion segment by the wrapped Rewrite().
+struct SegmentChanges {
+  // Sorted by position.
+  std::vector<Insertion> insertions;
+  std::vector<Annotation> annotations;
+};
+
+struct Result {
+  bool modified = false;
+  std::vector<SegmentChanges> segments;
+  // Approximate memory held by the result in bytes.
+  size_t footprint = 0;
+};
+
+size_t GetResultFootprint(const Result &result) {
+  size_t footprint =
+      sizeof(Result) + result.segments.capacity() * sizeof(SegmentChanges);
+  for (const SegmentChanges &changes : result.segments) {
+    footprint += changes.insertions.capacity() * sizeof(Insertion) +
+                 changes.annotations.capacity() * sizeof(Annotation);
+    for (const Insertion &insertion : changes.insertions) {
+      footprint += insertion.candidate.GetFootprint() -
+                   sizeof(Segment::Candidate);
+    }
+    for (const Annotation &annotation : changes.annotations) {
+      footprint += annotation.description.capacity();
+    }
+  }
+  return footprint;
+}
+
+// Candidates of a segment and the hashes of their descriptions before
+// Rewrite().
+using Snapshot = std::vector<std::pair<const Segment::Candidate *, size_t>>;
+
+// Compares |segment| with |before| and returns false if Rewrite() did more
+// than inserting candidates and updating descriptions.
+bool GetChanges(const Snapshot &before, const Segment &segment,
+                SegmentChanges *changes) {
+  size_t index = 0;
+  for (size_t i = 0; i < segment.candidates_size(); ++i) {
+    const Segment::Candidate &candidate = segment.candidate(i);
+    if (index < before.size() && &candidate == before[index].first) {
+      if (absl::HashOf(candidate.description) != before[index].second) {
+        changes->annotations.push_back({index, candidate.description});
+      }
+      ++index;
+      continue;
+    }
+    changes->insertions.push_back({i, candidate});
+  }
+  // Existing candidates were removed or reordered.
+  return index == before.size();
+}
+
+}  // namespace
+
+class MemoizingRewriter::ResultCache : public Segments::RewriterCache {
+ public:
+  ResultCache(uint64_t generation, size_t size)
+      : generation_(generation), results_(size) {}
+
+  uint64_t generation() const { return generation_; }
+
+  const Result *Lookup(uint64_t key) { return results_.Lookup(key); }
+
+  void Insert(uint64_t key, Result result) {
+    result.footprint = GetResultFootprint(result);
+    // An evicted element is reused for the new result.
+    Result &value = results_.Insert(key)->value;
+    footprint_ = footprint_ - value.footprint + result.footprint;
+    value = std::move(result);
+  }
+
+  size_t GetFootprint() const override { return sizeof(*this) + footprint_; }
+
+ private:
+  const uint64_t generation_;
+  storage::LruCache<uint64_t, Result> results_;
+  // Sum of the footprints of the results.
+  size_t footprint_ = 0;
+};
+
+void MemoizableRewriterInterface::CacheKey::AddCandidate(
+    const Segment::Candidate &candidate) {
+  hash_ = absl::HashOf(
+      hash_, candidate.key, candidate.value, candidate.content_key,
+      candidate.content_value, candidate.prefix, candidate.suffix,
+      candidate.description, candidate.a11y_description, candidate.usage_title,
+      candidate.usage_description, candidate.consumed_key_size,
+      candidate.usage_id, candidate.cost, candidate.wcost,
+      candidate.structure_cost, candidate.lid, candidate.rid,
+      candidate.attributes, candidate.source_info,
+      static_cast<int>(candidate.category), static_cast<int>(candidate.style),
+      static_cast<int>(candidate.command), candidate.inner_segment_boundary);
+}
+
+MemoizingRewriter::MemoizingRewriter(
+    std::unique_ptr<MemoizableRewriterInterface> rewriter, size_t cache_size)
+    : rewriter_(std::move(rewriter)),
+      cache_size_(cache_size),
+      id_(next_rewriter_id.fetch_add(1, std::memory_order_relaxed)) {
+  DCHECK(rewriter_);
+}
+
+MemoizingRewriter::ResultCache *MemoizingRewriter::GetResultCache(
+    Segments *segments) const {
+  const uint64_t generation = generation_.load(std::memory_order_acquire);
+  // Only this rewriter stores caches for |id_|.
+  auto *cache =
+      static_cast<ResultCache *>(segments->mutable_rewriter_cache(id_));
+  if (cache == nullptr || cache->generation() != generation) {
+    auto new_cache = std::make_unique<ResultCache>(generation, cache_size_);
+    cache = new_cache.get();
+    segments->set_rewriter_cache(id_, std::move(new_cache));
+  }
+  return cache;
+}
+
+bool MemoizingRewriter::Rewrite(const ConversionRequest &request,
+                                Segments *segments) const {
+  if (!rewriter_->IsEnabled(request)) {
+    return false;
+  }
+  if (HasCandidateGenerator(*segments)) {
+    return rewriter_->Rewrite(request, segments);
+  }
+
+  // The number of candidates is always in the key, as the changes are
+  // replayed by index.
+  MemoizableRewriterInterface::CacheKey cache_key;
+  cache_key.AddInt(segments->conversion_segments_size());
+  for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
+    cache_key.AddInt(segments->conversion_segment(i).candidates_size());
+  }
+  rewriter_->AppendCacheKey(request, *segments, &cache_key);
+  const uint64_t key = cache_key.hash();
+
+  ResultCache *cache = GetResultCache(segments);
+  if (const Result *result = cache->Lookup(key); result != nullptr) {
+    DCHECK_EQ(result->segments.size(), segments->conversion_segments_size());
+    for (size_t i = 0; i < result->segments.size(); ++i) {
+      Segment *segment = segments->mutable_conversion_segment(i);
+      const SegmentChanges &changes = result->segments[i];
+      for (const Annotation &annotation : changes.annotations) {
+        segment->mutable_candidate(annotation.index)->description =
+            annotation.description;
+      }
+      for (const Insertion &insertion : changes.insertions) {
+        *segment->insert_candidate(insertion.position) = insertion.candidate;
+      }
+    }
+    return result->modified;
+  }
+
+  // Candidates are owned by the segment and keep their addresses, so the
+  // existing ones are told apart from the inserted ones by address. Only the
+  // hashes of the descriptions are kept to find the updated ones.
+  const std::vector<SegmentShape> shape = GetShape(*segments);
+  std::vector<Snapshot> snapshots(segments->conversion_segments_size());
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    const Segment &segment = segments->conversion_segment(i);
+    snapshots[i].reserve(segment.candidates_size());
+    for (size_t j = 0; j < segment.candidates_size(); ++j) {
+      const Segment::Candidate &candidate = segment.candidate(j);
+      snapshots[i].emplace_back(&candidate,
+                                absl::HashOf(candidate.description));
+    }
+  }
+
+  Result result;
+  result.modified = rewriter_->Rewrite(request, segments);
+  if (GetShape(*segments) != shape) {
+    return result.modified;
+  }
+  result.segments.resize(snapshots.size());
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    if (!GetChanges(snapshots[i], segments->conversion_segment(i),
+                    &result.segments[i])) {
+      // The wrapped rewriter reordered or removed candidates, which can't be
+      // replayed. The result is used as is but not cached.
+      VLOG(1) << "Existing candidates were changed. Not cached.";
+      return result.modified;
+    }
+  }
+
+  const bool modified = result.modified;
+  cache->Insert(key, std::move(result));
+  return modified;
+}
+
+bool MemoizingRewriter::Reload() {
+  ClearCache();
+  return rewriter_->Reload();
+}
+
+void MemoizingRewriter::Clear() {
+  ClearCache();
+  rewriter_->Clear();
+}
+
+void MemoizingRewriter::ClearCache() {
+  generation_.fetch_add(1, std::memory_order_release);
+}
+
+}  // namespace mozc
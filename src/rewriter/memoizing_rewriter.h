@@ -0,0 +1,137 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_REWRITER_MEMOIZING_REWRITER_H_
+#define MOZC_REWRITER_MEMOIZING_REWRITER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+#include "rewriter/rewriter_interface.h"
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+
+// A rewriter that MemoizingRewriter can wrap. Its Rewrite() may only insert
+// candidates into the conversion segments and set the descriptions of the
+// existing ones, and must be a pure function of what AppendCacheKey() adds:
+// it must not read the composer, learned user data, the user dictionary or
+// the clock. Results that change the segment structure (e.g., by
+// ResizeSegment()) are not cached.
+class MemoizableRewriterInterface : public RewriterInterface {
+ public:
+  // Hash of the inputs of Rewrite(). Values are hashed as they are added, so
+  // building a key doesn't allocate.
+  class CacheKey {
+   public:
+    void AddString(absl::string_view str) { hash_ = absl::HashOf(hash_, str); }
+    void AddInt(int64_t value) { hash_ = absl::HashOf(hash_, value); }
+    // Adds all the fields of |candidate|.
+    void AddCandidate(const Segment::Candidate &candidate);
+
+    uint64_t hash() const { return hash_; }
+
+   private:
+    uint64_t hash_ = 0;
+  };
+
+  // Returns false if Rewrite() returns false without touching the segments
+  // for |request|, e.g., when the feature is disabled in the config. Checked
+  // before the cache key is built.
+  virtual bool IsEnabled(const ConversionRequest &request) const = 0;
+
+  // Adds the request fields and the parts of |segments| that Rewrite() reads
+  // to |key|.
+  virtual void AppendCacheKey(const ConversionRequest &request,
+                              const Segments &segments,
+                              CacheKey *key) const = 0;
+};
+
+// Wraps a rewriter and replays its previous result when Rewrite() is called
+// again with the same input, e.g., when the user resizes a segment back and
+// forth. Only the inserted candidates and the updated descriptions are kept.
+// The results are stored in the Segments of each session, so sessions don't
+// share or evict each other's results.
+class MemoizingRewriter : public RewriterInterface {
+ public:
+  static constexpr size_t kDefaultCacheSize = 16;
+
+  explicit MemoizingRewriter(
+      std::unique_ptr<MemoizableRewriterInterface> rewriter,
+      size_t cache_size = kDefaultCacheSize);
+
+  int capability(const ConversionRequest &request) const override {
+    return rewriter_->capability(request);
+  }
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override;
+
+  bool Focus(Segments *segments, size_t segment_index,
+             int candidate_index) const override {
+    return rewriter_->Focus(segments, segment_index, candidate_index);
+  }
+
+  void Finish(const ConversionRequest &request, Segments *segments) override {
+    rewriter_->Finish(request, segments);
+  }
+
+  bool Sync() override { return rewriter_->Sync(); }
+
+  bool Reload() override;
+
+  void Clear() override;
+
+ private:
+  class ResultCache;
+
+  // Returns the cache of this rewriter stored in |segments|. Creates a new one
+  // if there is none or the cache was cleared after it was created.
+  ResultCache *GetResultCache(Segments *segments) const;
+
+  // Drops the results cached in all the sessions.
+  void ClearCache();
+
+  std::unique_ptr<MemoizableRewriterInterface> rewriter_;
+  const size_t cache_size_;
+  // Identifies the caches of this rewriter in Segments.
+  const uint64_t id_;
+  // Incremented by ClearCache(). Caches of older generations are dropped.
+  std::atomic<uint64_t> generation_ = 0;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_MEMOIZING_REWRITER_H_
@@ -0,0 +1,204 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures SingleKanjiRewriter, EmojiRewriter and SymbolRewriter with and
+// without MemoizingRewriter on a typing trace with the mock data. Every
+// keystroke of a sentence is rewritten as a suggestion of the typed prefix,
+// which always misses the cache, and then the sentence is converted and its
+// first segment is resized back and forth.
+//
+// Usage:
+//   memoizing_rewriter_benchmark_main --iterations=100
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base/init_mozc.h"
+#include "base/stopwatch.h"
+#include "base/util.h"
+#include "config/config_handler.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "rewriter/emoji_rewriter.h"
+#include "rewriter/memoizing_rewriter.h"
+#include "rewriter/rewriter_interface.h"
+#include "rewriter/single_kanji_rewriter.h"
+#include "rewriter/symbol_rewriter.h"
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(int32_t, iterations, 100, "number of runs of the trace");
+ABSL_FLAG(int32_t, candidates_size, 30, "number of candidates per segment");
+
+namespace mozc {
+namespace {
+
+constexpr absl::string_view kSentences[] = {
+    "わたしのなまえはなかのです",
+    "きょうはいいてんきですね",
+    "かっこをいれる",
+    "やじるしのきごう",
+    "あしたはあめがふるかも",
+};
+
+// Number of conversions per sentence. The first segment alternates between
+// two sizes, so only the first two conversions miss the cache.
+constexpr int kConversionsPerSentence = 4;
+
+struct Step {
+  ConversionRequest::RequestType type;
+  Segments segments;
+};
+
+Segments MakeSegments(const std::vector<absl::string_view> &keys) {
+  const int candidates_size = absl::GetFlag(FLAGS_candidates_size);
+  Segments segments;
+  for (const absl::string_view key : keys) {
+    Segment *segment = segments.add_segment();
+    segment->set_key(key);
+    for (int i = 0; i < candidates_size; ++i) {
+      Segment::Candidate *candidate = segment->add_candidate();
+      candidate->key = std::string(key);
+      candidate->content_key = candidate->key;
+      candidate->value = i == 0 ? std::string(key) : absl::StrCat(key, i);
+      candidate->content_value = candidate->value;
+      candidate->cost = 1000 + i * 100;
+    }
+  }
+  return segments;
+}
+
+std::vector<Step> MakeTrace() {
+  std::vector<Step> trace;
+  for (const absl::string_view sentence : kSentences) {
+    const size_t length = Util::CharsLen(sentence);
+    for (size_t i = 1; i <= length; ++i) {
+      trace.push_back({ConversionRequest::SUGGESTION,
+                       MakeSegments({Util::Utf8SubString(sentence, 0, i)})});
+    }
+    for (int i = 0; i < kConversionsPerSentence; ++i) {
+      const size_t first = length / 2 + i % 2;
+      trace.push_back(
+          {ConversionRequest::CONVERSION,
+           MakeSegments({Util::Utf8SubString(sentence, 0, first),
+                         Util::Utf8SubString(sentence, first)})});
+    }
+  }
+  return trace;
+}
+
+class Benchmark {
+ public:
+  Benchmark() { config::ConfigHandler::GetDefaultConfig(&config_); }
+
+  // Returns the rewriters in the order of RewriterImpl.
+  std::vector<std::unique_ptr<RewriterInterface>> CreateRewriters() const {
+    std::vector<std::unique_ptr<RewriterInterface>> rewriters;
+    rewriters.push_back(std::make_unique<SingleKanjiRewriter>(data_manager_));
+    rewriters.push_back(std::make_unique<EmojiRewriter>(data_manager_));
+    rewriters.push_back(
+        std::make_unique<SymbolRewriter>(&converter_, &data_manager_));
+    return rewriters;
+  }
+
+  std::vector<std::unique_ptr<RewriterInterface>> CreateMemoizingRewriters()
+      const {
+    std::vector<std::unique_ptr<RewriterInterface>> rewriters;
+    rewriters.push_back(std::make_unique<MemoizingRewriter>(
+        std::make_unique<SingleKanjiRewriter>(data_manager_)));
+    rewriters.push_back(std::make_unique<MemoizingRewriter>(
+        std::make_unique<EmojiRewriter>(data_manager_)));
+    rewriters.push_back(std::make_unique<MemoizingRewriter>(
+        std::make_unique<SymbolRewriter>(&converter_, &data_manager_)));
+    return rewriters;
+  }
+
+  // Returns the average time to rewrite the whole trace. Copying the segments
+  // is not measured. Each run uses a new Segments as a new session, so it
+  // doesn't hit the entries of the previous one.
+  absl::Duration Measure(
+      const std::vector<Step> &trace,
+      const std::vector<std::unique_ptr<RewriterInterface>> &rewriters) const {
+    const int iterations = absl::GetFlag(FLAGS_iterations);
+    Stopwatch stopwatch;
+    for (int i = 0; i < iterations; ++i) {
+      // Assignment keeps the results cached in the Segments.
+      Segments segments;
+      for (const Step &step : trace) {
+        ConversionRequest request;
+        request.set_config(&config_);
+        request.set_request_type(step.type);
+        segments = step.segments;
+        stopwatch.Start();
+        for (const std::unique_ptr<RewriterInterface> &rewriter : rewriters) {
+          rewriter->Rewrite(request, &segments);
+        }
+        stopwatch.Stop();
+      }
+    }
+    return stopwatch.GetElapsed() / iterations;
+  }
+
+ private:
+  const testing::MockDataManager data_manager_;
+  const MockConverter converter_;
+  config::Config config_;
+};
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+
+  const std::vector<mozc::Step> trace = mozc::MakeTrace();
+  mozc::Benchmark benchmark;
+  const absl::Duration plain =
+      benchmark.Measure(trace, benchmark.CreateRewriters());
+  const absl::Duration memoizing =
+      benchmark.Measure(trace, benchmark.CreateMemoizingRewriters());
+  std::cout << absl::StrFormat("%8s %12s %12s", "steps", "plain", "memoizing")
+            << std::endl;
+  std::cout << absl::StrFormat("%8d %10.1fus %10.1fus", trace.size(),
+                               absl::ToDoubleMicroseconds(plain),
+                               absl::ToDoubleMicroseconds(memoizing))
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,348 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/memoizing_rewriter.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "converter/segments.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "rewriter/rewriter_interface.h"
+#include "testing/gunit.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace {
+
+// Sets a description to the top candidate if it has none, and inserts
+// "<value>!" after it unless the value already ends with "!". Disabled by
+// use_emoji_conversion just for testing.
+class TestRewriter : public MemoizableRewriterInterface {
+ public:
+  explicit TestRewriter(int *count) : count_(count) {}
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    ++*count_;
+    bool modified = false;
+    for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
+      Segment *segment = segments->mutable_conversion_segment(i);
+      if (segment->candidates_size() == 0) {
+        continue;
+      }
+      Segment::Candidate *top = segment->mutable_candidate(0);
+      if (top->description.empty()) {
+        top->description = "top";
+      }
+      if (top->value.back() == '!') {
+        continue;
+      }
+      Segment::Candidate *candidate = segment->insert_candidate(1);
+      candidate->key = segment->key();
+      candidate->value = absl::StrCat(top->value, "!");
+      candidate->description = "test";
+      modified = true;
+    }
+    return modified;
+  }
+
+  bool IsEnabled(const ConversionRequest &request) const override {
+    return !request.config().use_emoji_conversion();
+  }
+
+  void AppendCacheKey(const ConversionRequest &request,
+                      const Segments &segments,
+                      CacheKey *key) const override {
+    for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+      const Segment &segment = segments.conversion_segment(i);
+      key->AddString(segment.key());
+      if (segment.candidates_size() > 0) {
+        key->AddCandidate(segment.candidate(0));
+      }
+    }
+  }
+
+ private:
+  int *count_;
+};
+
+// Merges all the conversion segments into one.
+class ResizeRewriter : public MemoizableRewriterInterface {
+ public:
+  explicit ResizeRewriter(int *count) : count_(count) {}
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    ++*count_;
+    if (segments->conversion_segments_size() < 2) {
+      return false;
+    }
+    Segment *first = segments->mutable_conversion_segment(0);
+    const std::string key = absl::StrCat(
+        first->key(), segments->conversion_segment(1).key());
+    first->set_key(key);
+    segments->erase_segment(segments->history_segments_size() + 1);
+    return true;
+  }
+
+  bool IsEnabled(const ConversionRequest &request) const override {
+    return true;
+  }
+
+  void AppendCacheKey(const ConversionRequest &request,
+                      const Segments &segments,
+                      CacheKey *key) const override {
+    for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+      key->AddString(segments.conversion_segment(i).key());
+    }
+  }
+
+ private:
+  int *count_;
+};
+
+// Swaps the first two candidates, which MemoizingRewriter can't replay.
+class SwapRewriter : public MemoizableRewriterInterface {
+ public:
+  explicit SwapRewriter(int *count) : count_(count) {}
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    ++*count_;
+    Segment *segment = segments->mutable_conversion_segment(0);
+    segment->move_candidate(1, 0);
+    return true;
+  }
+
+  bool IsEnabled(const ConversionRequest &request) const override {
+    return true;
+  }
+
+  void AppendCacheKey(const ConversionRequest &request,
+                      const Segments &segments,
+                      CacheKey *key) const override {}
+
+ private:
+  int *count_;
+};
+
+void AddSegment(absl::string_view key, absl::string_view value,
+                Segments *segments) {
+  Segment *segment = segments->add_segment();
+  segment->set_key(key);
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->key = std::string(key);
+  candidate->value = std::string(value);
+}
+
+void ExpectSameCandidates(const Segments &expected, const Segments &actual) {
+  ASSERT_EQ(actual.conversion_segments_size(),
+            expected.conversion_segments_size());
+  for (size_t i = 0; i < actual.conversion_segments_size(); ++i) {
+    const Segment &expected_segment = expected.conversion_segment(i);
+    const Segment &actual_segment = actual.conversion_segment(i);
+    ASSERT_EQ(actual_segment.candidates_size(),
+              expected_segment.candidates_size());
+    for (size_t j = 0; j < actual_segment.candidates_size(); ++j) {
+      EXPECT_EQ(actual_segment.candidate(j).value,
+                expected_segment.candidate(j).value);
+      EXPECT_EQ(actual_segment.candidate(j).description,
+                expected_segment.candidate(j).description);
+    }
+  }
+}
+
+// The results are cached in the Segments of a session. Each test assigns the
+// input to the same Segments, which doesn't clear the cache, as a session
+// converts again.
+TEST(MemoizingRewriterTest, ReplaysCachedResult) {
+  int count = 0;
+  MemoizingRewriter rewriter(std::make_unique<TestRewriter>(&count));
+  const ConversionRequest request;
+
+  Segments segments;
+  AddSegment("a", "A", &segments);
+  segments.mutable_conversion_segment(0)->add_candidate()->value = "a";
+  AddSegment("b", "B", &segments);
+  Segments session = segments;
+  EXPECT_TRUE(rewriter.Rewrite(request, &session));
+  EXPECT_EQ(count, 1);
+  ASSERT_EQ(session.conversion_segment(0).candidates_size(), 3);
+  EXPECT_EQ(session.conversion_segment(0).candidate(1).value, "A!");
+  const Segments expected = session;
+
+  session = segments;
+  EXPECT_TRUE(rewriter.Rewrite(request, &session));
+  EXPECT_EQ(count, 1);
+  ExpectSameCandidates(expected, session);
+}
+
+TEST(MemoizingRewriterTest, CachesUnmodifiedResult) {
+  int count = 0;
+  MemoizingRewriter rewriter(std::make_unique<TestRewriter>(&count));
+  const ConversionRequest request;
+
+  Segments segments;
+  AddSegment("a", "A!", &segments);
+  Segments session = segments;
+  EXPECT_FALSE(rewriter.Rewrite(request, &session));
+  EXPECT_EQ(session.conversion_segment(0).candidate(0).description, "top");
+  const Segments expected = session;
+
+  // The description is replayed even though Rewrite() returned false.
+  session = segments;
+  EXPECT_FALSE(rewriter.Rewrite(request, &session));
+  EXPECT_EQ(count, 1);
+  ExpectSameCandidates(expected, session);
+}
+
+TEST(MemoizingRewriterTest, DifferentInputMisses) {
+  int count = 0;
+  MemoizingRewriter rewriter(std::make_unique<TestRewriter>(&count));
+  const ConversionRequest request;
+
+  Segments segments;
+  AddSegment("a", "A", &segments);
+  Segments session = segments;
+  EXPECT_TRUE(rewriter.Rewrite(request, &session));
+  EXPECT_EQ(count, 1);
+
+  session = segments;
+  session.mutable_conversion_segment(0)->mutable_candidate(0)->cost = 100;
+  EXPECT_TRUE(rewriter.Rewrite(request, &session));
+  EXPECT_EQ(count, 2);
+
+  // The number of candidates is always a part of the key.
+  session = segments;
+  session.mutable_conversion_segment(0)->add_candidate()->value = "a";
+  EXPECT_TRUE(rewriter.Rewrite(request, &session));
+  EXPECT_EQ(count, 3);
+  EXPECT_EQ(session.conversion_segment(0).candidates_size(), 3);
+}
+
+TEST(MemoizingRewriterTest, CachesPerSegments) {
+  int count = 0;
+  MemoizingRewriter rewriter(std::make_unique<TestRewriter>(&count));
+  const ConversionRequest request;
+
+  Segments segments;
+  AddSegment("a", "A", &segments);
+  Segments session1 = segments;
+  EXPECT_TRUE(rewriter.Rewrite(request, &session1));
+  EXPECT_EQ(count, 1);
+  EXPECT_GT(session1.GetFootprint(), segments.GetFootprint());
+
+  // Another session doesn't see the result of the first one.
+  Segments session2 = segments;
+  EXPECT_TRUE(rewriter.Rewrite(request, &session2));
+  EXPECT_EQ(count, 2);
+
+  // A copy doesn't take the cache.
+  Segments copied = session1;
+  copied = segments;
+  EXPECT_TRUE(rewriter.Rewrite(request, &copied));
+  EXPECT_EQ(count, 3);
+
+  session1 = segments;
+  EXPECT_TRUE(rewriter.Rewrite(request, &session1));
+  EXPECT_EQ(count, 3);
+}
+
+TEST(MemoizingRewriterTest, SkipsDisabledRewriter) {
+  int count = 0;
+  MemoizingRewriter rewriter(std::make_unique<TestRewriter>(&count));
+  config::Config config;
+  config.set_use_emoji_conversion(true);
+  ConversionRequest request;
+  request.set_config(&config);
+
+  Segments segments;
+  AddSegment("a", "A", &segments);
+  EXPECT_FALSE(rewriter.Rewrite(request, &segments));
+  EXPECT_EQ(count, 0);
+  EXPECT_EQ(segments.conversion_segment(0).candidates_size(), 1);
+}
+
+TEST(MemoizingRewriterTest, DoesNotCacheResizedSegments) {
+  int count = 0;
+  MemoizingRewriter rewriter(std::make_unique<ResizeRewriter>(&count));
+  const ConversionRequest request;
+
+  Segments segments;
+  AddSegment("a", "A", &segments);
+  AddSegment("b", "B", &segments);
+  Segments session;
+  for (int i = 1; i <= 2; ++i) {
+    session = segments;
+    EXPECT_TRUE(rewriter.Rewrite(request, &session));
+    EXPECT_EQ(count, i);
+    ASSERT_EQ(session.conversion_segments_size(), 1);
+    EXPECT_EQ(session.conversion_segment(0).key(), "ab");
+  }
+}
+
+TEST(MemoizingRewriterTest, DoesNotCacheReorderedCandidates) {
+  int count = 0;
+  MemoizingRewriter rewriter(std::make_unique<SwapRewriter>(&count));
+  const ConversionRequest request;
+
+  Segments segments;
+  AddSegment("a", "A", &segments);
+  segments.mutable_conversion_segment(0)->add_candidate()->value = "a";
+  Segments session;
+  for (int i = 1; i <= 2; ++i) {
+    session = segments;
+    EXPECT_TRUE(rewriter.Rewrite(request, &session));
+    EXPECT_EQ(count, i);
+    EXPECT_EQ(session.conversion_segment(0).candidate(0).value, "a");
+  }
+}
+
+TEST(MemoizingRewriterTest, ClearDropsCache) {
+  int count = 0;
+  MemoizingRewriter rewriter(std::make_unique<TestRewriter>(&count));
+  const ConversionRequest request;
+
+  Segments segments;
+  AddSegment("a", "A", &segments);
+  Segments session = segments;
+  EXPECT_TRUE(rewriter.Rewrite(request, &session));
+  rewriter.Clear();
+  session = segments;
+  EXPECT_TRUE(rewriter.Rewrite(request, &session));
+  EXPECT_EQ(count, 2);
+}
+
+}  // namespace
+}  // namespace mozc
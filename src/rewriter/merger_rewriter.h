@@ -30,10 +30,13 @@
 #ifndef MOZC_REWRITER_MERGER_REWRITER_H_
 #define MOZC_REWRITER_MERGER_REWRITER_H_
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <utility>
 #include <vector>
 
+#include "base/trace.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
@@ -87,9 +90,12 @@ class MergerRewriter : public RewriterInterface {
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override {
     bool result = false;
-    for (const std::unique_ptr<RewriterInterface> &rewriter : rewriters_) {
-      if (CheckCapability(request, segments, *rewriter)) {
-        result |= rewriter->Rewrite(request, segments);
+    for (size_t i = 0; i < rewriters_.size(); ++i) {
+      const RewriterInterface &rewriter = *rewriters_[i];
+      if (CheckCapability(request, segments, rewriter)) {
+        // Rewriters are identified by their position in the chain.
+        const TraceSpan span("RewriterInterface::Rewrite", i);
+        result |= rewriter.Rewrite(request, segments);
       }
     }
 
@@ -107,6 +113,19 @@ class MergerRewriter : public RewriterInterface {
     return result;
   }
 
+  size_t GetRequiredCandidatesSize(const ConversionRequest &request,
+                                   const Segments &segments,
+                                   size_t segment_index) const override {
+    size_t size = 0;
+    for (const std::unique_ptr<RewriterInterface> &rewriter : rewriters_) {
+      if (CheckCapability(request, &segments, *rewriter)) {
+        size = std::max(size, rewriter->GetRequiredCandidatesSize(
+                                  request, segments, segment_index));
+      }
+    }
+    return size;
+  }
+
   // This method is mainly called when user puts SPACE key
   // and changes the focused candidate.
   // In this method, Converter will find bracketing matching.
@@ -51,6 +51,7 @@
 #include "rewriter/fortune_rewriter.h"
 #include "rewriter/ivs_variants_rewriter.h"
 #include "rewriter/language_aware_rewriter.h"
+#include "rewriter/memoizing_rewriter.h"
 #include "rewriter/merger_rewriter.h"
 #include "rewriter/number_rewriter.h"
 #include "rewriter/order_rewriter.h"
@@ -106,12 +107,18 @@ RewriterImpl::RewriterImpl(const ConverterInterface *parent_converter,
   AddRewriter(std::make_unique<EnglishVariantsRewriter>(pos_matcher_));
   AddRewriter(std::make_unique<NumberRewriter>(data_manager));
   AddRewriter(CollocationRewriter::Create(*data_manager));
-  AddRewriter(std::make_unique<SingleKanjiRewriter>(*data_manager));
+  // Single kanji, emoji and symbol candidates only depend on the segments and
+  // the request, so they are replayed when the same segments are rewritten
+  // again, e.g., while the user resizes a segment back and forth.
+  AddRewriter(std::make_unique<MemoizingRewriter>(
+      std::make_unique<SingleKanjiRewriter>(*data_manager)));
   AddRewriter(std::make_unique<IvsVariantsRewriter>());
-  AddRewriter(std::make_unique<EmojiRewriter>(*data_manager));
+  AddRewriter(std::make_unique<MemoizingRewriter>(
+      std::make_unique<EmojiRewriter>(*data_manager)));
   AddRewriter(EmoticonRewriter::CreateFromDataManager(*data_manager));
   AddRewriter(std::make_unique<CalculatorRewriter>(parent_converter));
-  AddRewriter(std::make_unique<SymbolRewriter>(parent_converter, data_manager));
+  AddRewriter(std::make_unique<MemoizingRewriter>(
+      std::make_unique<SymbolRewriter>(parent_converter, data_manager)));
   AddRewriter(std::make_unique<UnicodeRewriter>(parent_converter));
   AddRewriter(std::make_unique<VariantsRewriter>(pos_matcher_));
   AddRewriter(std::make_unique<ZipcodeRewriter>(pos_matcher_));
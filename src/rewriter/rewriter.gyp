@@ -60,6 +60,7 @@
         'fortune_rewriter.cc',
         'ivs_variants_rewriter.cc',
         'language_aware_rewriter.cc',
+        'memoizing_rewriter.cc',
         'number_compound_util.cc',
         'number_rewriter.cc',
         'order_rewriter.cc',
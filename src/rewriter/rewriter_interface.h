@@ -59,6 +59,16 @@ class RewriterInterface {
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const = 0;
 
+  // Returns the number of candidates the segment_index-th segment should have
+  // when Rewrite() is called. When the converter generates the candidates
+  // lazily (see ConversionRequest::initial_conversion_candidates_size()), it
+  // generates the candidates up to this size before calling Rewrite().
+  virtual size_t GetRequiredCandidatesSize(const ConversionRequest &request,
+                                           const Segments &segments,
+                                           size_t segment_index) const {
+    return 0;
+  }
+
   // This method is mainly called when user puts SPACE key
   // and changes the focused candidate.
   // In this method, Converter will find bracketing matching.
@@ -92,6 +92,13 @@ void InsertNounPrefix(const PosMatcher &pos_matcher, Segment *segment,
   }
 }
 
+bool UseSvs(const ConversionRequest &request) {
+  return request.request()
+             .decoder_experiment_params()
+             .variation_character_types() &
+         commands::DecoderExperimentParams::SVS_JAPANESE;
+}
+
 }  // namespace
 
 SingleKanjiRewriter::SingleKanjiRewriter(
@@ -109,8 +116,7 @@ int SingleKanjiRewriter::capability(const ConversionRequest &request) const {
   return RewriterInterface::CONVERSION;
 }
 
-bool SingleKanjiRewriter::Rewrite(const ConversionRequest &request,
-                                  Segments *segments) const {
+bool SingleKanjiRewriter::IsEnabled(const ConversionRequest &request) const {
   if (!request.config().use_single_kanji_conversion()) {
     VLOG(2) << "no use_single_kanji_conversion";
     return false;
@@ -120,14 +126,44 @@ bool SingleKanjiRewriter::Rewrite(const ConversionRequest &request,
     VLOG(2) << "single kanji prediction is enabled";
     return false;
   }
+  return true;
+}
+
+void SingleKanjiRewriter::AppendCacheKey(const ConversionRequest &request,
+                                         const Segments &segments,
+                                         CacheKey *key) const {
+  key->AddInt(UseSvs(request));
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &segment = segments.conversion_segment(i);
+    key->AddInt(segment.segment_type());
+    key->AddString(segment.key());
+    if (segment.candidates_size() == 0) {
+      continue;
+    }
+    // The top candidate gives the key, the POS of the right segment and the
+    // insert position of noun prefixes.
+    key->AddCandidate(segment.candidate(0));
+    // The others only get descriptions, and the leading history predictions
+    // shift the insert position.
+    for (size_t j = 1; j < segment.candidates_size(); ++j) {
+      const Segment::Candidate &candidate = segment.candidate(j);
+      key->AddString(candidate.value);
+      key->AddInt(candidate.description.empty());
+      key->AddInt(candidate.attributes);
+    }
+  }
+}
+
+bool SingleKanjiRewriter::Rewrite(const ConversionRequest &request,
+                                  Segments *segments) const {
+  if (!IsEnabled(request)) {
+    return false;
+  }
 
   bool modified = false;
   const size_t segments_size = segments->conversion_segments_size();
   const bool is_single_segment = (segments_size == 1);
-  const bool use_svs = (request.request()
-                            .decoder_experiment_params()
-                            .variation_character_types() &
-                        commands::DecoderExperimentParams::SVS_JAPANESE);
+  const bool use_svs = UseSvs(request);
   for (size_t i = 0; i < segments_size; ++i) {
     AddDescriptionForExistingCandidates(
         segments->mutable_conversion_segment(i));
@@ -37,12 +37,13 @@
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/single_kanji_dictionary.h"
+#include "rewriter/memoizing_rewriter.h"
 #include "rewriter/rewriter_interface.h"
 #include "absl/strings/string_view.h"
 
 namespace mozc {
 
-class SingleKanjiRewriter : public RewriterInterface {
+class SingleKanjiRewriter : public MemoizableRewriterInterface {
  public:
   explicit SingleKanjiRewriter(const DataManagerInterface &data_manager);
   ~SingleKanjiRewriter() override;
@@ -52,6 +53,12 @@ class SingleKanjiRewriter : public RewriterInterface {
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
+  bool IsEnabled(const ConversionRequest &request) const override;
+
+  void AppendCacheKey(const ConversionRequest &request,
+                      const Segments &segments,
+                      CacheKey *key) const override;
+
  private:
   void AddDescriptionForExistingCandidates(Segment *segment) const;
   bool InsertCandidate(bool is_single_segment, uint16_t single_kanji_id,
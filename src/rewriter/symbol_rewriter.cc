@@ -64,6 +64,9 @@ constexpr size_t kDefaultOffset = 3;
 constexpr size_t kOffsetForSymbolKey = 1;
 // Number of symbols which are inserted to first part
 constexpr size_t kMaxInsertToMedium = 15;
+
+constexpr absl::string_view kHalfWidthSpace = " ";   // U+0020
+constexpr absl::string_view kFullWidthSpace = "　";  // U+3000
 }  // namespace
 
 size_t SymbolRewriter::GetOffset(const ConversionRequest &request,
@@ -123,8 +126,6 @@ void SymbolRewriter::ExpandSpace(Segment *segment) {
     segment->insert_candidate(base + 1, std::move(c));
   };
 
-  constexpr absl::string_view kHalfWidthSpace = " ";   // U+0020
-  constexpr absl::string_view kFullWidthSpace = "　";  // U+3000
   for (size_t i = 0; i < segment->candidates_size(); ++i) {
     if (segment->candidate(i).value == kHalfWidthSpace) {
       insert_candidate(i, kFullWidthSpace);
@@ -369,12 +370,45 @@ int SymbolRewriter::capability(const ConversionRequest &request) const {
   return RewriterInterface::CONVERSION;
 }
 
-bool SymbolRewriter::Rewrite(const ConversionRequest &request,
-                             Segments *segments) const {
+bool SymbolRewriter::IsEnabled(const ConversionRequest &request) const {
   if (!request.config().use_symbol_conversion()) {
     VLOG(2) << "no use_symbol_conversion";
     return false;
   }
+  return true;
+}
+
+void SymbolRewriter::AppendCacheKey(const ConversionRequest &request,
+                                    const Segments &segments,
+                                    CacheKey *key) const {
+  key->AddInt(request.request().mixed_conversion());
+  key->AddInt(segments.resized());
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &segment = segments.conversion_segment(i);
+    key->AddString(segment.key());
+    for (size_t j = 0; j < segment.candidates_size(); ++j) {
+      const Segment::Candidate &candidate = segment.candidate(j);
+      // The top candidate gives the key and the costs of the symbols, and a
+      // space is copied by ExpandSpace().
+      if (j == 0 || candidate.value == kHalfWidthSpace ||
+          candidate.value == kFullWidthSpace) {
+        key->AddCandidate(candidate);
+        continue;
+      }
+      // The others get descriptions, and their values and attributes decide
+      // the insert position.
+      key->AddString(candidate.value);
+      key->AddString(candidate.description);
+      key->AddInt(candidate.attributes);
+    }
+  }
+}
+
+bool SymbolRewriter::Rewrite(const ConversionRequest &request,
+                             Segments *segments) const {
+  if (!IsEnabled(request)) {
+    return false;
+  }
 
   // apply entire candidate first, as we want to
   // find character combinations first, e.g.,
@@ -34,6 +34,7 @@
 #include <string>
 
 #include "data_manager/serialized_dictionary.h"
+#include "rewriter/memoizing_rewriter.h"
 #include "rewriter/rewriter_interface.h"
 // for FRIEND_TEST()
 #include "testing/gunit_prod.h"
@@ -47,7 +48,7 @@ class DataManagerInterface;
 class Segment;
 class Segments;
 
-class SymbolRewriter : public RewriterInterface {
+class SymbolRewriter : public MemoizableRewriterInterface {
  public:
   explicit SymbolRewriter(const ConverterInterface *parent_converter,
                           const DataManagerInterface *data_manager);
@@ -58,6 +59,12 @@ class SymbolRewriter : public RewriterInterface {
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
+  bool IsEnabled(const ConversionRequest &request) const override;
+
+  void AppendCacheKey(const ConversionRequest &request,
+                      const Segments &segments,
+                      CacheKey *key) const override;
+
  private:
   FRIEND_TEST(SymbolRewriterTest, TriggerRewriteEntireTest);
   FRIEND_TEST(SymbolRewriterTest, TriggerRewriteEachTest);
@@ -908,6 +908,22 @@ bool UserSegmentHistoryRewriter::RewriteNumber(Segment *segment) const {
   return SortCandidates(scores, segment);
 }
 
+size_t UserSegmentHistoryRewriter::GetRequiredCandidatesSize(
+    const ConversionRequest &request, const Segments &segments,
+    size_t segment_index) const {
+  if (!IsAvailable(request, segments) ||
+      request.config().history_learning_level() == Config::NO_HISTORY) {
+    return 0;
+  }
+  const Segment &segment = segments.segment(segment_index);
+  if (segment.segment_type() == Segment::FIXED_VALUE) {
+    return 0;
+  }
+  size_t max_candidates_size = 0;
+  ShouldRewrite(segment, &max_candidates_size);
+  return max_candidates_size;
+}
+
 bool UserSegmentHistoryRewriter::Rewrite(const ConversionRequest &request,
                                          Segments *segments) const {
   if (!IsAvailable(request, *segments)) {
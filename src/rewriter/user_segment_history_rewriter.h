@@ -53,6 +53,11 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
 
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
+  // Returns the number of candidates the segment had when the user chose one
+  // of them, so that the chosen candidate can be promoted.
+  size_t GetRequiredCandidatesSize(const ConversionRequest &request,
+                                   const Segments &segments,
+                                   size_t segment_index) const override;
 
   void Finish(const ConversionRequest &request, Segments *segments) override;
   bool Sync() override;
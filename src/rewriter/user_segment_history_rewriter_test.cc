@@ -405,6 +405,31 @@ TEST_F(UserSegmentHistoryRewriterTest, BasicTest) {
 }
 
 // Test for Issue 2155278
+TEST_F(UserSegmentHistoryRewriterTest, RequiredCandidatesSize) {
+  Segments segments;
+  std::unique_ptr<UserSegmentHistoryRewriter> rewriter(
+      CreateUserSegmentHistoryRewriter());
+  rewriter->Clear();
+
+  InitSegments(&segments, 1, 27);
+  EXPECT_EQ(rewriter->GetRequiredCandidatesSize(request_, segments, 0), 0);
+
+  // Learn the 41st candidate of 50.
+  InitSegments(&segments, 1, 50);
+  segments.mutable_segment(0)->move_candidate(40, 0);
+  segments.mutable_segment(0)->mutable_candidate(0)->attributes |=
+      Segment::Candidate::RERANKED;
+  segments.mutable_segment(0)->set_segment_type(Segment::FIXED_VALUE);
+  rewriter->Finish(request_, &segments);
+
+  // The converter needs to generate 50 candidates to promote it.
+  InitSegments(&segments, 1, 27);
+  EXPECT_EQ(rewriter->GetRequiredCandidatesSize(request_, segments, 0), 50);
+  InitSegments(&segments, 1, 50);
+  rewriter->Rewrite(request_, &segments);
+  EXPECT_EQ(segments.segment(0).candidate(0).value, "candidate40");
+}
+
 TEST_F(UserSegmentHistoryRewriterTest, SequenceTest) {
   Segments segments;
   std::unique_ptr<UserSegmentHistoryRewriter> rewriter(
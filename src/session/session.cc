@@ -40,6 +40,7 @@
 
 #include "base/clock.h"
 #include "base/logging.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/key_event_util.h"
@@ -500,6 +501,7 @@ bool Session::TestSendKey(commands::Command *command) {
 }
 
 bool Session::SendKey(commands::Command *command) {
+  const TraceSpan span("Session::SendKey");
   UpdateTime();
   UpdatePreferences(command);
   TransformInput(command->mutable_input());
@@ -1441,6 +1443,24 @@ absl::Time Session::last_command_time() const {
   return context_->last_command_time();
 }
 
+namespace {
+
+size_t GetContextFootprint(const ImeContext &context) {
+  return sizeof(ImeContext) + context.composer().GetFootprint() +
+         context.converter().GetFootprint();
+}
+
+}  // namespace
+
+size_t Session::GetFootprint() const {
+  size_t footprint = sizeof(Session) + GetContextFootprint(*context_);
+  // The undo contexts hold their own composers and converters.
+  for (const std::unique_ptr<ImeContext> &context : undo_contexts_) {
+    footprint += GetContextFootprint(*context);
+  }
+  return footprint;
+}
+
 bool Session::InsertCharacter(commands::Command *command) {
   if (!command->input().has_key()) {
     LOG(ERROR) << "No key event: " << MOZC_LOG_PROTOBUF(command->input());
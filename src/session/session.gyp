@@ -96,6 +96,7 @@
       'sources': [
         'session_handler.cc',
         'session_observer_handler.cc',
+        'session_table.cc',
       ],
       'dependencies': [
         '../base/absl.gyp:absl_strings',
@@ -264,6 +264,8 @@ class Session : public SessionInterface {
   // return 0 (default value) if no command is executed in this session.
   absl::Time last_command_time() const override;
 
+  size_t GetFootprint() const override;
+
   // TODO(komatsu): delete this function.
   // For unittest only
   mozc::composer::Composer *get_internal_composer_only_for_unittest();
@@ -38,8 +38,10 @@
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
 #include "base/logging.h"
 #include "base/text_normalizer.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/converter_interface.h"
@@ -58,10 +60,14 @@
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 ABSL_FLAG(bool, use_actual_converter_for_realtime_conversion, true,
           "If true, use the actual (non-immutable) converter for real "
           "time conversion.");
+ABSL_FLAG(int32_t, suggestion_time_budget_msec, 0,
+          "If positive, suggestion and prediction return the best results "
+          "found within this time budget in milliseconds.");
 
 namespace mozc {
 namespace session {
@@ -117,6 +123,24 @@ void SetUseActualConverterForRealtimeConversion(
       absl::GetFlag(FLAGS_use_actual_converter_for_realtime_conversion));
 }
 
+void SetSuggestionDeadline(ConversionRequest *conversion_request) {
+  const int32_t budget_msec = absl::GetFlag(FLAGS_suggestion_time_budget_msec);
+  if (budget_msec > 0) {
+    conversion_request->set_deadline(Clock::GetAbslTime() +
+                                     absl::Milliseconds(budget_msec));
+  }
+}
+
+// Conversion materializes this many pages of candidates first. The following
+// pages are generated when the focus reaches the last materialized page.
+constexpr size_t kInitialConversionCandidatePages = 3;
+
+void SetInitialConversionCandidatesSize(const Request &request,
+                                        ConversionRequest *conversion_request) {
+  conversion_request->set_initial_conversion_candidates_size(
+      kInitialConversionCandidatePages * request.candidate_page_size());
+}
+
 // Make a segment having one candidate. The value of candidate is the
 // same as the preedit.  This function can be used for error handling.
 // When the converter fails, we can call this function to make a
@@ -182,6 +206,7 @@ bool SessionConverter::ConvertWithPreferences(
   ConversionRequest conversion_request(&composer, request_, config_);
   SetConversionPreferences(preferences, segments_.get(), &conversion_request);
   SetRequestType(ConversionRequest::CONVERSION, &conversion_request);
+  SetInitialConversionCandidatesSize(*request_, &conversion_request);
 
   if (!converter_->StartConversionForRequest(conversion_request,
                                              segments_.get())) {
@@ -472,6 +497,7 @@ bool SessionConverter::SuggestWithPreferences(
                                   cursor != 0 && request_->mixed_conversion());
   // Setup request based on the above two flags.
   SetUseActualConverterForRealtimeConversion(*request_, &conversion_request);
+  SetSuggestionDeadline(&conversion_request);
   if (use_partial_composition) {
     // Auto partial suggestion should be activated only when we use all the
     // composition.
@@ -569,6 +595,7 @@ bool SessionConverter::PredictWithPreferences(
   SetConversionPreferences(preferences, segments_.get(), &conversion_request);
   SetRequestType(ConversionRequest::PREDICTION, &conversion_request);
   SetUseActualConverterForRealtimeConversion(*request_, &conversion_request);
+  SetSuggestionDeadline(&conversion_request);
 
   const bool predict_first =
       !CheckState(PREDICTION) && IsEmptySegment(previous_suggestions_);
@@ -633,6 +660,35 @@ void SessionConverter::MaybeExpandPrediction(
   UpdateSelectedCandidateIndex();
 }
 
+void SessionConverter::MaybeExpandConversion() {
+  DCHECK(CheckState(PREDICTION | CONVERSION));
+
+  // Generate the next pages of the focused segment before the focus moves out
+  // of the materialized candidates.
+  if (!CheckState(CONVERSION) || !candidate_list_->focused()) {
+    return;
+  }
+  const int focused_id = candidate_list_->focused_id();
+  const size_t page_size = candidate_list_->page_size();
+  const Segment &segment = segments_->conversion_segment(segment_index_);
+  if (focused_id < 0 || segment.candidate_generator() == nullptr ||
+      focused_id + page_size < segment.candidates_size()) {
+    return;
+  }
+
+  const ConversionRequest conversion_request(nullptr, request_, config_);
+  if (!converter_->ExpandCandidates(conversion_request, segments_.get(),
+                                    segment_index_,
+                                    kInitialConversionCandidatePages *
+                                        page_size)) {
+    return;
+  }
+
+  UpdateCandidateList();
+  candidate_list_->MoveToId(focused_id);
+  UpdateSelectedCandidateIndex();
+}
+
 void SessionConverter::Cancel() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
   ResetResult();
@@ -933,7 +989,8 @@ void SessionConverter::ResizeSegmentWidth(const composer::Composer &composer,
   }
   ResetResult();
 
-  const ConversionRequest conversion_request(&composer, request_, config_);
+  ConversionRequest conversion_request(&composer, request_, config_);
+  SetInitialConversionCandidatesSize(*request_, &conversion_request);
   if (!converter_->ResizeSegment(segments_.get(), conversion_request,
                                  segment_index_, delta)) {
     return;
@@ -978,6 +1035,7 @@ void SessionConverter::CandidateNext(const composer::Composer &composer) {
   ResetResult();
 
   MaybeExpandPrediction(composer);
+  MaybeExpandConversion();
   candidate_list_->MoveNext();
   candidate_list_visible_ = true;
   UpdateSelectedCandidateIndex();
@@ -987,6 +1045,7 @@ void SessionConverter::CandidateNext(const composer::Composer &composer) {
 void SessionConverter::CandidateNextPage() {
   DCHECK(CheckState(PREDICTION | CONVERSION));
   ResetResult();
+  MaybeExpandConversion();
 
   candidate_list_->MoveNextPage();
   candidate_list_visible_ = true;
@@ -1119,6 +1178,7 @@ void MaybeFillConfig(Segment::Candidate::Command command,
 
 void SessionConverter::FillOutput(const composer::Composer &composer,
                                   commands::Output *output) const {
+  const TraceSpan span("SessionConverter::FillOutput");
   if (!output) {
     LOG(ERROR) << "output is nullptr.";
     return;
@@ -1179,6 +1239,17 @@ void SessionConverter::SetConversionPreferences(
   request->set_enable_user_history_for_conversion(preferences.use_history);
 }
 
+size_t SessionConverter::GetFootprint() const {
+  size_t footprint = sizeof(SessionConverter) +
+                     previous_suggestions_.candidates_size() *
+                         sizeof(Segment::Candidate);
+  footprint += segments_->GetFootprint() + incognito_segments_->GetFootprint();
+  if (candidate_list_ != nullptr) {
+    footprint += candidate_list_->size() * sizeof(Candidate);
+  }
+  return footprint;
+}
+
 SessionConverter *SessionConverter::Clone() const {
   SessionConverter *session_converter =
       new SessionConverter(converter_, request_, config_);
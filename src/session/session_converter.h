@@ -259,6 +259,8 @@ class SessionConverter : public SessionConverterInterface {
     use_cascading_window_ = use_cascading_window;
   }
 
+  size_t GetFootprint() const override;
+
   // Meaning that all the composition characters are consumed.
   // c.f. CommitSuggestionInternal
   static constexpr size_t kConsumedAllCharacters =
@@ -322,6 +324,10 @@ class SessionConverter : public SessionConverterInterface {
   // call StartPrediction().
   void MaybeExpandPrediction(const composer::Composer &composer);
 
+  // If the focused candidate is on the last page of the materialized
+  // conversion candidates, generates the following ones.
+  void MaybeExpandConversion();
+
   // Returns the value of candidate to be used by the converter.
   std::string GetSelectedCandidateValue(size_t segment_index) const;
 
@@ -239,6 +239,10 @@ class SessionConverterInterface {
       config::Config::SelectionShortcut selection_shortcut) = 0;
 
   virtual void set_use_cascading_window(bool use_cascading_window) = 0;
+
+  // Returns the approximate memory held by the segments, the cached lattice
+  // and the candidate list in bytes.
+  virtual size_t GetFootprint() const = 0;
 };
 
 }  // namespace session
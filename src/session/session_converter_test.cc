@@ -65,6 +65,7 @@
 #include "transliteration/transliteration.h"
 #include "usage_stats/usage_stats.h"
 #include "usage_stats/usage_stats_testing_util.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 
 namespace mozc {
@@ -81,6 +82,7 @@ using ::testing::Mock;
 using ::testing::Pointee;
 using ::testing::Property;
 using ::testing::Return;
+using ::testing::SaveArg;
 using ::testing::SaveArgPointee;
 using ::testing::SetArgPointee;
 
@@ -139,6 +141,15 @@ class SessionConverterTest : public testing::TestWithTempUserProfile {
     *converter->segments_ = src;
   }
 
+  static void SetCandidateGenerator(
+      size_t segment_index,
+      std::unique_ptr<Segment::CandidateGenerator> generator,
+      SessionConverter *converter) {
+    CHECK(converter);
+    converter->segments_->mutable_conversion_segment(segment_index)
+        ->set_candidate_generator(std::move(generator));
+  }
+
   static const commands::Result &GetResult(const SessionConverter &converter) {
     return *converter.result_;
   }
@@ -469,6 +480,82 @@ TEST_F(SessionConverterTest, Convert) {
   EXPECT_COUNT_STATS("ConversionCandidates0", 1);
 }
 
+// The generation itself is done by the converter. SessionConverter only checks
+// whether the segment has more candidates to be generated.
+class UnusedCandidateGenerator : public Segment::CandidateGenerator {
+ public:
+  size_t Generate(const ConversionRequest &request, size_t size,
+                  Segment *segment) override {
+    return 0;
+  }
+};
+
+TEST_F(SessionConverterTest, ExpandConversionCandidatesOnLastPage) {
+  MockConverter mock_converter;
+  SessionConverter converter(&mock_converter, request_.get(), config_.get());
+  const size_t page_size = request_->candidate_page_size();
+  ConversionRequest conversion_request;
+  {
+    Segments segments;
+    Segment *segment = segments.add_segment();
+    segment->set_key(kChars_Aiueo);
+    for (size_t i = 0; i < page_size + 3; ++i) {
+      segment->add_candidate()->value = absl::StrCat(i);
+    }
+    EXPECT_CALL(mock_converter, StartConversionForRequest(_, _))
+        .WillOnce(DoAll(SaveArg<0>(&conversion_request),
+                        SetArgPointee<1>(segments), Return(true)));
+  }
+
+  composer_->InsertCharacterPreedit(kChars_Aiueo);
+  ASSERT_TRUE(converter.Convert(*composer_));
+  EXPECT_EQ(conversion_request.initial_conversion_candidates_size(),
+            3 * page_size);
+  SetCandidateGenerator(0, std::make_unique<UnusedCandidateGenerator>(),
+                        &converter);
+
+  // The focus is not on the last page yet.
+  EXPECT_CALL(mock_converter, ExpandCandidates(_, _, _, _)).Times(0);
+  converter.CandidateNextPage();
+  EXPECT_EQ(GetCandidateList(converter).focused_id(),
+            static_cast<int>(page_size));
+  Mock::VerifyAndClearExpectations(&mock_converter);
+
+  EXPECT_CALL(mock_converter, ExpandCandidates(_, _, 0, 3 * page_size))
+      .WillOnce([](const ConversionRequest &request, Segments *segments,
+                   size_t segment_index, size_t size) {
+        Segment *segment = segments->mutable_conversion_segment(segment_index);
+        const size_t begin = segment->candidates_size();
+        for (size_t i = begin; i < begin + size; ++i) {
+          segment->add_candidate()->value = absl::StrCat(i);
+        }
+        return true;
+      });
+  converter.CandidateNextPage();
+  EXPECT_EQ(GetCandidateList(converter).size(), 4 * page_size + 3);
+  EXPECT_EQ(GetCandidateList(converter).focused_id(),
+            static_cast<int>(2 * page_size));
+  const std::vector<int> expected_indices = {static_cast<int>(2 * page_size)};
+  EXPECT_SELECTED_CANDIDATE_INDICES_EQ(converter, expected_indices);
+}
+
+TEST_F(SessionConverterTest, GetFootprint) {
+  MockConverter mock_converter;
+  SessionConverter converter(&mock_converter, request_.get(), config_.get());
+  {
+    Segments segments;
+    SetAiueo(&segments);
+    FillT13Ns(&segments, composer_.get());
+    EXPECT_CALL(mock_converter, StartConversionForRequest(_, _))
+        .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+  }
+  const size_t initial_footprint = converter.GetFootprint();
+
+  composer_->InsertCharacterPreedit(kChars_Aiueo);
+  ASSERT_TRUE(converter.Convert(*composer_));
+  EXPECT_GT(converter.GetFootprint(), initial_footprint);
+}
+
 TEST_F(SessionConverterTest, ConvertWithSpellingCorrection) {
   MockConverter mock_converter;
   SessionConverter converter(&mock_converter, request_.get(), config_.get());
@@ -44,6 +44,7 @@
 #include "base/logging.h"
 #include "base/protobuf/message.h"
 #include "base/stopwatch.h"
+#include "base/trace.h"
 #include "composer/table.h"
 #include "config/character_form_manager.h"
 #include "config/config_handler.h"
@@ -63,6 +64,7 @@
 #include "session/session_observer_interface.h"
 #include "usage_stats/usage_stats.h"
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "absl/random/random.h"
 #include "absl/time/time.h"
 
@@ -103,6 +105,9 @@ ABSL_FLAG(int32_t, last_create_session_timeout, 300,
 
 ABSL_FLAG(bool, restricted, false, "Launch server with restricted setting");
 
+ABSL_FLAG(bool, enable_latency_tracing, false,
+          "Record latency trace spans, which can be dumped with GET_TRACE");
+
 namespace mozc {
 namespace {
 
@@ -155,8 +160,10 @@ void SessionHandler::Init(std::unique_ptr<EngineInterface> engine,
       std::make_unique<user_dictionary::UserDictionarySessionHandler>();
   table_manager_ = std::make_unique<composer::TableManager>();
   request_ = std::make_unique<commands::Request>();
-  config_ = config::ConfigHandler::GetConfig();
+  config_ = config::ConfigHandler::GetSharedConfig();
   key_map_manager_ = std::make_unique<keymap::KeyMapManager>(*config_);
+  config::CharacterFormManager::GetCharacterFormManager()->ReloadConfig(
+      *config_);
 
   if (absl::GetFlag(FLAGS_restricted)) {
     VLOG(1) << "Server starts with restricted mode";
@@ -172,10 +179,14 @@ void SessionHandler::Init(std::unique_ptr<EngineInterface> engine,
     absl::SetFlag(&FLAGS_last_command_timeout, 60);
   }
 
-  // allow [2..128] sessions
+  if (absl::GetFlag(FLAGS_enable_latency_tracing)) {
+    Trace::SetEnabled(true);
+  }
+
+  // allow [2..4096] sessions
   max_session_size_ =
-      std::max(2, std::min(absl::GetFlag(FLAGS_max_session_size), 128));
-  session_map_ = std::make_unique<SessionMap>(max_session_size_);
+      std::max(2, std::min(absl::GetFlag(FLAGS_max_session_size), 4096));
+  session_map_ = std::make_unique<session::SessionTable>(max_session_size_);
 
   if (!engine_) {
     return;
@@ -185,15 +196,7 @@ void SessionHandler::Init(std::unique_ptr<EngineInterface> engine,
   is_available_ = true;
 }
 
-SessionHandler::~SessionHandler() {
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
-       element != nullptr; element = element->next) {
-    delete element->value;
-    element->value = nullptr;
-  }
-  session_map_->Clear();
-}
+SessionHandler::~SessionHandler() { session_map_->Clear(); }
 
 bool SessionHandler::IsAvailable() const { return is_available_; }
 
@@ -206,43 +209,47 @@ void SessionHandler::StartWatchDog() {
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
 }
 
-void SessionHandler::UpdateSessions(const config::Config &config,
-                                    const commands::Request &request) {
-  auto new_config = std::make_unique<config::Config>(config);
-  auto new_request = std::make_unique<commands::Request>(request);
+void SessionHandler::UpdateSessions(
+    std::shared_ptr<const config::Config> config,
+    std::unique_ptr<const commands::Request> request) {
+  // The snapshot is immutable, so the derived data is still valid when the
+  // same snapshot is given again.
+  const bool config_changed = config != config_;
+  const commands::Request &new_request = request ? *request : *request_;
   const auto *data_manager = engine_->GetDataManager();
   const composer::Table *table =
       data_manager != nullptr
-          ? table_manager_->GetTable(*new_request, *new_config, *data_manager)
+          ? table_manager_->GetTable(new_request, *config, *data_manager)
           : nullptr;
   auto new_key_map_manager =
-      keymap::KeyMapManager::IsSameKeyMapManagerApplicable(*config_,
-                                                           *new_config)
+      !config_changed ||
+              keymap::KeyMapManager::IsSameKeyMapManagerApplicable(*config_,
+                                                                   *config)
           ? nullptr
-          : std::make_unique<keymap::KeyMapManager>(*new_config);
-
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
-       element != nullptr; element = element->next) {
-    if (element->value != nullptr) {
-      element->value->SetConfig(new_config.get());
-      element->value->SetKeyMapManager(
-          (new_key_map_manager ? new_key_map_manager : key_map_manager_).get());
-      element->value->SetRequest(new_request.get());
-      if (table != nullptr) {
-        element->value->SetTable(table);
-      }
+          : std::make_unique<keymap::KeyMapManager>(*config);
+
+  session_map_->ForEach([&](SessionID id, session::SessionInterface *session) {
+    session->SetConfig(config.get());
+    session->SetKeyMapManager(
+        (new_key_map_manager ? new_key_map_manager : key_map_manager_).get());
+    session->SetRequest(&new_request);
+    if (table != nullptr) {
+      session->SetTable(table);
     }
+  });
+  if (config_changed) {
+    config::CharacterFormManager::GetCharacterFormManager()->ReloadConfig(
+        *config);
   }
-  config::CharacterFormManager::GetCharacterFormManager()->ReloadConfig(
-      *new_config);
   // Now no references to the current config/key_map_manager/request
   // should exist. We can destroy them here.
-  config_ = std::move(new_config);
+  config_ = std::move(config);
   if (new_key_map_manager) {
     key_map_manager_ = std::move(new_key_map_manager);
   }
-  request_ = std::move(new_request);
+  if (request) {
+    request_ = std::move(request);
+  }
 }
 
 bool SessionHandler::SyncData(commands::Command *command) {
@@ -262,14 +269,14 @@ bool SessionHandler::Shutdown(commands::Command *command) {
 
 bool SessionHandler::Reload(commands::Command *command) {
   VLOG(1) << "Reloading server";
-  UpdateSessions(*config::ConfigHandler::GetConfig(), *request_);
+  UpdateSessions(config::ConfigHandler::GetSharedConfig(), nullptr);
   engine_->Reload();
   return true;
 }
 
 bool SessionHandler::ReloadAndWait(commands::Command *command) {
   VLOG(1) << "Reloading server and wait for reloader";
-  UpdateSessions(*config::ConfigHandler::GetConfig(), *request_);
+  UpdateSessions(config::ConfigHandler::GetSharedConfig(), nullptr);
   engine_->ReloadAndWait();
   return true;
 }
@@ -297,10 +304,12 @@ bool SessionHandler::ClearUnusedUserPrediction(commands::Command *command) {
 
 bool SessionHandler::GetConfig(commands::Command *command) {
   VLOG(1) << "Getting config";
-  config::ConfigHandler::GetConfig(command->mutable_output()->mutable_config());
+  std::shared_ptr<const config::Config> config =
+      config::ConfigHandler::GetSharedConfig();
+  *command->mutable_output()->mutable_config() = *config;
   // Ensure the onmemory config is same as the locally stored one
   // because the local data could be changed by sync.
-  UpdateSessions(command->output().config(), *request_);
+  UpdateSessions(std::move(config), nullptr);
   return true;
 }
 
@@ -324,16 +333,20 @@ bool SessionHandler::SetRequest(commands::Command *command) {
     LOG(WARNING) << "request is empty";
     return false;
   }
-  UpdateSessions(*config_, command->input().request());
+  UpdateSessions(config_, std::make_unique<commands::Request>(
+                              command->input().request()));
   return true;
 }
 
 bool SessionHandler::EvalCommand(commands::Command *command) {
+  const TraceSpan span("SessionHandler::EvalCommand");
   if (!is_available_) {
     LOG(ERROR) << "SessionHandler is not available.";
     return false;
   }
 
+  // TODO(all): Commands are evaluated serially on the IPC thread. Dispatching
+  // them to per-session executors requires the engine to be thread-safe.
   bool eval_succeeded = false;
   Stopwatch stopwatch;
   stopwatch.Start();
@@ -402,6 +415,9 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::RELOAD_SPELL_CHECKER:
       eval_succeeded = ReloadSpellChecker(command);
       break;
+    case commands::Input::GET_TRACE:
+      eval_succeeded = GetTrace(command);
+      break;
     default:
       eval_succeeded = false;
   }
@@ -452,36 +468,40 @@ void SessionHandler::MaybeUpdateConfig(commands::Command *command) {
 
 bool SessionHandler::SendKey(commands::Command *command) {
   const SessionID id = command->input().id();
-  session::SessionInterface **session = session_map_->MutableLookup(id);
-  if (session == nullptr || *session == nullptr) {
+  const std::shared_ptr<session::SessionInterface> session =
+      session_map_->Lookup(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendKey(command);
+  session->SendKey(command);
+  session_map_->UpdateFootprint(id, session->GetFootprint());
   MaybeUpdateConfig(command);
   return true;
 }
 
 bool SessionHandler::TestSendKey(commands::Command *command) {
   const SessionID id = command->input().id();
-  session::SessionInterface **session = session_map_->MutableLookup(id);
-  if (session == nullptr || *session == nullptr) {
+  const std::shared_ptr<session::SessionInterface> session =
+      session_map_->Lookup(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->TestSendKey(command);
+  session->TestSendKey(command);
   return true;
 }
 
 bool SessionHandler::SendCommand(commands::Command *command) {
   const SessionID id = command->input().id();
-  session::SessionInterface **session =
-      const_cast<session::SessionInterface **>(session_map_->Lookup(id));
-  if (session == nullptr || *session == nullptr) {
+  const std::shared_ptr<session::SessionInterface> session =
+      session_map_->Lookup(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendCommand(command);
+  session->SendCommand(command);
+  session_map_->UpdateFootprint(id, session->GetFootprint());
   MaybeUpdateConfig(command);
   return true;
 }
@@ -506,21 +526,6 @@ bool SessionHandler::CreateSession(commands::Command *command) {
 
   last_create_session_time_ = current_time;
 
-  // if session map is FULL, remove the oldest item from the LRU
-  SessionElement *oldest_element = nullptr;
-  if (session_map_->Size() >= max_session_size_) {
-    oldest_element = const_cast<SessionElement *>(session_map_->Tail());
-    if (oldest_element == nullptr) {
-      LOG(ERROR) << "oldest SessionElement is NULL";
-      return false;
-    }
-    delete oldest_element->value;
-    oldest_element->value = nullptr;
-    session_map_->Erase(oldest_element->key);
-    VLOG(1) << "Session is FULL, oldest SessionID " << oldest_element->key
-            << " is removed";
-  }
-
   // Maybe build new engine if new request is received.
   // EngineBuilder::Build just returns a future object so
   // client needs to replace the new engine when the future is the ready to use.
@@ -571,13 +576,13 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   }
 
   const SessionID new_id = CreateNewSessionID();
-  SessionElement *element = session_map_->Insert(new_id);
-  element->value = session;
+  // If the table is full, the least valuable session is evicted.
+  const SessionID evicted_id =
+      session_map_->Insert(new_id, absl::WrapUnique(session));
+  VLOG_IF(1, evicted_id != 0)
+      << "Session is FULL, SessionID " << evicted_id << " is removed";
   command->mutable_output()->set_id(new_id);
 
-  // The oldes item should be reused
-  DCHECK(oldest_element == nullptr || oldest_element == element);
-
   if (command->input().has_capability()) {
     session->set_client_capability(command->input().capability());
   }
@@ -590,7 +595,7 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   // SetConfig() will complete the initialization by setting information
   // (e.g., config, request, keymap, ...) to all the sessions,
   // including the newly created one.
-  UpdateSessions(*config::ConfigHandler::GetConfig(), *request_);
+  UpdateSessions(config::ConfigHandler::GetSharedConfig(), nullptr);
 
   // session is not empty.
   last_session_empty_time_ = absl::InfinitePast();
@@ -647,26 +652,23 @@ bool SessionHandler::Cleanup(commands::Command *command) {
                    absl::Seconds(7200)));
 
   std::vector<SessionID> remove_ids;
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
-       element != nullptr; element = element->next) {
-    session::SessionInterface *session = element->value;
+  session_map_->ForEach([&](SessionID id, session::SessionInterface *session) {
     if (!IsApplicationAlive(session)) {
-      VLOG(2) << "Application is not alive. Removing: " << element->key;
-      remove_ids.push_back(element->key);
+      VLOG(2) << "Application is not alive. Removing: " << id;
+      remove_ids.push_back(id);
     } else if (session->last_command_time() == absl::InfinitePast()) {
       // no command is exectuted
       if ((current_time - session->create_session_time()) >=
           create_session_timeout) {
-        remove_ids.push_back(element->key);
+        remove_ids.push_back(id);
       }
     } else {  // some commands are executed already
       if ((current_time - session->last_command_time()) >=
           last_command_timeout) {
-        remove_ids.push_back(element->key);
+        remove_ids.push_back(id);
       }
     }
-  }
+  });
 
   for (size_t i = 0; i < remove_ids.size(); ++i) {
     DeleteSessionID(remove_ids[i]);
@@ -728,6 +730,11 @@ bool SessionHandler::ReloadSpellChecker(commands::Command *command) {
   return true;
 }
 
+bool SessionHandler::GetTrace(commands::Command *command) {
+  command->mutable_output()->set_chrome_trace_json(Trace::GetChromeTraceJson());
+  return true;
+}
+
 // Create Random Session ID in order to make the session id unpredicable
 SessionID SessionHandler::CreateNewSessionID() {
   while (true) {
@@ -735,7 +742,7 @@ SessionID SessionHandler::CreateNewSessionID() {
     const SessionID id =
         absl::Uniform<SessionID>(absl::IntervalClosed, bitgen_, 1,
                                  std::numeric_limits<SessionID>::max());
-    if (!session_map_->HasKey(id)) {
+    if (!session_map_->Contains(id)) {
       return id;
     }
 
@@ -744,14 +751,10 @@ SessionID SessionHandler::CreateNewSessionID() {
 }
 
 bool SessionHandler::DeleteSessionID(SessionID id) {
-  session::SessionInterface **session = session_map_->MutableLookup(id);
-  if (session == nullptr || *session == nullptr) {
+  if (!session_map_->Erase(id)) {
     LOG_IF(WARNING, id != 0) << "cannot find SessionID " << id;
     return false;
   }
-  delete *session;
-
-  session_map_->Erase(id);  // remove from LRU
 
   // if session gets empty, save the timestamp
   if (last_session_empty_time_ == absl::InfinitePast() &&
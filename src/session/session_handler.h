@@ -47,9 +47,9 @@
 #include "session/internal/keymap.h"
 #include "session/session_handler_interface.h"
 #include "session/session_interface.h"
+#include "session/session_table.h"
 #include "session/session_observer_handler.h"
 #include "session/session_observer_interface.h"
-#include "storage/lru_cache.h"
 #include "testing/gunit_prod.h"  // for FRIEND_TEST()
 #include "absl/random/random.h"
 #include "absl/strings/string_view.h"
@@ -94,10 +94,6 @@ class SessionHandler : public SessionHandlerInterface {
   FRIEND_TEST(SessionHandlerTest, EngineUpdateSuccessfulScenarioTest);
   FRIEND_TEST(SessionHandlerTest, EngineRollbackDataTest);
 
-  using SessionMap =
-      mozc::storage::LruCache<SessionID, session::SessionInterface *>;
-  using SessionElement = SessionMap::Element;
-
   void Init(std::unique_ptr<EngineInterface> engine,
             std::unique_ptr<EngineBuilder> engine_builder);
 
@@ -125,11 +121,13 @@ class SessionHandler : public SessionHandlerInterface {
   // Updates all the sessions by UpdateSessions() with given |request|.
   bool SetRequest(commands::Command *command);
   // Sets the given config, request, and delivertive information
-  // to all the sessions.
+  // to all the sessions. If |request| is nullptr, the current request is kept.
+  // The derived information is rebuilt only when |config| is a different
+  // snapshot from the current one.
   // Then updates config_ and request_.
   // This method doesn't reload the sessions.
-  void UpdateSessions(const config::Config &config,
-                      const commands::Request &request);
+  void UpdateSessions(std::shared_ptr<const config::Config> config,
+                      std::unique_ptr<const commands::Request> request);
 
   bool Cleanup(commands::Command *command);
   bool SendUserDictionaryCommand(commands::Command *command);
@@ -137,11 +135,12 @@ class SessionHandler : public SessionHandlerInterface {
   bool NoOperation(commands::Command *command);
   bool CheckSpelling(commands::Command *command);
   bool ReloadSpellChecker(commands::Command *command);
+  bool GetTrace(commands::Command *command);
 
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
 
-  std::unique_ptr<SessionMap> session_map_;
+  std::unique_ptr<session::SessionTable> session_map_;
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   std::optional<SessionWatchDog> session_watch_dog_;
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
@@ -160,7 +159,8 @@ class SessionHandler : public SessionHandlerInterface {
       user_dictionary_session_handler_;
   std::unique_ptr<composer::TableManager> table_manager_;
   std::unique_ptr<const commands::Request> request_;
-  std::unique_ptr<const config::Config> config_;
+  // Immutable snapshot shared with config::ConfigHandler.
+  std::shared_ptr<const config::Config> config_;
   std::unique_ptr<keymap::KeyMapManager> key_map_manager_;
   std::unique_ptr<EngineBuilder::EngineResponseFuture> engine_response_future_;
 
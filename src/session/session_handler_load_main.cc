@@ -0,0 +1,589 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// session_handler_load_main.cc
+//
+// Load generator which drives the session layer from many simulated clients
+// at once. Each client owns its own session and replays a mixed workload of
+// typing, conversion, prediction, commit and undo with a randomized think
+// time between key strokes. At the end, per-command latency histograms and
+// the overall throughput are reported. The resident set size and the CPU load
+// are sampled periodically so that memory growth under sustained load can be
+// observed.
+//
+// Usage:
+// session_handler_load_main --clients 16 --duration 60s
+//                           --profile /tmp/mozc_load --mode inprocess
+// session_handler_load_main --clients 16 --duration 60s --mode ipc
+//                           --server_pid $(pidof mozc_server)
+//
+// In the "inprocess" mode, commands are serialized with a mutex in front of a
+// single SessionHandler, the same way SessionServer serves one IPC request at
+// a time. The "ipc" mode connects to the real server with client::Client.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/cpu_stats.h"
+#include "base/init_mozc.h"
+#include "base/japanese_util.h"
+#include "base/logging.h"
+#include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "base/thread.h"
+#include "client/client.h"
+#include "data_manager/oss/oss_data_manager.h"
+#include "engine/engine.h"
+#include "protocol/commands.pb.h"
+#include "session/random_keyevents_generator.h"
+#include "session/session_handler.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "absl/random/distributions.h"
+#include "absl/random/random.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+#ifdef __linux__
+#include <unistd.h>
+
+#include <fstream>
+#endif  // __linux__
+
+ABSL_FLAG(std::string, mode, "inprocess",
+          "Target of the load: 'inprocess' or 'ipc'");
+ABSL_FLAG(int32_t, clients, 8, "Number of simulated clients");
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(30),
+          "Duration of the load e.g. 30s, 5m");
+ABSL_FLAG(absl::Duration, think_time, absl::Milliseconds(50),
+          "Mean think time between commands. The actual think time follows "
+          "the exponential distribution. 0 disables the think time.");
+ABSL_FLAG(absl::Duration, sampling_interval, absl::Seconds(1),
+          "Interval of the throughput, RSS and CPU load sampling");
+ABSL_FLAG(std::string, profile, "", "User profile directory");
+ABSL_FLAG(std::string, server_path, "", "Server path for the 'ipc' mode");
+ABSL_FLAG(int32_t, server_pid, 0,
+          "Process ID whose RSS is sampled in the 'ipc' mode. "
+          "The load generator itself is sampled if 0.");
+ABSL_FLAG(std::optional<uint32_t>, random_seed, std::nullopt,
+          "Random seed value. This value will be interpreted as uint32_t.");
+
+ABSL_DECLARE_FLAG(int32_t, max_session_size);
+
+namespace mozc {
+namespace {
+
+enum CommandType {
+  TYPE,
+  CONVERT,
+  PREDICT,
+  COMMIT,
+  REVERT,
+  UNDO,
+  NUM_COMMAND_TYPES,
+};
+
+constexpr std::array<absl::string_view, NUM_COMMAND_TYPES> kCommandNames = {
+    "type", "convert", "predict", "commit", "revert", "undo",
+};
+
+// Latency histogram with buckets of a quarter of a power of two in
+// microseconds. The memory usage is constant regardless of the number of
+// samples, so that the histograms don't disturb the RSS measurement.
+class LatencyHistogram {
+ public:
+  void Add(absl::Duration latency) {
+    const uint64_t usec =
+        static_cast<uint64_t>(std::max<int64_t>(0, absl::ToInt64Microseconds(
+                                                       latency)));
+    ++buckets_[GetBucketIndex(usec)];
+    ++count_;
+    total_usec_ += usec;
+    max_usec_ = std::max(max_usec_, usec);
+  }
+
+  void Merge(const LatencyHistogram &other) {
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    total_usec_ += other.total_usec_;
+    max_usec_ = std::max(max_usec_, other.max_usec_);
+  }
+
+  // Returns the upper bound of the bucket containing the `ratio` percentile.
+  uint64_t GetPercentile(double ratio) const {
+    if (count_ == 0) {
+      return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(ratio * static_cast<double>(count_) + 0.5));
+    uint64_t accumulated = 0;
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+      accumulated += buckets_[i];
+      if (accumulated >= rank) {
+        return std::min(GetBucketUpperBound(i), max_usec_);
+      }
+    }
+    return max_usec_;
+  }
+
+  uint64_t count() const { return count_; }
+  uint64_t max_usec() const { return max_usec_; }
+  uint64_t mean_usec() const { return count_ == 0 ? 0 : total_usec_ / count_; }
+
+ private:
+  static constexpr size_t kNumBuckets = 256;
+
+  static size_t GetBucketIndex(uint64_t usec) {
+    if (usec < 4) {
+      return usec;
+    }
+    const int exponent = std::bit_width(usec) - 1;  // >= 2
+    const size_t sub = (usec >> (exponent - 2)) & 3;
+    return 4 * (exponent - 1) + sub;
+  }
+
+  static uint64_t GetBucketUpperBound(size_t index) {
+    if (index < 4) {
+      return index;
+    }
+    const int exponent = index / 4 + 1;
+    const uint64_t sub = index % 4;
+    return ((5 + sub) << (exponent - 2)) - 1;
+  }
+
+  std::array<uint64_t, kNumBuckets> buckets_ = {};
+  uint64_t count_ = 0;
+  uint64_t total_usec_ = 0;
+  uint64_t max_usec_ = 0;
+};
+
+using LatencyHistograms = std::array<LatencyHistogram, NUM_COMMAND_TYPES>;
+
+// A connection to the server from one simulated client.
+class LoadTargetInterface {
+ public:
+  virtual ~LoadTargetInterface() = default;
+
+  virtual bool SendKey(const commands::KeyEvent &key,
+                       commands::Output *output) = 0;
+  virtual bool SendCommand(const commands::SessionCommand &command,
+                           commands::Output *output) = 0;
+};
+
+// Serializes the commands from all the clients into one SessionHandler.
+class InProcessServer {
+ public:
+  InProcessServer()
+      : handler_(Engine::CreateDesktopEngine(
+                     std::make_unique<const oss::OssDataManager>())
+                     .value()) {}
+
+  bool EvalCommand(commands::Command *command) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    return handler_.EvalCommand(command);
+  }
+
+ private:
+  absl::Mutex mutex_;
+  SessionHandler handler_ ABSL_GUARDED_BY(mutex_);
+};
+
+class InProcessTarget : public LoadTargetInterface {
+ public:
+  explicit InProcessTarget(InProcessServer *server) : server_(server) {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::CREATE_SESSION);
+    CHECK(server_->EvalCommand(&command)) << "CREATE_SESSION failed";
+    id_ = command.output().id();
+  }
+
+  ~InProcessTarget() override {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::DELETE_SESSION);
+    command.mutable_input()->set_id(id_);
+    server_->EvalCommand(&command);
+  }
+
+  bool SendKey(const commands::KeyEvent &key,
+               commands::Output *output) override {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::SEND_KEY);
+    *command.mutable_input()->mutable_key() = key;
+    return Eval(&command, output);
+  }
+
+  bool SendCommand(const commands::SessionCommand &session_command,
+                   commands::Output *output) override {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+    *command.mutable_input()->mutable_command() = session_command;
+    return Eval(&command, output);
+  }
+
+ private:
+  bool Eval(commands::Command *command, commands::Output *output) {
+    command->mutable_input()->set_id(id_);
+    const bool result = server_->EvalCommand(command);
+    *output = std::move(*command->mutable_output());
+    return result;
+  }
+
+  InProcessServer *server_;
+  uint64_t id_ = 0;
+};
+
+class IpcTarget : public LoadTargetInterface {
+ public:
+  IpcTarget() {
+    if (!absl::GetFlag(FLAGS_server_path).empty()) {
+      client_.set_server_program(absl::GetFlag(FLAGS_server_path));
+    }
+    CHECK(client_.IsValidRunLevel()) << "IsValidRunLevel failed";
+    CHECK(client_.EnsureSession()) << "EnsureSession failed";
+  }
+
+  bool SendKey(const commands::KeyEvent &key,
+               commands::Output *output) override {
+    return client_.SendKey(key, output);
+  }
+
+  bool SendCommand(const commands::SessionCommand &command,
+                   commands::Output *output) override {
+    return client_.SendCommand(command, output);
+  }
+
+ private:
+  client::Client client_;
+};
+
+// Returns the resident set size of `pid` (0 for this process) in bytes, or
+// 0 if unavailable.
+uint64_t GetResidentSetSize(int pid) {
+#ifdef __linux__
+  const std::string path =
+      pid == 0 ? "/proc/self/statm" : absl::StrFormat("/proc/%d/statm", pid);
+  std::ifstream ifs(path);
+  uint64_t size = 0, resident = 0;
+  if (!(ifs >> size >> resident)) {
+    return 0;
+  }
+  return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else   // __linux__
+  return 0;
+#endif  // __linux__
+}
+
+std::vector<std::vector<commands::KeyEvent>> GetTestKeys() {
+  std::vector<std::vector<commands::KeyEvent>> keys;
+  for (const absl::string_view sentence :
+       session::RandomKeyEventsGenerator::GetTestSentences()) {
+    std::string romaji;
+    japanese_util::HiraganaToRomanji(sentence, &romaji);
+    std::vector<commands::KeyEvent> sequence;
+    for (const char c : romaji) {
+      if ((c >= 'a' && c <= 'z') || c == '-') {
+        commands::KeyEvent key;
+        key.set_key_code(static_cast<uint32_t>(c));
+        sequence.push_back(std::move(key));
+      }
+    }
+    if (!sequence.empty()) {
+      keys.push_back(std::move(sequence));
+    }
+  }
+  CHECK(!keys.empty());
+  return keys;
+}
+
+commands::KeyEvent SpecialKey(commands::KeyEvent::SpecialKey special_key) {
+  commands::KeyEvent key;
+  key.set_special_key(special_key);
+  return key;
+}
+
+class SimulatedClient {
+ public:
+  SimulatedClient(LoadTargetInterface *target,
+                  absl::Span<const std::vector<commands::KeyEvent>> test_keys,
+                  uint32_t seed, std::atomic<uint64_t> *num_commands)
+      : target_(target),
+        test_keys_(test_keys),
+        bitgen_(std::seed_seq{seed}),
+        num_commands_(num_commands) {}
+
+  // Replays utterances until `deadline`.
+  void Run(absl::Time deadline) {
+    commands::Output output;
+    target_->SendKey(SpecialKey(commands::KeyEvent::ON), &output);
+    while (absl::Now() < deadline) {
+      RunUtterance();
+    }
+  }
+
+  const LatencyHistograms &histograms() const { return histograms_; }
+  uint64_t num_failures() const { return num_failures_; }
+
+ private:
+  // Types one sentence and finishes it with one of the conversion flows.
+  void RunUtterance() {
+    const std::vector<commands::KeyEvent> &keys =
+        test_keys_[absl::Uniform<size_t>(bitgen_, 0, test_keys_.size())];
+    for (const commands::KeyEvent &key : keys) {
+      SendKey(TYPE, key);
+    }
+
+    const double dice = absl::Uniform<double>(bitgen_, 0.0, 1.0);
+    if (dice < 0.5) {
+      // Converts and optionally moves to the next candidates.
+      SendKey(CONVERT, SpecialKey(commands::KeyEvent::SPACE));
+      const int num_next = absl::Uniform<int>(bitgen_, 0, 3);
+      for (int i = 0; i < num_next; ++i) {
+        SendKey(CONVERT, SpecialKey(commands::KeyEvent::SPACE));
+      }
+      SendKey(COMMIT, SpecialKey(commands::KeyEvent::ENTER));
+    } else if (dice < 0.75) {
+      SendKey(PREDICT, SpecialKey(commands::KeyEvent::TAB));
+      SendKey(COMMIT, SpecialKey(commands::KeyEvent::ENTER));
+    } else if (dice < 0.9) {
+      SendKey(COMMIT, SpecialKey(commands::KeyEvent::ENTER));
+    } else {
+      commands::SessionCommand command;
+      command.set_type(commands::SessionCommand::REVERT);
+      SendCommand(REVERT, command);
+      return;
+    }
+
+    if (absl::Bernoulli(bitgen_, 0.1)) {
+      commands::SessionCommand command;
+      command.set_type(commands::SessionCommand::UNDO);
+      SendCommand(UNDO, command);
+      // Discards the restored preedit.
+      command.set_type(commands::SessionCommand::REVERT);
+      SendCommand(REVERT, command);
+    }
+  }
+
+  void SendKey(CommandType type, const commands::KeyEvent &key) {
+    Think();
+    const Stopwatch stopwatch = Stopwatch::StartNew();
+    const bool result = target_->SendKey(key, &output_);
+    Record(type, stopwatch.GetElapsed(), result);
+  }
+
+  void SendCommand(CommandType type, const commands::SessionCommand &command) {
+    Think();
+    const Stopwatch stopwatch = Stopwatch::StartNew();
+    const bool result = target_->SendCommand(command, &output_);
+    Record(type, stopwatch.GetElapsed(), result);
+  }
+
+  void Record(CommandType type, absl::Duration latency, bool result) {
+    histograms_[type].Add(latency);
+    if (!result) {
+      ++num_failures_;
+    }
+    num_commands_->fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void Think() {
+    const absl::Duration mean = absl::GetFlag(FLAGS_think_time);
+    if (mean <= absl::ZeroDuration()) {
+      return;
+    }
+    absl::SleepFor(mean * absl::Exponential<double>(bitgen_));
+  }
+
+  LoadTargetInterface *target_;
+  absl::Span<const std::vector<commands::KeyEvent>> test_keys_;
+  absl::BitGen bitgen_;
+  std::atomic<uint64_t> *num_commands_;
+  commands::Output output_;
+  LatencyHistograms histograms_;
+  uint64_t num_failures_ = 0;
+};
+
+std::string FormatMiB(uint64_t bytes) {
+  return absl::StrFormat("%.1fMiB", static_cast<double>(bytes) / (1 << 20));
+}
+
+int Run() {
+  const std::string mode = absl::GetFlag(FLAGS_mode);
+  const int num_clients = std::max(1, absl::GetFlag(FLAGS_clients));
+  const absl::Duration duration = absl::GetFlag(FLAGS_duration);
+  const absl::Duration sampling_interval =
+      std::max(absl::GetFlag(FLAGS_sampling_interval), absl::Milliseconds(10));
+  const uint32_t seed =
+      absl::GetFlag(FLAGS_random_seed).value_or(std::random_device()());
+  const int rss_pid = mode == "ipc" ? absl::GetFlag(FLAGS_server_pid) : 0;
+
+  std::unique_ptr<InProcessServer> server;
+  if (mode == "inprocess") {
+    absl::SetFlag(&FLAGS_max_session_size,
+                  std::max(absl::GetFlag(FLAGS_max_session_size), num_clients));
+    server = std::make_unique<InProcessServer>();
+  } else if (mode != "ipc") {
+    std::cerr << "ERROR: Unknown mode: " << mode << std::endl;
+    return 1;
+  }
+
+  const std::vector<std::vector<commands::KeyEvent>> test_keys = GetTestKeys();
+  std::vector<std::unique_ptr<LoadTargetInterface>> targets;
+  std::vector<std::unique_ptr<SimulatedClient>> clients;
+  std::atomic<uint64_t> num_commands = 0;
+  for (int i = 0; i < num_clients; ++i) {
+    if (server) {
+      targets.push_back(std::make_unique<InProcessTarget>(server.get()));
+    } else {
+      targets.push_back(std::make_unique<IpcTarget>());
+    }
+    clients.push_back(std::make_unique<SimulatedClient>(
+        targets.back().get(), test_keys, seed + i, &num_commands));
+  }
+
+  std::cout << absl::StrFormat("mode=%s clients=%d duration=%s seed=%d", mode,
+                               num_clients, absl::FormatDuration(duration),
+                               seed)
+            << std::endl;
+
+  const uint64_t initial_rss = GetResidentSetSize(rss_pid);
+  const absl::Time start = absl::Now();
+  const absl::Time deadline = start + duration;
+  std::vector<Thread> threads;
+  threads.reserve(num_clients);
+  for (const std::unique_ptr<SimulatedClient> &client : clients) {
+    threads.emplace_back(
+        [&client = *client, deadline] { client.Run(deadline); });
+  }
+
+  // Samples the throughput, RSS and CPU load until the deadline.
+  CPUStats cpu_stats;
+  uint64_t last_num_commands = 0;
+  uint64_t peak_rss = initial_rss;
+  absl::Time last_time = start;
+  while (absl::Now() < deadline) {
+    absl::SleepFor(std::min(sampling_interval, deadline - absl::Now()));
+    const absl::Time now = absl::Now();
+    const uint64_t current_commands = num_commands.load();
+    const uint64_t rss = GetResidentSetSize(rss_pid);
+    peak_rss = std::max(peak_rss, rss);
+    std::cout << absl::StrFormat(
+                     "time=%s commands=%d qps=%.1f rss=%s cpu=%.2f",
+                     absl::FormatDuration(absl::Trunc(now - start,
+                                                      absl::Milliseconds(1))),
+                     current_commands,
+                     (current_commands - last_num_commands) /
+                         absl::ToDoubleSeconds(now - last_time),
+                     FormatMiB(rss), cpu_stats.GetCurrentProcessCPULoad())
+              << std::endl;
+    last_num_commands = current_commands;
+    last_time = now;
+  }
+
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  const absl::Duration elapsed = absl::Now() - start;
+  const uint64_t final_rss = GetResidentSetSize(rss_pid);
+
+  LatencyHistograms histograms;
+  LatencyHistogram total;
+  uint64_t num_failures = 0;
+  for (const std::unique_ptr<SimulatedClient> &client : clients) {
+    for (size_t i = 0; i < NUM_COMMAND_TYPES; ++i) {
+      histograms[i].Merge(client->histograms()[i]);
+      total.Merge(client->histograms()[i]);
+    }
+    num_failures += client->num_failures();
+  }
+
+  std::cout << std::endl
+            << absl::StrFormat(
+                   "total commands=%d failures=%d throughput=%.1fqps",
+                   total.count(), num_failures,
+                   total.count() / absl::ToDoubleSeconds(elapsed))
+            << std::endl;
+  std::cout << absl::StrFormat("rss initial=%s final=%s peak=%s growth=%s",
+                               FormatMiB(initial_rss), FormatMiB(final_rss),
+                               FormatMiB(peak_rss),
+                               FormatMiB(final_rss - std::min(initial_rss,
+                                                              final_rss)))
+            << std::endl;
+  std::cout << "latency (usec)" << std::endl;
+  const auto print_histogram = [](absl::string_view name,
+                                  const LatencyHistogram &histogram) {
+    std::cout << absl::StrFormat(
+                     "  %-8s count=%d mean=%d p50=%d p90=%d p99=%d p999=%d "
+                     "max=%d",
+                     name, histogram.count(), histogram.mean_usec(),
+                     histogram.GetPercentile(0.5), histogram.GetPercentile(0.9),
+                     histogram.GetPercentile(0.99),
+                     histogram.GetPercentile(0.999), histogram.max_usec())
+              << std::endl;
+  };
+  for (size_t i = 0; i < NUM_COMMAND_TYPES; ++i) {
+    print_histogram(kCommandNames[i], histograms[i]);
+  }
+  print_histogram("all", total);
+
+  // Deletes the sessions before the server.
+  clients.clear();
+  targets.clear();
+  return 0;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+  if (!absl::GetFlag(FLAGS_profile).empty()) {
+    mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_profile));
+  }
+  return mozc::Run();
+}
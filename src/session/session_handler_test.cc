@@ -41,6 +41,7 @@
 #include "base/clock.h"
 #include "base/clock_mock.h"
 #include "base/thread.h"
+#include "base/trace.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "engine/engine.h"
@@ -62,6 +63,7 @@
 #include "absl/flags/declare.h"
 #include "absl/flags/flag.h"
 #include "absl/random/random.h"
+#include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
@@ -423,6 +425,25 @@ TEST_F(SessionHandlerTest, ElapsedTimeTest) {
   Clock::SetClockForUnitTest(nullptr);
 }
 
+TEST_F(SessionHandlerTest, GetTraceTest) {
+  SessionHandler handler(CreateMockDataEngine());
+  Trace::Clear();
+  Trace::SetEnabled(true);
+
+  uint64_t id = 0;
+  EXPECT_TRUE(CreateSession(&handler, &id));
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_TRACE);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  Trace::SetEnabled(false);
+
+  const std::string &json = command.output().chrome_trace_json();
+  EXPECT_TRUE(absl::StrContains(json, "\"traceEvents\""));
+  EXPECT_TRUE(absl::StrContains(json, "\"SessionHandler::EvalCommand\""));
+  Trace::Clear();
+}
+
 TEST_F(SessionHandlerTest, ConfigTest) {
   config::Config config;
   config::ConfigHandler::GetConfig(&config);
@@ -32,6 +32,8 @@
 #ifndef MOZC_SESSION_SESSION_INTERFACE_H_
 #define MOZC_SESSION_SESSION_INTERFACE_H_
 
+#include <cstddef>
+
 #include "composer/table.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
@@ -88,6 +90,11 @@ class SessionInterface {
   // return absl::InfinitePast (default value) if no command is executed in this
   // session.
   virtual absl::Time last_command_time() const = 0;
+
+  // Returns the approximate memory held by this session in bytes, which is
+  // used to pick sessions to evict. It must be cheap enough to call after
+  // every command.
+  virtual size_t GetFootprint() const { return 0; }
 };
 
 }  // namespace session
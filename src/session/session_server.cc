@@ -37,6 +37,7 @@
 #include <string>
 
 #include "base/logging.h"
+#include "base/trace.h"
 #include "engine/engine_factory.h"
 #include "ipc/ipc.h"
 #include "ipc/named_event.h"
@@ -87,6 +88,7 @@ bool SessionServer::Connected() const {
 }
 
 bool SessionServer::Process(absl::string_view request, std::string *response) {
+  const TraceSpan span("IPCServer::Process");
   if (!session_handler_) {
     LOG(WARNING) << "handler is not available";
     return false;  // shutdown the server if handler doesn't exist
@@ -0,0 +1,181 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/session_table.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "base/clock.h"
+#include "base/logging.h"
+#include "session/common.h"
+#include "session/session_interface.h"
+#include "absl/functional/function_ref.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+// The footprint is counted in this unit when weighting the idle time.
+constexpr size_t kFootprintUnit = 16 * 1024;
+
+// Returns the eviction score of a session. Larger is evicted first.
+double GetEvictionScore(const absl::Time now, const absl::Time last_access_time,
+                        const size_t footprint) {
+  const double idle_sec =
+      absl::ToDoubleSeconds(std::max(now - last_access_time, absl::Duration()));
+  return idle_sec * (1.0 + static_cast<double>(footprint) / kFootprintUnit);
+}
+
+}  // namespace
+
+SessionTable::SessionTable(size_t max_size) : max_size_(max_size) {
+  DCHECK_GT(max_size_, 0);
+}
+
+std::shared_ptr<SessionInterface> SessionTable::Lookup(const SessionID id) {
+  Shard &shard = GetShard(id);
+  absl::MutexLock l(&shard.mutex);
+  const auto it = shard.index.find(id);
+  if (it == shard.index.end()) {
+    return nullptr;
+  }
+  it->second->last_access_time = Clock::GetAbslTime();
+  it->second->access_sequence = NextAccessSequence();
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  return it->second->session;
+}
+
+bool SessionTable::Contains(const SessionID id) const {
+  const Shard &shard = GetShard(id);
+  absl::MutexLock l(&shard.mutex);
+  return shard.index.contains(id);
+}
+
+SessionID SessionTable::Insert(const SessionID id,
+                               std::unique_ptr<SessionInterface> session) {
+  const SessionID evicted_id = Size() >= max_size_ ? EvictOne() : 0;
+
+  Shard &shard = GetShard(id);
+  absl::MutexLock l(&shard.mutex);
+  DCHECK(!shard.index.contains(id)) << "Duplicated SessionID " << id;
+  shard.lru.push_front(Entry{.id = id,
+                             .session = std::move(session),
+                             .last_access_time = Clock::GetAbslTime(),
+                             .access_sequence = NextAccessSequence()});
+  shard.index[id] = shard.lru.begin();
+  size_.fetch_add(1, std::memory_order_relaxed);
+  return evicted_id;
+}
+
+bool SessionTable::Erase(const SessionID id) {
+  std::shared_ptr<SessionInterface> session;
+  {
+    Shard &shard = GetShard(id);
+    absl::MutexLock l(&shard.mutex);
+    const auto it = shard.index.find(id);
+    if (it == shard.index.end()) {
+      return false;
+    }
+    // Destroys the session outside of the lock.
+    session = std::move(it->second->session);
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+void SessionTable::UpdateFootprint(const SessionID id, const size_t footprint) {
+  Shard &shard = GetShard(id);
+  absl::MutexLock l(&shard.mutex);
+  if (const auto it = shard.index.find(id); it != shard.index.end()) {
+    it->second->footprint = footprint;
+  }
+}
+
+void SessionTable::ForEach(
+    absl::FunctionRef<void(SessionID, SessionInterface *)> callback) const {
+  for (const Shard &shard : shards_) {
+    absl::MutexLock l(&shard.mutex);
+    for (const Entry &entry : shard.lru) {
+      callback(entry.id, entry.session.get());
+    }
+  }
+}
+
+void SessionTable::Clear() {
+  for (Shard &shard : shards_) {
+    std::list<Entry> lru;
+    {
+      absl::MutexLock l(&shard.mutex);
+      size_.fetch_sub(shard.lru.size(), std::memory_order_relaxed);
+      shard.index.clear();
+      lru.swap(shard.lru);
+    }
+  }
+}
+
+SessionID SessionTable::EvictOne() {
+  const absl::Time now = Clock::GetAbslTime();
+
+  // Picks the victim among the least recently used sessions of the shards.
+  // Ties, e.g. when the clock doesn't advance, go to the least recently used.
+  SessionID victim_id = 0;
+  double victim_score = -1.0;
+  uint64_t victim_sequence = UINT64_MAX;
+  for (const Shard &shard : shards_) {
+    absl::MutexLock l(&shard.mutex);
+    if (shard.lru.empty()) {
+      continue;
+    }
+    const Entry &entry = shard.lru.back();
+    const double score =
+        GetEvictionScore(now, entry.last_access_time, entry.footprint);
+    if (score > victim_score ||
+        (score == victim_score && entry.access_sequence < victim_sequence)) {
+      victim_id = entry.id;
+      victim_score = score;
+      victim_sequence = entry.access_sequence;
+    }
+  }
+  if (victim_id == 0 || !Erase(victim_id)) {
+    return 0;
+  }
+  return victim_id;
+}
+
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,137 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_SESSION_SESSION_TABLE_H_
+#define MOZC_SESSION_SESSION_TABLE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+
+#include "session/common.h"
+#include "session/session_interface.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace session {
+
+// Thread-safe table of sessions keyed by SessionID.
+//
+// Sessions are distributed over shards by their IDs. Each shard has its own
+// lock and LRU list, so operations on sessions in different shards don't
+// contend with each other.
+//
+// When the table is full, Insert() evicts one of the least recently used
+// sessions of the shards. The candidates are compared by their idle time
+// weighted by the memory footprint reported by UpdateFootprint(), so a large
+// idle session is evicted before a small one that has been idle as long.
+class SessionTable {
+ public:
+  static constexpr size_t kNumShards = 16;
+
+  explicit SessionTable(size_t max_size);
+  SessionTable(const SessionTable &) = delete;
+  SessionTable &operator=(const SessionTable &) = delete;
+
+  static size_t ShardIndex(SessionID id) { return id % kNumShards; }
+
+  // Returns the session for `id` and marks it as the most recently used one.
+  // Returns nullptr if not found. The returned session stays valid even if it
+  // is erased from the table concurrently.
+  std::shared_ptr<SessionInterface> Lookup(SessionID id);
+
+  bool Contains(SessionID id) const;
+
+  // Inserts `session` for a new `id`. If the table is full, evicts a session
+  // first and returns its ID. Otherwise returns 0. Concurrent insertions may
+  // exceed max_size() by the number of the inserting threads.
+  SessionID Insert(SessionID id, std::unique_ptr<SessionInterface> session);
+
+  // Removes the session for `id`. Returns false if not found.
+  bool Erase(SessionID id);
+
+  // Records the approximate memory footprint of the session in bytes.
+  void UpdateFootprint(SessionID id, size_t footprint);
+
+  // Calls `callback` for all the sessions. The callback must not modify the
+  // table.
+  void ForEach(absl::FunctionRef<void(SessionID, SessionInterface *)> callback)
+      const;
+
+  void Clear();
+
+  size_t Size() const { return size_.load(std::memory_order_relaxed); }
+  size_t max_size() const { return max_size_; }
+
+ private:
+  struct Entry {
+    SessionID id;
+    std::shared_ptr<SessionInterface> session;
+    absl::Time last_access_time;
+    // Orders accesses even when the clock doesn't advance.
+    uint64_t access_sequence = 0;
+    size_t footprint = 0;
+  };
+
+  // The LRU list of a shard. The front is the most recently used.
+  struct Shard {
+    mutable absl::Mutex mutex;
+    std::list<Entry> lru ABSL_GUARDED_BY(mutex);
+    absl::flat_hash_map<SessionID, std::list<Entry>::iterator> index
+        ABSL_GUARDED_BY(mutex);
+  };
+
+  uint64_t NextAccessSequence() {
+    return access_sequence_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Shard &GetShard(SessionID id) { return shards_[ShardIndex(id)]; }
+  const Shard &GetShard(SessionID id) const { return shards_[ShardIndex(id)]; }
+
+  // Evicts one session and returns its ID, or 0 if the table is empty.
+  SessionID EvictOne();
+
+  const size_t max_size_;
+  std::atomic<size_t> size_ = 0;
+  std::atomic<uint64_t> access_sequence_ = 0;
+  std::array<Shard, kNumShards> shards_;
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_SESSION_TABLE_H_
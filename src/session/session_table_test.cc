@@ -0,0 +1,202 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/session_table.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "base/clock.h"
+#include "base/clock_mock.h"
+#include "base/thread.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "session/common.h"
+#include "session/session_interface.h"
+#include "testing/gunit.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+class FakeSession : public SessionInterface {
+ public:
+  explicit FakeSession(std::atomic<int> *num_alive = nullptr)
+      : num_alive_(num_alive) {
+    if (num_alive_ != nullptr) {
+      ++*num_alive_;
+    }
+  }
+  ~FakeSession() override {
+    if (num_alive_ != nullptr) {
+      --*num_alive_;
+    }
+  }
+
+  bool SendKey(commands::Command *command) override { return true; }
+  bool TestSendKey(commands::Command *command) override { return true; }
+  bool SendCommand(commands::Command *command) override { return true; }
+  void SetConfig(const config::Config *config) override {}
+  void set_client_capability(const commands::Capability &capability) override {
+  }
+  void set_application_info(
+      const commands::ApplicationInfo &application_info) override {}
+  const commands::ApplicationInfo &application_info() const override {
+    return commands::ApplicationInfo::default_instance();
+  }
+  absl::Time create_session_time() const override {
+    return absl::InfinitePast();
+  }
+  absl::Time last_command_time() const override { return absl::InfinitePast(); }
+
+ private:
+  std::atomic<int> *num_alive_;
+};
+
+class SessionTableTest : public ::testing::Test {
+ protected:
+  SessionTableTest() : clock_(absl::FromUnixSeconds(1000)) {
+    Clock::SetClockForUnitTest(&clock_);
+  }
+  ~SessionTableTest() override { Clock::SetClockForUnitTest(nullptr); }
+
+  ClockMock clock_;
+};
+
+TEST_F(SessionTableTest, InsertLookupErase) {
+  std::atomic<int> num_alive = 0;
+  SessionTable table(8);
+  EXPECT_EQ(table.Size(), 0);
+  EXPECT_EQ(table.Lookup(1), nullptr);
+
+  EXPECT_EQ(table.Insert(1, std::make_unique<FakeSession>(&num_alive)), 0);
+  EXPECT_EQ(table.Insert(17, std::make_unique<FakeSession>(&num_alive)), 0);
+  EXPECT_EQ(table.Size(), 2);
+  EXPECT_TRUE(table.Contains(1));
+  EXPECT_TRUE(table.Contains(17));
+  EXPECT_FALSE(table.Contains(2));
+  EXPECT_NE(table.Lookup(17), nullptr);
+
+  // A session looked up before is kept alive until released.
+  std::shared_ptr<SessionInterface> session = table.Lookup(1);
+  EXPECT_TRUE(table.Erase(1));
+  EXPECT_FALSE(table.Erase(1));
+  EXPECT_FALSE(table.Contains(1));
+  EXPECT_EQ(table.Size(), 1);
+  EXPECT_EQ(num_alive, 2);
+  session.reset();
+  EXPECT_EQ(num_alive, 1);
+
+  table.Clear();
+  EXPECT_EQ(table.Size(), 0);
+  EXPECT_EQ(num_alive, 0);
+}
+
+TEST_F(SessionTableTest, ForEach) {
+  SessionTable table(8);
+  for (SessionID id = 1; id <= 5; ++id) {
+    table.Insert(id, std::make_unique<FakeSession>());
+  }
+  SessionID sum = 0;
+  table.ForEach([&sum](SessionID id, SessionInterface *session) {
+    EXPECT_NE(session, nullptr);
+    sum += id;
+  });
+  EXPECT_EQ(sum, 15);
+}
+
+TEST_F(SessionTableTest, EvictLeastRecentlyUsed) {
+  SessionTable table(3);
+  // IDs are in the same shard and in different shards.
+  EXPECT_EQ(table.Insert(1, std::make_unique<FakeSession>()), 0);
+  EXPECT_EQ(table.Insert(2, std::make_unique<FakeSession>()), 0);
+  EXPECT_EQ(table.Insert(17, std::make_unique<FakeSession>()), 0);
+
+  // The clock doesn't advance, so the access order decides.
+  table.Lookup(1);
+  EXPECT_EQ(table.Insert(3, std::make_unique<FakeSession>()), 2);
+  EXPECT_EQ(table.Size(), 3);
+  EXPECT_FALSE(table.Contains(2));
+
+  clock_.Advance(absl::Seconds(10));
+  table.Lookup(17);
+  table.Lookup(3);
+  EXPECT_EQ(table.Insert(4, std::make_unique<FakeSession>()), 1);
+  EXPECT_EQ(table.Size(), 3);
+}
+
+TEST_F(SessionTableTest, EvictLargeIdleSessionFirst) {
+  SessionTable table(2);
+  table.Insert(1, std::make_unique<FakeSession>());
+  clock_.Advance(absl::Seconds(1));
+  table.Insert(2, std::make_unique<FakeSession>());
+  clock_.Advance(absl::Seconds(1));
+
+  // Session 1 is idle longer, but session 2 holds much more memory.
+  table.UpdateFootprint(2, 1024 * 1024);
+  EXPECT_EQ(table.Insert(3, std::make_unique<FakeSession>()), 2);
+  EXPECT_TRUE(table.Contains(1));
+}
+
+TEST_F(SessionTableTest, ConcurrentAccess) {
+  constexpr int kNumThreads = 8;
+  constexpr SessionID kNumIdsPerThread = 200;
+  std::atomic<int> num_alive = 0;
+  SessionTable table(64);
+
+  std::vector<Thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&table, &num_alive, i] {
+      for (SessionID j = 0; j < kNumIdsPerThread; ++j) {
+        const SessionID id = i * kNumIdsPerThread + j + 1;
+        table.Insert(id, std::make_unique<FakeSession>(&num_alive));
+        table.UpdateFootprint(id, j);
+        table.Lookup(id);
+        if (j % 2 == 0) {
+          table.Erase(id);
+        }
+      }
+    });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+
+  EXPECT_EQ(num_alive, table.Size());
+  table.Clear();
+  EXPECT_EQ(num_alive, 0);
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
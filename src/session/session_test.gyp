@@ -98,6 +98,7 @@
       'type': 'executable',
       'sources': [
         'session_handler_test.cc',
+        'session_table_test.cc',
       ],
       'dependencies': [
         '../base/base_test.gyp:clock_mock',
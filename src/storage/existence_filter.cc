@@ -34,6 +34,7 @@
 #include <cstdint>
 #include <cstring>
 #include <iterator>
+#include <limits>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -116,7 +117,18 @@ BlockBitmap BlockBitmapBuilder::Build() const {
 
 namespace {
 
+using ::mozc::storage::existence_filter_internal::kFilterBlockBits;
+using ::mozc::storage::existence_filter_internal::kFilterBlockShift;
+
 constexpr uint32_t kHeaderSize = 3;
+// The header of the blocked format is padded to a block, so that the blocks
+// are aligned to cache lines when the data is aligned to 512 bits.
+constexpr uint32_t kBlockedHeaderSize = kFilterBlockBits / 32;
+
+// The third word of the header holds the number of hashes in the lowest byte
+// and the format above it. The old data have format 0 (kModulo).
+constexpr int kFormatShift = 8;
+constexpr uint32_t kNumHashesMask = (1 << kFormatShift) - 1;
 
 absl::StatusOr<ExistenceFilterParams> ReadHeader(
     absl::Span<const uint32_t> buf) {
@@ -129,13 +141,32 @@ absl::StatusOr<ExistenceFilterParams> ReadHeader(
   ExistenceFilterParams params;
   params.size = *it++;
   params.expected_nelts = *it++;
-  params.num_hashes = *it++;
+  const uint32_t hashes_and_format = *it++;
+  params.num_hashes = hashes_and_format & kNumHashesMask;
   if (params.num_hashes >= 8 || params.num_hashes <= 0) {
     return absl::InvalidArgumentError("Bad number of hashes (header.k)");
   }
+  switch (hashes_and_format >> kFormatShift) {
+    case static_cast<uint32_t>(ExistenceFilterFormat::kModulo):
+      params.format = ExistenceFilterFormat::kModulo;
+      break;
+    case static_cast<uint32_t>(ExistenceFilterFormat::kBlocked):
+      params.format = ExistenceFilterFormat::kBlocked;
+      if (params.size == 0 || params.size % kFilterBlockBits != 0) {
+        return absl::InvalidArgumentError("Bad size for the blocked format");
+      }
+      break;
+    default:
+      return absl::InvalidArgumentError("Unknown format");
+  }
   return params;
 }
 
+constexpr uint32_t GetHeaderSize(ExistenceFilterFormat format) {
+  return format == ExistenceFilterFormat::kBlocked ? kBlockedHeaderSize
+                                                   : kHeaderSize;
+}
+
 constexpr uint32_t BitsToWords(uint32_t bits) {
   uint32_t words = (bits + 31) >> 5;
   if (bits > 0 && words == 0) {
@@ -144,6 +175,76 @@ constexpr uint32_t BitsToWords(uint32_t bits) {
   return words;
 }
 
+int GetOptimalNumHashes(uint32_t m, uint32_t n) {
+  const int optimal_k =
+      static_cast<int>((static_cast<float>(m) / n * log(2.0)) + 0.5);
+  return std::clamp(optimal_k, 1, 7);
+}
+
+// Returns the 512-bit block of `hash` in the blocked format. Uses the upper
+// 32 bits with multiply-shift, i.e., maps them to [0, num_blocks).
+inline uint32_t GetFilterBlockIndex(uint64_t hash, uint32_t num_blocks) {
+  return static_cast<uint32_t>(((hash >> 32) * num_blocks) >> 32);
+}
+
+// Returns the bit position of the i-th probe within the block. Each probe
+// multiplies the lower 32 bits by a different odd constant and takes the top
+// 9 bits.
+inline uint32_t GetBitInFilterBlock(uint64_t hash, int i) {
+  static constexpr uint32_t kMultipliers[7] = {
+      0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+      0x705495c7U, 0x2df1424bU, 0x9efc4947U,
+  };
+  return (static_cast<uint32_t>(hash) * kMultipliers[i]) >>
+         (32 - kFilterBlockShift);
+}
+
+// Returns the false positive rate of the blocked format. The number of
+// elements in a block follows the Poisson distribution, and each block is a
+// small Bloom filter.
+double GetBlockedFalsePositiveRate(uint32_t num_blocks, size_t num_elements,
+                                   int num_hashes) {
+  const double lambda = static_cast<double>(num_elements) / num_blocks;
+  const double max_j = lambda + 10 * std::sqrt(lambda) + 10;
+  double rate = 0.0;
+  for (int j = 0; j <= max_j; ++j) {
+    const double log_poisson =
+        -lambda + j * std::log(lambda) - std::lgamma(j + 1);
+    const double bit_unset =
+        std::pow(1.0 - 1.0 / kFilterBlockBits, num_hashes * j);
+    rate += std::exp(log_poisson) * std::pow(1.0 - bit_unset, num_hashes);
+  }
+  return rate;
+}
+
+size_t MinBlockedFilterSizeInBytesForErrorRate(float error_rate,
+                                               size_t num_elements) {
+  if (num_elements == 0) {
+    return kFilterBlockBits / 8;
+  }
+  auto satisfies = [&](uint32_t num_blocks) {
+    const int k =
+        GetOptimalNumHashes(num_blocks * kFilterBlockBits, num_elements);
+    return GetBlockedFalsePositiveRate(num_blocks, num_elements, k) <=
+           error_rate;
+  };
+  // The smallest number of blocks is found by doubling and bisection.
+  uint32_t hi = 1;
+  while (!satisfies(hi) && hi < (1 << 22)) {
+    hi *= 2;
+  }
+  uint32_t lo = hi / 2;
+  while (lo + 1 < hi) {
+    const uint32_t mid = lo + (hi - lo) / 2;
+    if (satisfies(mid)) {
+      hi = mid;
+    } else {
+      lo = mid;
+    }
+  }
+  return static_cast<size_t>(hi) * kFilterBlockBits / 8;
+}
+
 }  // namespace
 
 std::ostream& operator<<(std::ostream& os,
@@ -153,6 +254,9 @@ std::ostream& operator<<(std::ostream& os,
 }
 
 bool ExistenceFilter::Exists(uint64_t hash) const {
+  if (params_.format == ExistenceFilterFormat::kBlocked) {
+    return ExistsInBlock(hash);
+  }
   for (int i = 0; i < params_.num_hashes; ++i) {
     hash = absl::rotl(hash, 8);
     const uint32_t index = hash % params_.size;
@@ -163,6 +267,22 @@ bool ExistenceFilter::Exists(uint64_t hash) const {
   return true;
 }
 
+bool ExistenceFilter::ExistsInBlock(uint64_t hash) const {
+  const uint32_t block =
+      GetFilterBlockIndex(hash, params_.size >> kFilterBlockShift);
+  const uint32_t *words = rep_.GetWords(block << kFilterBlockShift);
+  // All the probes read the same cache line, so only the first one can miss
+  // the cache. Testing them one by one with early exit was faster than
+  // building a 512-bit mask and comparing the block at once.
+  for (int i = 0; i < params_.num_hashes; ++i) {
+    const uint32_t bit = GetBitInFilterBlock(hash, i);
+    if (!((words[bit >> 5] >> (bit & 31)) & 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 absl::StatusOr<ExistenceFilter> ExistenceFilter::Read(
     absl::Span<const uint32_t> buf) {
   ExistenceFilterParams params;
@@ -172,7 +292,12 @@ absl::StatusOr<ExistenceFilter> ExistenceFilter::Read(
   } else {
     return absl::InvalidArgumentError("Invalid format: could not read header");
   }
-  buf.remove_prefix(kHeaderSize);
+  const uint32_t header_size = GetHeaderSize(params.format);
+  if (buf.size() < header_size) {
+    return absl::InvalidArgumentError(
+        "Not enough bufsize: could not read header");
+  }
+  buf.remove_prefix(header_size);
 
   VLOG(1) << "Reading bloom filter with params: " << params;
 
@@ -184,27 +309,37 @@ absl::StatusOr<ExistenceFilter> ExistenceFilter::Read(
 }
 
 ExistenceFilterBuilder ExistenceFilterBuilder::CreateOptimal(
-    size_t size_in_bytes, uint32_t estimated_insertions) {
+    size_t size_in_bytes, uint32_t estimated_insertions,
+    ExistenceFilterFormat format) {
   CHECK_LT(size_in_bytes, (1 << 29)) << "Requested size is too big";
   CHECK_GT(estimated_insertions, 0);
-  const uint32_t m = std::max<size_t>(1, size_in_bytes * 8);
-  const uint32_t n = estimated_insertions;
-
-  int optimal_k =
-      static_cast<int>((static_cast<float>(m) / n * log(2.0)) + 0.5);
-  if (optimal_k < 1) {
-    optimal_k = 1;
-  }
-  if (optimal_k > 7) {
-    optimal_k = 7;
+  uint64_t num_bits = std::max<uint64_t>(1, uint64_t{size_in_bytes} * 8);
+  if (format == ExistenceFilterFormat::kBlocked) {
+    // Rounds up to the multiple of the block size. This is done in 64 bits as
+    // it can exceed the range of uint32_t near the size limit.
+    num_bits = (num_bits + kFilterBlockBits - 1) &
+               ~uint64_t{kFilterBlockBits - 1};
+    CHECK_LE(num_bits, std::numeric_limits<uint32_t>::max())
+        << "Requested size is too big";
   }
+  const uint32_t m = static_cast<uint32_t>(num_bits);
+  const uint32_t n = estimated_insertions;
+  const int optimal_k = GetOptimalNumHashes(m, n);
 
   VLOG(1) << "optimal_k: " << optimal_k;
 
-  return ExistenceFilterBuilder({m, n, optimal_k});
+  return ExistenceFilterBuilder({m, n, optimal_k, format});
 }
 
 void ExistenceFilterBuilder::Insert(uint64_t hash) {
+  if (params_.format == ExistenceFilterFormat::kBlocked) {
+    const uint32_t block =
+        GetFilterBlockIndex(hash, params_.size >> kFilterBlockShift);
+    for (int i = 0; i < params_.num_hashes; ++i) {
+      rep_.Set((block << kFilterBlockShift) + GetBitInFilterBlock(hash, i));
+    }
+    return;
+  }
   for (int i = 0; i < params_.num_hashes; ++i) {
     hash = absl::rotl(hash, 8);
     const uint32_t index = hash % params_.size;
@@ -213,7 +348,10 @@ void ExistenceFilterBuilder::Insert(uint64_t hash) {
 }
 
 size_t ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(
-    float error_rate, size_t num_elements) {
+    float error_rate, size_t num_elements, ExistenceFilterFormat format) {
+  if (format == ExistenceFilterFormat::kBlocked) {
+    return MinBlockedFilterSizeInBytesForErrorRate(error_rate, num_elements);
+  }
   // (-num_hashes * num_elements) / log(1 - error_rate^(1/num_hashes))
 
   double min_bits = 0;
@@ -228,7 +366,8 @@ size_t ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(
 
 std::string ExistenceFilterBuilder::SerializeAsString() {
   const size_t required_bytes =
-      (kHeaderSize + BitsToWords(params_.size)) * sizeof(uint32_t);
+      (GetHeaderSize(params_.format) + BitsToWords(params_.size)) *
+      sizeof(uint32_t);
   std::string buf;
   buf.resize(required_bytes);
 
@@ -236,7 +375,13 @@ std::string ExistenceFilterBuilder::SerializeAsString() {
   // write header
   it = StoreUnaligned<uint32_t>(params_.size, it);
   it = StoreUnaligned<uint32_t>(params_.expected_nelts, it);
-  it = StoreUnaligned<uint32_t>(params_.num_hashes, it);
+  it = StoreUnaligned<uint32_t>(
+      params_.num_hashes |
+          (static_cast<uint32_t>(params_.format) << kFormatShift),
+      it);
+  it = std::fill_n(it, (GetHeaderSize(params_.format) - kHeaderSize) *
+                           sizeof(uint32_t),
+                   '\0');
   // This method is called on data generation and we can call LOG(INFO) here.
   LOG(INFO) << "Header written: " << params_;
 
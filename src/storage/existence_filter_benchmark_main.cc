@@ -0,0 +1,139 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Microbenchmark of ExistenceFilter::Exists for the modulo and the blocked
+// formats sized for the same false positive rate. The filters are read from a
+// serialized image aligned to 512 bits like the data set.
+//
+// Usage:
+//   existence_filter_benchmark_main --num_elements=1000000 --error_rate=0.00001
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/stopwatch.h"
+#include "storage/existence_filter.h"
+#include "absl/flags/flag.h"
+#include "absl/random/random.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+ABSL_FLAG(int32_t, num_elements, 1000000, "number of inserted hashes");
+ABSL_FLAG(double, error_rate, 0.00001, "target false positive rate");
+ABSL_FLAG(int32_t, num_queries, 10000000, "number of lookups per case");
+
+namespace mozc::storage {
+namespace {
+
+// A 512-bit block aligned to a cache line.
+struct alignas(64) AlignedBlock {
+  uint32_t words[16];
+};
+
+void Run(const absl::string_view name, const ExistenceFilterFormat format,
+         const std::vector<uint64_t> &inserted,
+         const std::vector<uint64_t> &queries) {
+  const size_t num_bytes =
+      ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(
+          absl::GetFlag(FLAGS_error_rate), inserted.size(), format);
+  ExistenceFilterBuilder builder = ExistenceFilterBuilder::CreateOptimal(
+      num_bytes, inserted.size(), format);
+  for (const uint64_t hash : inserted) {
+    builder.Insert(hash);
+  }
+  const std::string image = builder.SerializeAsString();
+  std::vector<AlignedBlock> blocks(
+      (image.size() + sizeof(AlignedBlock) - 1) / sizeof(AlignedBlock));
+  std::memcpy(blocks.data(), image.data(), image.size());
+  const absl::Span<const uint32_t> words(
+      reinterpret_cast<const uint32_t *>(blocks.data()),
+      image.size() / sizeof(uint32_t));
+  const ExistenceFilter filter = ExistenceFilter::Read(words).value();
+
+  size_t num_hits = 0;
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (const uint64_t hash : queries) {
+    num_hits += filter.Exists(hash);
+  }
+  stopwatch.Stop();
+  const absl::Duration absent = stopwatch.GetElapsed() / queries.size();
+
+  // Lookups of the inserted hashes check all the probes.
+  size_t num_present = 0;
+  stopwatch.Reset();
+  stopwatch.Start();
+  for (size_t i = 0; i < queries.size(); ++i) {
+    num_present += filter.Exists(inserted[i % inserted.size()]);
+  }
+  stopwatch.Stop();
+  const absl::Duration present = stopwatch.GetElapsed() / queries.size();
+  CHECK_EQ(num_present, queries.size());
+
+  // The queries are not inserted, so all the hits are false positives.
+  std::cout << absl::StrFormat(
+                   "%-8s %10d bytes  absent: %6.1f ns  present: %6.1f ns  "
+                   "false positive: %.2e",
+                   name, num_bytes, absl::ToDoubleNanoseconds(absent),
+                   absl::ToDoubleNanoseconds(present),
+                   static_cast<double>(num_hits) / queries.size())
+            << std::endl;
+}
+
+}  // namespace
+}  // namespace mozc::storage
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+
+  absl::BitGen gen;
+  std::vector<uint64_t> inserted(absl::GetFlag(FLAGS_num_elements));
+  for (uint64_t &hash : inserted) {
+    hash = absl::Uniform<uint64_t>(gen);
+  }
+  std::vector<uint64_t> queries(absl::GetFlag(FLAGS_num_queries));
+  for (uint64_t &hash : queries) {
+    hash = absl::Uniform<uint64_t>(gen);
+  }
+
+  mozc::storage::Run("modulo", mozc::storage::ExistenceFilterFormat::kModulo,
+                     inserted, queries);
+  mozc::storage::Run("blocked", mozc::storage::ExistenceFilterFormat::kBlocked,
+                     inserted, queries);
+  return 0;
+}
@@ -41,6 +41,7 @@
 #include "testing/gunit.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace storage {
@@ -134,6 +135,86 @@ TEST(ExistenceFilterTest, ReadWriteTest) {
   }
 }
 
+TEST(ExistenceFilterTest, BlockedFormat) {
+  constexpr int kNumElements = 50000;
+  constexpr float kErrorRate = 0.001;
+  const size_t num_bytes =
+      ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(
+          kErrorRate, kNumElements, ExistenceFilterFormat::kBlocked);
+  EXPECT_EQ(num_bytes % 64, 0);
+  // The blocked format needs more bits, but not too many.
+  const size_t modulo_num_bytes =
+      ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(kErrorRate,
+                                                               kNumElements);
+  EXPECT_GE(num_bytes, modulo_num_bytes);
+  EXPECT_LE(num_bytes, modulo_num_bytes * 3 / 2);
+
+  ExistenceFilterBuilder builder = ExistenceFilterBuilder::CreateOptimal(
+      num_bytes, kNumElements, ExistenceFilterFormat::kBlocked);
+  for (int i = 0; i < kNumElements; ++i) {
+    builder.Insert(Fingerprint(i * 2));
+  }
+
+  const std::string buf = builder.SerializeAsString();
+  const std::vector<uint32_t> aligned_buf = StringToAlignedBuffer(buf);
+  absl::StatusOr<ExistenceFilter> filter_read =
+      ExistenceFilter::Read(aligned_buf);
+  ASSERT_OK(filter_read);
+
+  const ExistenceFilter filter = builder.Build();
+  int false_positives = 0;
+  for (int i = 0; i < 2 * kNumElements; ++i) {
+    const uint64_t hash = Fingerprint(i);
+    const bool exists = filter.Exists(hash);
+    EXPECT_EQ(filter_read->Exists(hash), exists);
+    if (i % 2 == 0) {
+      EXPECT_TRUE(exists) << i;
+    } else if (exists) {
+      ++false_positives;
+    }
+  }
+  EXPECT_LE(false_positives, kNumElements * kErrorRate * 2);
+}
+
+TEST(ExistenceFilterTest, ReadBadHeader) {
+  ExistenceFilterBuilder builder = ExistenceFilterBuilder::CreateOptimal(
+      128, 10, ExistenceFilterFormat::kBlocked);
+  std::vector<uint32_t> buf =
+      StringToAlignedBuffer(builder.SerializeAsString());
+  ASSERT_GE(buf.size(), 3);
+  EXPECT_OK(ExistenceFilter::Read(buf));
+
+  // Unknown format.
+  std::vector<uint32_t> bad_format = buf;
+  bad_format[2] |= 0xff00;
+  EXPECT_FALSE(ExistenceFilter::Read(bad_format).ok());
+
+  // The size of the blocked format must be a multiple of the block.
+  std::vector<uint32_t> bad_size = buf;
+  bad_size[0] -= 1;
+  EXPECT_FALSE(ExistenceFilter::Read(bad_size).ok());
+}
+
+TEST(ExistenceFilterTest, BlockedHeaderIsPadded) {
+  ExistenceFilterBuilder builder = ExistenceFilterBuilder::CreateOptimal(
+      128, 10, ExistenceFilterFormat::kBlocked);
+  builder.Insert(Fingerprint(1));
+  const std::string buf = builder.SerializeAsString();
+  // 64 bytes of the header and 1024 bits of the bit vector.
+  ASSERT_EQ(buf.size(), 64 + 128);
+  EXPECT_EQ(buf.substr(12, 52), std::string(52, '\0'));
+
+  const std::vector<uint32_t> aligned_buf = StringToAlignedBuffer(buf);
+  absl::StatusOr<ExistenceFilter> filter = ExistenceFilter::Read(aligned_buf);
+  ASSERT_OK(filter);
+  EXPECT_TRUE(filter->Exists(Fingerprint(1)));
+
+  // The padding is a part of the header.
+  EXPECT_FALSE(ExistenceFilter::Read(
+                   absl::MakeConstSpan(aligned_buf).subspan(0, 15))
+                   .ok());
+}
+
 TEST(ExistenceFilterTest, InsertAndExistsTest) {
   const std::vector<std::string> words = {"a", "b", "c", "d", "e",
                                           "f", "g", "h", "i"};
@@ -139,6 +139,21 @@ class Louds {
     ++node->node_id_;
   }
 
+  // Moves the given node to its |n|-th next sibling.  If |n| is the number of
+  // the following siblings plus one, the resulting node becomes invalid, as
+  // MoveToNextSibling() does after the last sibling.
+  static void MoveToNextSibling(int n, Node *node) {
+    node->edge_index_ += n;
+    node->node_id_ += n;
+  }
+
+  // Returns the number of nodes from |node| to its last sibling, including
+  // |node| itself.  If |node| is the first child, this is the number of
+  // children of its parent.  Returns 0 if |node| is invalid.
+  int GetNumSiblingsFrom(const Node &node) const {
+    return index_.GetNumConsecutive1Bits(node.edge_index_);
+  }
+
   // Moves the given node to its unique parent.  For example, in the above
   // diagram of tree, moves are as follows:
   //   * node 2 -> node 1
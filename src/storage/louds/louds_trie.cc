@@ -31,6 +31,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 #include "base/bits.h"
 #include "base/logging.h"
@@ -41,6 +42,30 @@
 namespace mozc {
 namespace storage {
 namespace louds {
+namespace {
+
+// For shorter runs of labels, a plain loop is faster than calling memchr().
+constexpr int kMinNumLabelsForMemchr = 16;
+
+// Returns the index of |label| in labels[0, size), or |size| if not found.
+// The children of a node are consecutive in LOUDS order, so their labels form
+// a contiguous run.  memchr() is vectorized by the C library, which speeds up
+// the search over the long runs of the nodes near the root.
+int FindLabel(const char *labels, int size, char label) {
+  if (size < kMinNumLabelsForMemchr) {
+    for (int i = 0; i < size; ++i) {
+      if (labels[i] == label) {
+        return i;
+      }
+    }
+    return size;
+  }
+  const void *found = memchr(labels, label, size);
+  return found == nullptr ? size
+                          : static_cast<const char *>(found) - labels;
+}
+
+}  // namespace
 
 bool LoudsTrie::Open(const uint8_t *image, size_t louds_lb0_cache_size,
                      size_t louds_lb1_cache_size,
@@ -91,21 +116,63 @@ bool LoudsTrie::Open(const uint8_t *image, size_t louds_lb0_cache_size,
   return true;
 }
 
+void LoudsTrie::BuildJumpTable(int num_levels) {
+  jump_table_.clear();
+  // Node IDs are assigned in BFS order, so the nodes of each level have
+  // consecutive IDs, starting from the root whose ID is 1.
+  int level_begin = 1;
+  int level_end = 2;
+  for (int level = 0; level < num_levels && level_begin < level_end; ++level) {
+    int next_level_begin = level_end;
+    int next_level_size = 0;
+    for (int id = level_begin; id < level_end; ++id) {
+      Node node;
+      louds_.InitNodeFromNodeId(id, &node);
+      MoveToFirstChild(&node);
+      if (id == level_begin) {
+        next_level_begin = node.node_id();
+      }
+      const int num_children = louds_.GetNumSiblingsFrom(node);
+      uint16_t *table = &*jump_table_.insert(jump_table_.end(), 256, 0);
+      for (int i = 0; i < num_children; ++i) {
+        const uint8_t label = edge_character_[node.node_id() - 1 + i];
+        table[label] = i + 1;
+      }
+      next_level_size += num_children;
+    }
+    level_begin = next_level_begin;
+    level_end = next_level_begin + next_level_size;
+  }
+  num_jump_table_nodes_ = jump_table_.size() / 256;
+}
+
 void LoudsTrie::Close() {
   louds_.Reset();
   terminal_bit_vector_.Reset();
   edge_character_ = nullptr;
+  jump_table_.clear();
+  num_jump_table_nodes_ = 0;
 }
 
 bool LoudsTrie::MoveToChildByLabel(char label, Node *node) const {
+  const int parent_id = node->node_id();
   MoveToFirstChild(node);
-  while (IsValidNode(*node)) {
-    if (GetEdgeLabelToParentNode(*node) == label) {
+  if (parent_id <= num_jump_table_nodes_) {
+    const uint16_t entry =
+        jump_table_[(parent_id - 1) * 256 + static_cast<uint8_t>(label)];
+    if (entry != 0) {
+      Louds::MoveToNextSibling(entry - 1, node);
       return true;
     }
-    MoveToNextSibling(node);
+    // Make |node| invalid as documented.
+    Louds::MoveToNextSibling(louds_.GetNumSiblingsFrom(*node), node);
+    return false;
   }
-  return false;
+  const int num_children = louds_.GetNumSiblingsFrom(*node);
+  const int index =
+      FindLabel(edge_character_ + node->node_id() - 1, num_children, label);
+  Louds::MoveToNextSibling(index, node);
+  return index < num_children;
 }
 
 bool LoudsTrie::Traverse(absl::string_view key, Node *node) const {
@@ -32,6 +32,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include "storage/louds/louds.h"
 #include "storage/louds/simple_succinct_bit_vector_index.h"
@@ -65,6 +66,12 @@ class LoudsTrie {
 
   bool Open(const uint8_t *data) { return Open(data, 0, 0, 0, 0, 0); }
 
+  // Builds dense tables mapping an edge label to a child for the nodes in the
+  // top |num_levels| levels of the trie (1 for the root only), so that
+  // MoveToChildByLabel() from those nodes doesn't search the children.  Each
+  // node takes 512 bytes.  Must be called after Open().
+  void BuildJumpTable(int num_levels);
+
   // Destructs the internal data structure explicitly (the destructor will do
   // clean up too).
   void Close();
@@ -200,6 +207,12 @@ class LoudsTrie {
   // This array also doesn't have an entry for super root.
   // In other words, id=2 in louds_ corresponds to edge_character_[1].
   const char *edge_character_ = nullptr;
+
+  // Jump tables built by BuildJumpTable().  For a node with id < 1 +
+  // num_jump_table_nodes_, jump_table_[(id - 1) * 256 + label] is the index of
+  // the child with |label| plus one, or 0 if there's no such child.
+  std::vector<uint16_t> jump_table_;
+  int num_jump_table_nodes_ = 0;
 };
 
 }  // namespace louds
@@ -30,6 +30,7 @@
 #include "storage/louds/louds_trie.h"
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "storage/louds/louds_trie_builder.h"
@@ -528,6 +529,52 @@ TEST_P(LoudsTrieTest, RestoreKeyString) {
 }
 INSTANTIATE_TEST_CASE(GenRestoreKeyStringTest);
 
+TEST_P(LoudsTrieTest, WideNodesAndJumpTable) {
+  // The root and "a" have children for all the 256 labels, which exercises
+  // the search over long runs of labels, including those >= 0x80.
+  std::vector<std::string> keys;
+  for (int c = 0; c < 256; ++c) {
+    keys.push_back(std::string(1, static_cast<char>(c)));
+    keys.push_back(std::string("a") + static_cast<char>(c));
+    keys.push_back(std::string("b") + static_cast<char>(c) + "z");
+  }
+  keys.push_back("cd");
+  LoudsTrieBuilder builder;
+  for (const std::string &key : keys) {
+    builder.Add(key);
+  }
+  builder.Build();
+
+  const CacheSizeParam &param = GetParam();
+  for (int num_levels = 0; num_levels <= 3; ++num_levels) {
+    LoudsTrie trie;
+    trie.Open(reinterpret_cast<const uint8_t *>(builder.image().data()),
+              param.louds_lb0_cache_size, param.louds_lb1_cache_size,
+              param.louds_select0_cache_size, param.louds_select1_cache_size,
+              param.termvec_lb1_cache_size);
+    trie.BuildJumpTable(num_levels);
+    for (const std::string &key : keys) {
+      EXPECT_EQ(trie.ExactSearch(key), builder.GetId(key)) << num_levels;
+    }
+    EXPECT_EQ(trie.ExactSearch("ce"), -1);
+    EXPECT_EQ(trie.ExactSearch("dd"), -1);
+
+    // The node becomes invalid when there's no child with the label.
+    LoudsTrie::Node node;
+    ASSERT_TRUE(trie.MoveToChildByLabel('c', &node));
+    EXPECT_FALSE(trie.MoveToChildByLabel('e', &node));
+    EXPECT_FALSE(trie.IsValidNode(node));
+    node = LoudsTrie::Node();
+    ASSERT_TRUE(trie.MoveToChildByLabel('b', &node));
+    ASSERT_TRUE(trie.MoveToChildByLabel('\xff', &node));
+    EXPECT_EQ(trie.GetEdgeLabelToParentNode(node), '\xff');
+    EXPECT_FALSE(trie.MoveToChildByLabel('y', &node));
+    EXPECT_FALSE(trie.IsValidNode(node));
+    trie.Close();
+  }
+}
+INSTANTIATE_TEST_CASE(GenWideNodesAndJumpTableTest);
+
 }  // namespace
 }  // namespace louds
 }  // namespace storage
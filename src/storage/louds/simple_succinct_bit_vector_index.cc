@@ -215,6 +215,30 @@ int SimpleSuccinctBitVectorIndex::Rank1(int n) const {
   return result;
 }
 
+int SimpleSuccinctBitVectorIndex::GetNumConsecutive1Bits(int index) const {
+  int result = 0;
+  int offset = index / 8;
+  int shift = index % 8;
+  // Scan 64 bits at a time while the word fits in the data.
+  for (; offset + 8 <= length_; offset += 8, shift = 0) {
+    const uint64_t word = LoadUnaligned<uint64_t>(data_ + offset) >> shift;
+    const int ones = absl::countr_one(word);
+    if (ones < 64 - shift) {
+      return result + ones;
+    }
+    result += 64 - shift;
+  }
+  for (; offset < length_; ++offset, shift = 0) {
+    const uint8_t byte = data_[offset] >> shift;
+    const int ones = absl::countr_one(byte);
+    if (ones < 8 - shift) {
+      return result + ones;
+    }
+    result += 8 - shift;
+  }
+  return result;
+}
+
 int SimpleSuccinctBitVectorIndex::Select0(int n) const {
   DCHECK_GT(n, 0);
 
@@ -76,6 +76,10 @@ class SimpleSuccinctBitVectorIndex {
   //     76543210
   int Get(int index) const { return (data_[index / 8] >> (index % 8)) & 1; }
 
+  // Returns the number of consecutive 1-bits starting at the index, i.e., the
+  // length of the run of 1-bits beginning there (0 if the bit is 0).
+  int GetNumConsecutive1Bits(int index) const;
+
   // Returns the number of 0-bit in [0, n) bits of data.
   int Rank0(int n) const { return n - Rank1(n); }
 
@@ -32,6 +32,7 @@
 #include <cstdint>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "testing/gunit.h"
 
@@ -191,4 +192,47 @@ TEST_P(SimpleSuccinctBitVectorIndexTest, Pattern2) {
 }
 INSTANTIATE_TEST_CASE(GenPattern2Test);
 
+TEST_P(SimpleSuccinctBitVectorIndexTest, GetNumConsecutive1Bits) {
+  const CacheSizeParam &param = GetParam();
+
+  // Runs of 1-bits of lengths 0 to 99 separated by a 0-bit, crossing byte and
+  // word boundaries at various offsets.
+  std::string data;
+  std::vector<int> run_begins;
+  int num_bits = 0;
+  auto append_bit = [&](int bit) {
+    if (num_bits % 32 == 0) {
+      data.append(4, '\0');
+    }
+    data[num_bits / 8] |= bit << (num_bits % 8);
+    ++num_bits;
+  };
+  for (int length = 0; length < 100; ++length) {
+    run_begins.push_back(num_bits);
+    for (int i = 0; i < length; ++i) {
+      append_bit(1);
+    }
+    append_bit(0);
+  }
+
+  SimpleSuccinctBitVectorIndex bit_vector;
+  bit_vector.Init(reinterpret_cast<const uint8_t *>(data.data()), data.length(),
+                  param.first, param.second);
+  for (int length = 0; length < 100; ++length) {
+    const int begin = run_begins[length];
+    for (int i = 0; i <= length; ++i) {
+      EXPECT_EQ(bit_vector.GetNumConsecutive1Bits(begin + i), length - i)
+          << length << " " << i;
+    }
+  }
+
+  // A run reaching the end of the data.
+  const std::string ones(12, '\xFF');
+  bit_vector.Init(reinterpret_cast<const uint8_t *>(ones.data()), ones.length(),
+                  param.first, param.second);
+  EXPECT_EQ(bit_vector.GetNumConsecutive1Bits(0), 96);
+  EXPECT_EQ(bit_vector.GetNumConsecutive1Bits(70), 26);
+}
+INSTANTIATE_TEST_CASE(GenGetNumConsecutive1BitsTest);
+
 }  // namespace
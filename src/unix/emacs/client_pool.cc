@@ -33,6 +33,8 @@
 
 #include <memory>
 
+#include "client/client.h"
+
 namespace mozc {
 namespace emacs {
 namespace {
@@ -51,7 +53,7 @@ int ClientPool::CreateClient() {
       next_id_ = 1;  // Keep next_id_ to be a positive 28-bit integer.
     }
   }
-  lru_cache_.Insert(next_id_, std::make_shared<Client>());
+  lru_cache_.Insert(next_id_, client::ClientFactory::NewClient());
   return next_id_++;
 }
 
@@ -63,7 +65,7 @@ std::shared_ptr<ClientPool::Client> ClientPool::GetClient(int id) {
     lru_cache_.Insert(id, *value);  // Put id at the head of LRU.
     return *value;
   } else {
-    auto client_ptr = std::make_shared<Client>();
+    std::shared_ptr<Client> client_ptr = client::ClientFactory::NewClient();
     lru_cache_.Insert(id, client_ptr);
     return client_ptr;
   }
@@ -35,14 +35,14 @@
 #include <memory>
 
 #include "storage/lru_cache.h"
-#include "client/client.h"
+#include "client/client_interface.h"
 
 namespace mozc {
 namespace emacs {
 
 class ClientPool final {
  public:
-  using Client = ::mozc::client::Client;
+  using Client = ::mozc::client::ClientInterface;
 
   ClientPool();
   ClientPool(const ClientPool&) = delete;
@@ -56,7 +56,8 @@ class ClientPool final {
   void DeleteClient(int id);
 
   // Returns a Client instance.  If the specified session ID is not in this
-  // pool, creates a new Client and returns it.
+  // pool, creates a new Client and returns it.  Clients are created with
+  // client::ClientFactory.
   std::shared_ptr<Client> GetClient(int id);
 
  private:
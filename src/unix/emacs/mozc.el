@@ -324,6 +324,17 @@ the Emacs version.  `char-valid-p' is deprecated since Emacs 23."
 
 ;;;; Key event handling
 
+(defcustom mozc-send-pending-key-events-at-once t
+  "Non-nil means key events queued up are sent to Mozc server at once.
+Key events are queued up when, for example, text is pasted in a terminal or
+a keyboard macro is executed.  They are sent in a single request and only
+the final result is rendered, which makes such input much faster."
+  :type 'boolean
+  :group 'mozc)
+
+(defconst mozc-max-key-events-at-once 256
+  "Maximum number of key events sent in a single request.")
+
 (defun mozc-handle-event (event)
   "Pass all key inputs to Mozc server and render the resulting response.
 If Mozc server didn't consume a key event, try to process the key event
@@ -334,7 +345,7 @@ EVENT is the last input event, which is usually passed by the command loop."
   (cond
    ;; Keyboard event
    ((or (integerp event) (symbolp event))
-    (let ((output (mozc-send-key-event event)))
+    (let ((output (mozc-send-key-events event)))
       (cond
        ((null output)  ; Error occurred.
         (mozc-clean-up-session)  ; Discard the current session.
@@ -377,14 +388,84 @@ EVENT is the last input event, which is usually passed by the command loop."
   "Send a key event EVENT and return the resulting protobuf.
 The resulting protocol buffer, which is represented as alist, is
 mozc::commands::Output."
+  (mozc-session-sendkey (mozc-key-event-to-key-list event)))
+
+(defun mozc-send-key-events (event)
+  "Send a key event EVENT and the key events queued up after it.
+Return the resulting protobuf of the last processed key event, whose result
+is the concatenation of the results of all the processed key events.
+The key events which were not processed are pushed back on
+`unread-command-events' so the command loop handles them as usual.
+
+If no key event is queued up, this function is the same as
+`mozc-send-key-event'."
+  (let ((events (and (mozc-key-event-batchable-p event)
+                     (mozc-read-pending-key-events))))
+    (if (null events)
+        (mozc-send-key-event event)
+      (let* ((resp (mozc-session-sendkeys
+                    (mapcar #'mozc-key-event-to-key-list (cons event events))))
+             ;; EVENT is always processed unless an error occurred.
+             (num-processed (or (mozc-protobuf-get resp 'emacs-processed-keys)
+                                1)))
+        (setq unread-command-events
+              (append (nthcdr (1- num-processed) events)
+                      unread-command-events))
+        (mozc-protobuf-get resp 'output)))))
+
+(defun mozc-key-event-batchable-p (event)
+  "Return non-nil if EVENT can be sent together with other key events.
+Only characters without modifiers are sent together so that key sequences
+bound to other commands are handled by the command loop as usual."
+  (and (mozc-characterp event)
+       (null (event-modifiers event))
+       (eq (key-binding (vector event) t) #'mozc-handle-event)))
+
+(defun mozc-key-event-pending-p ()
+  "Return non-nil if a key event can be read without waiting."
+  (or unread-command-events
+      (if executing-kbd-macro
+          (< executing-kbd-macro-index (length executing-kbd-macro))
+        (input-pending-p))))
+
+(defun mozc-read-pending-key-events ()
+  "Read key events queued up and return them as a list.
+Reading stops before a key event which is not batchable.  Return nil if
+sending key events at once is disabled or not supported by the helper
+process, or while defining a keyboard macro."
+  (when (and mozc-send-pending-key-events-at-once
+             mozc-helper-process-send-keys-p
+             (not defining-kbd-macro))
+    (let ((events nil)
+          (count 1)  ; The current key event is sent together.
+          (continuep t))
+      (while (and continuep
+                  (< count mozc-max-key-events-at-once)
+                  (mozc-key-event-pending-p))
+        (let ((event (read-event nil nil 0)))
+          (cond
+           ((null event)
+            (setq continuep nil))
+           ((mozc-key-event-batchable-p event)
+            (push event events)
+            (setq count (1+ count)))
+           (t
+            ;; Leave it to the command loop.
+            (push event unread-command-events)
+            (setq continuep nil)))))
+      (nreverse events))))
+
+(defun mozc-key-event-to-key-list (event)
+  "Convert a keyboard event EVENT to a key list of `mozc-session-sendkey'.
+A character is mapped to a string by the current keymap if any."
   (let* ((key-and-modifiers (mozc-key-event-to-key-and-modifiers event))
          (key (car key-and-modifiers))
          (keymap (mozc-keymap-current-active-keymap))
          (str (and (null (cdr key-and-modifiers))
                    (mozc-keymap-get-entry keymap key))))
-    (mozc-session-sendkey (if str
-                              (list key str)
-                            key-and-modifiers))))
+    (if str
+        (list key str)
+      key-and-modifiers)))
 
 (defun mozc-key-event-to-key-and-modifiers (event)
   "Convert a keyboard event EVENT to a list of key and modifiers.
@@ -1472,11 +1553,34 @@ inserted (\"\\u3061\")."
   (when (mozc-session-create)
     (apply #'mozc-session-execute-command 'SendKey key-list)))
 
+(defun mozc-session-sendkeys (key-lists)
+  "Send key events to the helper process at once and return the response.
+The response is alist which has the number of processed key events as
+`emacs-processed-keys' and mozc::commands::Output of the last processed
+key event as `output'.  Return nil on error.
+
+KEY-LISTS is a list of KEY-LISTs of `mozc-session-sendkey'.  The helper
+process stops sending them at the first key event which Mozc server doesn't
+consume."
+  (when (mozc-session-create)
+    (apply #'mozc-session-execute-command-and-get-response
+           'SendKeys key-lists)))
+
 (defun mozc-session-execute-command (command &rest args)
   "Send a COMMAND and receive a corresponding response.
 And then return mozc::commands::Output protocol buffer as alist.
 If error occurred, return nil.
 
+ARGS must suit to a COMMAND.  See the document of the helper process."
+  (mozc-protobuf-get
+   (apply #'mozc-session-execute-command-and-get-response command args)
+   'output))
+
+(defun mozc-session-execute-command-and-get-response (command &rest args)
+  "Send a COMMAND and receive a corresponding response.
+And then return the whole response as alist.
+If error occurred, return nil.
+
 ARGS must suit to a COMMAND.  See the document of the helper process."
   (let ((seq mozc-session-seq))
     ;; Increment the seq first so that it produces another seq
@@ -1492,19 +1596,18 @@ ARGS must suit to a COMMAND.  See the document of the helper process."
              (cons mozc-session-id args)))
     ;; Check whether the session ID matches or not.
     (let* ((resp (mozc-session-recv-corresponding-response seq))
-           (session-id (cdr (assq 'emacs-session-id resp)))
-           (output (mozc-protobuf-get resp 'output)))
+           (session-id (cdr (assq 'emacs-session-id resp))))
       ;; mozc-session-id should be nil when not yet connected.
       ;; session-id is nil when an error occurred.
       (cond
        ((eq command 'CreateSession)
         (if (setq mozc-session-id session-id)
-            output
+            resp
           (mozc-abort)
           (message "mozc.el: Failed to start a new session.")
           (signal 'mozc-session-error resp)))
        ((eq session-id mozc-session-id)
-        output)
+        resp)
        ;; Otherwise, return nil.
        ))))
 
@@ -1558,6 +1661,9 @@ which doesn't understand S-expression.")
 (defvar mozc-helper-process-version nil
   "A version string of the helper process.")
 
+(defvar mozc-helper-process-send-keys-p nil
+  "Non-nil if the helper process accepts SendKeys command.")
+
 (defvar mozc-helper-process-message-queue nil
   "A list of messages sent by the helper process.")
 
@@ -1615,7 +1721,8 @@ Return non-nil on success.
 The expected greeting message is alist which includes the following keys
 at least:
 mozc-emacs-helper -- must be t
-version           -- should be version string"
+version           -- should be version string
+send-keys         -- t if SendKeys command is available (optional)"
   ;; Set mozc-helper-process temporarily and try to receive
   ;; the greeting message of the helper process.
   (let* ((mozc-helper-process proc)
@@ -1625,6 +1732,8 @@ version           -- should be version string"
                (cdr (assq 'mozc-emacs-helper resp)))
       ;; Set the optional version string.
       (setq mozc-helper-process-version (cdr (assq 'version resp)))
+      ;; Set whether SendKeys command is available.
+      (setq mozc-helper-process-send-keys-p (cdr (assq 'send-keys resp)))
       ;; Set the optional server side configuration.
       (setq mozc-config-protobuf (cdr (assq 'config resp)))
       t)))
@@ -27,6 +27,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <iostream>
@@ -40,24 +41,33 @@
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
 #include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "client/client.h"
+#include "client/client_interface.h"
 #include "unix/emacs/client_pool.h"
 #include "unix/emacs/mozc_emacs_helper_lib.h"
 
+#ifdef MOZC_IN_PROCESS_ENGINE
+#include "client/in_process_client.h"
+#endif  // MOZC_IN_PROCESS_ENGINE
+
 ABSL_FLAG(bool, suppress_stderr, false, "Discards all the output to stderr.");
+ABSL_FLAG(bool, print_all_output_fields, false,
+          "Prints all the fields of outputs, including ones mozc.el doesn't "
+          "use.");
 
 namespace mozc::emacs {
 namespace {
 
 // Prints a greeting message when a process starts.
 void PrintGreetingMessage() {
-  config::Config config;
-  config::ConfigHandler::GetConfig(&config);
+  const std::shared_ptr<const config::Config> config =
+      config::ConfigHandler::GetSharedConfig();
   absl::string_view preedit_method = "unknown";
-  switch (config.preedit_method()) {
+  switch (config->preedit_method()) {
     case config::Config::ROMAN:
       preedit_method = "roman";
       break;
@@ -66,8 +76,9 @@ void PrintGreetingMessage() {
       break;
   }
 
+  // send-keys tells mozc.el that SendKeys is available.
   absl::FPrintF(stdout,
-                "((mozc-emacs-helper . t)(version . %s)"
+                "((mozc-emacs-helper . t)(version . %s)(send-keys . t)"
                 "(config . ((preedit-method . %s))))\n",
                 QuoteString(Version::GetMozcVersion()), preedit_method);
   fflush(stdout);
@@ -76,18 +87,25 @@ void PrintGreetingMessage() {
 // Main loop, which takes an input line as a command and print a corresponding
 // result returned by Mozc server in S-expression.
 void ProcessLoop() {
+  const bool print_all_output_fields =
+      absl::GetFlag(FLAGS_print_all_output_fields);
   ClientPool client_pool;
   commands::Command command;
+  std::vector<commands::KeyEvent> keys;
   std::string line;
+  std::string output;
 
   while (std::getline(std::cin, line)) {
     command.clear_input();
     command.clear_output();
     uint32_t event_id = 0;
     uint32_t session_id = 0;
+    // The number of processed key events of SendKeys.
+    size_t num_processed = 0;
 
     // Parse an input line.
-    ParseInputLine(line, &event_id, &session_id, command.mutable_input());
+    ParseInputLine(line, &event_id, &session_id, command.mutable_input(),
+                   &keys);
 
     switch (command.input().type()) {
       case commands::Input::CREATE_SESSION:
@@ -97,10 +115,16 @@ void ProcessLoop() {
         client_pool.DeleteClient(session_id);
         break;
       case commands::Input::SEND_KEY: {
-        std::shared_ptr<client::Client> client =
+        std::shared_ptr<client::ClientInterface> client =
             client_pool.GetClient(session_id);
         CHECK(client.get());
-        if (!client->SendKey(command.input().key(), command.mutable_output())) {
+        if (!keys.empty()) {
+          num_processed = SendKeys(*client, keys, command.mutable_output());
+          if (num_processed == 0) {
+            ErrorExit(kErrSessionError, "Session failed");
+          }
+        } else if (!client->SendKey(command.input().key(),
+                                    command.mutable_output())) {
           ErrorExit(kErrSessionError, "Session failed");
         }
         break;
@@ -112,12 +136,22 @@ void ProcessLoop() {
     RemoveUsageData(command.mutable_output());
 
     // Output results.
-    std::vector<std::string> buffer;
-    PrintMessage(command.output(), &buffer);
-    const std::string output = absl::StrJoin(buffer, "");
-    absl::FPrintF(
-        stdout, "((emacs-event-id . %u)(emacs-session-id . %u)(output . %s))\n",
-        event_id, session_id, output);
+    output.clear();
+    absl::StrAppend(&output, "((emacs-event-id . ", event_id,
+                    ")(emacs-session-id . ", session_id, ")");
+    if (!keys.empty()) {
+      absl::StrAppend(&output, "(emacs-processed-keys . ", num_processed, ")");
+    }
+    output.append("(output . ");
+    if (print_all_output_fields) {
+      std::vector<std::string> buffer;
+      PrintMessage(command.output(), &buffer);
+      absl::StrAppend(&output, absl::StrJoin(buffer, ""));
+    } else {
+      PrintOutput(command.output(), &output);
+    }
+    output.append("))\n");
+    fwrite(output.data(), 1, output.size(), stdout);
     fflush(stdout);
   }
 }
@@ -141,6 +175,11 @@ int main(int argc, char **argv) {
 
   mozc::emacs::PrintGreetingMessage();
 
+#ifdef MOZC_IN_PROCESS_ENGINE
+  mozc::client::InProcessClientFactory client_factory;
+  mozc::client::ClientFactory::SetClientFactory(&client_factory);
+#endif  // MOZC_IN_PROCESS_ENGINE
+
   mozc::emacs::ProcessLoop();
 
   return 0;
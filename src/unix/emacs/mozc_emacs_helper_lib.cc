@@ -30,8 +30,10 @@
 #include "unix/emacs/mozc_emacs_helper_lib.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -39,6 +41,7 @@
 #include "base/logging.h"
 #include "base/protobuf/descriptor.h"
 #include "base/util.h"
+#include "client/client_interface.h"
 #include "composer/key_parser.h"
 #include "protocol/candidates.pb.h"
 #include "protocol/commands.pb.h"
@@ -49,12 +52,14 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace emacs {
 
 namespace {
 // forward declaration
+void ParseKeys(absl::Span<const std::string> tokens, commands::KeyEvent *key);
 void PrintField(const protobuf::Message &message,
                 const protobuf::Reflection &reflection,
                 const protobuf::FieldDescriptor &field,
@@ -76,9 +81,25 @@ void PrintFieldValue(const protobuf::Message &message,
 // like a S-expression.
 void ParseInputLine(absl::string_view line, uint32_t *event_id,
                     uint32_t *session_id, commands::Input *input) {
+  ParseInputLine(line, event_id, session_id, input, nullptr);
+}
+
+// Parses a line like the above, and also accepts a batch of key events in
+// form of:
+//     '(' EVENT_ID SendKeys SESSION_ID '(' KEY... ')'... ')'
+// where each list of KEYs is the same as the arguments of SendKey.
+// The type of 'input' is set to SEND_KEY and the key events are stored in
+// 'keys' instead of 'input'.  'keys' is cleared for the other commands.
+// SendKeys is rejected if 'keys' is nullptr.
+void ParseInputLine(absl::string_view line, uint32_t *event_id,
+                    uint32_t *session_id, commands::Input *input,
+                    std::vector<commands::KeyEvent> *keys) {
   CHECK(event_id);
   CHECK(session_id);
   CHECK(input);
+  if (keys != nullptr) {
+    keys->clear();
+  }
 
   std::vector<std::string> tokens;
   if (!TokenizeSExpr(line, &tokens) ||
@@ -94,8 +115,11 @@ void ParseInputLine(absl::string_view line, uint32_t *event_id,
 
   // Read a command.
   const std::string &func = tokens[2];
+  const bool is_batch = keys != nullptr && func == "SendKeys";
   if (func == "SendKey") {  // SendKey is a most-frequently-used command.
     input->set_type(commands::Input::SEND_KEY);
+  } else if (is_batch) {
+    input->set_type(commands::Input::SEND_KEY);
   } else if (func == "CreateSession") {
     input->set_type(commands::Input::CREATE_SESSION);
   } else if (func == "DeleteSession") {
@@ -126,7 +150,6 @@ void ParseInputLine(absl::string_view line, uint32_t *event_id,
       break;
     }
     case commands::Input::SEND_KEY: {
-      // Suppose: (EVENT_ID SendKey SESSION_ID KEY...)
       if (tokens.size() < 6) {
         ErrorExit(kErrWrongNumberOfArguments, "Wrong number of arguments");
       }
@@ -134,35 +157,27 @@ void ParseInputLine(absl::string_view line, uint32_t *event_id,
       if (!absl::SimpleAtoi(tokens[3], session_id)) {
         ErrorExit(kErrWrongTypeArgument, "Session ID is not an integer");
       }
-      // Parse keys.
-      std::vector<std::string> keys;
-      std::string key_string;
-      for (int i = 4; i < tokens.size() - 1; ++i) {
-        if (absl::ascii_isdigit(tokens[i][0])) {  // Numeric key code
-          uint32_t key_code;
-          if (!absl::SimpleAtoi(tokens[i], &key_code) || key_code > 255) {
-            ErrorExit(kErrWrongTypeArgument, "Wrong character code");
-          }
-          keys.push_back(std::string(1, static_cast<char>(key_code)));
-        } else if (tokens[i][0] == '\"') {  // String literal
-          if (!key_string.empty()) {
-            ErrorExit(kErrWrongTypeArgument, "Wrong number of key strings");
-          }
-          if (!UnquoteString(tokens[i], &key_string)) {
-            ErrorExit(kErrWrongTypeArgument, "Wrong key string literal");
-          }
-        } else {  // Key symbol
-          keys.push_back(tokens[i]);
-        }
-      }
-      if (!KeyParser::ParseKeyVector(keys, input->mutable_key()) &&
-          // If there are any unsupported key symbols, falls back to
-          // commands::KeyEvent::UNDEFINED_KEY.
-          !KeyParser::ParseKey("undefinedkey", input->mutable_key())) {
-        ABSL_UNREACHABLE();
+      const absl::Span<const std::string> args =
+          absl::MakeConstSpan(tokens).subspan(4, tokens.size() - 5);
+      if (!is_batch) {
+        // Suppose: (EVENT_ID SendKey SESSION_ID KEY...)
+        ParseKeys(args, input->mutable_key());
+        break;
       }
-      if (!key_string.empty()) {
-        input->mutable_key()->set_key_string(key_string);
+      // Suppose: (EVENT_ID SendKeys SESSION_ID (KEY...)...)
+      for (auto it = args.begin(); it != args.end();) {
+        if (*it != "(") {
+          ErrorExit(kErrWrongTypeArgument, "Key events must be lists");
+        }
+        const auto end = std::find(++it, args.end(), ")");
+        if (end == args.end() || std::find(it, end, "(") != end) {
+          ErrorExit(kErrScanError, "S expression in the wrong format");
+        }
+        if (it == end) {
+          ErrorExit(kErrWrongNumberOfArguments, "Wrong number of arguments");
+        }
+        ParseKeys(absl::MakeConstSpan(&*it, end - it), &keys->emplace_back());
+        it = end + 1;
       }
       break;
     }
@@ -171,6 +186,254 @@ void ParseInputLine(absl::string_view line, uint32_t *event_id,
   }
 }
 
+namespace {
+
+// Appends a symbol normalized as NormalizeSymbol().
+void AppendSymbol(absl::string_view symbol, std::string *buffer) {
+  for (const char c : symbol) {
+    buffer->push_back(c == '_' ? '-' : absl::ascii_tolower(c));
+  }
+}
+
+// Appends a string quoted as QuoteString().
+void AppendQuotedString(absl::string_view str, std::string *buffer) {
+  buffer->push_back('\"');
+  for (const char c : str) {
+    if (c == '\\' || c == '\"') {
+      buffer->push_back('\\');
+    }
+    buffer->push_back(c);
+  }
+  buffer->push_back('\"');
+}
+
+// The following functions print a field in the same format as PrintField().
+// 'name' must be already normalized.
+template <typename T>
+void PrintIntField(absl::string_view name, T value, std::string *buffer) {
+  absl::StrAppend(buffer, "(", name, " . ", value, ")");
+}
+
+void PrintBoolField(absl::string_view name, bool value, std::string *buffer) {
+  absl::StrAppend(buffer, "(", name, " . ", value ? "t" : "nil", ")");
+}
+
+void PrintEnumField(absl::string_view name, absl::string_view value,
+                    std::string *buffer) {
+  absl::StrAppend(buffer, "(", name, " . ");
+  AppendSymbol(value, buffer);
+  buffer->push_back(')');
+}
+
+void PrintStringField(absl::string_view name, absl::string_view value,
+                      std::string *buffer) {
+  absl::StrAppend(buffer, "(", name, " . ");
+  AppendQuotedString(value, buffer);
+  buffer->push_back(')');
+}
+
+void PrintResult(const commands::Result &result, std::string *buffer) {
+  buffer->push_back('(');
+  if (result.has_type()) {
+    PrintEnumField("type",
+                   commands::Result::ResultType_Name(result.type()), buffer);
+  }
+  if (result.has_value()) {
+    PrintStringField("value", result.value(), buffer);
+  }
+  if (result.has_key()) {
+    PrintStringField("key", result.key(), buffer);
+  }
+  if (result.has_cursor_offset()) {
+    PrintIntField("cursor-offset", result.cursor_offset(), buffer);
+  }
+  buffer->push_back(')');
+}
+
+void PrintPreedit(const commands::Preedit &preedit, std::string *buffer) {
+  buffer->push_back('(');
+  if (preedit.has_cursor()) {
+    PrintIntField("cursor", preedit.cursor(), buffer);
+  }
+  if (preedit.segment_size() > 0) {
+    buffer->append("(segment ");
+    for (const commands::Preedit::Segment &segment : preedit.segment()) {
+      buffer->push_back('(');
+      if (segment.has_annotation()) {
+        PrintEnumField(
+            "annotation",
+            commands::Preedit::Segment::Annotation_Name(segment.annotation()),
+            buffer);
+      }
+      if (segment.has_value()) {
+        PrintStringField("value", segment.value(), buffer);
+      }
+      if (segment.has_value_length()) {
+        PrintIntField("value-length", segment.value_length(), buffer);
+      }
+      if (segment.has_key()) {
+        PrintStringField("key", segment.key(), buffer);
+      }
+      buffer->push_back(')');
+    }
+    buffer->push_back(')');
+  }
+  if (preedit.has_highlighted_position()) {
+    PrintIntField("highlighted-position", preedit.highlighted_position(),
+                  buffer);
+  }
+  if (preedit.has_is_toggleable()) {
+    PrintBoolField("is-toggleable", preedit.is_toggleable(), buffer);
+  }
+  buffer->push_back(')');
+}
+
+void PrintAnnotation(const commands::Annotation &annotation,
+                     std::string *buffer) {
+  buffer->push_back('(');
+  if (annotation.has_prefix()) {
+    PrintStringField("prefix", annotation.prefix(), buffer);
+  }
+  if (annotation.has_suffix()) {
+    PrintStringField("suffix", annotation.suffix(), buffer);
+  }
+  if (annotation.has_description()) {
+    PrintStringField("description", annotation.description(), buffer);
+  }
+  if (annotation.has_shortcut()) {
+    PrintStringField("shortcut", annotation.shortcut(), buffer);
+  }
+  if (annotation.has_deletable()) {
+    PrintBoolField("deletable", annotation.deletable(), buffer);
+  }
+  if (annotation.has_a11y_description()) {
+    PrintStringField("a11y-description", annotation.a11y_description(),
+                     buffer);
+  }
+  buffer->push_back(')');
+}
+
+void PrintFooter(const commands::Footer &footer, std::string *buffer) {
+  buffer->push_back('(');
+  if (footer.has_label()) {
+    PrintStringField("label", footer.label(), buffer);
+  }
+  if (footer.has_index_visible()) {
+    PrintBoolField("index-visible", footer.index_visible(), buffer);
+  }
+  if (footer.has_logo_visible()) {
+    PrintBoolField("logo-visible", footer.logo_visible(), buffer);
+  }
+  if (footer.has_sub_label()) {
+    PrintStringField("sub-label", footer.sub_label(), buffer);
+  }
+  buffer->push_back(')');
+}
+
+// Prints candidates except for subcandidates and usages, which mozc.el
+// doesn't use.
+void PrintCandidates(const commands::Candidates &candidates,
+                     std::string *buffer) {
+  buffer->push_back('(');
+  if (candidates.has_focused_index()) {
+    PrintIntField("focused-index", candidates.focused_index(), buffer);
+  }
+  if (candidates.has_size()) {
+    PrintIntField("size", candidates.size(), buffer);
+  }
+  if (candidates.candidate_size() > 0) {
+    buffer->append("(candidate ");
+    for (const commands::Candidates::Candidate &candidate :
+         candidates.candidate()) {
+      buffer->push_back('(');
+      if (candidate.has_index()) {
+        PrintIntField("index", candidate.index(), buffer);
+      }
+      if (candidate.has_value()) {
+        PrintStringField("value", candidate.value(), buffer);
+      }
+      if (candidate.has_annotation()) {
+        buffer->append("(annotation . ");
+        PrintAnnotation(candidate.annotation(), buffer);
+        buffer->push_back(')');
+      }
+      if (candidate.has_id()) {
+        PrintIntField("id", candidate.id(), buffer);
+      }
+      if (candidate.has_information_id()) {
+        PrintIntField("information-id", candidate.information_id(), buffer);
+      }
+      buffer->push_back(')');
+    }
+    buffer->push_back(')');
+  }
+  if (candidates.has_position()) {
+    PrintIntField("position", candidates.position(), buffer);
+  }
+  if (candidates.has_category()) {
+    PrintEnumField("category", commands::Category_Name(candidates.category()),
+                   buffer);
+  }
+  if (candidates.has_display_type()) {
+    PrintEnumField("display-type",
+                   commands::DisplayType_Name(candidates.display_type()),
+                   buffer);
+  }
+  if (candidates.has_footer()) {
+    buffer->append("(footer . ");
+    PrintFooter(candidates.footer(), buffer);
+    buffer->push_back(')');
+  }
+  if (candidates.has_direction()) {
+    PrintEnumField(
+        "direction",
+        commands::Candidates::Direction_Name(candidates.direction()), buffer);
+  }
+  if (candidates.has_page_size()) {
+    PrintIntField("page-size", candidates.page_size(), buffer);
+  }
+  buffer->push_back(')');
+}
+
+}  // namespace
+
+// Prints the fields of commands::Output used by mozc.el in S-expression.
+// The format is the same as PrintMessage() but the other fields are omitted.
+// This function doesn't use reflection and appends the S-expression to
+// 'buffer' directly.
+void PrintOutput(const commands::Output &output, std::string *buffer) {
+  DCHECK(buffer);
+
+  buffer->push_back('(');
+  if (output.has_id()) {
+    // 64-bit integers are printed as strings.  See PrintFieldValue().
+    absl::StrAppend(buffer, "(id . \"", output.id(), "\")");
+  }
+  if (output.has_mode()) {
+    PrintEnumField("mode", commands::CompositionMode_Name(output.mode()),
+                   buffer);
+  }
+  if (output.has_consumed()) {
+    PrintBoolField("consumed", output.consumed(), buffer);
+  }
+  if (output.has_result()) {
+    buffer->append("(result . ");
+    PrintResult(output.result(), buffer);
+    buffer->push_back(')');
+  }
+  if (output.has_preedit()) {
+    buffer->append("(preedit . ");
+    PrintPreedit(output.preedit(), buffer);
+    buffer->push_back(')');
+  }
+  if (output.has_candidates()) {
+    buffer->append("(candidates . ");
+    PrintCandidates(output.candidates(), buffer);
+    buffer->push_back(')');
+  }
+  buffer->push_back(')');
+}
+
 // Prints the content of a protocol buffer in S-expression.
 // - 'message' and 'group' are mapped to alist (associative list)
 // - 'repeated' is expressed as a list
@@ -195,6 +458,63 @@ void PrintMessage(const protobuf::Message &message,
   output->push_back(")");
 }
 
+// Sends key events one by one and stores the merged output into 'output'.
+// Sending stops at the first key event which the server doesn't consume, and
+// after a key event whose output requests an action of the client.
+// Returns the number of processed key events, or 0 on error.
+size_t SendKeys(client::ClientInterface &client,
+                absl::Span<const commands::KeyEvent> keys,
+                commands::Output *output) {
+  DCHECK(output);
+  DCHECK(!keys.empty());
+
+  output->Clear();
+  std::optional<commands::Result> result;
+  commands::Output key_output;
+  size_t num_processed = 0;
+  for (const commands::KeyEvent &key : keys) {
+    key_output.Clear();
+    if (!client.SendKey(key, &key_output)) {
+      return 0;
+    }
+    if (!key_output.consumed()) {
+      if (num_processed == 0) {
+        // Returns the output as is so that the caller can handle the first
+        // key event as SendKey.
+        output->Swap(&key_output);
+        return 1;
+      }
+      // The server doesn't change its state for an unconsumed key event, so
+      // the caller can send it again by itself.
+      break;
+    }
+    if (key_output.has_result()) {
+      if (!result.has_value()) {
+        result = key_output.result();
+      } else {
+        // Concatenates the committed strings.
+        result->mutable_value()->append(key_output.result().value());
+        result->mutable_key()->append(key_output.result().key());
+        result->set_cursor_offset(key_output.result().cursor_offset());
+        result->clear_tokens();
+      }
+    }
+    output->Swap(&key_output);
+    ++num_processed;
+    // These fields are not merged. The output which has them is returned as
+    // the last one so that the client can handle them.
+    if (output->has_callback() || output->has_deletion_range() ||
+        output->has_launch_tool_mode()) {
+      break;
+    }
+  }
+
+  if (result.has_value()) {
+    *output->mutable_result() = *std::move(result);
+  }
+  return num_processed;
+}
+
 // Utilities
 
 // Normalizes a symbol with the following rules:
@@ -390,6 +710,40 @@ bool RemoveUsageData(commands::Output *output) {
 
 namespace {
 
+// Parses key tokens of SendKey, which are key codes, key symbols and
+// an optional string literal, into 'key'.
+void ParseKeys(absl::Span<const std::string> tokens, commands::KeyEvent *key) {
+  std::vector<std::string> keys;
+  std::string key_string;
+  for (const std::string &token : tokens) {
+    if (absl::ascii_isdigit(token[0])) {  // Numeric key code
+      uint32_t key_code;
+      if (!absl::SimpleAtoi(token, &key_code) || key_code > 255) {
+        ErrorExit(kErrWrongTypeArgument, "Wrong character code");
+      }
+      keys.push_back(std::string(1, static_cast<char>(key_code)));
+    } else if (token[0] == '\"') {  // String literal
+      if (!key_string.empty()) {
+        ErrorExit(kErrWrongTypeArgument, "Wrong number of key strings");
+      }
+      if (!UnquoteString(token, &key_string)) {
+        ErrorExit(kErrWrongTypeArgument, "Wrong key string literal");
+      }
+    } else {  // Key symbol
+      keys.push_back(token);
+    }
+  }
+  if (!KeyParser::ParseKeyVector(keys, key) &&
+      // If there are any unsupported key symbols, falls back to
+      // commands::KeyEvent::UNDEFINED_KEY.
+      !KeyParser::ParseKey("undefinedkey", key)) {
+    ABSL_UNREACHABLE();
+  }
+  if (!key_string.empty()) {
+    key->set_key_string(key_string);
+  }
+}
+
 // Prints one entry of a protocol buffer in S-expression.
 // An entry is a cons cell of key and value.
 //
@@ -30,14 +30,17 @@
 #ifndef MOZC_UNIX_EMACS_MOZC_EMACS_HELPER_LIB_H_
 #define MOZC_UNIX_EMACS_MOZC_EMACS_HELPER_LIB_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
 
 #include "base/protobuf/message.h"
 #include "base/protobuf/protobuf.h"
+#include "client/client_interface.h"
 #include "protocol/commands.pb.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace emacs {
@@ -66,6 +69,31 @@ inline constexpr absl::string_view kErrSessionError = "session-error";
 void ParseInputLine(absl::string_view line, uint32_t *event_id,
                     uint32_t *session_id, mozc::commands::Input *input);
 
+// Parses a line like the above, and also accepts a batch of key events in
+// form of:
+//     '(' EVENT_ID SendKeys SESSION_ID '(' KEY... ')'... ')'
+// where each list of KEYs is the same as the arguments of SendKey.
+// The type of 'input' is set to SEND_KEY and the key events are stored in
+// 'keys' instead of 'input'.  'keys' is cleared for the other commands.
+// SendKeys is rejected if 'keys' is nullptr.
+void ParseInputLine(absl::string_view line, uint32_t *event_id,
+                    uint32_t *session_id, mozc::commands::Input *input,
+                    std::vector<mozc::commands::KeyEvent> *keys);
+
+// Sends key events one by one and stores the merged output into 'output'.
+// Sending stops at the first key event which the server doesn't consume so
+// that the caller can handle it and the rest of the key events by itself.
+// Sending also stops after a key event whose output has callback,
+// deletion_range or launch_tool_mode, as they are not merged.
+// 'output' is the output of the last processed key event, and its result is
+// the concatenation of all the results of the processed key events.  If the
+// first key event is not consumed, 'output' is the output of the key event
+// and it is counted as processed.  'keys' must not be empty.
+// Returns the number of processed key events, or 0 on error.
+size_t SendKeys(mozc::client::ClientInterface &client,
+                absl::Span<const mozc::commands::KeyEvent> keys,
+                mozc::commands::Output *output);
+
 // Prints the content of a protocol buffer in S-expression.
 // - 'message' and 'group' are mapped to alist (associative list)
 // - 'repeated' is expressed as a list
@@ -78,6 +106,13 @@ void ParseInputLine(absl::string_view line, uint32_t *event_id,
 void PrintMessage(const mozc::protobuf::Message &message,
                   std::vector<std::string> *output);
 
+// Prints the fields of commands::Output used by mozc.el in S-expression.
+// The format is the same as PrintMessage() but the other fields, e.g. key,
+// status and all_candidate_words, are omitted.  Unlike PrintMessage(), this
+// function doesn't use reflection and appends the S-expression to 'buffer'
+// directly.
+void PrintOutput(const mozc::commands::Output &output, std::string *buffer);
+
 // Utilities
 
 // Normalizes a symbol with the following rule:
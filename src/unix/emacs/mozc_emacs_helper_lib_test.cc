@@ -34,6 +34,7 @@
 #include <vector>
 
 #include "base/protobuf/message.h"
+#include "client/client_mock.h"
 #include "protocol/candidates.pb.h"
 #include "protocol/commands.pb.h"
 #include "testing/gmock.h"
@@ -48,6 +49,7 @@ namespace {
 
 using ::testing::ElementsAreArray;
 using ::testing::IsEmpty;
+using ::testing::Return;
 
 class MozcEmacsHelperLibTest : public ::testing::Test {
  protected:
@@ -223,6 +225,160 @@ TEST_F(MozcEmacsHelperLibTest, PrintMessage) {
                     "(modifier-keys key-down shift))))");
 }
 
+TEST_F(MozcEmacsHelperLibTest, ParseInputLineWithBatch) {
+  uint32_t event_id = 0;
+  uint32_t session_id = 0;
+  commands::Input input;
+  std::vector<commands::KeyEvent> keys;
+  ParseInputLine("(14 SendKeys 12 (97) (return shift) (72 \"Hello\"))",
+                 &event_id, &session_id, &input, &keys);
+  EXPECT_EQ(event_id, 14);
+  EXPECT_EQ(session_id, 12);
+  EXPECT_PROTO_EQ("type: SEND_KEY", input);
+  ASSERT_EQ(keys.size(), 3);
+  EXPECT_PROTO_EQ("key_code: 97", keys[0]);
+  EXPECT_PROTO_EQ("special_key: ENTER modifier_keys: SHIFT", keys[1]);
+  EXPECT_PROTO_EQ("key_code: 72 key_string: \"Hello\"", keys[2]);
+
+  // SendKey doesn't use the batch.
+  input.Clear();
+  ParseInputLine("(15 SendKey 12 97)", &event_id, &session_id, &input, &keys);
+  EXPECT_PROTO_EQ("type: SEND_KEY key { key_code: 97 }", input);
+  EXPECT_THAT(keys, IsEmpty());
+}
+
+TEST_F(MozcEmacsHelperLibTest, SendKeys) {
+  client::ClientMock client;
+  std::vector<commands::KeyEvent> keys(3);
+  keys[0].set_key_code('a');
+  keys[1].set_special_key(commands::KeyEvent::ENTER);
+  keys[2].set_key_code('b');
+
+  auto set_output = [](bool consumed, absl::string_view result) {
+    return [=](const commands::KeyEvent &key, const commands::Context &context,
+               commands::Output *output) {
+      output->set_consumed(consumed);
+      if (!result.empty()) {
+        output->mutable_result()->set_type(commands::Result::STRING);
+        output->mutable_result()->set_value(result);
+      }
+      return true;
+    };
+  };
+
+  {
+    SCOPED_TRACE("The results of all the key events are concatenated.");
+    EXPECT_CALL(client, SendKeyWithContext)
+        .WillOnce(set_output(true, "A"))
+        .WillOnce(set_output(true, ""))
+        .WillOnce(set_output(true, "B"));
+    commands::Output output;
+    EXPECT_EQ(SendKeys(client, keys, &output), 3);
+    EXPECT_TRUE(output.consumed());
+    EXPECT_EQ(output.result().value(), "AB");
+  }
+  {
+    SCOPED_TRACE("Stops at the key event which is not consumed.");
+    EXPECT_CALL(client, SendKeyWithContext)
+        .WillOnce(set_output(true, "A"))
+        .WillOnce(set_output(false, ""));
+    commands::Output output;
+    EXPECT_EQ(SendKeys(client, keys, &output), 1);
+    EXPECT_TRUE(output.consumed());
+    EXPECT_EQ(output.result().value(), "A");
+  }
+  {
+    SCOPED_TRACE("The first key event is processed even if not consumed.");
+    EXPECT_CALL(client, SendKeyWithContext).WillOnce(set_output(false, ""));
+    commands::Output output;
+    EXPECT_EQ(SendKeys(client, keys, &output), 1);
+    EXPECT_FALSE(output.consumed());
+  }
+  {
+    SCOPED_TRACE("Stops after the output which has a deletion range.");
+    EXPECT_CALL(client, SendKeyWithContext)
+        .WillOnce(set_output(true, "A"))
+        .WillOnce([](const commands::KeyEvent &key,
+                     const commands::Context &context,
+                     commands::Output *output) {
+          output->set_consumed(true);
+          output->mutable_deletion_range()->set_offset(-1);
+          output->mutable_deletion_range()->set_length(1);
+          return true;
+        });
+    commands::Output output;
+    EXPECT_EQ(SendKeys(client, keys, &output), 2);
+    EXPECT_EQ(output.result().value(), "A");
+    EXPECT_EQ(output.deletion_range().offset(), -1);
+  }
+  {
+    SCOPED_TRACE("Returns 0 on error.");
+    EXPECT_CALL(client, SendKeyWithContext)
+        .WillOnce(set_output(true, "A"))
+        .WillOnce(Return(false));
+    commands::Output output;
+    EXPECT_EQ(SendKeys(client, keys, &output), 0);
+  }
+}
+
+TEST_F(MozcEmacsHelperLibTest, PrintOutput) {
+  commands::Output output;
+  output.set_id(1234);
+  output.set_mode(commands::FULL_ASCII);
+  output.set_consumed(true);
+  commands::Result *result = output.mutable_result();
+  result->set_type(commands::Result::STRING);
+  result->set_value("\"RESULT\\STRING\"");
+  result->set_key("KEY");
+  result->set_cursor_offset(-1);
+  commands::Preedit *preedit = output.mutable_preedit();
+  preedit->set_cursor(1);
+  commands::Preedit::Segment *segment = preedit->add_segment();
+  segment->set_annotation(commands::Preedit::Segment::UNDERLINE);
+  segment->set_value("なし");
+  segment->set_value_length(2);
+  segment = preedit->add_segment();
+  segment->set_annotation(commands::Preedit::Segment::HIGHLIGHT);
+  segment->set_value("UNDER_LINE");
+  segment->set_value_length(10);
+  segment->set_key("KEY");
+  preedit->set_highlighted_position(0);
+  preedit->set_is_toggleable(false);
+  commands::Candidates *candidates = output.mutable_candidates();
+  candidates->set_focused_index(1);
+  candidates->set_size(2);
+  for (int i = 0; i < 2; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_value(absl::StrCat("候補", i));
+    candidate->set_id(-i);
+    candidate->mutable_annotation()->set_description("説明");
+    candidate->mutable_annotation()->set_shortcut(absl::StrCat(i + 1));
+    candidate->mutable_annotation()->set_deletable(true);
+  }
+  candidates->set_position(0);
+  candidates->set_category(commands::PREDICTION);
+  candidates->set_display_type(commands::MAIN);
+  candidates->mutable_footer()->set_index_visible(true);
+  candidates->mutable_footer()->set_label("LABEL");
+  candidates->set_direction(commands::Candidates::VERTICAL);
+  candidates->set_page_size(9);
+
+  // PrintOutput() must print the same S-expression as PrintMessage().
+  std::string sexpr;
+  PrintOutput(output, &sexpr);
+  PrintAndTestSexpr(output, sexpr);
+
+  // Fields which mozc.el doesn't use are omitted.
+  commands::Output full_output = output;
+  full_output.mutable_key()->set_key_code(97);
+  full_output.mutable_all_candidate_words()->set_focused_index(1);
+  full_output.mutable_candidates()->mutable_subcandidates()->set_size(1);
+  sexpr.clear();
+  PrintOutput(full_output, &sexpr);
+  PrintAndTestSexpr(output, sexpr);
+}
+
 TEST_F(MozcEmacsHelperLibTest, NormalizeSymbol) {
   EXPECT_EQ(NormalizeSymbol("PAGE_UP"), "page-up");
   EXPECT_EQ(NormalizeSymbol("PAGE_DOWN"), "page-down");
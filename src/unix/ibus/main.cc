@@ -43,6 +43,11 @@
 #include "unix/ibus/path_util.h"
 #include "absl/flags/flag.h"
 
+#ifdef MOZC_IN_PROCESS_ENGINE
+#include "client/client.h"
+#include "client/in_process_client.h"
+#endif  // MOZC_IN_PROCESS_ENGINE
+
 ABSL_FLAG(bool, ibus, false, "The engine is started by ibus-daemon");
 ABSL_FLAG(bool, xml, false, "Output xml data for the engine.");
 
@@ -117,6 +122,11 @@ void OutputXml() {
 }
 
 void RunIbus() {
+#ifdef MOZC_IN_PROCESS_ENGINE
+  // Must outlive `engine`, which creates its client with ClientFactory.
+  client::InProcessClientFactory client_factory;
+  client::ClientFactory::SetClientFactory(&client_factory);
+#endif  // MOZC_IN_PROCESS_ENGINE
   IbusWrapper::Init();
   IbusBusWrapper bus;
   MozcEngine engine;
@@ -53,6 +53,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "client/client.h"
+#include "renderer/async_renderer_client.h"
 #include "renderer/renderer_client.h"
 #include "unix/ibus/candidate_window_handler.h"
 #include "unix/ibus/engine_registrar.h"
@@ -233,7 +234,8 @@ MozcEngine::MozcEngine()
       client_(CreateAndConfigureClient()),
       preedit_handler_(new PreeditHandler()),
       use_mozc_candidate_window_(false),
-      mozc_candidate_window_handler_(new renderer::RendererClient()),
+      mozc_candidate_window_handler_(new renderer::AsyncRendererClient(
+          std::make_unique<renderer::RendererClient>())),
       preedit_method_(config::Config::ROMAN) {
   ibus_config_.Initialize();
   use_mozc_candidate_window_ = UseMozcCandidateWindow(ibus_config_);